@@ -9,13 +9,63 @@
  *
  */
 
-#include <conio.h>
+/**
+ * @brief
+ * õ POSIX 볣 clock_gettime  CLOCK_MONOTONIC  fileno
+ * ȣʹ -std=c11 Ҳܱ룬 GNU ԵĬáʱ
+ * syscall Ҫ _DEFAULT_SOURCE 
+ *
+ */
+#define _POSIX_C_SOURCE 200809L
+#if defined(LIFE_PROFILE) && defined(__linux__)
+#define _DEFAULT_SOURCE
+#endif
+
+#include <assert.h>
+#include <errno.h>
 #include <math.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
+#ifdef _WIN32
+#include <conio.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <termios.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+/**
+ * @brief ֧ x86 SIMD ָʱѡ SSE4.1  AVX2 ںˡ
+ *
+ */
+#define SIMD_X86
+#endif
+
+#if defined(LIFE_PROFILE) && defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+/**
+ * @brief  LIFE_PROFILE ϵͳṩ perf_event_open ɶȡӲ
+ *
+ */
+#define PROF_HW
+#endif
+
 /**
  * @brief ַ󳤶ȡ
  *
@@ -23,10 +73,302 @@
 #define LEN 1024
 
 /**
- * @brief ͼ󳤿
+ * @brief ͼ󳤿ڷֹʵܼصĴСɿڴ
+ *
+ */
+#define KMAX (1 << 30)
+
+/**
+ * @brief ͼڴĶֽ뻺дСһ¡
+ *
+ */
+#define ALIGN 64
+
+/**
+ * @brief ߳ޡ
+ *
+ */
+#define TMAX 256
+
+/**
+ * @brief λ棺ŵͼͼϸΪ
+ *
+ */
+#define ENGINE_BITWISE 0
+
+/**
+ * @brief HashLife 棺Ĳӽ棬ͼΪƽ档
+ *
+ */
+#define ENGINE_HASHLIFE 1
+
+/**
+ * @brief 棺ÿβõ 2x2 ϸһͼϸΪӡ
+ *
+ */
+#define ENGINE_LUT 2
+
+/**
+ * @brief HashLife սڵţʾ޻
+ *
+ */
+#define HL_NONE 0xffffffffu
+
+/**
+ * @brief HashLife ڵޣղʹõĽڵ뻺档
+ *
+ */
+#define HL_LIMIT (1u << 22)
+
+/**
+ * @brief ϡģʽÿΪһ֣ 64x64 ϸ
+ *
+ */
+#define TILE 64
+
+/**
+ * @brief ߽ϸΪ
+ *
+ */
+#define BOUNDARY_DEAD 0
+
+/**
+ * @brief ƽ棬ͼֻƽϵһڡ
+ *
+ */
+#define BOUNDARY_INFINITE 1
+
+/**
+ * @brief 棬¡ӡ
+ *
+ */
+#define BOUNDARY_TORUS 2
+
+/**
+ * @brief ƽÿı߳ÿǡһ֡
+ *
+ */
+#define CHUNK 64
+
+/**
+ * @brief ƽÿη
+ *
+ */
+#define CHUNK_BLOCK 1024
+
+/**
+ * @brief ƽбʾ顱ıš
+ *
+ */
+#define PL_NONE 0xffffffffu
+
+/**
+ * @brief ȡͼļʱÿζֽ
+ *
+ */
+#define RD_BLOCK (1 << 22)
+
+/**
+ * @brief ȡÿ֮ǰ֤ʣֽʹԽ߽硣
+ *
+ */
+#define RD_MARGIN 128
+
+/**
+ * @brief ƿļͷ 8 ֽڱʶ
+ *
+ */
+#define SNAP_MAGIC "LIFESNAP"
+
+/**
+ * @brief ƿոʽ汾š
+ *
+ */
+#define SNAP_VERSION 1
+
+/**
+ * @brief ׼ÿе
+ *
+ */
+#define BENCH_TIME 0.25
+
+/**
+ * @brief ɼڣʷĴ
+ *
+ */
+#define HISTORY 1024
+
+/**
+ * @brief
+ * fast_forward  infinite ߽¸ HashLife ٴʱת뽨Ŀֲ棬㡣
+ *
+ */
+#define JUMP_MIN 1024
+
+/**
+ * @brief
+ * һɵĴ HashLife ǰ 2  j ηҪڵ j + 3 㣬ͼ󣬶
+ * hl_empty ֻ 63 㣻ȡ 2  58 η
+ *
+ */
+#define GENS_MAX (1ll << 58)
+
+/**
+ * @brief ʷΪ 2 ݡ
+ *
+ */
+#define HISTORY_SLOTS 4096
+
+/**
+ * @brief ʷÿβһ̽
+ *
+ */
+#define HISTORY_PROBE 16
+
+/**
+ * @brief 彻λбʾ֡ı־λ
+ *
+ */
+#define FRAME_FRESH 4
+
+/**
+ * @brief read_key ڱ׼ʱķֵ볬ʱ -1 ֡
+ *
+ */
+#define KEY_EOF -2
+
+/**
+ * @brief ֲÿŵͼеĴ
+ *
+ */
+#define CHECK_GENS 64
+
+/**
+ * @brief ֲгʱеĴ
+ *
+ */
+#define CHECK_LONG 2000
+
+/**
+ * @brief ԶģʽʾʽͼŵʱʾäַСʾ
+ *
+ */
+#define VIEW_AUTO 0
+
+/**
+ * @brief ʾÿϸռ GLYPH_W С
+ *
+ */
+#define VIEW_CELLS 1
+
+/**
+ * @brief äַʾÿַ 4  2 ϸ
+ *
+ */
+#define VIEW_BRAILLE 2
+
+/**
+ * @brief
+ * ʾʱÿϸżһոնռ GBK ̨   
+ * ΪȫַռС
+ *
+ */
+#ifdef _WIN32
+#define GLYPH_W 3
+#else
+#define GLYPH_W 2
+#endif
+
+/**
+ * @brief ʱ׶ΣеˮƽͣھӼ
+ *
+ */
+#define PROF_SUM 0
+
+/**
+ * @brief ʱ׶ΣкͰһĲҲ˽׶Σ
+ *
+ */
+#define PROF_RULE 1
+
+/**
+ * @brief ʱ׶Σһ generate_next_status ȫ
+ *
+ */
+#define PROF_STEP 2
+
+/**
+ * @brief ʱ׶ΣӡͼԶģʽһ֡
+ *
+ */
+#define PROF_RENDER 3
+
+/**
+ * @brief ʱ׶Σصͼļ
+ *
+ */
+#define PROF_LOAD 4
+
+/**
+ * @brief ʱ׶Σͼļ
+ *
+ */
+#define PROF_SAVE 5
+
+/**
+ * @brief ʱ׶
+ *
+ */
+#define PROF_PHASES 6
+
+/**
+ * @brief
+ * ھӼ֮Ĳ֣ϣͳƣʾֻڰʱ
+ *
+ */
+#define PROF_REST PROF_PHASES
+
+/**
+ * @brief
+ * ÿÿУΪٴ lut_rows ϸּʱһУΪ 2 ݡвʱӡ
+ *
+ */
+#define PROF_EVERY 64
+
+/**
+ * @brief ȡӲָδ֧Ԥʧ
+ *
+ */
+#define PROF_EVENTS 3
+
+/**
+ * @brief
+ * ȵ·ʱʱ LIFE_PROFILE Ч¸չΪգκδ롣
+ * жʱӵĿխͼϻᳬĹֻʱһΣ PROF_START 
+ * PROF_BAND ÿ PROF_EVERY  PROF_SAMPLE ѡһУ PROF_LAP
+ * ϸΪھӼಿ֣ʱЩеıֵ׶Ρ
+ * PROF_ENTER  PROF_LEAVE סϴֵĽ׶ΣͬʱȡӲ
  *
  */
-#define KMAX 120
+#ifdef LIFE_PROFILE
+#define PROF_INIT() prof_init()
+#define PROF_START(t) double t = now_seconds()
+#define PROF_SAMPLE(t, k)                                                      \
+  int t##_on = (k) % PROF_EVERY == 0;                                          \
+  double t = t##_on ? now_seconds() : 0
+#define PROF_LAP(id, phase, t) (t##_on ? prof_lap(id, phase, &t) : (void)0)
+#define PROF_BAND(id, t, rows, cells) prof_band(id, t, rows, cells)
+#define PROF_ENTER(phase) prof_enter(phase)
+#define PROF_LEAVE(phase, cells) prof_leave(phase, cells)
+#else
+#define PROF_INIT()
+#define PROF_START(t)
+#define PROF_SAMPLE(t, k)
+#define PROF_LAP(id, phase, t)
+#define PROF_BAND(id, t, rows, cells)
+#define PROF_ENTER(phase)
+#define PROF_LEAVE(phase, cells)
+#endif
 
 #define HELP "\\h"
 #define LOAD "\\l"
@@ -34,9 +376,18 @@
 #define DESIGN "\\d"
 #define GENERATE "\\g"
 #define RUN "\\r"
-#define EXIT "\\e"
 #define QUIT "\\q"
 #define PRINT "\\p"
+#define ENGINE "\\engine"
+#define SPARSE "\\sparse"
+#define DETECT "\\detect"
+#define BOUNDARY "\\boundary"
+#define VIEW "\\view"
+#define RULE "\\rule"
+#define SPEED "\\speed"
+#define FPS "\\fps"
+#define STATS "\\stats"
+#define PROF "\\prof"
 #define END "end"
 #define EMPTY ""
 
@@ -52,6 +403,30 @@ int row = 0;
  */
 int col = 0;
 
+/**
+ * @brief ͼÿʵʹõ 64 λÿִ 64 ϸһλһϸ
+ *
+ */
+int words = 0;
+
+/**
+ * @brief ͼÿڴеΪ words Ҹһ߿֡
+ *
+ */
+int stride = 0;
+
+/**
+ * @brief ͼڴ׵ַͼһкͻӴ򻮷֡
+ *
+ */
+uint64_t *arena = NULL;
+
+/**
+ * @brief ͼڴǰֽڣֻڼظĵͼʱ·䡣
+ *
+ */
+size_t arena_size = 0;
+
 /**
  * @brief ǣжϳǷеͼ
  *
@@ -59,272 +434,6256 @@ int col = 0;
 int is_map = 0;
 
 /**
- * @brief ȫֵͼ顣
+ * @brief
+ * ȫֵͼλ洢 i е j ϸΪ row_ptr(map, i)[j / 64] ĵ j % 64
+ * λÿг col ĶλΪ 0ܸһȦ߿¸һУҸһ֣߿ϸΪʹʱжϱ߽硣
  *
  */
-int map[KMAX][KMAX];
+uint64_t *map = NULL;
 
 /**
- * @brief ڴϸ
+ * @brief
+ * һϸͼ壬Сͼͬʱֱд˴ɺ map
+ * ָ룬Ϊǰͼ
  *
  */
-int alive_neighbors[KMAX][KMAX];
+uint64_t *next_map = NULL;
 
-void get_input(char *);
-
-void help(void);
+/**
+ * @brief 壬һ֡һεͼƴúһ write д
+ *
+ */
+char *out_buf = NULL;
 
-void welcome(void);
+/**
+ * @brief еֽ
+ *
+ */
+size_t out_len = 0, out_cap = 0;
 
-void get_command(char *, char *, char *);
+/**
+ * @brief Զģʽʾʽ VIEW_AUTO  VIEW_CELLS  VIEW_BRAILLE 
+ *
+ */
+int view_mode = VIEW_AUTO;
 
-void load_map(char *);
+/**
+ * @brief ӿϽϸС
+ *
+ */
+int view_row = 0, view_col = 0;
 
-void save_map(char *);
+/**
+ * @brief ԶģʽÿɵĴ 0 ʾٶȡ
+ *
+ */
+double sim_speed = 10;
 
-void convert_lower_case(char *);
+/**
+ * @brief ԶģʽÿػĴɵٶ޹ء
+ *
+ */
+double frame_rate = 30;
 
-void generate_next_status(void);
+/**
+ * @brief
+ * նÿַλõǰʾݣʾʱΪϸ״̬äʾʱΪλ-1
+ * ʾδ֪һֻ֡ػ˲ַͬ
+ *
+ */
+int16_t *screen = NULL;
 
-void print_map(void);
+/**
+ * @brief screen 
+ *
+ */
+size_t screen_cap = 0;
 
-void design_map(void);
+/**
+ * @brief screen Ƿնһ£ԼӦʾʽӿС
+ *
+ */
+int screen_valid = 0, screen_braille = 0, screen_r0 = 0, screen_c0 = 0,
+    screen_rows = 0, screen_cols = 0;
 
-void auto_run(void);
+/**
+ * @brief ǰͼĴıʽʱΪ 0 ƿձ沢ֵָ
+ *
+ */
+long long generation = 0;
 
-void is_map_error(void);
+/**
+ * @brief
+ * дʱƷʽӳ䵽ڴĶƿļغ map ֱָеĵͼ֡һɺһ廻ڴӳ䡣
+ *
+ */
+void *snapshot = NULL;
 
-int main() {
-  system("cls");
+/**
+ * @brief ӳֽ
+ *
+ */
+size_t snapshot_size = 0;
+
+/**
+ * @brief
+ * кͻ壬ÿ̸߳һݣÿУеĺ͡ÿλƽ棬ֱΪ͵ĵλλ
+ *
+ */
+uint64_t *row_sums = NULL;
+
+/**
+ * @brief ǰͼеĹϣͼϣ board_hash Ϊǵ
+ *
+ */
+uint64_t *row_hash = NULL;
+
+/**
+ * @brief ÿ̵߳кͻж̼߳α
+ *
+ */
+size_t sums_stride = 0;
+
+/**
+ * @brief ʱʹọ̃߳߳ʱвָ
+ *
+ */
+int threads = 1;
+
+/**
+ * @brief ̣߳ threads - 1 ʱ֮ÿá
+ *
+ */
+pthread_t *workers = NULL;
+
+/**
+ * @brief ̳߳صǰҪִе񣬲Ϊ̱߳šΪ NULL ʱ߳˳
+ *
+ */
+void (*pool_job)(int) = NULL;
+
+/**
+ * @brief ̳߳ϵĻ
+ *
+ */
+pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief ̳߳ϵ
+ *
+ */
+pthread_cond_t pool_cond = PTHREAD_COND_INITIALIZER;
+
+/**
+ * @brief ѵϵ߳
+ *
+ */
+int pool_count = 0;
+
+/**
+ * @brief ִΣÿȫ̵߳ʱһ
+ *
+ */
+unsigned pool_phase = 0;
+
+/**
+ * @brief ϡģʽءλֻһб仯鼰顣
+ *
+ */
+int sparse = 0;
+
+/**
+ * @brief 
+ *
+ */
+int tile_rows = 0, tile_cols = 0;
+
+/**
+ * @brief һǷб仯ʱд tile_next ɺ֮
+ *
+ */
+uint8_t *tile_last = NULL;
+
+/**
+ * @brief ڱǷб仯
+ *
+ */
+uint8_t *tile_next = NULL;
+
+/**
+ * @brief ÿ߳ڱ
+ *
+ */
+long long tile_work[TMAX];
+
+/**
+ * @brief ÿ̱߳ͼϣı仯 generate_next_status ϲ board_hash 
+ *
+ */
+uint64_t hash_delta[TMAX];
+
+/**
+ * @brief
+ * һͳƣϸԼϸӾΣϡ¡ң߽磻
+ * infinite ߽¿ΪΪ 0 ʱӾ塣
+ *
+ */
+typedef struct {
+  long long generation;
+  long long population, births, deaths;
+  long long top, left, bottom, right;
+} life_stats;
+
+/**
+ * @brief ÿ̱߳Ĳͳƣ finish_stats ϲ
+ *
+ */
+life_stats band_stats[TMAX];
+
+/**
+ * @brief һεͳƽ finish_stats  scan_stats ¡
+ *
+ */
+life_stats stats;
+
+/**
+ * @brief
+ * Ƿʱͳơ棨 HashLife ⣩һ漴ͳƸУɨͼ
+ *
+ */
+int stats_on = 0;
+
+/**
+ * @brief stats ״̬ 0 ΪЧ 1 Ϊɨãûг 2 Ϊʱͳá
+ *
+ */
+int stats_valid = 0;
+
+/**
+ * @brief дͳƽ CSV ļΪ NULL ʱд
+ *
+ */
+FILE *stats_csv = NULL;
+
+/**
+ * @brief
+ * ϡģʽÿһμʱͳƣáλ arena С
+ *
+ */
+life_stats *tile_stats = NULL;
+
+#ifdef LIFE_PROFILE
+/**
+ * @brief
+ * һ߳ڸ׶ۼƵʱ룩봦ϸԼǰвھӼಿֵʱ
+ *
+ */
+typedef struct {
+  double seconds[PROF_PHASES];
+  double cells[PROF_PHASES];
+  long long calls[PROF_PHASES];
+  double sampled[PROF_REST + 1];
+} prof_counter;
+
+/**
+ * @brief
+ * ̵߳ļʱ̺߳ϴֵĽ׶Σ PROF_STEP Ժͬһʱֻһ߳̽룬ڵ 0 
+ *
+ */
+prof_counter prof[TMAX];
+
+/**
+ * @brief ϴֵĽ׶һνʱʱ䡣
+ *
+ */
+double prof_begin[PROF_PHASES];
+
+/**
+ * @brief ϴֵĽ׶һνʱӲ
+ *
+ */
+long long prof_hw_begin[PROF_PHASES][PROF_EVENTS];
+
+/**
+ * @brief ϴֵĽ׶ۼƵӲ
+ *
+ */
+long long prof_hw[PROF_PHASES][PROF_EVENTS];
+
+/**
+ * @brief
+ * ӲļʱΪ -1
+ * ڴκ֮߳ǰ򿪲ü̳У˼߳ģ̡߳
+ *
+ */
+int prof_fd[PROF_EVENTS] = {-1, -1, -1};
+
+/**
+ * @brief Ӳõԭ
+ *
+ */
+char prof_hw_error[LEN] = "";
+#endif
+
+/**
+ * @brief
+ * ǰͼ 64 λϣΪְλɢкʱ߳һ漴¸еĹϣڻУֻѱ仯ϲɨͼֻ
+ * history_on δ⵽ʱ¡
+ *
+ */
+uint64_t board_hash = 0;
+
+/**
+ * @brief ͬСĿյͼĹϣڷ
+ *
+ */
+uint64_t empty_hash = 0;
+
+/**
+ * @brief ʷиĵͼϣ
+ *
+ */
+uint64_t history_hash[HISTORY_SLOTS];
+
+/**
+ * @brief ʷиĴ -1 ΪС
+ *
+ */
+long long history_gen[HISTORY_SLOTS];
+
+/**
+ * @brief
+ * Ƿ񵴼⣬ \detect ģʽ --detect
+ * ãĬϹرաÿҪάͼϣ߳ 3000x3000 ܶ 50% ͼ 300 Լ 0.077 s
+ * Լ 0.110 s Լ 40%ͬСֻ 12 ˹ǹĵͼԼ 0.073 s Լ 0.087 s
+ * Լ 20%Ϊûб仯ֻȽϲɢС
+ *
+ */
+int detect = 0;
+
+/**
+ * @brief Ƿ񵴣 detect ҵǰ߽ģʽ֧֡
+ *
+ */
+int history_on = 0;
+
+/**
+ * @brief ⵽ڣ 0 Ϊδ֣ 1 Ϊ 1 Ϊڡ
+ *
+ */
+int period = 0;
+
+/**
+ * @brief ͼǷȫ
+ *
+ */
+int extinct = 0;
+
+/**
+ * @brief ͼ뾲񵴣ĴδʱΪ -1 
+ *
+ */
+long long settled_at = -1;
+
+/**
+ * @brief
+ * ȷϵڣΪ 0 ʱûСʷйϣֻͬ˵ܿظ confirm_at
+ * ֮һڣֱȽϵͼ confirm_map ͬ period 
+ *
+ */
+int confirm_period = 0;
+
+/**
+ * @brief ֹϣͬʱĴ
+ *
+ */
+long long confirm_at = -1;
+
+/**
+ * @brief ȷϽнһĴȷϺΪ settled_at 
+ *
+ */
+long long confirm_from = -1;
+
+/**
+ * @brief ֹϣͬʱͼĸÿ words ֣λ
+ *
+ */
+uint64_t *confirm_map = NULL;
+
+/**
+ * @brief һ
+ *
+ */
+long long tiles_computed = 0, tiles_skipped = 0;
+
+/**
+ * @brief ϡģʽۼƼ
+ *
+ */
+long long tiles_computed_sum = 0, tiles_skipped_sum = 0;
+
+/**
+ * @brief ǰͼʹõģ棬 ENGINE_BITWISE  ENGINE_LUT  ENGINE_HASHLIFE 
+ *
+ */
+int engine = ENGINE_BITWISE;
+
+/**
+ * @brief ߽ģʽ BOUNDARY_DEAD  BOUNDARY_INFINITE  BOUNDARY_TORUS 
+ * HashLife ֻ֧ƽ档
+ *
+ */
+int boundary = BOUNDARY_DEAD;
+
+/**
+ * @brief ƽһ 64x64 顣 r Ϊ cells[r] ʱһд next 
+ *
+ */
+typedef struct {
+  int32_t cy, cx;
+  uint64_t cells[CHUNK];
+  uint64_t next[CHUNK];
+} pl_chunk;
+
+/**
+ * @brief أÿ CHUNK_BLOCK 飬 i λڵ i / CHUNK_BLOCK
+ * 顣ѷĿ鲻ƶ
+ *
+ */
+pl_chunk **pl_blocks = NULL;
+
+/**
+ * @brief ѷ
+ *
+ */
+uint32_t pl_total = 0;
+
+/**
+ * @brief ջС
+ *
+ */
+uint32_t *pl_free = NULL, pl_free_count = 0;
+
+/**
+ * @brief ϣļΪƴɵ 64 λѰַ
+ *
+ */
+uint64_t *pl_keys = NULL;
+
+/**
+ * @brief ϣֵΪţ PL_NONE ʾλ
+ *
+ */
+uint32_t *pl_vals = NULL;
+
+/**
+ * @brief ϣС 2 ݣ
+ *
+ */
+uint32_t pl_size = 0, pl_used = 0;
+
+/**
+ * @brief Ҫб
+ *
+ */
+uint32_t *pl_list = NULL, pl_list_count = 0, pl_list_capacity = 0;
+
+/**
+ * @brief HashLife Ĳڵ㡣 3 ΪҶӣ 8x8
+ * ϸ߲ĸһӽڵɡͬݵĽڵֻһݡ
+ *
+ */
+typedef struct {
+  uint32_t nw, ne, sw, se;
+  uint64_t bits;
+  uint32_t result;
+  int8_t level, result_j;
+} hl_node;
+
+/**
+ * @brief HashLife ڵ飬ñŴָ롣
+ *
+ */
+hl_node *hl_nodes = NULL;
+
+/**
+ * @brief HashLife ýڵڵ
+ *
+ */
+uint32_t hl_count = 0, hl_capacity = 0;
+
+/**
+ * @brief HashLife ϣѰַŽڵţڲͬݵĽڵ㡣
+ *
+ */
+uint32_t *hl_table = NULL;
+
+/**
+ * @brief HashLife ϣСΪ 2 ݡ
+ *
+ */
+uint32_t hl_table_size = 0;
+
+/**
+ * @brief ȫڵš
+ *
+ */
+uint32_t hl_empty[64];
+
+/**
+ * @brief HashLife ڵš
+ *
+ */
+uint32_t hl_root = HL_NONE;
+
+/**
+ * @brief HashLife ڵϽڵͼеСС
+ *
+ */
+long long hl_y = 0, hl_x = 0;
+
+/**
+ * @brief HashLife ÿǰ 2  hl_k η
+ *
+ */
+int hl_k = 0;
+
+int get_input(char *);
+
+void help(void);
+
+void welcome(void);
+
+void get_command(char *, char *, char *);
+
+/**
+ * @brief ȡļĻ
+ *
+ */
+typedef struct {
+  FILE *fp;
+  char *buf;
+  size_t pos, len;
+  int eof;
+  long long bytes;
+} reader;
+
+/**
+ * @brief
+ * ƿգ .bin ļͷ 64 ֽڣֽšŵͼڴеӣ
+ * (rows + 2) Уÿ (cols + 63) / 64 + 2 ֣ұ߿򣬱߿ÿжλΪ 0
+ * ˼ʱɰļӳ䵽ڴֱΪͼ
+ *
+ */
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  int64_t rows, cols;
+  int64_t generation;
+  char rule[24];
+} snap_header;
+
+/**
+ * @brief
+ * Զģʽģ߳̽ʾ̵߳һ֡ͼ map ͬ
+ *
+ */
+typedef struct {
+  uint64_t *cells;
+  long long generation;
+  char note[LEN];
+} frame;
+
+/**
+ * @brief
+ * ֡ģ̶߳ռ frame_back д룬ʾ̶߳ռһ֡ȡһ֡ıŷ
+ * frame_spare У˫һԭӽ˭Ҳ˭
+ *
+ */
+frame frames[3];
+
+/**
+ * @brief ģ߳д֡
+ *
+ */
+int frame_back = 1;
+
+/**
+ * @brief ĽλλΪ֡ FRAME_FRESH λʾ֡δʾ߳ȡߡ
+ *
+ */
+atomic_int frame_spare = 2;
+
+/**
+ * @brief ԶģʽĿ run_paused  run_steps  run_stop  run_target 
+ * frame_wanted  sim_speed 
+ *
+ */
+pthread_mutex_t run_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief ״̬ıʱģ̵߳
+ *
+ */
+pthread_cond_t run_cond = PTHREAD_COND_INITIALIZER;
+
+/**
+ * @brief ģ߳ǷͣͣʱɵĵǷ˳
+ *
+ */
+int run_paused = 0, run_steps = 0, run_stop = 0;
+
+/**
+ * @brief ԶģʽĿָͣΪ -1 Ϊ -1 ʱûĿꡣ
+ *
+ */
+long long run_target = -1;
+
+/**
+ * @brief ʾ߳Ҫµһ֡ʱ 1 ģ̷߳ 0 
+ *
+ */
+int frame_wanted = 0;
+
+double now_seconds(void);
+
+void rd_fill(reader *);
+
+int rd_skip_space(reader *);
+
+int rd_int(reader *);
+
+int rd_cell(reader *);
+
+int rd_getc(reader *);
+
+int rd_line(reader *, char *);
+
+void rd_rewind(reader *);
+
+const char *file_ext(const char *);
+
+int ctz64(uint64_t);
+
+int clz64(uint64_t);
+
+int popcount64(uint64_t);
+
+int run_end(const uint64_t *, int, int);
+
+void set_run(int, int, int);
+
+void load_rule(const char *);
+
+int load_dense(reader *);
+
+int load_rle(reader *);
+
+int load_life106(reader *);
+
+int load_cells(reader *);
+
+int load_binary(reader *);
+
+void load_map(char *);
+
+int save_dense(FILE *);
+
+int save_rle(FILE *);
+
+int save_life106(FILE *);
+
+int save_cells(FILE *, const char *);
+
+int save_binary(FILE *);
+
+int save_map(char *);
+
+void convert_lower_case(char *);
+
+int get_cell(int, int);
+
+void set_cell(int, int, int);
+
+void *aligned_malloc(size_t);
+
+void aligned_free(void *);
+
+int reserve_map(int, int);
+
+int clear_map(int, int);
+
+void unmap_snapshot(void);
+
+uint64_t *row_ptr(uint64_t *, int);
+
+uint64_t tail_mask(void);
+
+int count_alive_neighbors(const uint8_t *, int, int, int, int);
+
+void row_sum(const uint64_t *, uint64_t *, uint64_t *, int);
+
+void row_rule(const uint64_t *, const uint64_t *, const uint64_t *,
+              const uint64_t *, const uint64_t *, const uint64_t *,
+              const uint64_t *, uint64_t *, int);
+
+#ifdef SIMD_X86
+void row_sum_sse(const uint64_t *, uint64_t *, uint64_t *, int);
+
+void row_rule_any(const uint64_t *, const uint64_t *, const uint64_t *,
+                  const uint64_t *, const uint64_t *, const uint64_t *,
+                  const uint64_t *, uint64_t *, int);
+
+void row_rule_any_avx2(const uint64_t *, const uint64_t *, const uint64_t *,
+                       const uint64_t *, const uint64_t *, const uint64_t *,
+                       const uint64_t *, uint64_t *, int);
+
+void row_rule_sse(const uint64_t *, const uint64_t *, const uint64_t *,
+                  const uint64_t *, const uint64_t *, const uint64_t *,
+                  const uint64_t *, uint64_t *, int);
+
+void row_sum_avx2(const uint64_t *, uint64_t *, uint64_t *, int);
+
+void row_rule_avx2(const uint64_t *, const uint64_t *, const uint64_t *,
+                   const uint64_t *, const uint64_t *, const uint64_t *,
+                   const uint64_t *, uint64_t *, int);
+#endif
+
+void select_kernels(void);
+
+void use_kernels(int);
+
+int parse_rule(const char *, int *, int *);
+
+void format_rule(int, int, char *);
+
+void compile_rule(void);
+
+void build_lut(void);
+
+void lut_rows(int, int, int, int);
+
+void generate_lut_band(int);
+
+int set_rule(int, int);
+
+void choose_rule(char *);
+
+int parse_options(int, char *[]);
+
+long long advance(long long);
+
+int run_batch(void);
+
+int bench_fill(int, int);
+
+void configure_engine(int, int, int);
+
+long long peak_rss_kb(void);
+
+int run_bench(void);
+
+void ref_step(const uint8_t *, uint8_t *, uint8_t *, int, int, int);
+
+uint64_t map_hash(void);
+
+int map_clean(void);
+
+uint64_t ref_hash(const uint8_t *, int, int, int, int);
+
+int check_case(int, int, int, int, int, int);
+
+int check_detect(int, int, int);
+
+int check_collision(int, int);
+
+void ref_stats(const uint8_t *, const uint8_t *, int, int, int, life_stats *);
+
+int run_check(void);
+
+void barrier_wait(void);
+
+void *worker_main(void *);
+
+void start_workers(int);
+
+void stop_workers(void);
+
+void pool_run(void (*)(int));
+
+void clear_halo(void);
+
+void fill_halo(void);
+
+void generate_band(int);
+
+int generate_tile(int, int, uint64_t *);
+
+void generate_sparse_band(int);
+
+void mark_all_tiles(void);
+
+uint64_t word_key(uint64_t, int, int);
+
+void hash_row(const uint64_t *, const uint64_t *, int, uint64_t *);
+
+void stats_row(const uint64_t *, const uint64_t *, int, long long, long long,
+               uint64_t, life_stats *);
+#ifdef SIMD_X86
+
+void stats_row_popcnt(const uint64_t *, const uint64_t *, int, long long,
+                      long long, uint64_t, life_stats *);
+
+void stats_row_avx2(const uint64_t *, const uint64_t *, int, long long,
+                    long long, uint64_t, life_stats *);
+#endif
+
+void stats_add(const uint64_t *, int, long long, long long, long long,
+               long long, life_stats *);
+
+void merge_stats(life_stats *, const life_stats *);
+
+void finish_stats(void);
+
+void scan_stats(void);
+
+int open_stats_csv(const char *);
+
+int close_stats_csv(void);
+
+void write_stats(void);
+
+void show_stats(char *);
+
+#ifdef LIFE_PROFILE
+void prof_init(void);
+
+long long prof_read(int);
+
+void prof_lap(int, int, double *);
+
+void prof_band(int, double, int, double);
+
+void prof_enter(int);
+
+void prof_leave(int, double);
+#endif
+
+void show_profile(char *);
+
+int hash_word(const uint64_t *, const uint64_t *, int, int, uint64_t *);
+
+uint64_t full_hash(int);
+
+int board_empty(void);
+
+void reset_history(void);
+
+void record_history(void);
+
+void copy_board(uint64_t *);
+
+int board_matches(const uint64_t *);
+
+int describe_history(char *);
+
+void set_sparse(char *);
+
+void set_detect(char *);
+
+int generate_next_status(void);
+
+void choose_engine(char *);
+
+void engine_attach(void);
+
+uint64_t next_bits(uint64_t, uint64_t, uint64_t);
+
+uint64_t hl_hash(uint64_t);
+
+void hl_reset(void);
+
+uint32_t hl_intern(hl_node *);
+
+uint32_t hl_leaf(uint64_t);
+
+uint32_t hl_join(uint32_t, uint32_t, uint32_t, uint32_t);
+
+uint32_t hl_centre(uint32_t);
+
+uint32_t hl_leaf_centre(uint32_t, uint32_t, uint32_t, uint32_t);
+
+uint32_t hl_inner(uint32_t, uint32_t, uint32_t, uint32_t);
+
+uint32_t hl_base(uint32_t, int);
+
+uint32_t hl_step(uint32_t, int);
+
+int hl_is_centred(uint32_t);
+
+void hl_expand(void);
+
+void hl_advance(uint64_t);
+
+uint32_t hl_build(long long, long long, int);
+
+void hl_from_map(void);
+
+void hl_write(uint32_t, long long, long long, int);
+
+void hl_to_map(void);
+
+uint32_t hl_build_rows(const uint64_t *, int, int, int);
+
+int pl_split(uint32_t *, int, int, long long);
+
+uint32_t hl_build_chunks(uint32_t *, int, long long, long long, int);
+
+void hl_from_plane(void);
+
+int hl_put(uint32_t, long long, long long, int);
+
+int hl_to_plane(void);
+
+uint32_t hl_copy(uint32_t, hl_node *, uint32_t *);
+
+void hl_collect(void);
+
+void set_boundary(char *);
+
+pl_chunk *pl_get(uint32_t);
+
+void pl_reset(void);
+
+uint32_t pl_find(int32_t, int32_t);
+
+uint32_t pl_insert(int32_t, int32_t);
+
+void pl_remove(int32_t, int32_t);
+
+int pl_gather(void);
+
+int pl_grow(void);
+
+void pl_compute(pl_chunk *);
+
+void pl_band(int);
+
+int pl_step(void);
+
+void pl_compact(void);
+
+int pl_from_map(void);
+
+void pl_to_map(void);
+
+void out_put(const char *, size_t);
+
+void out_printf(const char *, ...);
+
+void out_flush(void);
+
+void clear_screen(void);
+
+void term_init(void);
+
+void term_size(int *, int *);
+
+void out_braille(int);
+
+int grid_cell(const uint64_t *, int, int);
+
+int braille_dots(const uint64_t *, int, int);
+
+void render_frame(const char *, const uint64_t *);
+
+void set_view(char *);
+
+void print_map(void);
+
+void design_map(void);
+
+void term_raw(int);
+
+int read_key(int);
+
+void set_speed(char *);
+
+void set_fps(char *);
+
+void publish_frame(void);
+
+void *sim_main(void *);
+
+void sim_control(int, int, int, int);
+
+void auto_run(long long);
+
+void fast_forward(long long);
+
+void generate_command(char *);
+
+void run_command(char *);
+
+void is_map_error(void);
+
+/**
+ * @brief  n λΪ 1 ʾϸ n ھʱĬΪ B3 
+ *
+ */
+int rule_birth = 1 << 3;
+
+/**
+ * @brief  n λΪ 1 ʾϸ n ھʱĬΪ S23 
+ *
+ */
+int rule_survive = 1 << 2 | 1 << 3;
+
+/**
+ * @brief
+ *  compile_rule չĹ룬Ź0  9ȫ 1
+ * ʾʱ rule_bm ʱ rule_sm 
+ *
+ */
+uint64_t rule_bm[10], rule_sm[10];
+
+/**
+ * @brief
+ * ı build_lut ǰɡ±Ϊһ 4x4 飬 r ռ 4r  4r + 3
+ * λڵλֵĵ 0  1 λΪһ 2  3 λΪ񡣹 64
+ * KB ԷŽ L2 档
+ *
+ */
+uint8_t lut[1 << 16];
+
+/**
+ * @brief ѡںʱָ0 Ϊ 1 Ϊ SSE4.1  2 Ϊ AVX2 
+ *
+ */
+int kernel_level = 2;
+
+/**
+ * @brief ǰʹõкͺ select_kernels  CPU ֵָ֧ѡ
+ *
+ */
+void (*row_sum_fn)(const uint64_t *, uint64_t *, uint64_t *, int) = row_sum;
+
+/**
+ * @brief ǰʹõĹ select_kernels  CPU ֵָ֧뵱ǰѡ
+ *
+ */
+void (*row_rule_fn)(const uint64_t *, const uint64_t *, const uint64_t *,
+                    const uint64_t *, const uint64_t *, const uint64_t *,
+                    const uint64_t *, uint64_t *, int) = row_rule;
+
+/**
+ * @brief ͳƺ use_kernels ѡ AVX2  POPCNT 汾
+ *
+ */
+void (*stats_row_fn)(const uint64_t *, const uint64_t *, int, long long,
+                     long long, uint64_t, life_stats *) = stats_row;
+
+/**
+ * @brief
+ * ǰıϡģʽ HashLife ƽֵá
+ *
+ */
+void (*rule_fn)(const uint64_t *, const uint64_t *, const uint64_t *,
+                const uint64_t *, const uint64_t *, const uint64_t *,
+                const uint64_t *, uint64_t *, int) = row_rule;
+
+/**
+ * @brief ģʽļΪ NULL ʱ뽻ģʽ
+ *
+ */
+char *batch_in = NULL;
+
+/**
+ * @brief ģʽļΪ NULL ʱ档
+ *
+ */
+char *batch_out = NULL;
+
+/**
+ * @brief ģʽʹõ߽ģʽΪ NULL ʱĬϡ
+ *
+ */
+char *batch_engine = NULL, *batch_boundary = NULL;
+
+/**
+ * @brief
+ *  --rule ָĹ򣨳 parse_options һΡ batch_birth
+ * Ϊ -1 ʱδָʹĬϹͼļеĹ
+ *
+ */
+int batch_birth = -1, batch_survive = 0;
+
+/**
+ * @brief ģʽдͳƽ CSV ļΪ NULL ʱͳơ
+ *
+ */
+char *batch_stats = NULL;
+
+/**
+ * @brief ģʽҪɵĴ
+ *
+ */
+long long batch_gens = 0;
+
+/**
+ * @brief ǣǷԻ׼ģʽС
+ *
+ */
+int bench = 0;
+
+/**
+ * @brief ǣǷԲֲģʽС
+ *
+ */
+int check = 0;
+
+/**
+ * @brief ǰʹõںơ
+ *
+ */
+const char *kernel_name = "scalar";
+
+int main(int argc, char *argv[]) {
+  PROF_INIT();
+  select_kernels();
+  compile_rule();
+  if (!parse_options(argc, argv)) {
+    return 1;
+  }
+  if (batch_in != NULL) {
+    return run_batch();
+  }
+  if (bench) {
+    return run_bench();
+  }
+  if (check) {
+    return run_check();
+  }
+  term_init();
+  clear_screen();
   welcome();
   char cmd[LEN], buff[LEN], filename[LEN];
   while (1) {
-    printf("\n[I] -> ");
-    get_input(cmd);
-    get_command(cmd, buff, filename);
-    if (strcmp(buff, HELP) == 0 && strcmp(filename, EMPTY) == 0) {
-      help();
-    } else if (strcmp(buff, LOAD) == 0) {
-      load_map(filename);
-    } else if (strcmp(buff, SAVE) == 0) {
-      save_map(filename);
-    } else if (strcmp(buff, DESIGN) == 0 && strcmp(filename, EMPTY) == 0) {
-      design_map();
-    } else if (strcmp(buff, GENERATE) == 0 && strcmp(filename, EMPTY) == 0) {
+    printf("\n[I] -> ");
+    if (!get_input(cmd)) {
+      strcpy(cmd, END);
+    }
+    get_command(cmd, buff, filename);
+    if (strcmp(buff, HELP) == 0 && strcmp(filename, EMPTY) == 0) {
+      help();
+    } else if (strcmp(buff, LOAD) == 0) {
+      PROF_ENTER(PROF_LOAD);
+      load_map(filename);
+      PROF_LEAVE(PROF_LOAD, is_map ? (double)row * col : 0);
+    } else if (strcmp(buff, SAVE) == 0) {
+      PROF_ENTER(PROF_SAVE);
+      save_map(filename);
+      PROF_LEAVE(PROF_SAVE, is_map ? (double)row * col : 0);
+    } else if (strcmp(buff, DESIGN) == 0 && strcmp(filename, EMPTY) == 0) {
+      design_map();
+    } else if (strcmp(buff, GENERATE) == 0) {
+      generate_command(filename);
+    } else if (strcmp(buff, RUN) == 0) {
+      run_command(filename);
+    } else if (strcmp(buff, QUIT) == 0 && strcmp(filename, EMPTY) == 0) {
+      printf("This command is only available in design mode.\n");
+    } else if (strcmp(buff, PRINT) == 0 && strcmp(filename, EMPTY) == 0) {
+      print_map();
+    } else if (strcmp(buff, ENGINE) == 0) {
+      choose_engine(filename);
+    } else if (strcmp(buff, SPARSE) == 0) {
+      set_sparse(filename);
+    } else if (strcmp(buff, DETECT) == 0) {
+      set_detect(filename);
+    } else if (strcmp(buff, BOUNDARY) == 0) {
+      set_boundary(filename);
+    } else if (strcmp(buff, VIEW) == 0) {
+      set_view(filename);
+    } else if (strcmp(buff, RULE) == 0) {
+      choose_rule(filename);
+    } else if (strcmp(buff, SPEED) == 0) {
+      set_speed(filename);
+    } else if (strcmp(buff, FPS) == 0) {
+      set_fps(filename);
+    } else if (strcmp(buff, STATS) == 0) {
+      show_stats(filename);
+    } else if (strcmp(buff, PROF) == 0) {
+      show_profile(filename);
+    } else if (strcmp(buff, END) == 0 && strcmp(filename, EMPTY) == 0) {
+      printf("See you next time!\n");
+      stop_workers();
+      break;
+    } else if (strcmp(buff, EMPTY) == 0) {
+      continue;
+    } else {
+      printf("error: command not found: %s %s\n", buff, filename);
+    }
+    printf("\n");
+  }
+  return 0;
+}
+
+/**
+ * @brief ȡһַȲ1024ʱõմ
+ *
+ * @param buf ַλ
+ * @return int 1ΪһУ0Ϊ
+ */
+int get_input(char *buf) {
+  if (fgets(buf, LEN, stdin) == NULL) {
+    buf[0] = '\0';
+    return 0;
+  }
+  buf[strcspn(buf, "\n")] = '\0';
+  return 1;
+}
+/**
+ * @brief ʾ档
+ *
+ */
+void help() {
+  printf("    [\\h]    print command [h]ints\n");
+  printf("    [\\p]    [p]rint current map\n");
+  printf("    [\\l <filename>]  [l]oad map from a local file\n");
+  printf("    [\\s <filename>]  [s]ave map to local\n");
+  printf("            (.rle, .lif/.life, .cells and .bin files use the RLE, "
+         "Life 1.06, plaintext and binary snapshot formats)\n");
+  printf("    [\\d]    enter [d]esign mode\n");
+  printf("    [\\q]    [q]uit design mode\n");
+  printf("    [\\g [N]]  [g]enerate next generation of life, or N "
+         "generations at full speed (any key cancels)\n");
+  printf("    [\\r [--to GEN]]  enter auto_[r]un mode (keys: ENTER pause/run, "
+         "n step, +/- speed), --to runs at full speed and pauses at GEN\n");
+  printf("    [e]     [e]xit auto_run mode\n");
+  printf("    [\\engine [bitwise|lut|hashlife [k]]]  show or choose the "
+         "simulation [engine]\n");
+  printf("    [\\sparse [on|off]]  skip unchanged 64x64 tiles, show tile "
+         "counters\n");
+  printf("    [\\detect [on|off]]  [detect] extinction, still lifes and "
+         "oscillators (off by default)\n");
+  printf("    [\\boundary [dead|infinite|torus]]  show or choose the "
+         "[boundary] mode\n");
+  printf("    [\\view [auto|cells|braille|<row> <col>]]  choose how auto_run "
+         "draws the map, or move the [view]port\n");
+  printf("    [\\rule [B3/S23]]  show or set the B/S [rule], e.g. B36/S23\n");
+  printf("    [\\speed [N|max]]  generations per second in auto_run\n");
+  printf("    [\\fps [N]]  redraws per second in auto_run\n");
+  printf("    [\\stats [on|off|csv <filename>|csv off]]  population, births, "
+         "deaths and bounding box, tracked while generating\n");
+  printf("    [\\prof [reset]]  time per phase and hardware counters "
+         "(builds with -DLIFE_PROFILE)\n");
+  printf("    [end]   [end] the game\n");
+}
+
+/**
+ * @brief ʾʼӭ档
+ *
+ */
+void welcome() {
+  char *s = "************************************************\n";
+  printf("%s%s", s, s);
+  printf("                GAME OF LIFE\n\n");
+  printf("          Welcome to the game of life.\n");
+  printf("You'll experience the joy of Cellular Automaton.\n\n");
+  printf("                ARE YOU READY\n\n");
+  printf("%s%s", s, s);
+  help();
+}
+
+/**
+ * @brief
+ * һַֽΪ֡һΪȥհַͷһհַβ֮ǰڶΪһհַβȥհַ֮ǰڷֽȡȡֽʱڴոļ·ȡʱͨһϵжȷһ
+ *
+ * @param cmd ͨΪȡһַ
+ * @param buf ֽĵһַ
+ * @param filename ֽĵڶַ
+ */
+void get_command(char *cmd, char *buf, char *filename) {
+  convert_lower_case(cmd);
+  int t = 0, len = (int)strlen(cmd), i = 0, j = 0;
+  while (t < len && (cmd[t] == ' ' || cmd[t] == '\t')) ++t;
+  while (t < len && cmd[t] != ' ' && cmd[t] != '\t') buf[i++] = cmd[t++];
+  buf[i] = '\0';
+  while (t < len && (cmd[t] == ' ' || cmd[t] == '\t')) ++t;
+  while (t < len) filename[j++] = cmd[t++];
+  j--;
+  while (j >= 0 && filename[j] == ' ' || filename[j] == '\t') j--;
+  filename[j + 1] = '\0';
+}
+
+/**
+ * @brief ַsеĸȫתΪСд
+ *
+ * @param s Ҫתַ
+ */
+void convert_lower_case(char *s) {
+  int len = (int)strlen(s);
+  for (int i = 0; i < len; ++i) {
+    if (s[i] >= 'A' && s[i] <= 'Z') {
+      s[i] += 32;
+    }
+  }
+}
+
+/**
+ * @brief ȡõʱ䣬ڼʱ
+ *
+ * @return double 
+ */
+double now_seconds() {
+#ifdef _WIN32
+  LARGE_INTEGER freq, t;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&t);
+  return (double)t.QuadPart / (double)freq.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+/**
+ * @brief
+ * ѻδֽƵͷļֱֽļĩβǲһ
+ * '\0' 
+ *
+ * @param r 
+ */
+void rd_fill(reader *r) {
+  memmove(r->buf, r->buf + r->pos, r->len - r->pos);
+  r->len -= r->pos, r->pos = 0;
+  while (!r->eof && r->len < RD_BLOCK) {
+    size_t n = fread(r->buf + r->len, 1, RD_BLOCK - r->len, r->fp);
+    if (n == 0) {
+      r->eof = 1;
+    }
+    r->len += n, r->bytes += (long long)n;
+  }
+  r->buf[r->len] = '\0';
+}
+
+/**
+ * @brief հַ֤֮󻺳 RD_MARGIN ֽڣѵļβ
+ *
+ * @param r 
+ * @return int ַɶΪ1ѵļβΪ0
+ */
+int rd_skip_space(reader *r) {
+  while (1) {
+    while (r->pos < r->len &&
+           (r->buf[r->pos] == ' ' || (r->buf[r->pos] >= '\t' &&
+                                      r->buf[r->pos] <= '\r'))) {
+      r->pos++;
+    }
+    if (r->len - r->pos < RD_MARGIN && !r->eof) {
+      rd_fill(r);
+      continue;
+    }
+    return r->pos < r->len;
+  }
+}
+
+/**
+ * @brief ȡһʮʽͬ scanf  %d 
+ *
+ * @param r 
+ * @return int ʧʱΪ 0
+ */
+int rd_int(reader *r) {
+  if (!rd_skip_space(r)) {
+    return 0;
+  }
+  char *end;
+  long v = strtol(r->buf + r->pos, &end, 10);
+  r->pos = (size_t)(end - r->buf);
+  return v > KMAX || v < -KMAX ? KMAX : (int)v;
+}
+
+/**
+ * @brief
+ * ȡһϸĴͬ scanf  %lf жǷ 0
+ * Ǵֱֽ֣жǷ񺬷 0 ֣šС㡢ָȵ
+ * strtod ޷ʱ -1  scanf һ֮ϸ
+ *
+ * @param r 
+ * @return int Ϊ1Ϊ0޷ȡΪ-1
+ */
+int rd_cell(reader *r) {
+  if (!rd_skip_space(r)) {
+    return -1;
+  }
+  const char *p = r->buf + r->pos, *end = r->buf + r->len;
+  int nonzero = 0, digits = 0;
+  while (p < end && *p >= '0' && *p <= '9') {
+    nonzero |= *p++ != '0';
+    digits++;
+    if (p == end && !r->eof) {
+      r->pos = (size_t)(p - r->buf);
+      rd_fill(r);
+      p = r->buf, end = r->buf + r->len;
+    }
+  }
+  if (digits > 0 && (p == end || (*p != '.' && *p != 'e' &&
+                                           *p != 'E' && *p != 'x' &&
+                                           *p != 'X'))) {
+    r->pos = (size_t)(p - r->buf);
+    return nonzero;
+  }
+  char *stop;
+  double v = strtod(r->buf + r->pos, &stop);
+  if (stop == r->buf + r->pos) {
+    return -1;
+  }
+  r->pos = (size_t)(stop - r->buf);
+  return v > 0;
+}
+
+/**
+ * @brief ȡһַ
+ *
+ * @param r 
+ * @return int ַѵļβΪ EOF
+ */
+int rd_getc(reader *r) {
+  if (r->pos == r->len) {
+    rd_fill(r);
+  }
+  return r->pos < r->len ? (unsigned char)r->buf[r->pos++] : EOF;
+}
+
+/**
+ * @brief ȡһУȥзس LEN - 1 ַĲֱ
+ *
+ * @param r 
+ * @param line еĴλ
+ * @return int һΪ1ѵļβΪ0
+ */
+int rd_line(reader *r, char *line) {
+  int c = rd_getc(r), n = 0;
+  if (c == EOF) {
+    return 0;
+  }
+  while (c != EOF && c != '\n') {
+    if (c != '\r' && n < LEN - 1) {
+      line[n++] = (char)c;
+    }
+    c = rd_getc(r);
+  }
+  line[n] = '\0';
+  return 1;
+}
+
+/**
+ * @brief صļͷ¶ȡ
+ *
+ * @param r 
+ */
+void rd_rewind(reader *r) {
+  rewind(r->fp);
+  r->pos = r->len = 0, r->eof = 0;
+}
+
+/**
+ * @brief ȡļչ
+ *
+ * @param filename ļ
+ * @return const char* һ '.' ʼĲ֣ûչʱΪַ
+ */
+const char *file_ext(const char *filename) {
+  const char *dot = strrchr(filename, '.');
+  const char *slash = strrchr(filename, '/');
+  if (dot == NULL || (slash != NULL && slash > dot)) {
+    return EMPTY;
+  }
+  return dot;
+}
+
+/**
+ * @brief  64 λĩβ 0 ĸ
+ *
+ * @param x  0 
+ * @return int ĩβ 0 ĸ
+ */
+int ctz64(uint64_t x) {
+#ifdef __GNUC__
+  return __builtin_ctzll(x);
+#else
+  int n = 0;
+  while (!(x & 1)) {
+    x >>= 1, n++;
+  }
+  return n;
+#endif
+}
+
+/**
+ * @brief  64 λͷ 0 ĸ
+ *
+ * @param x  0 
+ * @return int ͷ 0 ĸ
+ */
+int clz64(uint64_t x) {
+#ifdef __GNUC__
+  return __builtin_clzll(x);
+#else
+  int n = 0;
+  while (!(x >> 63)) {
+    x <<= 1, n++;
+  }
+  return n;
+#endif
+}
+
+/**
+ * @brief  64 λ 1 ĸ
+ *
+ * @param x 
+ * @return int 1 ĸ
+ */
+int popcount64(uint64_t x) {
+#ifdef __GNUC__
+  return __builtin_popcountll(x);
+#else
+  int n = 0;
+  for (; x; x &= x - 1) {
+    n++;
+  }
+  return n;
+#endif
+}
+
+/**
+ * @brief ĳе j пʼҵһ״̬Ϊ v ϸͬʱһ 64 
+ *
+ * @param p ֵַ
+ * @param j ʼ
+ * @param v ϸ״̬
+ * @return int һ״̬Ϊ v УֱβͬʱΪ col
+ */
+int run_end(const uint64_t *p, int j, int v) {
+  while (j < col) {
+    uint64_t x = (v ? ~p[j >> 6] : p[j >> 6]) >> (j & 63);
+    if (x) {
+      j += ctz64(x);
+      return j < col ? j : col;
+    }
+    j = (j | 63) + 1;
+  }
+  return col;
+}
+
+/**
+ * @brief  i дӵ j пʼ n ϸΪͼĲֺԡ
+ *
+ * @param i 
+ * @param j ʼ
+ * @param n 
+ */
+void set_run(int i, int j, int n) {
+  if (i < 0 || i >= row || j < 0 || j >= col || n <= 0) {
+    return;
+  }
+  int e = n > col - j ? col : j + n;
+  uint64_t *p = row_ptr(map, i);
+  while (j < e) {
+    int k = (j | 63) + 1 < e ? (j | 63) + 1 : e;
+    uint64_t bits = k - j == 64 ? ~(uint64_t)0 : ((uint64_t)1 << (k - j)) - 1;
+    p[j >> 6] |= bits << (j & 63);
+    j = k;
+  }
+}
+
+/**
+ * @brief
+ * صͼļм¼Ĺ޷ʶ뵱ǰͻʱʾ沢ǰ
+ *
+ * @param rule ַΪ NULL ʱı
+ */
+void load_rule(const char *rule) {
+  int b, s;
+  if (rule == NULL) {
+    return;
+  }
+  if (!parse_rule(rule, &b, &s)) {
+    printf("load_map: warning: unknown rule %s, keeping the current rule\n",
+           rule);
+  } else if (!set_rule(b, s)) {
+    printf("load_map: warning: keeping the current rule\n");
+  }
+}
+
+/**
+ * @brief
+ * ȡıʽһΪ֮ÿϸһֵ0ȡΪȡΪȡѾȡļβʣϸĬ
+ * rd_cell ֱɨַÿдһдͼ
+ *
+ * @param r 
+ * @return int ɹΪ1ʧΪ0
+ */
+int load_dense(reader *r) {
+  int x = rd_int(r);
+  int y = rd_int(r);
+  if (x <= 0 || y <= 0) {
+    printf("load_map: error: illegal map\n");
+    return 0;
+  }
+  if (x >= KMAX || y >= KMAX || !clear_map(x, y)) {
+    printf("load_map: error: map is too large\n");
+    return 0;
+  }
+  int stop = 0;
+  for (int i = 0; i < row && !stop; ++i) {
+    uint64_t *p = row_ptr(map, i), word = 0;
+    int j = 0;
+    for (; j < col; ++j) {
+      int v = rd_cell(r);
+      if (v < 0) {
+        stop = 1;
+        break;
+      }
+      word |= (uint64_t)v << (j & 63);
+      if ((j & 63) == 63) {
+        p[j >> 6] = word, word = 0;
+      }
+    }
+    if (word) {
+      p[j >> 6] = word;
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief
+ * ȡ RLE ʽ # ͷΪעͣͷ "x = , y = "
+ * ͼС֮ b Ϊϸ o ĸΪϸ $
+ * ΪУǰΪظ ! Ϊͼϸԡͷ rule
+ * Ϊ
+ *
+ * @param r 
+ * @return int ɹΪ1ʧΪ0
+ */
+int load_rle(reader *r) {
+  char line[LEN], compact[LEN], *rule = NULL;
+  int x = 0, y = 0;
+  while (rd_line(r, line)) {
+    if (line[0] == '#' || line[0] == '\0') {
+      continue;
+    }
+    int n = 0;
+    for (int i = 0; line[i]; ++i) {
+      if (line[i] != ' ' && line[i] != '\t') {
+        compact[n++] = line[i];
+      }
+    }
+    compact[n] = '\0';
+    sscanf(compact, "x=%d,y=%d", &y, &x);
+    rule = strstr(compact, "rule=");
+    if (rule != NULL) {
+      rule += 5;
+    }
+    break;
+  }
+  if (x <= 0 || y <= 0) {
+    printf("load_map: error: illegal map\n");
+    return 0;
+  }
+  if (x >= KMAX || y >= KMAX || !clear_map(x, y)) {
+    printf("load_map: error: map is too large\n");
+    return 0;
+  }
+  int i = 0, j = 0, c, count = 0;
+  while ((c = rd_getc(r)) != EOF && c != '!') {
+    if (c >= '0' && c <= '9') {
+      count = count >= KMAX / 10 ? KMAX : count * 10 + (c - '0');
+      continue;
+    }
+    int n = count > 0 ? count : 1;
+    if (c == 'b' || c == '.') {
+      j = n > col - j ? col : j + n;
+    } else if (c == '$') {
+      i = n > row - i ? row : i + n, j = 0;
+    } else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+      set_run(i, j, n);
+      j = n > col - j ? col : j + n;
+    } else {
+      continue;
+    }
+    count = 0;
+  }
+  load_rule(rule);
+  return 1;
+}
+
+/**
+ * @brief
+ * ȡ Life 1.06 ʽ # ͷΪעͣÿΪһϸ " "
+ * ꣬ΪͼСȡлϸӾΣûлϸʱΪ 1x1  #R
+ * Ϊ strtoll 룬 long long ΧļӾεĿ޷ã
+ * ԶҲȷͼС֮ǰ KMAX Ƚϡ
+ *
+ * @param r 
+ * @return int ɹΪ1ʧΪ0
+ */
+int load_life106(reader *r) {
+  char line[LEN], rule[LEN] = "";
+  long long *cells = NULL, n = 0, cap = 0;
+  long long min_x = 0, max_x = 0, min_y = 0, max_y = 0, cx, cy;
+  while (rd_line(r, line)) {
+    if (line[0] == '#' && line[1] == 'R') {
+      sscanf(line + 2, "%1023s", rule);
+    }
+    char *end1, *end2;
+    errno = 0;
+    cx = strtoll(line, &end1, 10);
+    cy = strtoll(end1, &end2, 10);
+    if (line[0] == '#' || end1 == line || end2 == end1) {
+      continue;
+    }
+    if (errno == ERANGE) {
+      free(cells);
+      printf("load_map: error: map is too large\n");
+      return 0;
+    }
+    if (n == cap) {
+      cap = cap ? cap * 2 : 1024;
+      long long *q = realloc(cells, sizeof(long long) * 2 * cap);
+      if (q == NULL) {
+        free(cells);
+        printf("load_map: error: out of memory\n");
+        return 0;
+      }
+      cells = q;
+    }
+    cells[2 * n] = cx, cells[2 * n + 1] = cy;
+    min_x = n == 0 || cx < min_x ? cx : min_x;
+    max_x = n == 0 || cx > max_x ? cx : max_x;
+    min_y = n == 0 || cy < min_y ? cy : min_y;
+    max_y = n == 0 || cy > max_y ? cy : max_y;
+    n++;
+  }
+  unsigned long long span_x = (unsigned long long)max_x - min_x;
+  unsigned long long span_y = (unsigned long long)max_y - min_y;
+  if (span_x >= KMAX - 1 || span_y >= KMAX - 1 ||
+      !clear_map((int)span_y + 1, (int)span_x + 1)) {
+    free(cells);
+    printf("load_map: error: map is too large\n");
+    return 0;
+  }
+  for (long long k = 0; k < n; ++k) {
+    set_cell((int)(cells[2 * k + 1] - min_y), (int)(cells[2 * k] - min_x), 1);
+  }
+  free(cells);
+  load_rule(rule[0] ? rule : NULL);
+  return 1;
+}
+
+/**
+ * @brief
+ * ȡ plaintext  .cells ʽ ! ͷΪעͣÿΪͼһУ
+ * . ΪϸַΪϸȶһעеĳȣٻصͷϸ
+ *
+ * @param r 
+ * @return int ɹΪ1ʧΪ0
+ */
+int load_cells(reader *r) {
+  long long x = 0, y = 0, len = 0;
+  int c, comment = 0, start = 1;
+  while ((c = rd_getc(r)) != EOF) {
+    if (start) {
+      comment = c == '!', start = 0;
+      x += !comment;
+    }
+    if (c == '\n') {
+      start = 1, len = 0;
+    } else if (!comment && c != '\r' && ++len > y) {
+      y = len;
+    }
+  }
+  if (x <= 0 || y <= 0) {
+    printf("load_map: error: illegal map\n");
+    return 0;
+  }
+  if (x >= KMAX || y >= KMAX || !clear_map((int)x, (int)y)) {
+    printf("load_map: error: map is too large\n");
+    return 0;
+  }
+  rd_rewind(r);
+  int i = 0, j = 0;
+  start = 1;
+  while ((c = rd_getc(r)) != EOF) {
+    if (start) {
+      comment = c == '!', start = 0;
+    }
+    if (c == '\n') {
+      i += !comment, j = 0, start = 1;
+    } else if (!comment && c != '\r') {
+      if (c != '.') {
+        set_cell(i, j, 1);
+      }
+      j++;
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief
+ * ȡƿգ .bin ļͷļС󣬰ļдʱƷʽӳ䵽ڴ棬
+ * map ֱָļеĵͼ֣ƣֻʱдҳŻḴơ
+ * 򱣴Ŀձ߿λΪ 0 Դ𻵵ļһӳֻһ飬ɾʱ
+ * clear_halo ֻбдҳḴƣʹǰȡͼתͳơϣӰ졣 Windows
+ * û mmap Ϊһζ롣
+ *
+ * @param r ֻʹеļֽ
+ * @return int ɹΪ1ʧΪ0
+ */
+int load_binary(reader *r) {
+  snap_header h;
+  if (fread(&h, sizeof(h), 1, r->fp) != 1 ||
+      memcmp(h.magic, SNAP_MAGIC, 8) != 0 || h.version != SNAP_VERSION ||
+      h.header_size != sizeof(h) || h.rows <= 0 || h.cols <= 0) {
+    printf("load_map: error: illegal map\n");
+    return 0;
+  }
+  int birth, survive;
+  h.rule[sizeof(h.rule) - 1] = '\0';
+  if (!parse_rule(h.rule, &birth, &survive)) {
+    printf("load_map: error: unknown rule\n");
+    return 0;
+  }
+  if (h.rows >= KMAX || h.cols >= KMAX) {
+    printf("load_map: error: map is too large\n");
+    return 0;
+  }
+  size_t plane = ((size_t)h.rows + 2) * (((size_t)h.cols + 63) / 64 + 2) *
+                 sizeof(uint64_t);
+  size_t size = sizeof(h) + plane;
+#ifdef _WIN32
+  _fseeki64(r->fp, 0, SEEK_END);
+  long long bytes = _ftelli64(r->fp);
+#else
+  struct stat st;
+  long long bytes = fstat(fileno(r->fp), &st) == 0 ? (long long)st.st_size : -1;
+#endif
+  if (bytes < 0 || (size_t)bytes != size) {
+    printf("load_map: error: illegal map\n");
+    return 0;
+  }
+#ifdef _WIN32
+  void *p = malloc(size);
+  fseek(r->fp, 0, SEEK_SET);
+  if (p != NULL && fread(p, 1, size, r->fp) != size) {
+    free(p);
+    printf("load_map: error: illegal map\n");
+    return 0;
+  }
+#else
+  void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                 fileno(r->fp), 0);
+  if (p == MAP_FAILED) {
+    p = NULL;
+  }
+#endif
+  if (p == NULL || !reserve_map((int)h.rows, (int)h.cols)) {
+#ifdef _WIN32
+    free(p);
+#else
+    if (p != NULL) {
+      munmap(p, size);
+    }
+#endif
+    printf("load_map: error: map is too large\n");
+    return 0;
+  }
+  memset(next_map, 0, (size_t)(tile_next + (size_t)tile_rows * tile_cols -
+                                (uint8_t *)next_map));
+  snapshot = p, snapshot_size = size;
+  map = (uint64_t *)((char *)p + sizeof(h));
+  if (!map_clean()) {
+    clear_halo();
+  }
+  generation = (long long)h.generation;
+  r->bytes = (long long)size;
+  load_rule(h.rule);
+  return 1;
+}
+
+/**
+ * @brief
+ * رصͼʽչѡ .rle Ϊ RLE  .lif  .life Ϊ Life 1.06
+ *  .cells Ϊ plaintext  .bin ΪƿգΪıʽϵͳԭԭ޷أļͼСϷ򳬹Χļ
+ * RD_BLOCK ֽڷֿ룬ʾȡٶȡ
+ *
+ * @param filename Ҫصļ
+ */
+void load_map(char *filename) {
+  double start = now_seconds();
+  FILE *fp = fopen(filename, "rb");
+  if (fp == NULL) {
+    printf("load_map: error: no such file\n");
+    return;
+  }
+  reader r = {fp, malloc(RD_BLOCK + 1), 0, 0, 0, 0};
+  if (r.buf == NULL) {
+    printf("load_map: error: out of memory\n");
+    fclose(fp);
+    return;
+  }
+  const char *ext = file_ext(filename);
+  int ok;
+  if (strcmp(ext, ".rle") == 0) {
+    ok = load_rle(&r);
+  } else if (strcmp(ext, ".lif") == 0 || strcmp(ext, ".life") == 0) {
+    ok = load_life106(&r);
+  } else if (strcmp(ext, ".cells") == 0) {
+    ok = load_cells(&r);
+  } else if (strcmp(ext, ".bin") == 0) {
+    ok = load_binary(&r);
+  } else {
+    ok = load_dense(&r);
+  }
+  free(r.buf);
+  fclose(fp);
+  if (!ok) {
+    return;
+  }
+  is_map = 1;
+  engine_attach();
+  double secs = now_seconds() - start;
+  printf("row = %d, column = %d\n", row, col);
+  if (generation) {
+    printf("generation = %lld\n", generation);
+  }
+  printf("loading complete (%.1f MB in %.3f s, %.1f MB/s)\n", r.bytes / 1e6,
+         secs, secs > 0 ? r.bytes / 1e6 / secs : 0.0);
+}
+
+/**
+ * @brief
+ * ԱıʽдͼһΪ֮ÿϸһÿڻƴһд
+ *
+ * @param fp ļ
+ * @return int ɹΪ1ڴ治дΪ0
+ */
+int save_dense(FILE *fp) {
+  fprintf(fp, "%d %d\n", row, col);
+  char *line = malloc((size_t)col * 2 + 2);
+  if (line == NULL) {
+    printf("save_map: error: out of memory\n");
+    return 0;
+  }
+  for (int i = 0; i < row; ++i) {
+    const uint64_t *p = row_ptr(map, i);
+    for (int j = 0; j < col; ++j) {
+      line[2 * j] = (char)('0' + (p[j >> 6] >> (j & 63) & 1));
+      line[2 * j + 1] = ' ';
+    }
+    line[2 * col] = '\n', line[2 * col + 1] = '\0';
+    fputs(line, fp);
+  }
+  free(line);
+  return !ferror(fp);
+}
+
+/**
+ * @brief
+ *  RLE ʽдͼֲͬϸĩϸĩβĿʡԣĻкϲΪһ
+ * $ ÿв 70 ַ
+ *
+ * @param fp ļ
+ * @return int ɹΪ1дΪ0
+ */
+int save_rle(FILE *fp) {
+  char rule[24];
+  format_rule(rule_birth, rule_survive, rule);
+  fprintf(fp, "x = %d, y = %d, rule = %s\n", col, row, rule);
+  char item[32];
+  int width = 0, pending = 0;
+  for (int i = 0; i < row; ++i) {
+    const uint64_t *p = row_ptr(map, i);
+    int j = 0;
+    while (j < col) {
+      int v = (int)(p[j >> 6] >> (j & 63) & 1), e = run_end(p, j, v);
+      if (!v && e == col) {
+        break;
+      }
+      for (int k = 0; k < 2; ++k) {
+        int n = k == 0 ? pending : e - j;
+        char tag = k == 0 ? '$' : v ? 'o' : 'b';
+        if (n == 0) {
+          continue;
+        }
+        int len = n == 1 ? sprintf(item, "%c", tag)
+                         : sprintf(item, "%d%c", n, tag);
+        if (width + len > 70) {
+          fputc('\n', fp);
+          width = 0;
+        }
+        fputs(item, fp);
+        width += len;
+      }
+      pending = 0;
+      j = e;
+    }
+    pending++;
+  }
+  fprintf(fp, "!\n");
+  return !ferror(fp);
+}
+
+/**
+ * @brief  Life 1.06 ʽдͼÿϸһ " " ÿһȽȥλ
+ *
+ * @param fp ļ
+ * @return int ɹΪ1дΪ0
+ */
+int save_life106(FILE *fp) {
+  char rule[24];
+  format_rule(rule_birth, rule_survive, rule);
+  fprintf(fp, "#Life 1.06\n#R %s\n", rule);
+  uint64_t tail = tail_mask();
+  for (int i = 0; i < row; ++i) {
+    const uint64_t *p = row_ptr(map, i);
+    for (int w = 0; w < words; ++w) {
+      for (uint64_t x = w == words - 1 ? p[w] & tail : p[w]; x; x &= x - 1) {
+        fprintf(fp, "%d %d\n", w * 64 + ctz64(x), i);
+      }
+    }
+  }
+  return !ferror(fp);
+}
+
+/**
+ * @brief  plaintext  .cells ʽдͼÿд col ַ
+ *
+ * @param fp ļ
+ * @param filename ļд !Name: ע
+ * @return int ɹΪ1ڴ治дΪ0
+ */
+int save_cells(FILE *fp, const char *filename) {
+  fprintf(fp, "!Name: %s\n", filename);
+  char *line = malloc((size_t)col + 2);
+  if (line == NULL) {
+    printf("save_map: error: out of memory\n");
+    return 0;
+  }
+  for (int i = 0; i < row; ++i) {
+    for (int j = 0; j < col; ++j) {
+      line[j] = get_cell(i, j) ? 'O' : '.';
+    }
+    line[col] = '\n', line[col + 1] = '\0';
+    fputs(line, fp);
+  }
+  free(line);
+  return !ferror(fp);
+}
+
+/**
+ * @brief
+ * Զƿոʽдͼļͷ֮Ǻ߿ŵͼһддǰձ߿ʹļֱӳΪͼ
+ *
+ * @param fp ļ
+ * @return int ɹΪ1дΪ0
+ */
+int save_binary(FILE *fp) {
+  snap_header h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, SNAP_MAGIC, 8);
+  h.version = SNAP_VERSION, h.header_size = sizeof(h);
+  h.rows = row, h.cols = col, h.generation = generation;
+  format_rule(rule_birth, rule_survive, h.rule);
+  clear_halo();
+  size_t n = (size_t)(row + 2) * stride;
+  return fwrite(&h, sizeof(h), 1, fp) == 1 &&
+         fwrite(map, sizeof(uint64_t), n, fp) == n;
+}
+
+/**
+ * @brief
+ * ͼء޵ͼ򱨴˳ϵͳԭ򱣴ʧܡʽչѡ
+ * load_map ͬʽдڴ治дرļʧʱʾɹ
+ *
+ * @param filename Ҫļ
+ * @return int ɹΪ1ʧΪ0
+ */
+int save_map(char *filename) {
+  if (!is_map) {
+    is_map_error();
+    return 0;
+  }
+  const char *ext = file_ext(filename);
+  FILE *fp = fopen(filename, strcmp(ext, ".bin") == 0 ? "wb" : "w");
+  if (fp == NULL) {
+    printf("save_map: error: failed to save file\n");
+    return 0;
+  }
+  int ok;
+  if (strcmp(ext, ".rle") == 0) {
+    ok = save_rle(fp);
+  } else if (strcmp(ext, ".lif") == 0 || strcmp(ext, ".life") == 0) {
+    ok = save_life106(fp);
+  } else if (strcmp(ext, ".cells") == 0) {
+    ok = save_cells(fp, filename);
+  } else if (strcmp(ext, ".bin") == 0) {
+    ok = save_binary(fp);
+  } else {
+    ok = save_dense(fp);
+  }
+  if (fclose(fp) != 0) {
+    ok = 0;
+  }
+  if (!ok) {
+    printf("save_map: error: failed to save file\n");
+    return 0;
+  }
+  printf("saving successfully\n");
+  return 1;
+}
+
+/**
+ * @brief ȡͼĳϸĴ
+ *
+ * @param x x
+ * @param y y
+ * @return int Ϊ1Ϊ0
+ */
+int get_cell(int x, int y) { return grid_cell(map, x, y); }
+
+/**
+ * @brief ȡ map ͬͼĳϸ
+ *
+ * @param grid ͼ
+ * @param x к
+ * @param y к
+ * @return int Ϊ1Ϊ0
+ */
+int grid_cell(const uint64_t *grid, int x, int y) {
+  return (int)(grid[(size_t)(x + 1) * stride + 1 + (y >> 6)] >> (y & 63) & 1);
+}
+
+/**
+ * @brief õͼĳϸĴ
+ *
+ * @param x x
+ * @param y y
+ * @param v 0Ϊ0Ϊ
+ */
+void set_cell(int x, int y, int v) {
+  uint64_t *p = row_ptr(map, x) + (y >> 6);
+  if (v) {
+    *p |= (uint64_t)1 << (y & 63);
+  } else {
+    *p &= ~((uint64_t)1 << (y & 63));
+  }
+}
+
+/**
+ * @brief 䰴 ALIGN ֽڶڴ档
+ *
+ * @param size ֽ
+ * @return void* ڴ׵ַʧʱΪ NULL
+ */
+void *aligned_malloc(size_t size) {
+#ifdef _WIN32
+  return _aligned_malloc(size, ALIGN);
+#else
+  void *p = NULL;
+  return posix_memalign(&p, ALIGN, size) == 0 ? p : NULL;
+#endif
+}
+
+/**
+ * @brief ͷ aligned_malloc ڴ档
+ *
+ * @param p ڴ׵ַ
+ */
+void aligned_free(void *p) {
+#ifdef _WIN32
+  _aligned_free(p);
+#else
+  free(p);
+#endif
+}
+
+/**
+ * @brief
+ * õͼڴݡͼһкͻͬһڴл֣ڴʱ·䣬֮ɾø򡣷ʧʱԭͼ
+ *
+ * @param x 
+ * @param y 
+ * @return int ɹΪ1ڴ治Ϊ0
+ */
+int reserve_map(int x, int y) {
+  size_t w = ((size_t)y + 63) / 64;
+  size_t plane = (((size_t)x + 2) * (w + 2) * sizeof(uint64_t) + ALIGN - 1) /
+                 ALIGN * ALIGN;
+  size_t sums = (6 * w * sizeof(uint64_t) + ALIGN - 1) / ALIGN * ALIGN;
+  size_t tiles = ((size_t)x + TILE - 1) / TILE * w;
+  size_t need = plane * 2 + sums * threads + (size_t)x * sizeof(uint64_t) +
+                tiles * sizeof(life_stats) + 2 * tiles;
+  if (need > arena_size) {
+    uint64_t *p = aligned_malloc(need);
+    if (p == NULL) {
+      return 0;
+    }
+    aligned_free(arena);
+    arena = p, arena_size = need;
+  }
+  unmap_snapshot();
+  row = x, col = y, words = (int)w, stride = (int)w + 2;
+  map = arena;
+  next_map = arena + plane / sizeof(uint64_t);
+  row_sums = next_map + plane / sizeof(uint64_t);
+  sums_stride = sums / sizeof(uint64_t);
+  tile_rows = (x + TILE - 1) / TILE, tile_cols = (int)w;
+  row_hash = row_sums + sums_stride * threads;
+  tile_stats = (life_stats *)(row_hash + x);
+  tile_last = (uint8_t *)(tile_stats + tiles);
+  tile_next = tile_last + tiles;
+  return 1;
+}
+
+/**
+ * @brief õͼϸΪ㡣ʧʱԭͼ
+ *
+ * @param x 
+ * @param y 
+ * @return int ɹΪ1ڴ治Ϊ0
+ */
+int clear_map(int x, int y) {
+  if (!reserve_map(x, y)) {
+    return 0;
+  }
+  memset(arena, 0, (size_t)(tile_next + (size_t)tile_rows * tile_cols -
+                             (uint8_t *)arena));
+  mark_all_tiles();
+  generation = 0;
+  return 1;
+}
+
+/**
+ * @brief ƿյӳ䡣ǰ map  next_map Ѳָա
+ *
+ */
+void unmap_snapshot() {
+  if (snapshot == NULL) {
+    return;
+  }
+#ifdef _WIN32
+  free(snapshot);
+#else
+  munmap(snapshot, snapshot_size);
+#endif
+  snapshot = NULL, snapshot_size = 0;
+}
+
+/**
+ * @brief
+ * ͼĳΧϸԱ߽ۡͼΪÿһֽڵ r x c
+ * 飬ĵͼʾһʱʹãΪֲԣ ref_step Ĳοʵ֡
+ *
+ * @param g ͼ
+ * @param r 
+ * @param c 
+ * @param x x
+ * @param y y
+ * @return int õΧϸ
+ */
+int count_alive_neighbors(const uint8_t *g, int r, int c, int x, int y) {
+  int alive = 0;
+  for (int i = x - 1; i <= x + 1; ++i) {
+    if (i < 0 || i >= r) continue;
+    for (int j = y - 1; j <= y + 1; ++j) {
+      if (j < 0 || j >= c || (i == x && j == y)) continue;
+      alive += g[(size_t)i * c + j];
+    }
+  }
+  return alive;
+}
+
+/**
+ * @brief ȡͼĳһеһЧֵĵַ i Ϊ -1  row ʱΪ±߿С
+ *
+ * @param grid ͼһ
+ * @param i к
+ * @return uint64_t* ֵַ
+ */
+uint64_t *row_ptr(uint64_t *grid, int i) {
+  return grid + (size_t)(i + 1) * stride + 1;
+}
+
+/**
+ * @brief ȡÿһֵЧλ룺 col % 64 λΪ 1 Ϊ 64 ıʱȫΪ 1 
+ *
+ * @return uint64_t 
+ */
+uint64_t tail_mask() {
+  return (col & 63) ? ((uint64_t)1 << (col & 63)) - 1 : ~(uint64_t)0;
+}
+
+/**
+ * @brief
+ * һÿϸĴ֮ͣ0  3һδ 64
+ * ϸھλ룬ֵλȡ֣βȡԱ߿֣жϱ߽硣
+ *
+ * @param src ֵַ
+ * @param s0 ͵ĵλ
+ * @param s1 ͵ĸλ
+ * @param n 
+ */
+void row_sum(const uint64_t *src, uint64_t *s0, uint64_t *s1, int n) {
+  for (int w = 0; w < n; ++w) {
+    uint64_t x = src[w];
+    uint64_t l = (x << 1) | (src[w - 1] >> 63);
+    uint64_t r = (x >> 1) | (src[w + 1] << 63);
+    s0[w] = l ^ x ^ r;
+    s1[w] = (l & x) | (r & (l ^ x));
+  }
+}
+
+/**
+ * @brief
+ * ϡеĺ͵õŹϷõһŹΪ
+ * 3 ϸضΪ 4 ϸԭ״̬λʱλֱ򣬽λλһֻжϸüΪ
+ * 1  2 
+ *
+ * @param a0 һк͵ĵλ
+ * @param a1 һк͵ĸλ
+ * @param b0 к͵ĵλ
+ * @param b1 к͵ĸλ
+ * @param c0 һк͵ĵλ
+ * @param c1 һк͵ĸλ
+ * @param self еǰ״̬
+ * @param dst һ״̬
+ * @param n 
+ */
+void row_rule(const uint64_t *a0, const uint64_t *a1, const uint64_t *b0,
+              const uint64_t *b1, const uint64_t *c0, const uint64_t *c1,
+              const uint64_t *self, uint64_t *dst, int n) {
+  for (int w = 0; w < n; ++w) {
+    uint64_t u0 = a0[w] ^ b0[w] ^ c0[w];
+    uint64_t k = (a0[w] & b0[w]) | (c0[w] & (a0[w] ^ b0[w]));
+    uint64_t p = a1[w] ^ b1[w], q = a1[w] & b1[w];
+    uint64_t r = c1[w] ^ k, s = c1[w] & k;
+    uint64_t one = (p ^ r) & ~(q | s);
+    uint64_t two = (p & r) | (~(p | r) & (q ^ s));
+    dst[w] = (u0 & one) | (~u0 & two & self[w]);
+  }
+}
+
+/**
+ * @brief
+ *  B/S  row_rule Ȱ row_rule ķѾŹ0  9
+ * ĸλƽ棬Ϊȡֵƽ棬 compile_rule Ԥչ rule_bm ʱ
+ * rule_sm ʱϲڱʱѱ룬ʱжϡ
+ *
+ * @param a0 һк͵ĵλ
+ * @param a1 һк͵ĸλ
+ * @param b0 к͵ĵλ
+ * @param b1 к͵ĸλ
+ * @param c0 һк͵ĵλ
+ * @param c1 һк͵ĸλ
+ * @param self еǰ״̬
+ * @param dst һ״̬
+ * @param n 
+ */
+void row_rule_any(const uint64_t *a0, const uint64_t *a1, const uint64_t *b0,
+                  const uint64_t *b1, const uint64_t *c0, const uint64_t *c1,
+                  const uint64_t *self, uint64_t *dst, int n) {
+  for (int w = 0; w < n; ++w) {
+    uint64_t u0 = a0[w] ^ b0[w] ^ c0[w];
+    uint64_t k = (a0[w] & b0[w]) | (c0[w] & (a0[w] ^ b0[w]));
+    uint64_t p = a1[w] ^ b1[w], q = a1[w] & b1[w];
+    uint64_t r = c1[w] ^ k, s = c1[w] & k;
+    uint64_t h0 = p ^ r, h1 = q ^ s ^ (p & r), h2 = q & s;
+    uint64_t lo[4] = {~u0 & ~h0, u0 & ~h0, ~u0 & h0, u0 & h0};
+    uint64_t hi[3] = {~h1 & ~h2, h1, h2};
+    uint64_t born = 0, keep = 0;
+    for (int t = 0; t < 10; ++t) {
+      uint64_t eq = lo[t & 3] & hi[t >> 2];
+      born |= eq & rule_bm[t], keep |= eq & rule_sm[t];
+    }
+    dst[w] = (~self[w] & born) | (self[w] & keep);
+  }
+}
+
+#ifdef SIMD_X86
+/**
+ * @brief
+ * row_rule_any  AVX2 汾 GCC չÿδĸ֣µֽ
+ * row_rule_any 
+ *
+ * @param a0 һк͵ĵλ
+ * @param a1 һк͵ĸλ
+ * @param b0 к͵ĵλ
+ * @param b1 к͵ĸλ
+ * @param c0 һк͵ĵλ
+ * @param c1 һк͵ĸλ
+ * @param self еǰ״̬
+ * @param dst һ״̬
+ * @param n 
+ */
+__attribute__((target("avx2"))) void row_rule_any_avx2(
+    const uint64_t *a0, const uint64_t *a1, const uint64_t *b0,
+    const uint64_t *b1, const uint64_t *c0, const uint64_t *c1,
+    const uint64_t *self, uint64_t *dst, int n) {
+  typedef uint64_t v4 __attribute__((vector_size(32), aligned(8)));
+  v4 bm[10], sm[10];
+  for (int t = 0; t < 10; ++t) {
+    bm[t] = (v4){rule_bm[t], rule_bm[t], rule_bm[t], rule_bm[t]};
+    sm[t] = (v4){rule_sm[t], rule_sm[t], rule_sm[t], rule_sm[t]};
+  }
+  int w = 0;
+  for (; w + 4 <= n; w += 4) {
+    v4 va0 = *(const v4 *)(a0 + w), vb0 = *(const v4 *)(b0 + w);
+    v4 vc0 = *(const v4 *)(c0 + w), va1 = *(const v4 *)(a1 + w);
+    v4 vb1 = *(const v4 *)(b1 + w), vc1 = *(const v4 *)(c1 + w);
+    v4 x = *(const v4 *)(self + w);
+    v4 u0 = va0 ^ vb0 ^ vc0;
+    v4 k = (va0 & vb0) | (vc0 & (va0 ^ vb0));
+    v4 p = va1 ^ vb1, q = va1 & vb1, r = vc1 ^ k, s = vc1 & k;
+    v4 h0 = p ^ r, h1 = q ^ s ^ (p & r), h2 = q & s;
+    v4 lo[4] = {~u0 & ~h0, u0 & ~h0, ~u0 & h0, u0 & h0};
+    v4 hi[3] = {~h1 & ~h2, h1, h2};
+    v4 born = lo[0] & hi[0] & bm[0], keep = lo[0] & hi[0] & sm[0];
+    for (int t = 1; t < 10; ++t) {
+      v4 eq = lo[t & 3] & hi[t >> 2];
+      born |= eq & bm[t], keep |= eq & sm[t];
+    }
+    *(v4 *)(dst + w) = (~x & born) | (x & keep);
+  }
+  _mm256_zeroupper();
+  row_rule_any(a0 + w, a1 + w, b0 + w, b1 + w, c0 + w, c1 + w, self + w,
+               dst + w, n - w);
+}
+#endif
+
+
+#ifdef SIMD_X86
+/**
+ * @brief row_sum  SSE4.1 汾ÿδ֣µֽ row_sum 
+ *
+ * @param src ֵַ
+ * @param s0 ͵ĵλ
+ * @param s1 ͵ĸλ
+ * @param n 
+ */
+__attribute__((target("sse4.1"))) void row_sum_sse(const uint64_t *src,
+                                                   uint64_t *s0, uint64_t *s1,
+                                                   int n) {
+  int w = 0;
+  for (; w + 2 <= n; w += 2) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(src + w));
+    __m128i xl = _mm_loadu_si128((const __m128i *)(src + w - 1));
+    __m128i xr = _mm_loadu_si128((const __m128i *)(src + w + 1));
+    __m128i l = _mm_or_si128(_mm_slli_epi64(x, 1), _mm_srli_epi64(xl, 63));
+    __m128i r = _mm_or_si128(_mm_srli_epi64(x, 1), _mm_slli_epi64(xr, 63));
+    __m128i lx = _mm_xor_si128(l, x);
+    _mm_storeu_si128((__m128i *)(s0 + w), _mm_xor_si128(lx, r));
+    _mm_storeu_si128((__m128i *)(s1 + w),
+                     _mm_or_si128(_mm_and_si128(l, x), _mm_and_si128(r, lx)));
+  }
+  row_sum(src + w, s0 + w, s1 + w, n - w);
+}
+
+/**
+ * @brief row_rule  SSE4.1 汾ÿδ֣µֽ row_rule 
+ *
+ * @param a0 һк͵ĵλ
+ * @param a1 һк͵ĸλ
+ * @param b0 к͵ĵλ
+ * @param b1 к͵ĸλ
+ * @param c0 һк͵ĵλ
+ * @param c1 һк͵ĸλ
+ * @param self еǰ״̬
+ * @param dst һ״̬
+ * @param n 
+ */
+__attribute__((target("sse4.1"))) void row_rule_sse(
+    const uint64_t *a0, const uint64_t *a1, const uint64_t *b0,
+    const uint64_t *b1, const uint64_t *c0, const uint64_t *c1,
+    const uint64_t *self, uint64_t *dst, int n) {
+  int w = 0;
+  for (; w + 2 <= n; w += 2) {
+    __m128i va0 = _mm_loadu_si128((const __m128i *)(a0 + w));
+    __m128i vb0 = _mm_loadu_si128((const __m128i *)(b0 + w));
+    __m128i vc0 = _mm_loadu_si128((const __m128i *)(c0 + w));
+    __m128i va1 = _mm_loadu_si128((const __m128i *)(a1 + w));
+    __m128i vb1 = _mm_loadu_si128((const __m128i *)(b1 + w));
+    __m128i vc1 = _mm_loadu_si128((const __m128i *)(c1 + w));
+    __m128i x = _mm_loadu_si128((const __m128i *)(self + w));
+    __m128i ab = _mm_xor_si128(va0, vb0);
+    __m128i u0 = _mm_xor_si128(ab, vc0);
+    __m128i k = _mm_or_si128(_mm_and_si128(va0, vb0), _mm_and_si128(vc0, ab));
+    __m128i p = _mm_xor_si128(va1, vb1), q = _mm_and_si128(va1, vb1);
+    __m128i r = _mm_xor_si128(vc1, k), t = _mm_and_si128(vc1, k);
+    __m128i qt = _mm_or_si128(q, t);
+    __m128i one = _mm_andnot_si128(qt, _mm_xor_si128(p, r));
+    __m128i two = _mm_or_si128(_mm_and_si128(p, r),
+                               _mm_andnot_si128(_mm_or_si128(p, r),
+                                                _mm_xor_si128(q, t)));
+    __m128i res = _mm_or_si128(_mm_and_si128(u0, one),
+                               _mm_andnot_si128(u0, _mm_and_si128(two, x)));
+    _mm_storeu_si128((__m128i *)(dst + w), res);
+  }
+  row_rule(a0 + w, a1 + w, b0 + w, b1 + w, c0 + w, c1 + w, self + w, dst + w,
+           n - w);
+}
+
+/**
+ * @brief row_sum  AVX2 汾ÿδĸ֣µֽ row_sum 
+ *
+ * @param src ֵַ
+ * @param s0 ͵ĵλ
+ * @param s1 ͵ĸλ
+ * @param n 
+ */
+__attribute__((target("avx2"))) void row_sum_avx2(const uint64_t *src,
+                                                  uint64_t *s0, uint64_t *s1,
+                                                  int n) {
+  int w = 0;
+  for (; w + 4 <= n; w += 4) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(src + w));
+    __m256i xl = _mm256_loadu_si256((const __m256i *)(src + w - 1));
+    __m256i xr = _mm256_loadu_si256((const __m256i *)(src + w + 1));
+    __m256i l =
+        _mm256_or_si256(_mm256_slli_epi64(x, 1), _mm256_srli_epi64(xl, 63));
+    __m256i r =
+        _mm256_or_si256(_mm256_srli_epi64(x, 1), _mm256_slli_epi64(xr, 63));
+    __m256i lx = _mm256_xor_si256(l, x);
+    _mm256_storeu_si256((__m256i *)(s0 + w), _mm256_xor_si256(lx, r));
+    _mm256_storeu_si256(
+        (__m256i *)(s1 + w),
+        _mm256_or_si256(_mm256_and_si256(l, x), _mm256_and_si256(r, lx)));
+  }
+  _mm256_zeroupper();
+  row_sum(src + w, s0 + w, s1 + w, n - w);
+}
+
+/**
+ * @brief row_rule  AVX2 汾ÿδĸ֣µֽ row_rule 
+ *
+ * @param a0 һк͵ĵλ
+ * @param a1 һк͵ĸλ
+ * @param b0 к͵ĵλ
+ * @param b1 к͵ĸλ
+ * @param c0 һк͵ĵλ
+ * @param c1 һк͵ĸλ
+ * @param self еǰ״̬
+ * @param dst һ״̬
+ * @param n 
+ */
+__attribute__((target("avx2"))) void row_rule_avx2(
+    const uint64_t *a0, const uint64_t *a1, const uint64_t *b0,
+    const uint64_t *b1, const uint64_t *c0, const uint64_t *c1,
+    const uint64_t *self, uint64_t *dst, int n) {
+  int w = 0;
+  for (; w + 4 <= n; w += 4) {
+    __m256i va0 = _mm256_loadu_si256((const __m256i *)(a0 + w));
+    __m256i vb0 = _mm256_loadu_si256((const __m256i *)(b0 + w));
+    __m256i vc0 = _mm256_loadu_si256((const __m256i *)(c0 + w));
+    __m256i va1 = _mm256_loadu_si256((const __m256i *)(a1 + w));
+    __m256i vb1 = _mm256_loadu_si256((const __m256i *)(b1 + w));
+    __m256i vc1 = _mm256_loadu_si256((const __m256i *)(c1 + w));
+    __m256i x = _mm256_loadu_si256((const __m256i *)(self + w));
+    __m256i ab = _mm256_xor_si256(va0, vb0);
+    __m256i u0 = _mm256_xor_si256(ab, vc0);
+    __m256i k =
+        _mm256_or_si256(_mm256_and_si256(va0, vb0), _mm256_and_si256(vc0, ab));
+    __m256i p = _mm256_xor_si256(va1, vb1), q = _mm256_and_si256(va1, vb1);
+    __m256i r = _mm256_xor_si256(vc1, k), t = _mm256_and_si256(vc1, k);
+    __m256i qt = _mm256_or_si256(q, t);
+    __m256i one = _mm256_andnot_si256(qt, _mm256_xor_si256(p, r));
+    __m256i two = _mm256_or_si256(
+        _mm256_and_si256(p, r),
+        _mm256_andnot_si256(_mm256_or_si256(p, r), _mm256_xor_si256(q, t)));
+    __m256i res =
+        _mm256_or_si256(_mm256_and_si256(u0, one),
+                        _mm256_andnot_si256(u0, _mm256_and_si256(two, x)));
+    _mm256_storeu_si256((__m256i *)(dst + w), res);
+  }
+  _mm256_zeroupper();
+  row_rule(a0 + w, a1 + w, b0 + w, b1 + w, c0 + w, c1 + w, self + w, dst + w,
+           n - w);
+}
+#endif
+
+/**
+ * @brief
+ *  CPU ֵָ֧ѡкγ AVX2  SSE4.1
+ * 汾߽λͬ LIFE_SIMD Ϊ avx2  sse4.1 
+ * scalar ƿʹõָ
+ *
+ */
+void select_kernels() {
+  const char *env = getenv("LIFE_SIMD");
+  int level = 2;
+  if (env != NULL && strcmp(env, "sse4.1") == 0) {
+    level = 1;
+  } else if (env != NULL && strcmp(env, "scalar") == 0) {
+    level = 0;
+  }
+  use_kernels(level);
+}
+
+/**
+ * @brief
+ * ѡ񲻳 level ġ CPU ֵ֧ںˡ B3/S23 ʹרŵںˣʹ
+ * row_rule_any ϵУ SSE4.1 ûеİ汾ʹñ汾
+ *
+ * @param level 0 Ϊ 1 Ϊ SSE4.1  2 Ϊ AVX2
+ */
+void use_kernels(int level) {
+  int life = rule_birth == 1 << 3 && rule_survive == (1 << 2 | 1 << 3);
+  kernel_level = level;
+  rule_fn = life ? row_rule : row_rule_any;
+  row_sum_fn = row_sum, row_rule_fn = rule_fn, kernel_name = "scalar";
+  stats_row_fn = stats_row;
+#ifdef SIMD_X86
+  __builtin_cpu_init();
+  if (level >= 2 && __builtin_cpu_supports("avx2") &&
+      __builtin_cpu_supports("popcnt")) {
+    stats_row_fn = stats_row_avx2;
+  } else if (level >= 1 && __builtin_cpu_supports("popcnt")) {
+    stats_row_fn = stats_row_popcnt;
+  }
+  if (level >= 2 && __builtin_cpu_supports("avx2")) {
+    row_sum_fn = row_sum_avx2;
+    row_rule_fn = life ? row_rule_avx2 : row_rule_any_avx2;
+    kernel_name = "avx2";
+  } else if (level >= 1 && __builtin_cpu_supports("sse4.1")) {
+    row_sum_fn = row_sum_sse;
+    row_rule_fn = life ? row_rule_sse : row_rule_any;
+    kernel_name = "sse4.1";
+  }
+#endif
+}
+
+/**
+ * @brief
+ *  B/S ַ֧ B3/S23  S23/B3 ִСд봫ͳ 23/3
+ * /дֻΪ 0  8 
+ *
+ * @param str ַ
+ * @param birth λã n λʾ n ھʱ
+ * @param survive λã n λʾ n ھʱ
+ * @return int ɹΪ1ʽΪ0
+ */
+int parse_rule(const char *str, int *birth, int *survive) {
+  const char *slash = strchr(str, '/');
+  if (slash == NULL || strchr(slash + 1, '/') != NULL) {
+    return 0;
+  }
+  int mask[2] = {0, 0}, kind[2] = {-1, -1};
+  for (int part = 0; part < 2; ++part) {
+    const char *c = part == 0 ? str : slash + 1;
+    const char *end = part == 0 ? slash : slash + 1 + strlen(slash + 1);
+    if (c < end && (*c == 'b' || *c == 'B')) {
+      kind[part] = 0, c++;
+    } else if (c < end && (*c == 's' || *c == 'S')) {
+      kind[part] = 1, c++;
+    }
+    for (; c < end; ++c) {
+      if (*c < '0' || *c > '8') {
+        return 0;
+      }
+      mask[part] |= 1 << (*c - '0');
+    }
+  }
+  if (kind[0] == -1 && kind[1] == -1) {
+    *survive = mask[0], *birth = mask[1];
+    return 1;
+  }
+  if (kind[0] == -1 || kind[1] == -1 || kind[0] == kind[1]) {
+    return 0;
+  }
+  *birth = mask[kind[0] == 0 ? 0 : 1], *survive = mask[kind[0] == 1 ? 0 : 1];
+  return 1;
+}
+
+/**
+ * @brief ѹд B3/S23 ʽַ
+ *
+ * @param birth 
+ * @param survive 
+ * @param out ַλã 24 ֽ
+ */
+void format_rule(int birth, int survive, char *out) {
+  int n = 0;
+  out[n++] = 'B';
+  for (int i = 0; i <= 8; ++i) {
+    if (birth >> i & 1) out[n++] = (char)('0' + i);
+  }
+  out[n++] = '/', out[n++] = 'S';
+  for (int i = 0; i <= 8; ++i) {
+    if (survive >> i & 1) out[n++] = (char)('0' + i);
+  }
+  out[n] = '\0';
+}
+
+/**
+ * @brief
+ * 򣺰ѳչΪŹȫ 0 ȫ 1
+ * 룬ɲıѡںˡ B3/S23 ʹרŵ row_rule ϵУʹ row_rule_any ϵС
+ *
+ */
+void compile_rule() {
+  for (int t = 0; t < 10; ++t) {
+    rule_bm[t] = t <= 8 && (rule_birth >> t & 1) ? ~(uint64_t)0 : 0;
+    rule_sm[t] = t >= 1 && (rule_survive >> (t - 1) & 1) ? ~(uint64_t)0 : 0;
+  }
+  build_lut();
+  use_kernels(kernel_level);
+}
+
+/**
+ * @brief
+ * ǰɲıÿ 4x4 飬ĸϸľŹõһ
+ * 65536 ÿлʱɡ
+ *
+ */
+void build_lut() {
+  for (int idx = 0; idx < 1 << 16; ++idx) {
+    int out = 0;
+    for (int y = 1; y <= 2; ++y) {
+      for (int x = 1; x <= 2; ++x) {
+        int alive = 0;
+        for (int i = y - 1; i <= y + 1; ++i) {
+          for (int j = x - 1; j <= x + 1; ++j) {
+            alive += idx >> (4 * i + j) & 1;
+          }
+        }
+        int next = (idx >> (4 * y + x) & 1) ? rule_survive >> (alive - 1) & 1
+                                            : rule_birth >> alive & 1;
+        out |= next << (2 * (y - 1) + x - 1);
+      }
+    }
+    lut[idx] = (uint8_t)out;
+  }
+}
+
+/**
+ * @brief
+ * ò r0  r1 - 1 С w0  w1 - 1 ֵһдһ塣ÿȡм¸һУÿȡ
+ * 4 λƴ±꣬һβõ 2x2 ϸÿһλֵλʹ 2k  2k + 1
+ * еǡλڵ 2k  2k + 3 λĩҲ֣ƴӡΪʱһеֻȡϰ
+ *
+ * @param r0 ʼ
+ * @param r1 У
+ * @param w0 ʼ
+ * @param w1 ֣
+ */
+void lut_rows(int r0, int r1, int w0, int w1) {
+  uint64_t tail = tail_mask();
+  for (int i = r0; i < r1; i += 2) {
+    const uint64_t *p[4] = {row_ptr(map, i - 1), row_ptr(map, i),
+                            row_ptr(map, i + 1),
+                            row_ptr(map, i + 2 <= row ? i + 2 : i + 1)};
+    uint64_t *d0 = row_ptr(next_map, i), *d1 = row_ptr(next_map, i + 1);
+    int pair = i + 1 < r1;
+    for (int w = w0; w < w1; ++w) {
+      uint64_t lo[4];
+      unsigned last = 0;
+      for (int r = 0; r < 4; ++r) {
+        lo[r] = (p[r][w] << 1) | (p[r][w - 1] >> 63);
+        last |= (unsigned)((p[r][w] >> 61) | (p[r][w + 1] & 1) << 3) << 4 * r;
+      }
+      uint64_t a = 0, b = 0;
+      for (int s = 0; s < 62; s += 2) {
+        unsigned t = lut[(lo[0] >> s & 15) | (lo[1] >> s & 15) << 4 |
+                         (lo[2] >> s & 15) << 8 | (lo[3] >> s & 15) << 12];
+        a |= (uint64_t)(t & 3) << s;
+        b |= (uint64_t)(t >> 2) << s;
+      }
+      a |= (uint64_t)(lut[last] & 3) << 62;
+      b |= (uint64_t)(lut[last] >> 2) << 62;
+      if (w == words - 1) {
+        a &= tail, b &= tail;
+      }
+      d0[w] = a;
+      if (pair) {
+        d1[w] = b;
+      }
+    }
+  }
+}
+
+/**
+ * @brief
+ *  id һ generate_band
+ * ͬÿУݻڻиеĹϣδ⵽ʱͳƣͳʱ
+ *
+ * @param id ̱߳
+ */
+void generate_lut_band(int id) {
+  int r0 = (int)((long long)row * id / threads);
+  int r1 = (int)((long long)row * (id + 1) / threads);
+  uint64_t tail = tail_mask();
+  hash_delta[id] = 0;
+  memset(&band_stats[id], 0, sizeof(life_stats));
+  PROF_START(band);
+  for (int i = r0; i < r1; i += 2) {
+    int i1 = i + 2 < r1 ? i + 2 : r1;
+    PROF_SAMPLE(lap, (i - r0) / 2);
+    lut_rows(i, i1, 0, words);
+    PROF_LAP(id, PROF_RULE, lap);
+    for (int k = i; k < i1; ++k) {
+      if (history_on && !period) {
+        hash_row(row_ptr(map, k), row_ptr(next_map, k), k, &hash_delta[id]);
+      }
+      if (stats_on) {
+        stats_row_fn(row_ptr(map, k), row_ptr(next_map, k), words, k, 0, tail,
+                     &band_stats[id]);
+      }
+    }
+    PROF_LAP(id, PROF_REST, lap);
+  }
+  PROF_BAND(id, band, r1 - r0, 64.0 * words * (r1 - r0));
+}
+
+/**
+ * @brief
+ * ù򡣳 0 ĹõͼĿհ״ֻ߽İλ档
+ * HashLife Ľգ֮ engine_attach ؽ
+ *
+ * @param birth 
+ * @param survive 
+ * @return int ɹΪ1뵱ǰ߽ģʽͻΪ0
+ */
+int set_rule(int birth, int survive) {
+  if ((birth & 1) &&
+      (engine == ENGINE_HASHLIFE || boundary == BOUNDARY_INFINITE)) {
+    printf("set_rule: error: B0 rules need a dead or torus boundary\n");
+    return 0;
+  }
+  rule_birth = birth, rule_survive = survive;
+  compile_rule();
+  if (engine == ENGINE_HASHLIFE) {
+    hl_reset();
+  }
+  return 1;
+}
+
+/**
+ * @brief ʾù
+ *
+ * @param arg ַ
+ */
+void choose_rule(char *arg) {
+  int b, s;
+  if (strcmp(arg, EMPTY) != 0) {
+    if (!parse_rule(arg, &b, &s)) {
+      printf("choose_rule: error: unknown rule: %s\n", arg);
+      return;
+    }
+    if (!set_rule(b, s)) {
+      return;
+    }
+    engine_attach();
+  }
+  char name[24];
+  format_rule(rule_birth, rule_survive, name);
+  printf("rule = %s\n", name);
+}
+
+/**
+ * @brief
+ * в [-t|--threads N] ָʱʹõ߳ --in
+ * ʱģʽ --in Ϊͼ --gens Ϊɴ --out Ϊͼ
+ * --engine  --boundary ѡ߽ģʽ --detect ڼ⣬ʾͼȴ롣 --bench
+ * л׼ԣ --check вֲԡ --rule ָֻһΣ׼漴
+ * set_rule ãģʽ run_batch ѡ߽ãǵͼļеĹ
+ *
+ * @param argc 
+ * @param argv б
+ * @return int ɹΪ1Ϊ0
+ */
+int parse_options(int argc, char *argv[]) {
+  int n = 1, ok = 1;
+  for (int i = 1; i < argc && ok; ++i) {
+    if ((strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--threads") == 0) &&
+        i + 1 < argc) {
+      n = atoi(argv[++i]);
+      if (n <= 0 || n > TMAX) {
+        printf("error: thread count must be between 1 and %d\n", TMAX);
+        return 0;
+      }
+    } else if (strcmp(argv[i], "--bench") == 0) {
+      bench = 1;
+    } else if (strcmp(argv[i], "--check") == 0) {
+      check = 1;
+    } else if (strcmp(argv[i], "--rule") == 0 && i + 1 < argc) {
+      ok = parse_rule(argv[++i], &batch_birth, &batch_survive);
+    } else if (strcmp(argv[i], "--in") == 0 && i + 1 < argc) {
+      batch_in = argv[++i];
+    } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+      batch_out = argv[++i];
+    } else if (strcmp(argv[i], "--detect") == 0) {
+      detect = 1;
+    } else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+      batch_stats = argv[++i];
+    } else if (strcmp(argv[i], "--gens") == 0 && i + 1 < argc) {
+      char *end;
+      batch_gens = strtoll(argv[++i], &end, 10);
+      ok = *end == '\0' && batch_gens >= 0 && batch_gens <= GENS_MAX;
+    } else if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+      batch_engine = argv[++i];
+      ok = strcmp(batch_engine, "bitwise") == 0 ||
+           strcmp(batch_engine, "lut") == 0 ||
+           strcmp(batch_engine, "hashlife") == 0;
+    } else if (strcmp(argv[i], "--boundary") == 0 && i + 1 < argc) {
+      batch_boundary = argv[++i];
+      ok = strcmp(batch_boundary, "dead") == 0 ||
+           strcmp(batch_boundary, "infinite") == 0 ||
+           strcmp(batch_boundary, "torus") == 0;
+    } else {
+      ok = 0;
+    }
+  }
+  if (!ok || bench + check + (batch_in != NULL) > 1 ||
+      (batch_in == NULL && (batch_out != NULL || batch_stats != NULL ||
+                            batch_gens != 0 || detect ||
+                            batch_engine != NULL || batch_boundary != NULL))) {
+    printf("usage: %s [-t|--threads N]\n", argv[0]);
+    printf("       %s --in FILE [--gens N] [--out FILE] [--stats FILE.csv] "
+           "[--engine bitwise|lut|hashlife] [--boundary dead|infinite|torus] "
+           "[--rule B3/S23] [--detect] [-t|--threads N]\n",
+           argv[0]);
+    printf("       %s --bench [--rule B3/S23] [-t|--threads N]\n", argv[0]);
+    printf("       %s --check [-t|--threads N]\n", argv[0]);
+    return 0;
+  }
+  if (batch_birth >= 0 && batch_in == NULL) {
+    set_rule(batch_birth, batch_survive);
+  }
+  start_workers(n);
+  return 1;
+}
+
+/**
+ * @brief
+ *  gens  HashLife һǰ gens ٰѵͼΧڵϸдصͼ
+ * generate_next_status
+ * һ⵽ͼΪ񵴣ֱµڣֻɲһڵĴͬ
+ * ĳһʧܣƽڴ治㣩ʱͣ£ʱ generation Ԥڡ
+ *
+ * @param gens 
+ * @return long long ʵʼĴ
+ */
+long long advance(long long gens) {
+  if (gens <= 0) {
+    return 0;
+  }
+  if (engine == ENGINE_HASHLIFE) {
+    hl_advance((uint64_t)gens);
+    hl_to_map();
+    generation += gens;
+    return gens;
+  }
+  long long done = 0;
+  for (long long g = 0; g < gens; ++g) {
+    if (period) {
+      long long skip = (gens - g) / period * period;
+      generation += skip, g += skip;
+      if (g == gens) {
+        break;
+      }
+    }
+    if (!generate_next_status()) {
+      break;
+    }
+    done++;
+  }
+  return done;
+}
+
+/**
+ * @brief
+ * ģʽ batch_in ѡ߽ģʽ batch_gens 浽
+ * batch_out ʾʱÿɵĴϸյĹ --rule ļеĹ򣩡߽һμǷݣ
+ * hashlife ֻ֧ infinite  lut ֧ infinite  B0 Ĺ֧ infinite ʱ˳
+ * ʱʱĬϵ bitwise ߽磬 set_rule  choose_engine  set_boundary
+ * öʧܣֻƽڴ治ʱ engine_attach ỻ߽磬ʱͬ˳ batch_stats ʱͳƲд CSV
+ * ļдҲʧܡ;ʧܣƽڴ治㣩ʱ档
+ *  LIFE_PROFILE ʱʾ׶εʱӲ
+ *
+ * @return int ɹΪ0ʧΪ1
+ */
+int run_batch() {
+  PROF_ENTER(PROF_LOAD);
+  load_map(batch_in);
+  PROF_LEAVE(PROF_LOAD, is_map ? (double)row * col : 0);
+  if (!is_map) {
+    stop_workers();
+    return 1;
+  }
+  int birth = batch_birth >= 0 ? batch_birth : rule_birth;
+  int hashlife = batch_engine != NULL && strcmp(batch_engine, "hashlife") == 0;
+  int lut_engine = batch_engine != NULL && strcmp(batch_engine, "lut") == 0;
+  int plane =
+      batch_boundary != NULL && strcmp(batch_boundary, "infinite") == 0;
+  int infinite = hashlife || plane;
+  const char *error = NULL;
+  if (hashlife && batch_boundary != NULL && !plane) {
+    error = "hashlife only supports infinite";
+  } else if (lut_engine && infinite) {
+    error = "lut only supports dead and torus";
+  } else if ((birth & 1) && infinite) {
+    error = "B0 rules need a dead or torus boundary";
+  }
+  if (error != NULL) {
+    printf("batch: error: %s\n", error);
+    stop_workers();
+    return 1;
+  }
+  if (batch_birth >= 0) {
+    set_rule(batch_birth, batch_survive);
+  }
+  if (batch_engine != NULL) {
+    choose_engine(batch_engine);
+  }
+  if (batch_boundary != NULL) {
+    set_boundary(batch_boundary);
+  }
+  if (infinite && boundary != BOUNDARY_INFINITE) {
+    stop_workers();
+    return 1;
+  }
+  if (batch_stats != NULL) {
+    if (!open_stats_csv(batch_stats)) {
+      stop_workers();
+      return 1;
+    }
+    stats_on = 1;
+    scan_stats();
+    write_stats();
+  }
+  double start = now_seconds();
+  long long gen0 = generation;
+  long long done = advance(batch_gens);
+  double secs = now_seconds() - start;
+  int saved = generation == gen0 + batch_gens;
+  double cells = (double)row * col * (double)done;
+  char buf[LEN];
+  printf("generations = %lld, computed = %lld, time = %.3f s\n", batch_gens,
+         done, secs);
+  if (describe_history(buf)) {
+    printf("%s, stopped early\n", buf);
+  }
+  if (secs > 0) {
+    printf("%.1f generations/s, %.3e cells/s, %.3f ns/cell\n", done / secs,
+           cells / secs, cells > 0 ? secs * 1e9 / cells : 0);
+  }
+  if (!saved) {
+    printf("generation %lld reached, stopped early\n", generation);
+  } else if (batch_out != NULL) {
+    PROF_ENTER(PROF_SAVE);
+    saved = save_map(batch_out);
+    PROF_LEAVE(PROF_SAVE, (double)row * col);
+  }
+  saved &= close_stats_csv();
+#ifdef LIFE_PROFILE
+  show_profile(EMPTY);
+#endif
+  stop_workers();
+  return !saved;
+}
+
+/**
+ * @brief
+ * һ n x n Ļ׼Եͼ0  2 Ϊܶ 10%  35%  50%
+ * ͼ̶ӣ 3 Ϊ R-pentomino  4 Ϊĸ˹ǹ 5
+ * Ϊյͼ 6 Ϊľ
+ *
+ * @param workload 
+ * @param n ߳
+ * @return int ɹΪ1ڴ治Ϊ0
+ */
+int bench_fill(int workload, int n) {
+  static const int rpent[5][2] = {{0, 1}, {0, 2}, {1, 0}, {1, 1}, {2, 1}};
+  static const int gun[36][2] = {
+      {0, 24}, {1, 22}, {1, 24}, {2, 12}, {2, 13}, {2, 20}, {2, 21}, {2, 34},
+      {2, 35}, {3, 11}, {3, 15}, {3, 20}, {3, 21}, {3, 34}, {3, 35}, {4, 0},
+      {4, 1},  {4, 10}, {4, 16}, {4, 20}, {4, 21}, {5, 0},  {5, 1},  {5, 10},
+      {5, 14}, {5, 16}, {5, 17}, {5, 22}, {5, 24}, {6, 10}, {6, 16}, {6, 24},
+      {7, 11}, {7, 15}, {8, 12}, {8, 13}};
+  if (!clear_map(n, n)) {
+    return 0;
+  }
+  is_map = 1;
+  if (workload <= 2) {
+    static const int density[3] = {10, 35, 50};
+    for (int i = 0; i < n; ++i) {
+      for (int j = 0; j < n; ++j) {
+        if (hl_hash((uint64_t)i * n + j + 1) % 100 < (uint64_t)density[workload]) {
+          set_cell(i, j, 1);
+        }
+      }
+    }
+  } else if (workload == 3) {
+    for (int k = 0; k < 5; ++k) {
+      set_cell(n / 2 + rpent[k][0], n / 2 + rpent[k][1], 1);
+    }
+  } else if (workload == 4) {
+    for (int k = 0; k < 36; ++k) {
+      set_cell(n / 2 - 4 + gun[k][0], n / 2 - 18 + gun[k][1], 1);
+    }
+  } else if (workload == 6) {
+    for (int i = 0; i + 1 < n; i += 3) {
+      for (int j = 0; j + 1 < n; j += 3) {
+        set_run(i, j, 2);
+        set_run(i + 1, j, 2);
+      }
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief
+ * ֱ桢߽ģʽϡģʽ HashLife ƽ״̬ӵͼؽ HashLife
+ * ÿǰһ׼ֲʹãʾκϢ
+ *
+ * @param eng 
+ * @param bnd ߽ģʽ
+ * @param sp Ƿϡģʽ
+ */
+void configure_engine(int eng, int bnd, int sp) {
+  hl_reset();
+  pl_reset();
+  engine = eng, boundary = bnd, sparse = sp;
+  hl_k = 0;
+  engine_attach();
+}
+
+/**
+ * @brief ȡΪֹפڴ档
+ *
+ * @return long long ǧֽ޷ȡʱΪ -1
+ */
+long long peak_rss_kb() {
+#ifdef _WIN32
+  return -1;
+#else
+  struct rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru) != 0) {
+    return -1;
+  }
+#ifdef __APPLE__
+  return (long long)ru.ru_maxrss / 1024;
+#else
+  return (long long)ru.ru_maxrss;
+#endif
+#endif
+}
+
+/**
+ * @brief
+ * ׼ģʽÿֵͼÿ߳ÿ棬ֱʱﵽ BENCH_TIME
+ * 룬 JSON ʱÿÿϸÿϸפڴ档פڴΪķֵֻ
+ *
+ * @return int ɹΪ0ڴ治Ϊ1
+ */
+int run_bench() {
+  static const char *workloads[] = {"soup10",     "soup35", "soup50",
+                                    "rpentomino", "gun",    "empty",
+                                    "still_life"};
+  static const char *engines[] = {"bitwise",  "sparse",   "infinite",
+                                  "hashlife", "lut"};
+  static const int sizes[] = {256, 1024, 4096};
+  printf("{\n  \"kernel\": \"%s\",\n  \"threads\": %d,\n  \"results\": [",
+         kernel_name, threads);
+  int first = 1;
+  for (int w = 0; w < 7; ++w) {
+    for (int s = 0; s < 3; ++s) {
+      for (int e = 0; e < 5; ++e) {
+        if (!bench_fill(w, sizes[s])) {
+          printf("\n  ]\n}\n");
+          stop_workers();
+          return 1;
+        }
+        configure_engine(e == 3   ? ENGINE_HASHLIFE
+                         : e == 4 ? ENGINE_LUT
+                                  : ENGINE_BITWISE,
+                         e == 2 || e == 3 ? BOUNDARY_INFINITE : BOUNDARY_DEAD,
+                         e == 1);
+        long long gens = 0;
+        double start = now_seconds(), secs;
+        do {
+          generate_next_status();
+          gens++;
+          secs = now_seconds() - start;
+        } while (secs < BENCH_TIME);
+        double cells = (double)sizes[s] * sizes[s] * (double)gens;
+        printf("%s\n    {\"workload\": \"%s\", \"size\": %d, \"engine\": "
+               "\"%s\", \"generations\": %lld, \"seconds\": %.6f, "
+               "\"gens_per_s\": %.3f, \"cells_per_s\": %.6e, \"ns_per_cell\": "
+               "%.6f, \"peak_rss_kb\": %lld}",
+               first ? "" : ",", workloads[w], sizes[s], engines[e], gens, secs,
+               gens / secs, cells / secs, secs * 1e9 / cells, peak_rss_kb());
+        fflush(stdout);
+        first = 0;
+      }
+    }
+  }
+  printf("\n  ]\n}\n");
+  configure_engine(ENGINE_BITWISE, BOUNDARY_DEAD, 0);
+  stop_workers();
+  return 0;
+}
+
+/**
+ * @brief
+ * οʵ֣ count_alive_neighbors һھٰ rule_birth 
+ * rule_survive ͼΪÿһֽڵ r x c 顣 torus
+ * Ϊ1ʱ¡ӣȰѵͼͬƹһȦ߿Ƶ (r + 2) x (c + 2)  pad
+ * Ум߽Ϊֱ g ϼ
+ *
+ * @param g ǰһ
+ * @param out һ
+ * @param pad ʱʹõĻ壬 (r + 2) * (c + 2) ֽ
+ * @param r 
+ * @param c 
+ * @param torus ǷΪ
+ */
+void ref_step(const uint8_t *g, uint8_t *out, uint8_t *pad, int r, int c,
+              int torus) {
+  const uint8_t *s = g;
+  int sr = r, sc = c, o = 0;
+  if (torus) {
+    sr = r + 2, sc = c + 2, o = 1, s = pad;
+    for (int i = 0; i < sr; ++i) {
+      for (int j = 0; j < sc; ++j) {
+        pad[(size_t)i * sc + j] =
+            g[(size_t)((i - 1 + r) % r) * c + (j - 1 + c) % c];
+      }
+    }
+  }
+  for (int x = 0; x < r; ++x) {
+    for (int y = 0; y < c; ++y) {
+      int alive = count_alive_neighbors(s, sr, sc, x + o, y + o);
+      uint8_t self = g[(size_t)x * c + y];
+      out[(size_t)x * c + y] =
+          (uint8_t)((self ? rule_survive : rule_birth) >> alive & 1);
+    }
+  }
+}
+
+/**
+ * @brief
+ * 㵱ǰͼ 64 λϣֻϣÿһȽȥλֻȡڵͼڵϸ
+ *
+ * @return uint64_t ϣֵ
+ */
+uint64_t map_hash() {
+  uint64_t h = (uint64_t)row << 32 | (uint32_t)col;
+  uint64_t tail = tail_mask();
+  for (int i = 0; i < row; ++i) {
+    const uint64_t *p = row_ptr(map, i);
+    for (int w = 0; w < words; ++w) {
+      h = hl_hash(h ^ (w == words - 1 ? p[w] & tail : p[w]));
+    }
+  }
+  return h;
+}
+
+/**
+ * @brief
+ * 鵱ǰͼı߿ÿжλǷȫΪ 0  clear_halo
+ * ֮״ֻ̬дڼؿֲԡ
+ *
+ * @return int ȫΪ 0 ʱΪ1Ϊ0
+ */
+int map_clean() {
+  for (int i = -1; i <= row; ++i) {
+    const uint64_t *p = row_ptr(map, i);
+    if (i == -1 || i == row) {
+      for (int w = -1; w < stride - 1; ++w) {
+        if (p[w]) {
+          return 0;
+        }
+      }
+    } else if (p[-1] || p[words] || (p[words - 1] & ~tail_mask())) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief
+ *  map_hash ͬķοͼһڵĹϣΪ r x c Ͻλڲοͼÿ
+ * gc ֽڣ (m, m) 
+ *
+ * @param g οͼ
+ * @param gc οͼ
+ * @param m Ͻǵ
+ * @param r 
+ * @param c 
+ * @return uint64_t ϣֵ
+ */
+uint64_t ref_hash(const uint8_t *g, int gc, int m, int r, int c) {
+  uint64_t h = (uint64_t)r << 32 | (uint32_t)c;
+  for (int i = 0; i < r; ++i) {
+    const uint8_t *p = g + (size_t)(i + m) * gc + m;
+    for (int j = 0; j < c; j += 64) {
+      uint64_t x = 0;
+      for (int k = 0; k < 64 && j + k < c; ++k) {
+        x |= (uint64_t)p[j + k] << k;
+      }
+      h = hl_hash(h ^ x);
+    }
+  }
+  return h;
+}
+
+/**
+ * @brief
+ * ɲοͼ¾ͳƽڼͳơȥ m
+ * 뱻ͼһ¡
+ *
+ * @param g һοͼ
+ * @param h һοͼ
+ * @param gr οͼ
+ * @param gc οͼ
+ * @param m ĸ
+ * @param st ͳƽ
+ */
+void ref_stats(const uint8_t *g, const uint8_t *h, int gr, int gc, int m,
+               life_stats *st) {
+  life_stats s = {0, 0, 0, 0, 0, 0, 0, 0};
+  for (int i = 0; i < gr; ++i) {
+    for (int j = 0; j < gc; ++j) {
+      int a = h[(size_t)i * gc + j], b = g[(size_t)i * gc + j];
+      s.births += b && !a, s.deaths += a && !b;
+      if (b) {
+        life_stats one = {0, 1, 0, 0, i - m, j - m, i - m, j - m};
+        merge_stats(&s, &one);
+      }
+    }
+  }
+  *st = s;
+}
+
+/**
+ * @brief
+ * òοʵּһһŵͼϵĽͼΪ r x c  fill 0
+ * Ϊգ 1 ΪȫΪ fill Ϊӡܶ 35% ͼÿȽϵǰͼοͼĹϣ
+ * jump Ϊ1ʱΪһǰ gens ȽһΣ infinite ðƽת HashLife
+ * Ĳǰתأ fast_forward ƽĲοͼܸ gens + 2
+ * 񣬱֤ϸ˲οͼı߽硣ʱͬʱȽͳɲοͼõͳƣ޵ͼ߿λΪ
+ * 0 ޵ͼתΪƽ棬ȽϴӾΣģⱣл߽ʱλΡһʱһͬϸ
+ *
+ * @param cfg ñţ run_check
+ * @param r 
+ * @param c 
+ * @param fill ͼ
+ * @param gens 
+ * @param jump Ƿһǰ
+ * @return int һΪ1һ»ڴ治Ϊ0
+ */
+int check_case(int cfg, int r, int c, int fill, int gens, int jump) {
+  static const char *names[] = {"bitwise/dead", "sparse/dead", "bitwise/torus",
+                                "sparse/torus", "infinite",    "hashlife",
+                                "lut/dead",     "lut/torus",   "lut/sparse"};
+  int infinite = cfg == 4 || cfg == 5;
+  int torus = cfg == 2 || cfg == 3 || cfg == 7 || cfg == 8;
+  int m = infinite ? gens + 2 : 0, gr = r + 2 * m, gc = c + 2 * m;
+  uint8_t *g = calloc((size_t)gr * gc, 1), *h = calloc((size_t)gr * gc, 1);
+  uint8_t *pad = malloc((size_t)(gr + 2) * (gc + 2));
+  if (g == NULL || h == NULL || pad == NULL || !clear_map(r, c)) {
+    free(g);
+    free(h);
+    free(pad);
+    printf("check: error: out of memory\n");
+    return 0;
+  }
+  is_map = 1;
+  for (int i = 0; i < r; ++i) {
+    for (int j = 0; j < c; ++j) {
+      int v = fill == 1;
+      if (fill > 1) {
+        v = hl_hash((uint64_t)fill << 40 ^ ((uint64_t)i * c + j)) % 100 < 35;
+      }
+      g[(size_t)(i + m) * gc + j + m] = (uint8_t)v;
+      if (v) {
+        set_cell(i, j, 1);
+      }
+    }
+  }
+  stats_on = cfg != 5;
+  configure_engine(cfg == 5   ? ENGINE_HASHLIFE
+                   : cfg >= 6 ? ENGINE_LUT
+                              : ENGINE_BITWISE,
+                   infinite ? BOUNDARY_INFINITE
+                   : torus  ? BOUNDARY_TORUS
+                            : BOUNDARY_DEAD,
+                   cfg == 1 || cfg == 3 || cfg == 8);
+  int ok = 1;
+  for (int t = 1; t <= gens && ok; ++t) {
+    ref_step(g, h, pad, gr, gc, torus);
+    uint8_t *s = g;
+    g = h, h = s;
+    if (jump && t < gens) {
+      continue;
+    }
+    if (jump && cfg == 4) {
+      hl_from_plane();
+      hl_advance((uint64_t)gens);
+      if (hl_to_plane()) {
+        pl_to_map();
+      }
+      hl_reset();
+    } else if (jump) {
+      advance(gens);
+    } else {
       generate_next_status();
-      print_map();
-    } else if (strcmp(buff, RUN) == 0 && strcmp(filename, EMPTY) == 0) {
-      auto_run();
-    } else if (strcmp(buff, EXIT) == 0 && strcmp(filename, EMPTY) == 0) {
-      printf("This command is only available in auto_run mode.\n");
-    } else if (strcmp(buff, QUIT) == 0 && strcmp(filename, EMPTY) == 0) {
-      printf("This command is only available in design mode.\n");
-    } else if (strcmp(buff, PRINT) == 0 && strcmp(filename, EMPTY) == 0) {
-      print_map();
-    } else if (strcmp(buff, END) == 0 && strcmp(filename, EMPTY) == 0) {
-      printf("See you next time!\n");
+    }
+    if (history_on && !period && board_hash != full_hash(0)) {
+      printf("check: MISMATCH %s kernel=%s threads=%d board=%dx%d fill=%d "
+             "generation=%d incremental hash differs from a full rehash\n",
+             names[cfg], kernel_name, threads, r, c, fill, t);
+      ok = 0;
+      break;
+    }
+    life_stats want;
+    ref_stats(g, h, gr, gc, m, &want);
+    want.generation = stats.generation;
+    if (!jump && stats_on && memcmp(&want, &stats, sizeof(life_stats)) != 0) {
+      printf("check: MISMATCH %s kernel=%s threads=%d board=%dx%d fill=%d "
+             "generation=%d stats: population=%lld births=%lld deaths=%lld "
+             "box=%lld,%lld,%lld,%lld, expected %lld %lld %lld "
+             "%lld,%lld,%lld,%lld\n",
+             names[cfg], kernel_name, threads, r, c, fill, t, stats.population,
+             stats.births, stats.deaths, stats.top, stats.left, stats.bottom,
+             stats.right, want.population, want.births, want.deaths, want.top,
+             want.left, want.bottom, want.right);
+      ok = 0;
+      break;
+    }
+    if (!infinite && !map_clean()) {
+      printf("check: MISMATCH %s kernel=%s threads=%d board=%dx%d fill=%d "
+             "generation=%d halo or padding bits past col are set\n",
+             names[cfg], kernel_name, threads, r, c, fill, t);
+      ok = 0;
+      break;
+    }
+    if (map_hash() == ref_hash(g, gc, m, r, c)) {
+      continue;
+    }
+    ok = 0;
+    for (int i = 0; i < r; ++i) {
+      for (int j = 0; j < c; ++j) {
+        int want = g[(size_t)(i + m) * gc + j + m];
+        if (get_cell(i, j) != want) {
+          printf("check: MISMATCH %s kernel=%s threads=%d board=%dx%d fill=%d "
+                 "generation=%d cell=(%d, %d) expected=%d got=%d\n",
+                 names[cfg], kernel_name, threads, r, c, fill, t, i, j, want,
+                 !want);
+          i = r;
+          break;
+        }
+      }
+    }
+  }
+  if (ok && !infinite && !(rule_birth & 1)) {
+    life_stats want;
+    ref_stats(g, g, gr, gc, m, &want);
+    stats_on = 1;
+    configure_engine(ENGINE_BITWISE, BOUNDARY_INFINITE, 0);
+    scan_stats();
+    if (stats.population != want.population ||
+        (want.population &&
+         (stats.left != want.left || stats.right != want.right))) {
+      printf("check: MISMATCH %s kernel=%s threads=%d board=%dx%d fill=%d "
+             "converted to infinite: population=%lld columns %lld to %lld, "
+             "expected %lld columns %lld to %lld\n",
+             names[cfg], kernel_name, threads, r, c, fill, stats.population,
+             stats.left, stats.right, want.population, want.left, want.right);
+      ok = 0;
+    }
+  }
+  free(g);
+  free(h);
+  free(pad);
+  return ok;
+}
+
+/**
+ * @brief
+ * 񵴼⣺һСͼϷͼ gens
+ * رռ⣩½ٴ򿪼 advance ǰͬĴҪ⵽ԤڵʼںĵͼɵͬͼΪյͼ
+ * ϸ顢ơһΪϸϵĻ 8x8 ĻΪ 32 
+ *
+ * @param pat ͼ
+ * @param cfg ñţ run_check
+ * @param gens 
+ * @return int һΪ1Ϊ0
+ */
+int check_detect(int pat, int cfg, int gens) {
+  static const int cells[][6][2] = {
+      {{-1, 0}},
+      {{3, 3}, {-1, 0}},
+      {{1, 1}, {1, 2}, {2, 1}, {2, 2}, {-1, 0}},
+      {{2, 1}, {2, 2}, {2, 3}, {-1, 0}},
+      {{1, 1}, {1, 2}, {2, 1}, {-1, 0}},
+      {{0, 1}, {1, 2}, {2, 0}, {2, 1}, {2, 2}, {-1, 0}}};
+  static const int want[][3] = {{1, 0, 1}, {1, 1, 1},  {1, 0, 0},
+                                {2, 0, 0}, {1, 1, 0}, {32, 0, 0}};
+  int torus = cfg == 2 || cfg == 3 || cfg == 7 || cfg == 8;
+  if (pat == 5 && !torus) {
+    return 1;
+  }
+  uint64_t hash[2];
+  for (int pass = 0; pass < 2; ++pass) {
+    if (!clear_map(8, 8)) {
+      printf("check: error: out of memory\n");
+      return 0;
+    }
+    is_map = 1;
+    for (int k = 0; cells[pat][k][0] >= 0; ++k) {
+      set_cell(cells[pat][k][0], cells[pat][k][1], 1);
+    }
+    configure_engine(cfg >= 6 ? ENGINE_LUT : ENGINE_BITWISE,
+                     torus ? BOUNDARY_TORUS : BOUNDARY_DEAD,
+                     cfg == 1 || cfg == 3 || cfg == 8);
+    if (pass == 0) {
+      history_on = 0;
+      for (int t = 0; t < gens; ++t) {
+        generate_next_status();
+      }
+    } else {
+      advance(gens);
+    }
+    hash[pass] = map_hash();
+  }
+  if (period != want[pat][0] || settled_at != want[pat][1] ||
+      extinct != want[pat][2] || generation != gens || hash[0] != hash[1]) {
+    printf("check: MISMATCH detect pattern=%d cfg=%d period=%d settled_at=%lld "
+           "extinct=%d generation=%lld same_board=%d\n",
+           pat, cfg, period, settled_at, extinct, generation,
+           hash[0] == hash[1]);
+    return 0;
+  }
+  return 1;
+}
+
+/**
+ * @brief
+ * ڼڹϣײʱ 16x16 ĵͼ R-pentomino  5
+ * ʱʷбдΪ 2 ģ 2 Ĺϣײ advance
+ * ǰ gens ҪȷϺ϶ڣرռɵͬ
+ *
+ * @param cfg ñţ run_check
+ * @param gens 
+ * @return int һΪ1Ϊ0
+ */
+int check_collision(int cfg, int gens) {
+  int torus = cfg == 2 || cfg == 3 || cfg == 7 || cfg == 8;
+  uint64_t hash[2];
+  for (int pass = 0; pass < 2; ++pass) {
+    if (!clear_map(16, 16)) {
+      printf("check: error: out of memory\n");
+      return 0;
+    }
+    is_map = 1;
+    set_cell(7, 8, 1), set_cell(7, 9, 1), set_cell(8, 7, 1);
+    set_cell(8, 8, 1), set_cell(9, 8, 1);
+    configure_engine(cfg >= 6 ? ENGINE_LUT : ENGINE_BITWISE,
+                     torus ? BOUNDARY_TORUS : BOUNDARY_DEAD,
+                     cfg == 1 || cfg == 3 || cfg == 8);
+    if (pass == 0) {
+      history_on = 0;
+      advance(gens);
+    } else {
+      advance(5);
+      for (int i = 0; i < HISTORY_SLOTS; ++i) {
+        if (history_gen[i] == generation && history_hash[i] == board_hash) {
+          history_gen[i] = generation - 3;
+        }
+      }
+      record_history();
+      advance(gens - 5);
+    }
+    hash[pass] = map_hash();
+  }
+  if (period == 3 || generation != gens || hash[0] != hash[1]) {
+    printf("check: MISMATCH collision cfg=%d period=%d generation=%lld "
+           "same_board=%d\n",
+           cfg, period, generation, hash[0] == hash[1]);
+    return 0;
+  }
+  return 1;
+}
+
+/**
+ * @brief
+ * ֲģʽ count_alive_neighbors Ĳοʵ֣ ref_step Ϊ׼ B3/S23 뼸򣬼ÿںµİλϡģʽ뻷߽磩桢ƽ
+ * HashLife 棨 0 Ĺֻǰߣͼ 1x1  1xN  Nx1 ֱ߽ĿͨСΪաȫÿָ
+ * CHECK_GENS 룩 CHECK_LONG ĳʱУԼ HashLife һǰڼ俪ڼ⣬Աͬʱϣ check_detect 
+ *
+ * @return int ȫһΪ0Ϊ1
+ */
+int run_check() {
+  static const int sizes[][2] = {
+      {1, 1},   {1, 2},   {1, 63},  {1, 64},  {1, 65},   {1, 200},  {2, 1},
+      {63, 1},  {64, 1},  {65, 1},  {200, 1}, {2, 2},    {3, 3},    {5, 7},
+      {63, 63}, {64, 64}, {65, 65}, {64, 128}, {129, 65}, {100, 130}};
+  static const char *rules[] = {"B3/S23",      "B36/S23", "B3678/S34678",
+                                "B2/S",        "B1357/S1357", "B0/S8"};
+  int n = (int)(sizeof(sizes) / sizeof(sizes[0]));
+  long long cases = 0, failed = 0;
+  int level = kernel_level;
+  detect = 1;
+  for (int ru = 0; ru < 6; ++ru) {
+    int birth, survive;
+    parse_rule(rules[ru], &birth, &survive);
+    configure_engine(ENGINE_BITWISE, BOUNDARY_DEAD, 0);
+    set_rule(birth, survive);
+    int gens = ru == 0 ? CHECK_GENS : CHECK_GENS / 2;
+    const char *seen[3] = {NULL, NULL, NULL};
+    for (int lv = 0; lv < 3; ++lv) {
+      use_kernels(lv);
+      if ((seen[0] != NULL && strcmp(seen[0], kernel_name) == 0) ||
+          (seen[1] != NULL && strcmp(seen[1], kernel_name) == 0)) {
+        continue;
+      }
+      seen[lv] = kernel_name;
+      for (int cfg = 0; cfg < 4; ++cfg) {
+        for (int s = 0; s < n; ++s) {
+          for (int fill = 0; fill < 3; ++fill) {
+            cases++;
+            failed += !check_case(cfg, sizes[s][0], sizes[s][1],
+                                  fill < 2 ? fill : s + 2, gens, 0);
+          }
+        }
+        if (ru == 0) {
+          cases++;
+          failed += !check_case(cfg, 100, 130, 99, CHECK_LONG, 0);
+        }
+      }
+    }
+    use_kernels(level);
+    for (int cfg = 6; cfg < 9; ++cfg) {
+      for (int s = 0; s < n; ++s) {
+        for (int fill = 0; fill < 3; ++fill) {
+          cases++;
+          failed += !check_case(cfg, sizes[s][0], sizes[s][1],
+                                fill < 2 ? fill : s + 2, gens, 0);
+        }
+      }
+      if (ru == 0) {
+        cases++;
+        failed += !check_case(cfg, 100, 130, 99, CHECK_LONG, 0);
+      }
+    }
+    for (int cfg = 4; cfg < 6 && !(birth & 1); ++cfg) {
+      for (int s = 0; s < n; ++s) {
+        for (int fill = 0; fill < 3; ++fill) {
+          cases++;
+          failed += !check_case(cfg, sizes[s][0], sizes[s][1],
+                                fill < 2 ? fill : s + 2, gens / 2, 0);
+        }
+      }
+      cases++;
+      failed += !check_case(cfg, 40, 60, 98, CHECK_LONG / 10, 0);
+    }
+    for (int cfg = 4; cfg < 6 && !(birth & 1); ++cfg) {
+      cases++;
+      failed += !check_case(cfg, 40, 60, 97, CHECK_LONG / 10, 1);
+    }
+    if (ru == 0) {
+      for (int pat = 0; pat < 6; ++pat) {
+        for (int cfg = 0; cfg < 9; ++cfg) {
+          if (cfg != 4 && cfg != 5) {
+            cases++;
+            failed += !check_detect(pat, cfg, 1000);
+          }
+        }
+      }
+      for (int cfg = 0; cfg < 9; ++cfg) {
+        if (cfg != 4 && cfg != 5) {
+          cases++;
+          failed += !check_collision(cfg, 200);
+        }
+      }
+    }
+    printf("check: rule %s done\n", rules[ru]);
+  }
+  configure_engine(ENGINE_BITWISE, BOUNDARY_DEAD, 0);
+  set_rule(1 << 3, 1 << 2 | 1 << 3);
+  stats_on = 0, detect = 0;
+  printf("check: %lld cases, %lld failed\n", cases, failed);
+  stop_workers();
+  return failed != 0;
+}
+
+/**
+ * @brief ̳߳ϡ threads ̶߳úһ𷵻أظʹá
+ *
+ */
+void barrier_wait() {
+  pthread_mutex_lock(&pool_lock);
+  unsigned phase = pool_phase;
+  if (++pool_count == threads) {
+    pool_count = 0;
+    pool_phase++;
+    pthread_cond_broadcast(&pool_cond);
+  } else {
+    while (phase == pool_phase) {
+      pthread_cond_wait(&pool_cond, &pool_lock);
+    }
+  }
+  pthread_mutex_unlock(&pool_lock);
+}
+
+/**
+ * @brief ߳ѭϴȴִкٴϴϡ
+ *
+ * @param arg ̱߳
+ * @return void* 
+ */
+void *worker_main(void *arg) {
+  int id = (int)(intptr_t)arg;
+  while (1) {
+    barrier_wait();
+    if (pool_job == NULL) {
       break;
-    } else if (strcmp(buff, EMPTY) == 0) {
+    }
+    pool_job(id);
+    barrier_wait();
+  }
+  return NULL;
+}
+
+/**
+ * @brief ̳߳ء߳Ϊ 0 ̲߳㣬 n - 1
+ * ̡߳ʧʱ˳
+ *
+ * @param n ߳
+ */
+void start_workers(int n) {
+  threads = n;
+  if (n == 1) {
+    return;
+  }
+  workers = malloc(sizeof(pthread_t) * (n - 1));
+  for (int i = 1; i < n; ++i) {
+    if (workers == NULL ||
+        pthread_create(&workers[i - 1], NULL, worker_main,
+                       (void *)(intptr_t)i) != 0) {
+      printf("error: failed to create worker threads\n");
+      exit(1);
+    }
+  }
+}
+
+/**
+ * @brief ֪ͨ߳˳ȴ
+ *
+ */
+void stop_workers() {
+  if (threads == 1) {
+    return;
+  }
+  pool_job = NULL;
+  barrier_wait();
+  for (int i = 1; i < threads; ++i) {
+    pthread_join(workers[i - 1], NULL);
+  }
+  free(workers);
+  workers = NULL, threads = 1;
+}
+
+/**
+ * @brief ִ߳ͬһȫɺ󷵻ء߳ʱֱӵá
+ *
+ * @param job Ϊ̱߳
+ */
+void pool_run(void (*job)(int)) {
+  if (threads == 1) {
+    job(0);
+    return;
+  }
+  pool_job = job;
+  barrier_wait();
+  job(0);
+  barrier_wait();
+}
+
+/**
+ * @brief
+ * ѵǰͼı߿ÿжλΪ 0
+ * ߽µı߿򡣻߽ʱڴ˻дǰҲô˺
+ *
+ */
+void clear_halo() {
+  for (int i = 0; i < row; ++i) {
+    uint64_t *p = row_ptr(map, i);
+    p[words - 1] &= tail_mask();
+    p[-1] = p[words] = 0;
+  }
+  size_t bytes = (size_t)stride * sizeof(uint64_t);
+  memset(row_ptr(map, -1) - 1, 0, bytes);
+  memset(row_ptr(map, row) - 1, 0, bytes);
+}
+
+/**
+ * @brief
+ * ǰдǰͼı߿߽ʱ߿ȫΪ 0 ߽ʱ߿ֵλΪһϸ
+ * col УһֵĶλұ߿ֵλΪеһϸ±߿зֱһһУĽ֮ӡںȡģжϱ߽磬ֻб߿
+ * O(row + col) Ҫÿд
+ *
+ */
+void fill_halo() {
+  clear_halo();
+  if (boundary != BOUNDARY_TORUS) {
+    return;
+  }
+  int last = (col - 1) & 63;
+  for (int i = 0; i < row; ++i) {
+    uint64_t *p = row_ptr(map, i);
+    p[-1] = (p[words - 1] >> last & 1) << 63;
+    p[col >> 6] |= (p[0] & 1) << (col & 63);
+  }
+  size_t bytes = (size_t)stride * sizeof(uint64_t);
+  memcpy(row_ptr(map, -1) - 1, row_ptr(map, row - 1) - 1, bytes);
+  memcpy(row_ptr(map, row) - 1, row_ptr(map, 0) - 1, bytes);
+}
+
+/**
+ * @brief
+ *  id һдһ塣ͼƽΪ threads
+ * л㣺ÿеĺֻһΣڸֻ߳кͻУйãÿϸֻΰλӷڼʹ
+ * select_kernels ѡ SIMD ÿһֽȥ col
+ * λ֤߿λʼΪδ⵽ʱһ漴¸еĹϣͳʱ漴ͳƸС
+ *
+ * @param id ̱߳
+ */
+void generate_band(int id) {
+  int r0 = (int)((long long)row * id / threads);
+  int r1 = (int)((long long)row * (id + 1) / threads);
+  hash_delta[id] = 0;
+  memset(&band_stats[id], 0, sizeof(life_stats));
+  if (r0 >= r1) {
+    return;
+  }
+  int n = words;
+  uint64_t tail = tail_mask();
+  uint64_t *prev = row_sums + sums_stride * id;
+  uint64_t *cur = prev + 2 * n, *next = prev + 4 * n;
+  row_sum_fn(row_ptr(map, r0 - 1), prev, prev + n, n);
+  row_sum_fn(row_ptr(map, r0), cur, cur + n, n);
+  PROF_START(band);
+  for (int i = r0; i < r1; ++i) {
+    PROF_SAMPLE(lap, i - r0);
+    row_sum_fn(row_ptr(map, i + 1), next, next + n, n);
+    PROF_LAP(id, PROF_SUM, lap);
+    uint64_t *dst = row_ptr(next_map, i);
+    row_rule_fn(prev, prev + n, cur, cur + n, next, next + n, row_ptr(map, i),
+                dst, n);
+    dst[n - 1] &= tail;
+    PROF_LAP(id, PROF_RULE, lap);
+    if (history_on && !period) {
+      hash_row(row_ptr(map, i), dst, i, &hash_delta[id]);
+    }
+    if (stats_on) {
+      stats_row_fn(row_ptr(map, i), dst, n, i, 0, tail, &band_stats[id]);
+    }
+    PROF_LAP(id, PROF_REST, lap);
+    uint64_t *t = prev;
+    prev = cur, cur = next, next = t;
+  }
+  PROF_BAND(id, band, r1 - r0, 64.0 * n * (r1 - r0));
+}
+
+/**
+ * @brief
+ * һϸͼλиֻ߳ǰͼֻдһ壬һϻϺ󼴿ɽָ룬踴ơ
+ * HashLife һǰ 2  hl_k ηٰѵͼΧڵϸдصͼ
+ * ߽½ĵͼǰд߿Ļ壬ϡģʽŵʱдλĻϸ˽߿λʹ֣桢ת߽桢ͳƣĵͼǸɾġ
+ * ռضƿʱǰͼӳļһνһ廻ڴӳ䡣
+ * ϲ̵߳Ĺϣ仯񵴣ͳʱϲ̵߳ͳơ
+ * ƽڴ治ʱǰ
+ *
+ * @return int ǰΪ1ûеͼڴ治Ϊ0
+ */
+int generate_next_status() {
+  if (!is_map) {
+    is_map_error();
+    return 0;
+  }
+  PROF_ENTER(PROF_STEP);
+  if (engine == ENGINE_HASHLIFE) {
+    hl_advance((uint64_t)1 << hl_k);
+    hl_to_map();
+    generation += (long long)1 << hl_k;
+    stats_valid = 0;
+    PROF_LEAVE(PROF_STEP, (double)row * col * (double)((long long)1 << hl_k));
+    return 1;
+  }
+  if (boundary == BOUNDARY_INFINITE) {
+    if (!pl_step()) {
+      PROF_LEAVE(PROF_STEP, 0);
+      return 0;
+    }
+    pl_to_map();
+    generation++;
+    if (stats_on) {
+      finish_stats();
+    }
+    PROF_LEAVE(PROF_STEP, (double)row * col);
+    return 1;
+  }
+  fill_halo();
+  if (sparse) {
+    pool_run(generate_sparse_band);
+    long long total = (long long)tile_rows * tile_cols, work = 0;
+    for (int i = 0; i < threads; ++i) {
+      work += tile_work[i];
+    }
+    tiles_computed = work, tiles_skipped = total - work;
+    tiles_computed_sum += work, tiles_skipped_sum += total - work;
+    uint8_t *f = tile_last;
+    tile_last = tile_next, tile_next = f;
+  } else {
+    pool_run(engine == ENGINE_LUT ? generate_lut_band : generate_band);
+  }
+  uint64_t *t = map;
+  map = next_map, next_map = t;
+  if (boundary == BOUNDARY_TORUS) {
+    clear_halo();
+  }
+  generation++;
+  if (history_on && !period) {
+    for (int i = 0; i < threads; ++i) {
+      board_hash ^= hash_delta[i];
+    }
+    record_history();
+  }
+  if (stats_on) {
+    finish_stats();
+  }
+  if (snapshot != NULL && next_map != arena) {
+    next_map = arena;
+    unmap_snapshot();
+    mark_all_tiles();
+  }
+  PROF_LEAVE(PROF_STEP, (double)row * col);
+  return 1;
+}
+
+/**
+ * @brief
+ * һһдһ塣 generate_band ͬĻк㷨ֻÿֻһ֣
+ * lut_rows бȽ¾ͳƱ仯µͼϣͳʱѸͳƼ tile_stats 
+ *
+ * @param ty к
+ * @param tx кţֺ
+ * @param delta ͼϣ仯
+ * @return int б仯
+ */
+int generate_tile(int ty, int tx, uint64_t *delta) {
+  int r0 = ty * TILE, r1 = r0 + TILE < row ? r0 + TILE : row;
+  uint64_t tail = tx == words - 1 ? tail_mask() : ~(uint64_t)0;
+  int changes = 0;
+  life_stats *st = &tile_stats[(size_t)ty * tile_cols + tx];
+  if (stats_on) {
+    memset(st, 0, sizeof(life_stats));
+  }
+  if (engine == ENGINE_LUT) {
+    lut_rows(r0, r1, tx, tx + 1);
+    for (int i = r0; i < r1; ++i) {
+      changes += hash_word(row_ptr(map, i), row_ptr(next_map, i), i, tx, delta);
+      if (stats_on) {
+        stats_row_fn(row_ptr(map, i) + tx, row_ptr(next_map, i) + tx, 1, i,
+                     64ll * tx, tail, st);
+      }
+    }
+    return changes;
+  }
+  uint64_t s0[3], s1[3];
+  int prev = 0, cur = 1, next = 2;
+  row_sum(row_ptr(map, r0 - 1) + tx, &s0[prev], &s1[prev], 1);
+  row_sum(row_ptr(map, r0) + tx, &s0[cur], &s1[cur], 1);
+  for (int i = r0; i < r1; ++i) {
+    row_sum(row_ptr(map, i + 1) + tx, &s0[next], &s1[next], 1);
+    const uint64_t *src = row_ptr(map, i) + tx;
+    uint64_t *dst = row_ptr(next_map, i) + tx;
+    rule_fn(&s0[prev], &s1[prev], &s0[cur], &s1[cur], &s0[next], &s1[next],
+             src, dst, 1);
+    *dst &= tail;
+    changes += hash_word(row_ptr(map, i), row_ptr(next_map, i), i, tx, delta);
+    if (stats_on) {
+      stats_row_fn(src, dst, 1, i, 64ll * tx, tail, st);
+    }
+    int t = prev;
+    prev = cur, cur = next, next = t;
+  }
+  return changes;
+}
+
+/**
+ * @brief
+ * ϡģʽ¼ id л֣һڰ˸һûб仯ʱ鱾Ҳ仯ֱʱһбϴ뵱ǰͬ踴ơģʽӡ
+ *
+ * @param id ̱߳
+ */
+void generate_sparse_band(int id) {
+  int t0 = (int)((long long)tile_rows * id / threads);
+  int t1 = (int)((long long)tile_rows * (id + 1) / threads);
+  long long work = 0;
+  int torus = boundary == BOUNDARY_TORUS;
+  hash_delta[id] = 0;
+  for (int ty = t0; ty < t1; ++ty) {
+    for (int tx = 0; tx < tile_cols; ++tx) {
+      int active = 0;
+      for (int i = ty - 1; i <= ty + 1 && !active; ++i) {
+        for (int j = tx - 1; j <= tx + 1; ++j) {
+          int ii = i, jj = j;
+          if (torus) {
+            ii = ii < 0 ? tile_rows - 1 : ii == tile_rows ? 0 : ii;
+            jj = jj < 0 ? tile_cols - 1 : jj == tile_cols ? 0 : jj;
+          }
+          if (ii >= 0 && ii < tile_rows && jj >= 0 && jj < tile_cols &&
+              tile_last[(size_t)ii * tile_cols + jj]) {
+            active = 1;
+            break;
+          }
+        }
+      }
+      size_t t = (size_t)ty * tile_cols + tx;
+      tile_next[t] = active && generate_tile(ty, tx, &hash_delta[id]) > 0;
+      if (!active && stats_on) {
+        tile_stats[t].births = 0;
+      }
+      work += active;
+    }
+  }
+  tile_work[id] = work;
+}
+
+/**
+ * @brief
+ * Ϊб仯ʹϡģʽһȫ顣ͼдءơлϡģʽãʱһ뵱ǰͼһ
+ *
+ */
+void mark_all_tiles() {
+  if (tile_last != NULL) {
+    memset(tile_last, 1, (size_t)tile_rows * tile_cols);
+  }
+}
+
+/**
+ * @brief رϡģʽʾ
+ *
+ * @param arg on  off 
+ */
+void set_sparse(char *arg) {
+  if (strcmp(arg, "on") == 0) {
+    if (!sparse) {
+      sparse = 1;
+      tiles_computed = tiles_skipped = 0;
+      tiles_computed_sum = tiles_skipped_sum = 0;
+      mark_all_tiles();
+    }
+  } else if (strcmp(arg, "off") == 0) {
+    sparse = 0;
+  } else if (strcmp(arg, EMPTY) != 0) {
+    printf("set_sparse: error: expected on or off\n");
+    return;
+  }
+  printf("sparse = %s, tiles = %lld\n", sparse ? "on" : "off",
+         (long long)tile_rows * tile_cols);
+  printf("last generation: computed = %lld, skipped = %lld\n", tiles_computed,
+         tiles_skipped);
+  printf("total: computed = %lld, skipped = %lld\n", tiles_computed_sum,
+         tiles_skipped_sum);
+}
+
+/**
+ * @brief ر񵴼⣬ʾʱӵǰһ¿ʼ¼
+ *
+ * @param arg on  off 
+ */
+void set_detect(char *arg) {
+  if (strcmp(arg, "on") == 0 || strcmp(arg, "off") == 0) {
+    int on = strcmp(arg, "on") == 0;
+    if (on != detect) {
+      detect = on;
+      reset_history();
+    }
+  } else if (strcmp(arg, EMPTY) != 0) {
+    printf("set_detect: error: expected on or off\n");
+    return;
+  }
+  char buf[LEN];
+  printf("detect = %s%s\n", detect ? "on" : "off",
+         detect && !history_on && is_map
+             ? " (not available on the infinite plane or with hashlife)"
+             : "");
+  if (describe_history(buf)) {
+    printf("%s\n", buf);
+  }
+}
+
+/**
+ * @brief
+ * ʾѡģ档޲ʱʾǰ棻Ϊ bitwise  lut  hashlife
+ * ߿ٸһ k ʾÿǰ 2  k η 2  k η GENS_MAX  lut
+ * ֻ֧뻷߽硣
+ *
+ * @param arg 
+ */
+void choose_engine(char *arg) {
+  char name[LEN], rest[LEN];
+  get_command(arg, name, rest);
+  if (strcmp(name, EMPTY) == 0) {
+    if (engine == ENGINE_HASHLIFE) {
+      printf("engine = hashlife, 2^%d generations per step, %u nodes\n", hl_k,
+             hl_count);
+    } else if (engine == ENGINE_LUT) {
+      printf("engine = lut, 2x2 cells per lookup, threads = %d\n", threads);
+    } else {
+      printf("engine = bitwise, kernel = %s, threads = %d\n", kernel_name,
+             threads);
+    }
+    return;
+  }
+  int k = 0;
+  if (strcmp(name, "bitwise") == 0 && strcmp(rest, EMPTY) == 0) {
+    engine = ENGINE_BITWISE;
+    hl_reset();
+    engine_attach();
+  } else if (strcmp(name, "lut") == 0 && strcmp(rest, EMPTY) == 0) {
+    if (boundary == BOUNDARY_INFINITE) {
+      printf("choose_engine: error: lut only supports dead and torus\n");
+      return;
+    }
+    engine = ENGINE_LUT;
+    engine_attach();
+  } else if (strcmp(name, "hashlife") == 0 &&
+             (strcmp(rest, EMPTY) == 0 ||
+              (sscanf(rest, "%d", &k) == 1 && k >= 0 && k < 60 &&
+               (1ll << k) <= GENS_MAX))) {
+    if (rule_birth & 1) {
+      printf("choose_engine: error: hashlife does not support B0 rules\n");
+      return;
+    }
+    hl_k = k;
+    if (engine != ENGINE_HASHLIFE) {
+      engine = ENGINE_HASHLIFE;
+      boundary = BOUNDARY_INFINITE;
+      pl_reset();
+      engine_attach();
+    }
+  } else {
+    printf("choose_engine: error: unknown engine: %s\n", arg);
+    return;
+  }
+  choose_engine(EMPTY);
+}
+
+/**
+ * @brief
+ * ͼءơл߽ģʽãõǰӵͼؽڲ״̬ͼԭеϸᱣ
+ * ƽڴ治ʱ߽磬ͼӰ졣
+ *
+ */
+void engine_attach() {
+  if (engine == ENGINE_HASHLIFE && is_map) {
+    hl_from_map();
+  } else if (boundary == BOUNDARY_INFINITE && is_map && !pl_from_map()) {
+    boundary = BOUNDARY_DEAD;
+    printf("infinite: error: boundary = dead\n");
+  }
+  mark_all_tiles();
+  reset_history();
+  if (stats_on) {
+    scan_stats();
+  } else {
+    stats_valid = 0;
+  }
+}
+
+/**
+ * @brief
+ * ͼһְλõõɢֵͼϣΪֵɢֵȰѸ߰Ͱ֣ټλõõʹͬλáͬݵı仯ÿֻһγ˷
+ *
+ * @param x ֵ
+ * @param i к
+ * @param w ֺ
+ * @return uint64_t ɢֵ
+ */
+uint64_t word_key(uint64_t x, int i, int w) {
+  uint64_t y = (x ^ x >> 32) + ((uint64_t)i * words + w + 1) * 0x9e3779b97f4a7c15ull;
+  y *= 0xbf58476d1ce4e5b9ull;
+  return y ^ y >> 32;
+}
+
+/**
+ * @brief
+ * һеĹϣ row_hash ¾йϣۼӽ *delta ֱȽ¾ֱһ֣ͬ
+ * ͬʱ row_hash 䣬ֱӷأհ뾲ֹֻһȽϣб仯ͨͷ־ͷֳб仯ʱ¼㣬ÿһɢУֱȽ¾ʡͼÿҪɢУ߻Ƶط֧Ԥʧܡ
+ *
+ * @param src һֵַ
+ * @param dst һֵַһѽȥ col λ
+ * @param i к
+ * @param delta ͼϣ仯
+ */
+void hash_row(const uint64_t *src, const uint64_t *dst, int i,
+              uint64_t *delta) {
+  int same = 0;
+  while (same < words - 1 && src[same] == dst[same]) {
+    ++same;
+  }
+  if (same == words - 1 && (src[same] & tail_mask()) == dst[same]) {
+    return;
+  }
+  uint64_t h = 0;
+  for (int w = 0; w < words; ++w) {
+    h ^= word_key(dst[w], i, w);
+  }
+  *delta ^= h ^ row_hash[i];
+  row_hash[i] = h;
+}
+
+/**
+ * @brief
+ * Ƚĳһе w ֵ¾б仯ʱ¾ɢֵͬʱۼӽеĹϣ
+ * *delta ϡģʽʹãûб仯һȥ col
+ * λģʽű߿򣩡
+ *
+ * @param src һֵַ
+ * @param dst һֵַ
+ * @param i к
+ * @param w ֺ
+ * @param delta ͼϣ仯
+ * @return int б仯Ϊ1Ϊ0
+ */
+int hash_word(const uint64_t *src, const uint64_t *dst, int i, int w,
+              uint64_t *delta) {
+  uint64_t old = src[w];
+  if (w == words - 1) {
+    old &= tail_mask();
+  }
+  if (dst[w] == old) {
+    return 0;
+  }
+  uint64_t d = word_key(old, i, w) ^ word_key(dst[w], i, w);
+  row_hash[i] ^= d;
+  *delta ^= d;
+  return 1;
+}
+
+/**
+ * @brief
+ * ͳһ n ֵһۼӽ *st
+ * һһϸӾΡʱһ漴ãݶڻУɨͼм㣬
+ * finish_stats һ뱾Ĵ֮һһֽȥ tail
+ * λģʽű߿򣩡
+ *
+ * @param src һֵַ
+ * @param dst һֵַ
+ * @param n 
+ * @param y ек
+ * @param x ֵ 0 λк
+ * @param tail һֵЧλ
+ * @param st ͳƽ
+ */
+void stats_row(const uint64_t *src, const uint64_t *dst, int n, long long y,
+               long long x, uint64_t tail, life_stats *st) {
+  long long born = 0, live = 0;
+  for (int w = 0; w < n; ++w) {
+    uint64_t a = w == n - 1 ? src[w] & tail : src[w];
+    born += popcount64(dst[w] & ~a);
+    live += popcount64(dst[w]);
+  }
+  stats_add(dst, n, y, x, born, live, st);
+}
+
+#ifdef SIMD_X86
+/**
+ * @brief stats_row  POPCNT 汾ͬ
+ *
+ * @param src һֵַ
+ * @param dst һֵַ
+ * @param n 
+ * @param y ек
+ * @param x ֵ 0 λк
+ * @param tail һֵЧλ
+ * @param st ͳƽ
+ */
+__attribute__((target("popcnt"))) void stats_row_popcnt(
+    const uint64_t *src, const uint64_t *dst, int n, long long y, long long x,
+    uint64_t tail, life_stats *st) {
+  long long born = 0, live = 0;
+  for (int w = 0; w < n; ++w) {
+    uint64_t a = w == n - 1 ? src[w] & tail : src[w];
+    born += __builtin_popcountll(dst[w] & ~a);
+    live += __builtin_popcountll(dst[w]);
+  }
+  stats_add(dst, n, y, x, born, live, st);
+}
+
+/**
+ * @brief
+ * stats_row  AVX2 汾ͬÿδĸ֣ 4 λ vpshufb
+ * ֽ 1 ĸ vpsadbw ۼΪ 64 λĺͣһµֽ
+ * POPCNT 
+ *
+ * @param src һֵַ
+ * @param dst һֵַ
+ * @param n 
+ * @param y ек
+ * @param x ֵ 0 λк
+ * @param tail һֵЧλ
+ * @param st ͳƽ
+ */
+__attribute__((target("avx2,popcnt"))) void stats_row_avx2(
+    const uint64_t *src, const uint64_t *dst, int n, long long y, long long x,
+    uint64_t tail, life_stats *st) {
+  const __m256i nib = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2,
+                                       3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2,
+                                       2, 3, 2, 3, 3, 4);
+  const __m256i low = _mm256_set1_epi8(0x0f), zero = _mm256_setzero_si256();
+  __m256i vb = zero, vl = zero;
+  int w = 0;
+  for (; w + 4 < n; w += 4) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(src + w));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(dst + w));
+    __m256i c = _mm256_andnot_si256(a, b);
+    __m256i cb = _mm256_add_epi8(
+        _mm256_shuffle_epi8(nib, _mm256_and_si256(c, low)),
+        _mm256_shuffle_epi8(nib, _mm256_and_si256(_mm256_srli_epi16(c, 4), low)));
+    __m256i cl = _mm256_add_epi8(
+        _mm256_shuffle_epi8(nib, _mm256_and_si256(b, low)),
+        _mm256_shuffle_epi8(nib, _mm256_and_si256(_mm256_srli_epi16(b, 4), low)));
+    vb = _mm256_add_epi64(vb, _mm256_sad_epu8(cb, zero));
+    vl = _mm256_add_epi64(vl, _mm256_sad_epu8(cl, zero));
+  }
+  uint64_t sb[4], sl[4];
+  _mm256_storeu_si256((__m256i *)sb, vb);
+  _mm256_storeu_si256((__m256i *)sl, vl);
+  long long born = (long long)(sb[0] + sb[1] + sb[2] + sb[3]);
+  long long live = (long long)(sl[0] + sl[1] + sl[2] + sl[3]);
+  _mm256_zeroupper();
+  for (; w < n; ++w) {
+    uint64_t a = w == n - 1 ? src[w] & tail : src[w];
+    born += __builtin_popcountll(dst[w] & ~a);
+    live += __builtin_popcountll(dst[w]);
+  }
+  stats_add(dst, n, y, x, born, live, st);
+}
+#endif
+
+/**
+ * @brief
+ * һеĳۼӽ *st лϸʱҵһһ 0
+ * ֣лϸвӾΡ
+ *
+ * @param dst һֵַ
+ * @param n 
+ * @param y ек
+ * @param x ֵ 0 λк
+ * @param born 
+ * @param live 
+ * @param st ͳƽ
+ */
+void stats_add(const uint64_t *dst, int n, long long y, long long x,
+               long long born, long long live, life_stats *st) {
+  life_stats s = {0, live, born, 0, y, 0, y, 0};
+  if (live) {
+    int first = 0, last = n - 1;
+    while (!dst[first]) {
+      first++;
+    }
+    while (!dst[last]) {
+      last--;
+    }
+    s.left = x + 64ll * first + ctz64(dst[first]);
+    s.right = x + 64ll * last + 63 - clz64(dst[last]);
+  }
+  merge_stats(st, &s);
+}
+
+/**
+ * @brief  *src ļۼӽ *dst ӾȡߵĲ
+ *
+ * @param dst ۼӽ
+ * @param src ͳ
+ */
+void merge_stats(life_stats *dst, const life_stats *src) {
+  dst->births += src->births, dst->deaths += src->deaths;
+  if (src->population == 0) {
+    return;
+  }
+  if (dst->population == 0) {
+    dst->top = src->top, dst->left = src->left;
+    dst->bottom = src->bottom, dst->right = src->right;
+  } else {
+    dst->top = src->top < dst->top ? src->top : dst->top;
+    dst->left = src->left < dst->left ? src->left : dst->left;
+    dst->bottom = src->bottom > dst->bottom ? src->bottom : dst->bottom;
+    dst->right = src->right > dst->right ? src->right : dst->right;
+  }
+  dst->population += src->population;
+}
+
+/**
+ * @brief
+ * ÿʱãϲ̣߳ϡģʽΪ飩ͳƵõ stats һĴӱ
+ * stats_csv дһСϡģʽûб仯ϴεĴӾΡֻ
+ * stats_on ʱá
+ *
+ */
+void finish_stats() {
+  life_stats s = {generation, 0, 0, 0, 0, 0, 0, 0};
+  if (sparse && boundary != BOUNDARY_INFINITE) {
+    size_t tiles = (size_t)tile_rows * tile_cols;
+    for (size_t t = 0; t < tiles; ++t) {
+      merge_stats(&s, &tile_stats[t]);
+    }
+  } else {
+    for (int i = 0; i < threads; ++i) {
+      merge_stats(&s, &band_stats[i]);
+    }
+  }
+  if (stats_valid) {
+    s.deaths = stats.population + s.births - s.population;
+  }
+  stats = s, stats_valid = stats_valid ? 2 : 1;
+  write_stats();
+}
+
+/**
+ * @brief
+ * ɨ赱ǰͼ infinite ߽Ϊƽ棩õӾΣΪ 0
+ * ͼдã˺ɹά HashLife 治ͳơ
+ *
+ */
+void scan_stats() {
+  life_stats s = {generation, 0, 0, 0, 0, 0, 0, 0};
+  stats_valid = 0;
+  if (!is_map || engine == ENGINE_HASHLIFE) {
+    return;
+  }
+  if (boundary == BOUNDARY_INFINITE) {
+    for (uint32_t i = 0; i < pl_size; ++i) {
+      if (pl_vals[i] != PL_NONE) {
+        const pl_chunk *c = pl_get(pl_vals[i]);
+        for (int r = 0; r < CHUNK; ++r) {
+          stats_row_fn(&c->cells[r], &c->cells[r], 1,
+                       (long long)c->cy * CHUNK + r, (long long)c->cx * 64,
+                       ~(uint64_t)0, &s);
+        }
+      }
+    }
+  } else {
+    uint64_t tail = tail_mask();
+    for (int i = 0; i < row; ++i) {
+      const uint64_t *p = row_ptr(map, i);
+      stats_row_fn(p, p, words, i, 0, tail, &s);
+    }
+  }
+  stats = s, stats_valid = 1;
+}
+
+/**
+ * @brief  CSV ļдͷ˺ÿдһСд򿪵ļʱȹرա
+ *
+ * @param path ļ·
+ * @return int ɹΪ1ʧΪ0
+ */
+int open_stats_csv(const char *path) {
+  close_stats_csv();
+  stats_csv = fopen(path, "w");
+  if (stats_csv == NULL) {
+    printf("stats: error: cannot open %s\n", path);
+    return 0;
+  }
+  fprintf(stats_csv, "generation,population,births,deaths,top,left,bottom,"
+                     "right\n");
+  return 1;
+}
+
+/**
+ * @brief ر stats_csv дرճʱļʾûд򿪵ļʱʲôҲ
+ *
+ * @return int ɹûд򿪵ļΪ1Ϊ0
+ */
+int close_stats_csv() {
+  if (stats_csv == NULL) {
+    return 1;
+  }
+  int ok = !ferror(stats_csv);
+  ok = fclose(stats_csv) == 0 && ok;
+  stats_csv = NULL;
+  if (!ok) {
+    printf("stats: error: failed to write the csv file\n");
+  }
+  return ok;
+}
+
+/**
+ * @brief  stats_csv дһ stats ûлϸʱӾεա
+ *
+ */
+void write_stats() {
+  if (stats_csv == NULL) {
+    return;
+  }
+  if (stats.population) {
+    fprintf(stats_csv, "%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld\n",
+            stats.generation, stats.population, stats.births, stats.deaths,
+            stats.top, stats.left, stats.bottom, stats.right);
+  } else {
+    fprintf(stats_csv, "%lld,0,%lld,%lld,,,,\n", stats.generation,
+            stats.births, stats.deaths);
+  }
+}
+
+/**
+ * @brief
+ * ͳ޲ʱʾ stats  on  off رͳƣ csv FILE
+ * ͳƲÿĽд CSV ļ csv off رļ
+ *
+ * @param arg 
+ */
+void show_stats(char *arg) {
+  if (strcmp(arg, "on") == 0) {
+    stats_on = 1;
+    scan_stats();
+    mark_all_tiles();
+  } else if (strcmp(arg, "off") == 0) {
+    stats_on = 0;
+  } else if (strcmp(arg, "csv off") == 0) {
+    if (!close_stats_csv()) {
+      return;
+    }
+  } else if (strncmp(arg, "csv ", 4) == 0) {
+    if (!open_stats_csv(arg + 4)) {
+      return;
+    }
+    stats_on = 1;
+    scan_stats();
+    mark_all_tiles();
+    write_stats();
+  } else if (strcmp(arg, EMPTY) != 0) {
+    printf("stats: error: expected on, off, csv <filename> or csv off\n");
+    return;
+  }
+  printf("stats = %s%s\n", stats_on ? "on" : "off",
+         stats_csv != NULL ? ", writing csv" : "");
+  if (engine == ENGINE_HASHLIFE) {
+    printf("stats: not tracked by the hashlife engine\n");
+    return;
+  }
+  if (!is_map) {
+    return;
+  }
+  if (!stats_valid || stats.generation != generation) {
+    scan_stats();
+  }
+  printf("generation = %lld, population = %lld", stats.generation,
+         stats.population);
+  if (stats_valid == 2) {
+    printf(", births = %lld, deaths = %lld\n", stats.births, stats.deaths);
+  } else {
+    printf(" (births and deaths are counted while stats are on)\n");
+  }
+  if (stats.population) {
+    printf("bounding box: rows %lld to %lld, columns %lld to %lld (%lld x "
+           "%lld)\n",
+           stats.top, stats.bottom, stats.left, stats.right,
+           stats.bottom - stats.top + 1, stats.right - stats.left + 1);
+  } else {
+    printf("bounding box: empty\n");
+  }
+}
+
+#ifdef LIFE_PROFILE
+/**
+ * @brief
+ * Ӳָδ֧Ԥʧһ perf_event_open
+ * ֻû̬ڴκ֮߳ǰã֮󴴽̼̳߳мһ򲻿ʱȫرգֻʱ
+ *
+ */
+void prof_init() {
+#ifdef PROF_HW
+  static const uint64_t config[PROF_EVENTS] = {PERF_COUNT_HW_INSTRUCTIONS,
+                                               PERF_COUNT_HW_CACHE_MISSES,
+                                               PERF_COUNT_HW_BRANCH_MISSES};
+  for (int e = 0; e < PROF_EVENTS; ++e) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config[e];
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    prof_fd[e] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (prof_fd[e] < 0) {
+      snprintf(prof_hw_error, LEN, "perf_event_open: %s", strerror(errno));
+      for (int k = 0; k < e; ++k) {
+        close(prof_fd[k]);
+        prof_fd[k] = -1;
+      }
+      return;
+    }
+  }
+#else
+  snprintf(prof_hw_error, LEN, "perf_event_open needs Linux");
+#endif
+}
+
+/**
+ * @brief ȡһӲ̳ĸ̡߳
+ *
+ * @param e 
+ * @return long long ʱΪ0
+ */
+long long prof_read(int e) {
+  uint64_t v = 0;
+  if (prof_fd[e] < 0 || read(prof_fd[e], &v, sizeof(v)) != sizeof(v)) {
+    return 0;
+  }
+  return (long long)v;
+}
+
+/**
+ * @brief Ѳо *t ʱ߳ id ǰĳһ֣ *t Ϊǰʱ䡣
+ *
+ * @param id ̺߳
+ * @param phase PROF_SUM  PROF_RULE  PROF_REST
+ * @param t ʼʱ
+ */
+void prof_lap(int id, int phase, double *t) {
+  double now = now_seconds();
+  prof[id].sampled[phase] += now - *t;
+  *t = now;
+}
+
+/**
+ * @brief
+ * һ t ʱеıָھӼಿֲƣвĽ׶θ
+ * rows  cells ϸղ
+ *
+ * @param id ̺߳
+ * @param t ʼʱ
+ * @param rows 
+ * @param cells ϸ
+ */
+void prof_band(int id, double t, int rows, double cells) {
+  double secs = now_seconds() - t, *f = prof[id].sampled;
+  double total = f[PROF_SUM] + f[PROF_RULE] + f[PROF_REST];
+  for (int p = PROF_SUM; p <= PROF_RULE && rows > 0 && total > 0; ++p) {
+    if (f[p] > 0) {
+      prof[id].seconds[p] += secs * f[p] / total;
+      prof[id].cells[p] += cells;
+      prof[id].calls[p] += rows;
+    }
+  }
+  memset(f, 0, sizeof(prof[id].sampled));
+}
+
+/**
+ * @brief һϴֵĽ׶ΣʱӲ
+ *
+ * @param phase ׶
+ */
+void prof_enter(int phase) {
+  for (int e = 0; e < PROF_EVENTS; ++e) {
+    prof_hw_begin[phase][e] = prof_read(e);
+  }
+  prof_begin[phase] = now_seconds();
+}
+
+/**
+ * @brief 뿪һϴֵĽ׶ΣۼʱӲ
+ *
+ * @param phase ׶
+ * @param cells δϸ
+ */
+void prof_leave(int phase, double cells) {
+  prof[0].seconds[phase] += now_seconds() - prof_begin[phase];
+  prof[0].cells[phase] += cells;
+  prof[0].calls[phase]++;
+  for (int e = 0; e < PROF_EVENTS; ++e) {
+    prof_hw[phase][e] += prof_read(e) - prof_hw_begin[phase][e];
+  }
+}
+#endif
+
+/**
+ * @brief
+ * ޲ʱ׶ʾʱÿÿϸԼϴֽ׶εӲ
+ * reset 㡣ھӼ׶Ϊ߳ʱ֮ͣΪʵʾʱ䡣
+ * ԶģʽģͬʱУ̼ƽ׶εļͬʱеģ⡣
+ * δ LIFE_PROFILE ʱֻʾο
+ *
+ * @param arg 
+ */
+void show_profile(char *arg) {
+#ifdef LIFE_PROFILE
+  static const char *names[PROF_PHASES] = {
+      "neighbor count", "rule apply", "step", "render", "load", "save"};
+  if (strcmp(arg, "reset") == 0) {
+    memset(prof, 0, sizeof(prof));
+    memset(prof_hw, 0, sizeof(prof_hw));
+    printf("prof: counters reset\n");
+    return;
+  } else if (strcmp(arg, EMPTY) != 0) {
+    printf("prof: error: expected reset or nothing\n");
+    return;
+  }
+  printf("%-15s %10s %11s %12s %9s %14s %14s %14s\n", "phase", "calls",
+         "total ms", "ns/call", "ns/cell", "instructions", "cache-misses",
+         "branch-misses");
+  for (int p = 0; p < PROF_PHASES; ++p) {
+    double secs = 0, cells = 0;
+    long long calls = 0;
+    for (int i = 0; i < TMAX; ++i) {
+      secs += prof[i].seconds[p];
+      cells += prof[i].cells[p];
+      calls += prof[i].calls[p];
+    }
+    if (calls == 0) {
+      continue;
+    }
+    printf("%-15s %10lld %11.3f %12.1f %9.3f", names[p], calls, secs * 1e3,
+           secs * 1e9 / calls, cells > 0 ? secs * 1e9 / cells : 0);
+    if (p >= PROF_STEP && prof_fd[0] >= 0) {
+      printf(" %14lld %14lld %14lld\n", prof_hw[p][0], prof_hw[p][1],
+             prof_hw[p][2]);
+    } else {
+      printf(" %14s %14s %14s\n", "-", "-", "-");
+    }
+  }
+  printf("prof: neighbor count and rule apply are each band's time split by "
+         "1 row in %d timed in detail; their calls are rows\n",
+         PROF_EVERY);
+  if (prof_fd[0] < 0) {
+    printf("prof: hardware counters unavailable (%s)\n", prof_hw_error);
+  }
+#else
+  (void)arg;
+  printf("prof: not compiled in, rebuild with -DLIFE_PROFILE\n");
+#endif
+}
+
+/**
+ * @brief ּ㵱ǰͼͬСĿյͼĹϣ
+ *
+ * @param empty Ϊ1ʱյͼ
+ * @return uint64_t ϣ
+ */
+uint64_t full_hash(int empty) {
+  uint64_t tail = tail_mask();
+  uint64_t h = 0;
+  for (int i = 0; i < row; ++i) {
+    const uint64_t *p = row_ptr(map, i);
+    for (int w = 0; w < words; ++w) {
+      uint64_t x = empty ? 0 : w == words - 1 ? p[w] & tail : p[w];
+      h ^= word_key(x, i, w);
+    }
+  }
+  return h;
+}
+
+/**
+ * @brief ȷϵǰͼǷȫ
+ *
+ * @return int ȫΪ1Ϊ0
+ */
+int board_empty() {
+  uint64_t tail = tail_mask();
+  for (int i = 0; i < row; ++i) {
+    const uint64_t *p = row_ptr(map, i);
+    for (int w = 0; w < words; ++w) {
+      if ((w == words - 1 ? p[w] & tail : p[w]) != 0) {
+        return 0;
+      }
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief
+ * ͼд桢߽硢ıã¼ŵͼĹϣʷֻڿ
+ * detect ʱֻ߽ bitwise  lut м⣬ƽϵͼֻһڣظƽظ
+ *
+ */
+void reset_history() {
+  history_on = detect && is_map && engine != ENGINE_HASHLIFE &&
+               boundary != BOUNDARY_INFINITE;
+  period = 0, extinct = 0, settled_at = -1;
+  free(confirm_map);
+  confirm_map = NULL, confirm_period = 0;
+  for (int i = 0; i < HISTORY_SLOTS; ++i) {
+    history_gen[i] = -1;
+  }
+  if (history_on) {
+    uint64_t tail = tail_mask();
+    board_hash = 0;
+    for (int i = 0; i < row; ++i) {
+      const uint64_t *p = row_ptr(map, i);
+      row_hash[i] = 0;
+      for (int w = 0; w < words; ++w) {
+        row_hash[i] ^= word_key(w == words - 1 ? p[w] & tail : p[w], i, w);
+      }
+      board_hash ^= row_hash[i];
+    }
+    empty_hash = full_hash(1);
+    record_history();
+  }
+}
+
+/**
+ * @brief
+ * ÿʱã񵴡ϣڿյͼĹϣʱȷǷȫʷвͬĹϣҵߴ֮ΪѡڣΪ
+ * 1 Ҳ±ʷϣѰַÿ̽ HISTORY_PROBE
+ * ʱпСڻɵ˲붼ǳʱ䣬ĴС̶
+ * ϣײģʽݴڣ˺ѡȸƵǰͼһںֱȽϣͬȷϣͬΪײ¼
+ * ͬһʱֻȷһѡ޷ʱúѡѼ⵽ټ¼
+ *
+ */
+void record_history() {
+  if (!history_on || period) {
+    return;
+  }
+  if (board_hash == empty_hash && board_empty()) {
+    period = 1, extinct = 1, settled_at = generation;
+    return;
+  }
+  if (confirm_period && generation - confirm_at == confirm_period) {
+    int same = board_matches(confirm_map);
+    free(confirm_map);
+    confirm_map = NULL;
+    if (same) {
+      period = confirm_period, settled_at = confirm_from;
+      confirm_period = 0;
+      return;
+    }
+    confirm_period = 0;
+  }
+  int victim = -1;
+  for (int k = 0; k < HISTORY_PROBE; ++k) {
+    int s = (int)((board_hash + (uint64_t)k) & (HISTORY_SLOTS - 1));
+    long long g = history_gen[s];
+    if (g >= 0 && g < generation && generation - g <= HISTORY &&
+        history_hash[s] == board_hash) {
+      if (!confirm_period) {
+        confirm_map = malloc((size_t)row * words * sizeof(uint64_t));
+        if (confirm_map != NULL) {
+          copy_board(confirm_map);
+          confirm_period = (int)(generation - g);
+          confirm_at = generation, confirm_from = g;
+        }
+      }
+      return;
+    }
+    if (victim < 0 || g < history_gen[victim]) {
+      victim = s;
+    }
+  }
+  history_hash[victim] = board_hash;
+  history_gen[victim] = generation;
+}
+
+/**
+ * @brief ѵǰͼΪÿ words ֵĽոÿһֽȥλ
+ *
+ * @param copy  row * words 
+ */
+void copy_board(uint64_t *copy) {
+  uint64_t tail = tail_mask();
+  for (int i = 0; i < row; ++i) {
+    uint64_t *q = copy + (size_t)i * words;
+    memcpy(q, row_ptr(map, i), (size_t)words * sizeof(uint64_t));
+    q[words - 1] &= tail;
+  }
+}
+
+/**
+ * @brief ֱȽϵǰͼ copy_board õĸ
+ *
+ * @param copy 
+ * @return int ͬΪ1Ϊ0
+ */
+int board_matches(const uint64_t *copy) {
+  uint64_t tail = tail_mask();
+  for (int i = 0; i < row; ++i) {
+    const uint64_t *p = row_ptr(map, i), *q = copy + (size_t)i * words;
+    if (memcmp(p, q, (size_t)(words - 1) * sizeof(uint64_t)) != 0 ||
+        (p[words - 1] & tail) != q[words - 1]) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief ʾ
+ *
+ * @param buf 壬Ϊ LEN
+ * @return int Ѽ⵽Ϊ1Ϊ0
+ */
+int describe_history(char *buf) {
+  if (!period) {
+    return 0;
+  }
+  if (extinct) {
+    snprintf(buf, LEN, "extinct at generation %lld", settled_at);
+  } else if (period == 1) {
+    snprintf(buf, LEN, "still life since generation %lld", settled_at);
+  } else {
+    snprintf(buf, LEN, "period %d oscillator since generation %lld", period,
+             settled_at);
+  }
+  return 1;
+}
+
+/**
+ * @brief һ 64 ϸһھΪ
+ *
+ * @param a һ
+ * @param b 
+ * @param c һ
+ * @return uint64_t һ
+ */
+uint64_t next_bits(uint64_t a, uint64_t b, uint64_t c) {
+  uint64_t src[3][3] = {{0, a, 0}, {0, b, 0}, {0, c, 0}}, s0[3], s1[3], d;
+  for (int k = 0; k < 3; ++k) {
+    row_sum(&src[k][1], &s0[k], &s1[k], 1);
+  }
+  rule_fn(&s0[0], &s1[0], &s0[1], &s1[1], &s0[2], &s1[2], &b, &d, 1);
+  return d;
+}
+
+/**
+ * @brief 64 λϣ splitmix64 ĻϺ
+ *
+ * @param x 
+ * @return uint64_t ϣֵ
+ */
+uint64_t hl_hash(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ull;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+/**
+ * @brief ͷ HashLife ȫڵ㣬ոڵ㡣
+ *
+ */
+void hl_reset() {
+  free(hl_nodes);
+  free(hl_table);
+  hl_nodes = NULL, hl_table = NULL;
+  hl_count = hl_capacity = hl_table_size = 0;
+  hl_root = HL_NONE;
+}
+
+/**
+ * @brief
+ *  n ͬĽڵ㣬û½ڵϣ豶½ʱΪա
+ *
+ * @param n ڵ
+ * @return uint32_t ڵ
+ */
+uint32_t hl_intern(hl_node *n) {
+  if (hl_count * 2 >= hl_table_size) {
+    uint32_t size = hl_table_size ? hl_table_size * 2 : 1u << 16;
+    uint32_t *table = malloc(sizeof(uint32_t) * size);
+    if (table == NULL) {
+      printf("hashlife: error: out of memory\n");
+      exit(1);
+    }
+    memset(table, 0xff, sizeof(uint32_t) * size);
+    for (uint32_t i = 0; i < hl_count; ++i) {
+      hl_node *m = &hl_nodes[i];
+      uint64_t h = m->level == 3 ? hl_hash(m->bits)
+                                 : hl_hash(m->nw ^ (uint64_t)m->ne << 32) ^
+                                       hl_hash(m->sw ^ (uint64_t)m->se << 32 ^ 1);
+      uint32_t j = (uint32_t)h & (size - 1);
+      while (table[j] != HL_NONE) j = (j + 1) & (size - 1);
+      table[j] = i;
+    }
+    free(hl_table);
+    hl_table = table, hl_table_size = size;
+  }
+  uint64_t h = n->level == 3 ? hl_hash(n->bits)
+                             : hl_hash(n->nw ^ (uint64_t)n->ne << 32) ^
+                                   hl_hash(n->sw ^ (uint64_t)n->se << 32 ^ 1);
+  uint32_t j = (uint32_t)h & (hl_table_size - 1);
+  while (hl_table[j] != HL_NONE) {
+    hl_node *m = &hl_nodes[hl_table[j]];
+    if (m->level == n->level &&
+        (n->level == 3 ? m->bits == n->bits
+                       : m->nw == n->nw && m->ne == n->ne && m->sw == n->sw &&
+                             m->se == n->se)) {
+      return hl_table[j];
+    }
+    j = (j + 1) & (hl_table_size - 1);
+  }
+  if (hl_count == hl_capacity) {
+    uint32_t cap = hl_capacity ? hl_capacity * 2 : 1u << 15;
+    hl_node *nodes = realloc(hl_nodes, sizeof(hl_node) * cap);
+    if (nodes == NULL) {
+      printf("hashlife: error: out of memory\n");
+      exit(1);
+    }
+    hl_nodes = nodes, hl_capacity = cap;
+  }
+  n->result = HL_NONE, n->result_j = -1;
+  hl_nodes[hl_count] = *n;
+  hl_table[j] = hl_count;
+  return hl_count++;
+}
+
+/**
+ * @brief ȡһ 8x8 Ҷӽڵ㡣 r е c ϸΪ bits ĵ r * 8 + c λ
+ *
+ * @param bits 64 ϸ
+ * @return uint32_t ڵ
+ */
+uint32_t hl_leaf(uint64_t bits) {
+  hl_node n = {0, 0, 0, 0, bits, HL_NONE, 3, -1};
+  return hl_intern(&n);
+}
+
+/**
+ * @brief ĸͬӽڵһڵ㡣
+ *
+ * @param nw 
+ * @param ne 
+ * @param sw 
+ * @param se 
+ * @return uint32_t ڵ
+ */
+uint32_t hl_join(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se) {
+  hl_node n = {nw, ne, sw, se, 0, HL_NONE, (int8_t)(hl_nodes[nw].level + 1),
+               -1};
+  return hl_intern(&n);
+}
+
+/**
+ * @brief ȡڵ߳һĲ֣ڵ 5 
+ *
+ * @param m ڵ
+ * @return uint32_t 벿֣һ
+ */
+uint32_t hl_centre(uint32_t m) {
+  hl_node n = hl_nodes[m];
+  return hl_join(hl_nodes[n.nw].se, hl_nodes[n.ne].sw, hl_nodes[n.sw].ne,
+                 hl_nodes[n.se].nw);
+}
+
+/**
+ * @brief
+ * ĸ 8x8 Ҷƴɵ 16x16 ȡ 8x8  a ¡ b ¡ c
+ *  d ϸ 4x4 
+ *
+ * @param a Ҷ
+ * @param b Ҷ
+ * @param c Ҷ
+ * @param d Ҷ
+ * @return uint32_t Ҷӱ
+ */
+uint32_t hl_leaf_centre(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+  uint64_t ba = hl_nodes[a].bits, bb = hl_nodes[b].bits;
+  uint64_t bc = hl_nodes[c].bits, bd = hl_nodes[d].bits, bits = 0;
+  for (int r = 0; r < 4; ++r) {
+    uint64_t top = (ba >> ((r + 4) * 8 + 4) & 0xf) |
+                   (bb >> ((r + 4) * 8) & 0xf) << 4;
+    uint64_t bottom = (bc >> (r * 8 + 4) & 0xf) | (bd >> (r * 8) & 0xf) << 4;
+    bits |= top << (r * 8) | bottom << ((r + 4) * 8);
+  }
+  return hl_leaf(bits);
+}
+
+/**
+ * @brief
+ * ĸͬڵų 2x2 ʱȡͬСĲ֡ҶӲ hl_leaf_centre
+ * 
+ *
+ * @param a 
+ * @param b 
+ * @param c 
+ * @param d 
+ * @return uint32_t 벿֣ͬ
+ */
+uint32_t hl_inner(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+  if (hl_nodes[a].level == 3) {
+    return hl_leaf_centre(a, b, c, d);
+  }
+  return hl_join(hl_nodes[a].se, hl_nodes[b].sw, hl_nodes[c].ne,
+                 hl_nodes[d].nw);
+}
+
+/**
+ * @brief
+ *  4 ڵ㣨 16x16 ֱ 2  j η j  2
+ *  8x8 ÿЧһĴ 8x8 Ȼ׼ȷ
+ *
+ * @param m ڵ
+ * @param j ָ
+ * @return uint32_t Ҷӱ
+ */
+uint32_t hl_base(uint32_t m, int j) {
+  hl_node n = hl_nodes[m];
+  uint64_t rows[18] = {0}, next[16];
+  for (int r = 0; r < 8; ++r) {
+    rows[r + 1] = (hl_nodes[n.nw].bits >> (r * 8) & 0xff) |
+                  (hl_nodes[n.ne].bits >> (r * 8) & 0xff) << 8;
+    rows[r + 9] = (hl_nodes[n.sw].bits >> (r * 8) & 0xff) |
+                  (hl_nodes[n.se].bits >> (r * 8) & 0xff) << 8;
+  }
+  for (int g = 0; g < (1 << j); ++g) {
+    for (int r = 0; r < 16; ++r) {
+      next[r] = next_bits(rows[r], rows[r + 1], rows[r + 2]) & 0xffff;
+    }
+    memcpy(rows + 1, next, sizeof(next));
+  }
+  uint64_t bits = 0;
+  for (int r = 0; r < 8; ++r) {
+    bits |= (rows[r + 5] >> 4 & 0xff) << (r * 8);
+  }
+  return hl_leaf(bits);
+}
+
+/**
+ * @brief
+ * HashLife ĵݹ顣ص k ڵ߳һĲ 2  j
+ * η֮״̬ j  k - 2 ѽڵΪŸصһڵֱݹ飬
+ * j = k - 2 ʱٰѽƴĸڵݹһΣʹֱȡŸƴӡڽڵУͬڵֻһΡ
+ *
+ * @param m ڵ
+ * @param j ָ
+ * @return uint32_t ڵţһ
+ */
+uint32_t hl_step(uint32_t m, int j) {
+  int k = hl_nodes[m].level;
+  if (j > k - 2) {
+    j = k - 2;
+  }
+  if (m == hl_empty[k]) {
+    return hl_empty[k - 1];
+  }
+  if (hl_nodes[m].result != HL_NONE && hl_nodes[m].result_j == j) {
+    return hl_nodes[m].result;
+  }
+  uint32_t res;
+  if (k == 4) {
+    res = hl_base(m, j);
+  } else {
+    hl_node n = hl_nodes[m];
+    hl_node nw = hl_nodes[n.nw], ne = hl_nodes[n.ne];
+    hl_node sw = hl_nodes[n.sw], se = hl_nodes[n.se];
+    uint32_t sub[9] = {
+        n.nw,
+        hl_join(nw.ne, ne.nw, nw.se, ne.sw),
+        n.ne,
+        hl_join(nw.sw, nw.se, sw.nw, sw.ne),
+        hl_centre(m),
+        hl_join(ne.sw, ne.se, se.nw, se.ne),
+        n.sw,
+        hl_join(sw.ne, se.nw, sw.se, se.sw),
+        n.se,
+    };
+    uint32_t r[9];
+    for (int i = 0; i < 9; ++i) {
+      r[i] = hl_step(sub[i], j);
+    }
+    if (j == k - 2) {
+      res = hl_join(hl_step(hl_join(r[0], r[1], r[3], r[4]), j),
+                    hl_step(hl_join(r[1], r[2], r[4], r[5]), j),
+                    hl_step(hl_join(r[3], r[4], r[6], r[7]), j),
+                    hl_step(hl_join(r[4], r[5], r[7], r[8]), j));
+    } else {
+      res = hl_join(hl_inner(r[0], r[1], r[3], r[4]),
+                    hl_inner(r[1], r[2], r[4], r[5]),
+                    hl_inner(r[3], r[4], r[6], r[7]),
+                    hl_inner(r[4], r[5], r[7], r[8]));
+    }
+  }
+  hl_nodes[m].result = res, hl_nodes[m].result_j = (int8_t)j;
+  return res;
+}
+
+/**
+ * @brief жϽڵĻϸǷ߳һķΧڡ
+ *
+ * @param m ڵţ 5
+ * @return int Ϊ1Ϊ0
+ */
+int hl_is_centred(uint32_t m) {
+  hl_node n = hl_nodes[m];
+  uint32_t e = hl_empty[n.level - 2];
+  hl_node nw = hl_nodes[n.nw], ne = hl_nodes[n.ne];
+  hl_node sw = hl_nodes[n.sw], se = hl_nodes[n.se];
+  return nw.nw == e && nw.ne == e && nw.sw == e && ne.nw == e && ne.ne == e &&
+         ne.se == e && sw.nw == e && sw.sw == e && sw.se == e && se.ne == e &&
+         se.sw == e && se.se == e;
+}
+
+/**
+ * @brief ڸڵܲϸʹ߳ԭλ롣ڵ㲻 63 㣬 GENS_MAX
+ * ֤
+ *
+ */
+void hl_expand() {
+  hl_node n = hl_nodes[hl_root];
+  assert(n.level < 63);
+  uint32_t e = hl_empty[n.level - 1];
+  hl_root = hl_join(hl_join(e, e, e, n.nw), hl_join(e, e, n.ne, e),
+                    hl_join(e, n.sw, e, e), hl_join(n.se, e, e, e));
+  hl_y -= 1ll << (n.level - 1), hl_x -= 1ll << (n.level - 1);
+}
+
+/**
+ * @brief
+ * ƽǰ gens  gens Ķλִǰ 2  j
+ * ηչڵ㣬ʹϸλҲ㹻ٶչһռ䣬ȡ
+ * hl_step ĽΪµĸڵ㣻ȥܶĿհס
+ *
+ * @param gens 
+ */
+void hl_advance(uint64_t gens) {
+  for (int j = 0; j < 64 && (gens >> j) != 0; ++j) {
+    if (!(gens >> j & 1)) {
+      continue;
+    }
+    while (hl_nodes[hl_root].level < j + 2 || !hl_is_centred(hl_root)) {
+      hl_expand();
+    }
+    hl_expand();
+    int level = hl_nodes[hl_root].level;
+    hl_root = hl_step(hl_root, j);
+    hl_y += 1ll << (level - 2), hl_x += 1ll << (level - 2);
+    while (hl_nodes[hl_root].level > 5 && hl_is_centred(hl_root)) {
+      hl_y += 1ll << (hl_nodes[hl_root].level - 2);
+      hl_x += 1ll << (hl_nodes[hl_root].level - 2);
+      hl_root = hl_centre(hl_root);
+    }
+    if (hl_count > HL_LIMIT) {
+      hl_collect();
+    }
+  }
+}
+
+/**
+ * @brief
+ * ɵͼϽΪ (y, x)  level Сڵ㡣 col
+ * еҶӽȥͼλλΪ 0 
+ *
+ * @param y 
+ * @param x УΪ 8 ı
+ * @param level 
+ * @return uint32_t ڵ
+ */
+uint32_t hl_build(long long y, long long x, int level) {
+  if (y >= row || x >= col) {
+    return hl_empty[level];
+  }
+  if (level == 3) {
+    uint64_t mask = col - x < 8 ? ((uint64_t)1 << (col - x)) - 1 : 0xff;
+    uint64_t bits = 0;
+    for (int r = 0; r < 8 && y + r < row; ++r) {
+      bits |= (row_ptr(map, (int)(y + r))[x >> 6] >> (x & 63) & mask)
+              << (r * 8);
+    }
+    return hl_leaf(bits);
+  }
+  long long half = 1ll << (level - 1);
+  return hl_join(hl_build(y, x, level - 1), hl_build(y, x + half, level - 1),
+                 hl_build(y + half, x, level - 1),
+                 hl_build(y + half, x + half, level - 1));
+}
+
+/**
+ * @brief ɵǰͼؽ HashLife ĲͼϽǶڵϽǡ
+ *
+ */
+void hl_from_map() {
+  hl_reset();
+  hl_empty[3] = hl_leaf(0);
+  for (int i = 4; i < 64; ++i) {
+    hl_empty[i] = hl_join(hl_empty[i - 1], hl_empty[i - 1], hl_empty[i - 1],
+                          hl_empty[i - 1]);
+  }
+  int level = 5;
+  while ((1ll << level) < row || (1ll << level) < col) {
+    level++;
+  }
+  hl_root = hl_build(0, 0, level);
+  hl_y = hl_x = 0;
+}
+
+/**
+ * @brief ѽڵڵͼΧڵĻϸдͼ
+ *
+ * @param m ڵ
+ * @param y ڵϽǵ
+ * @param x ڵϽǵ
+ * @param level 
+ */
+void hl_write(uint32_t m, long long y, long long x, int level) {
+  long long size = 1ll << level;
+  if (m == hl_empty[level] || y >= row || x >= col || y + size <= 0 ||
+      x + size <= 0) {
+    return;
+  }
+  if (level == 3) {
+    uint64_t bits = hl_nodes[m].bits;
+    for (int r = 0; r < 8; ++r) {
+      for (int c = 0; c < 8; ++c) {
+        if ((bits >> (r * 8 + c) & 1) && y + r >= 0 && y + r < row &&
+            x + c >= 0 && x + c < col) {
+          set_cell((int)(y + r), (int)(x + c), 1);
+        }
+      }
+    }
+    return;
+  }
+  hl_node n = hl_nodes[m];
+  long long half = size / 2;
+  hl_write(n.nw, y, x, level - 1);
+  hl_write(n.ne, y, x + half, level - 1);
+  hl_write(n.sw, y + half, x, level - 1);
+  hl_write(n.se, y + half, x + half, level - 1);
+}
+
+/**
+ * @brief  HashLife ƽͼغϵĲдصͼͼϸӰ졣
+ *
+ */
+void hl_to_map() {
+  memset(map, 0, (size_t)(row + 2) * stride * sizeof(uint64_t));
+  hl_write(hl_root, hl_y, hl_x, hl_nodes[hl_root].level);
+}
+
+/**
+ * @brief ϽΪ (y, x)  level Сڵ㡣
+ *
+ * @param rows  64 
+ * @param y 
+ * @param x УΪ 8 ı
+ * @param level  6
+ * @return uint32_t ڵ
+ */
+uint32_t hl_build_rows(const uint64_t *rows, int y, int x, int level) {
+  if (level == 3) {
+    uint64_t bits = 0;
+    for (int r = 0; r < 8; ++r) {
+      bits |= (rows[y + r] >> x & 0xff) << (r * 8);
+    }
+    return hl_leaf(bits);
+  }
+  int half = 1 << (level - 1);
+  return hl_join(hl_build_rows(rows, y, x, level - 1),
+                 hl_build_rows(rows, y, x + half, level - 1),
+                 hl_build_rows(rows, y + half, x, level - 1),
+                 hl_build_rows(rows, y + half, x + half, level - 1));
+}
+
+/**
+ * @brief Ű꣨꣩ǷС mid ΪǰΡ
+ *
+ * @param ids 
+ * @param n 
+ * @param by_x 1Ϊ꣬0Ϊ
+ * @param mid ֽ
+ * @return int ǰһεĸ
+ */
+int pl_split(uint32_t *ids, int n, int by_x, long long mid) {
+  int k = 0;
+  for (int i = 0; i < n; ++i) {
+    const pl_chunk *c = pl_get(ids[i]);
+    if ((by_x ? c->cx : c->cy) < mid) {
+      uint32_t t = ids[i];
+      ids[i] = ids[k], ids[k++] = t;
+    }
+  }
+  return k;
+}
+
+/**
+ * @brief
+ * ϽΪ (cy, cx)  level Сڵ n 齨ڵ㣬ĸ޸Եݹ顣
+ *
+ * @param ids ڵţᱻ
+ * @param n 
+ * @param cy Ͻǵ
+ * @param cx Ͻǵ
+ * @param level С 6
+ * @return uint32_t ڵ
+ */
+uint32_t hl_build_chunks(uint32_t *ids, int n, long long cy, long long cx,
+                         int level) {
+  if (n == 0) {
+    return hl_empty[level];
+  }
+  if (level == 6) {
+    return hl_build_rows(pl_get(ids[0])->cells, 0, 0, 6);
+  }
+  long long half = 1ll << (level - 7);
+  int top = pl_split(ids, n, 0, cy + half);
+  int nw = pl_split(ids, top, 1, cx + half);
+  int sw = pl_split(ids + top, n - top, 1, cx + half);
+  return hl_join(hl_build_chunks(ids, nw, cy, cx, level - 1),
+                 hl_build_chunks(ids + nw, top - nw, cy, cx + half, level - 1),
+                 hl_build_chunks(ids + top, sw, cy + half, cx, level - 1),
+                 hl_build_chunks(ids + top + sw, n - top - sw, cy + half,
+                                 cx + half, level - 1));
+}
+
+/**
+ * @brief
+ * ƽȫ飨ֻǵͼΧڵĲ֣ؽ HashLife
+ * ĲڵϽǶӾεϽǡڴ治ʱ˳
+ *
+ */
+void hl_from_plane() {
+  hl_reset();
+  hl_empty[3] = hl_leaf(0);
+  for (int i = 4; i < 64; ++i) {
+    hl_empty[i] = hl_join(hl_empty[i - 1], hl_empty[i - 1], hl_empty[i - 1],
+                          hl_empty[i - 1]);
+  }
+  uint32_t *ids = malloc(sizeof(uint32_t) * (pl_used + 1));
+  if (ids == NULL) {
+    printf("hashlife: error: out of memory\n");
+    exit(1);
+  }
+  int n = 0;
+  long long y0 = 0, x0 = 0, y1 = 0, x1 = 0;
+  for (uint32_t i = 0; i < pl_size; ++i) {
+    if (pl_vals[i] == PL_NONE) {
       continue;
-    } else {
-      printf("error: command not found: %s %s\n", buff, filename);
     }
-    printf("\n");
+    const pl_chunk *c = pl_get(pl_vals[i]);
+    int live = 0;
+    for (int r = 0; r < CHUNK && !live; ++r) {
+      live = c->cells[r] != 0;
+    }
+    if (!live) {
+      continue;
+    }
+    if (n == 0 || c->cy < y0) y0 = c->cy;
+    if (n == 0 || c->cx < x0) x0 = c->cx;
+    if (n == 0 || c->cy > y1) y1 = c->cy;
+    if (n == 0 || c->cx > x1) x1 = c->cx;
+    ids[n++] = pl_vals[i];
+  }
+  int level = 6;
+  while ((1ll << (level - 6)) <= y1 - y0 || (1ll << (level - 6)) <= x1 - x0) {
+    level++;
+  }
+  hl_root = hl_build_chunks(ids, n, y0, x0, level);
+  hl_y = y0 * CHUNK, hl_x = x0 * CHUNK;
+  free(ids);
+}
+
+/**
+ * @brief ѽڵеȫϸдƽ棬Ҫʱ顣
+ *
+ * @param m ڵ
+ * @param y ڵϽǵ
+ * @param x ڵϽǵУΪ 8 ı
+ * @param level 
+ * @return int ɹΪ1ڴ治Ϊ0
+ */
+int hl_put(uint32_t m, long long y, long long x, int level) {
+  if (m == hl_empty[level]) {
+    return 1;
+  }
+  if (level == 3) {
+    uint64_t bits = hl_nodes[m].bits;
+    for (int r = 0; r < 8; ++r) {
+      uint64_t b = bits >> (r * 8) & 0xff;
+      if (b) {
+        long long yy = y + r;
+        uint32_t id = pl_insert((int32_t)(yy >> 6), (int32_t)(x >> 6));
+        if (id == PL_NONE) {
+          return 0;
+        }
+        pl_get(id)->cells[yy & 63] |= b << (x & 63);
+      }
+    }
+    return 1;
+  }
+  hl_node n = hl_nodes[m];
+  long long half = 1ll << (level - 1);
+  return hl_put(n.nw, y, x, level - 1) &&
+         hl_put(n.ne, y, x + half, level - 1) &&
+         hl_put(n.sw, y + half, x, level - 1) &&
+         hl_put(n.se, y + half, x + half, level - 1);
+}
+
+/**
+ * @brief
+ *  HashLife ƽȫϸؽƽ档ڴ治ʱΪֻѵͼΧڵϸдصͼƽ沢߽磬ͼϸʧ
+ *
+ * @return int ɹΪ1ڴ治Ϊ0
+ */
+int hl_to_plane() {
+  pl_reset();
+  if (hl_put(hl_root, hl_y, hl_x, hl_nodes[hl_root].level)) {
+    return 1;
   }
+  pl_reset();
+  hl_to_map();
+  boundary = BOUNDARY_DEAD;
+  printf("infinite: error: cells outside the map were dropped, boundary = "
+         "dead\n");
   return 0;
 }
 
 /**
- * @brief ȡһַȲ1024
+ * @brief  m ΪƵµĽڵУڻա
+ *
+ * @param m ɱ
+ * @param old ɽڵ
+ * @param remap ɱŵ±ŵĶӦ
+ * @return uint32_t ±
+ */
+uint32_t hl_copy(uint32_t m, hl_node *old, uint32_t *remap) {
+  if (remap[m] != HL_NONE) {
+    return remap[m];
+  }
+  hl_node n = old[m];
+  if (n.level == 3) {
+    remap[m] = hl_leaf(n.bits);
+  } else {
+    uint32_t nw = hl_copy(n.nw, old, remap), ne = hl_copy(n.ne, old, remap);
+    uint32_t sw = hl_copy(n.sw, old, remap), se = hl_copy(n.se, old, remap);
+    remap[m] = hl_join(nw, ne, sw, se);
+  }
+  return remap[m];
+}
+
+/**
+ * @brief սڵ㣺ֻڵȫڵɴĽڵ㣬н档
+ *
+ */
+void hl_collect() {
+  hl_node *old = hl_nodes;
+  uint32_t count = hl_count;
+  uint32_t *remap = malloc(sizeof(uint32_t) * count);
+  if (remap == NULL) {
+    return;
+  }
+  memset(remap, 0xff, sizeof(uint32_t) * count);
+  free(hl_table);
+  hl_nodes = NULL, hl_table = NULL;
+  hl_count = hl_capacity = hl_table_size = 0;
+  for (int i = 3; i < 64; ++i) {
+    hl_empty[i] = hl_copy(hl_empty[i], old, remap);
+  }
+  hl_root = hl_copy(hl_root, old, remap);
+  free(old);
+  free(remap);
+}
+
+/**
+ * @brief
+ * ʾѡ߽ģʽ dead ΪͼΪ infinite
+ * Ϊƽ棬ϸ뿪ͼݻͼֻʾƽ 0
+ * ʼĴڣ torus Ϊ棬ͼ¡ӡ
+ *
+ * @param arg dead  infinite  torus 
+ */
+void set_boundary(char *arg) {
+  if (strcmp(arg, "dead") == 0) {
+    if (engine == ENGINE_HASHLIFE) {
+      printf("set_boundary: error: hashlife only supports infinite\n");
+      return;
+    }
+    boundary = BOUNDARY_DEAD;
+    pl_reset();
+    engine_attach();
+  } else if (strcmp(arg, "infinite") == 0) {
+    if (engine == ENGINE_LUT) {
+      printf("set_boundary: error: lut only supports dead and torus\n");
+      return;
+    }
+    if (rule_birth & 1) {
+      printf("set_boundary: error: infinite does not support B0 rules\n");
+      return;
+    }
+    if (boundary != BOUNDARY_INFINITE) {
+      boundary = BOUNDARY_INFINITE;
+      engine_attach();
+    }
+  } else if (strcmp(arg, "torus") == 0) {
+    if (engine == ENGINE_HASHLIFE) {
+      printf("set_boundary: error: hashlife only supports infinite\n");
+      return;
+    }
+    boundary = BOUNDARY_TORUS;
+    pl_reset();
+    engine_attach();
+  } else if (strcmp(arg, EMPTY) != 0) {
+    printf("set_boundary: error: unknown boundary: %s\n", arg);
+    return;
+  }
+  if (boundary == BOUNDARY_INFINITE && engine != ENGINE_HASHLIFE) {
+    printf("boundary = infinite, chunks = %u (%u allocated)\n", pl_used,
+           pl_total);
+  } else {
+    printf("boundary = %s\n", boundary == BOUNDARY_INFINITE ? "infinite"
+                               : boundary == BOUNDARY_TORUS  ? "torus"
+                                                             : "dead");
+  }
+}
+
+/**
+ * @brief ɱȡַ
+ *
+ * @param i 
+ * @return pl_chunk* ַ
+ */
+pl_chunk *pl_get(uint32_t i) {
+  return &pl_blocks[i / CHUNK_BLOCK][i % CHUNK_BLOCK];
+}
+
+/**
+ * @brief ͷƽȫϣ
+ *
+ */
+void pl_reset() {
+  for (uint32_t i = 0; i < pl_total / CHUNK_BLOCK; ++i) {
+    aligned_free(pl_blocks[i]);
+  }
+  free(pl_blocks);
+  free(pl_free);
+  free(pl_keys);
+  free(pl_vals);
+  free(pl_list);
+  pl_blocks = NULL, pl_free = NULL, pl_keys = NULL, pl_vals = NULL;
+  pl_list = NULL;
+  pl_total = pl_free_count = pl_size = pl_used = 0;
+  pl_list_count = pl_list_capacity = 0;
+}
+
+/**
+ * @brief ڹϣв顣
+ *
+ * @param cy 
+ * @param cx 
+ * @return uint32_t ţʱΪ PL_NONE
+ */
+uint32_t pl_find(int32_t cy, int32_t cx) {
+  if (pl_size == 0) {
+    return PL_NONE;
+  }
+  uint64_t key = (uint64_t)(uint32_t)cy << 32 | (uint32_t)cx;
+  uint32_t j = (uint32_t)hl_hash(key) & (pl_size - 1);
+  while (pl_vals[j] != PL_NONE) {
+    if (pl_keys[j] == key) {
+      return pl_vals[j];
+    }
+    j = (j + 1) & (pl_size - 1);
+  }
+  return PL_NONE;
+}
+
+/**
+ * @brief
+ * ȡ飬ʱȡһȫ롣޿ʱ
+ * CHUNK_BLOCK ϣװʳһʱڴ治ʱʾƽ汣ԭ
+ *
+ * @param cy 
+ * @param cx 
+ * @return uint32_t ţڴ治ʱΪ PL_NONE
+ */
+uint32_t pl_insert(int32_t cy, int32_t cx) {
+  uint32_t found = pl_find(cy, cx);
+  if (found != PL_NONE) {
+    return found;
+  }
+  if ((pl_used + 1) * 2 > pl_size) {
+    uint32_t size = pl_size ? pl_size * 2 : 1024;
+    uint64_t *keys = malloc(sizeof(uint64_t) * size);
+    uint32_t *vals = malloc(sizeof(uint32_t) * size);
+    if (keys == NULL || vals == NULL) {
+      free(keys);
+      free(vals);
+      printf("infinite: error: out of memory\n");
+      return PL_NONE;
+    }
+    memset(vals, 0xff, sizeof(uint32_t) * size);
+    for (uint32_t i = 0; i < pl_size; ++i) {
+      if (pl_vals[i] != PL_NONE) {
+        uint32_t j = (uint32_t)hl_hash(pl_keys[i]) & (size - 1);
+        while (vals[j] != PL_NONE) j = (j + 1) & (size - 1);
+        keys[j] = pl_keys[i], vals[j] = pl_vals[i];
+      }
+    }
+    free(pl_keys);
+    free(pl_vals);
+    pl_keys = keys, pl_vals = vals, pl_size = size;
+  }
+  if (pl_free_count == 0) {
+    pl_chunk **blocks =
+        realloc(pl_blocks, sizeof(pl_chunk *) * (pl_total / CHUNK_BLOCK + 1));
+    uint32_t *stack =
+        realloc(pl_free, sizeof(uint32_t) * (pl_total + CHUNK_BLOCK));
+    if (blocks != NULL) {
+      pl_blocks = blocks;
+    }
+    if (stack != NULL) {
+      pl_free = stack;
+    }
+    pl_chunk *block =
+        blocks && stack ? aligned_malloc(sizeof(pl_chunk) * CHUNK_BLOCK) : NULL;
+    if (block == NULL) {
+      printf("infinite: error: out of memory\n");
+      return PL_NONE;
+    }
+    pl_blocks[pl_total / CHUNK_BLOCK] = block;
+    for (uint32_t i = CHUNK_BLOCK; i > 0; --i) {
+      pl_free[pl_free_count++] = pl_total + i - 1;
+    }
+    pl_total += CHUNK_BLOCK;
+  }
+  uint32_t id = pl_free[--pl_free_count];
+  pl_chunk *c = pl_get(id);
+  c->cy = cy, c->cx = cx;
+  memset(c->cells, 0, sizeof(c->cells));
+  uint64_t key = (uint64_t)(uint32_t)cy << 32 | (uint32_t)cx;
+  uint32_t j = (uint32_t)hl_hash(key) & (pl_size - 1);
+  while (pl_vals[j] != PL_NONE) j = (j + 1) & (pl_size - 1);
+  pl_keys[j] = key, pl_vals[j] = id;
+  pl_used++;
+  return id;
+}
+
+/**
+ * @brief
+ * ӹϣɾ鲢黹ءɾͬһ̽ıǰƣĹ
+ *
+ * @param cy 
+ * @param cx 
+ */
+void pl_remove(int32_t cy, int32_t cx) {
+  uint64_t key = (uint64_t)(uint32_t)cy << 32 | (uint32_t)cx;
+  uint32_t mask = pl_size - 1, j = (uint32_t)hl_hash(key) & mask;
+  while (pl_vals[j] != PL_NONE && pl_keys[j] != key) j = (j + 1) & mask;
+  if (pl_vals[j] == PL_NONE) {
+    return;
+  }
+  pl_free[pl_free_count++] = pl_vals[j];
+  pl_vals[j] = PL_NONE;
+  pl_used--;
+  for (uint32_t k = (j + 1) & mask; pl_vals[k] != PL_NONE; k = (k + 1) & mask) {
+    uint32_t home = (uint32_t)hl_hash(pl_keys[k]) & mask;
+    if (((k - home) & mask) >= ((k - j) & mask)) {
+      pl_keys[j] = pl_keys[k], pl_vals[j] = pl_vals[k];
+      pl_vals[k] = PL_NONE;
+      j = k;
+    }
+  }
+}
+
+/**
+ * @brief ѹϣȫıռ pl_list С
+ *
+ * @return int ɹΪ1ڴ治Ϊ0
+ */
+int pl_gather() {
+  if (pl_list_capacity < pl_used) {
+    uint32_t *list = realloc(pl_list, sizeof(uint32_t) * pl_size);
+    if (list == NULL) {
+      printf("infinite: error: out of memory\n");
+      return 0;
+    }
+    pl_list = list, pl_list_capacity = pl_size;
+  }
+  pl_list_count = 0;
+  for (uint32_t i = 0; i < pl_size; ++i) {
+    if (pl_vals[i] != PL_NONE) {
+      pl_list[pl_list_count++] = pl_vals[i];
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief
+ * ϸԵʱΪһܳϸ飨ԽǣԤȲȫ顣
+ *
+ * @return int ɹΪ1ڴ治Ϊ0ʱѲȫ鲻Ӱ
+ */
+int pl_grow() {
+  if (!pl_gather()) {
+    return 0;
+  }
+  uint32_t n = pl_list_count;
+  int ok = 1;
+  for (uint32_t i = 0; i < n; ++i) {
+    const pl_chunk *c = pl_get(pl_list[i]);
+    uint64_t any = 0;
+    for (int r = 0; r < CHUNK; ++r) {
+      any |= c->cells[r];
+    }
+    uint64_t top = c->cells[0], bottom = c->cells[CHUNK - 1];
+    int32_t cy = c->cy, cx = c->cx;
+    if (top) ok &= pl_insert(cy - 1, cx) != PL_NONE;
+    if (bottom) ok &= pl_insert(cy + 1, cx) != PL_NONE;
+    if (any & 1) ok &= pl_insert(cy, cx - 1) != PL_NONE;
+    if (any >> 63) ok &= pl_insert(cy, cx + 1) != PL_NONE;
+    if (top & 1) ok &= pl_insert(cy - 1, cx - 1) != PL_NONE;
+    if (top >> 63) ok &= pl_insert(cy - 1, cx + 1) != PL_NONE;
+    if (bottom & 1) ok &= pl_insert(cy + 1, cx - 1) != PL_NONE;
+    if (bottom >> 63) ok &= pl_insert(cy + 1, cx + 1) != PL_NONE;
+    if (!ok) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief
+ * һһд next ȴڰ˸ȡΧһȦϸƴ
+ * 66 Сÿֵľֲͼ밴λͬк㡣
+ *
+ * @param c ַ
+ */
+void pl_compute(pl_chunk *c) {
+  const pl_chunk *nb[3][3];
+  for (int dy = -1; dy <= 1; ++dy) {
+    for (int dx = -1; dx <= 1; ++dx) {
+      uint32_t id = dy || dx ? pl_find(c->cy + dy, c->cx + dx) : PL_NONE;
+      nb[dy + 1][dx + 1] = dy || dx ? (id == PL_NONE ? NULL : pl_get(id)) : c;
+    }
+  }
+  uint64_t rows[CHUNK + 2][3], s0[CHUNK + 2], s1[CHUNK + 2];
+  for (int r = 0; r < CHUNK + 2; ++r) {
+    int dy = r == 0 ? 0 : r == CHUNK + 1 ? 2 : 1;
+    int rr = r == 0 ? CHUNK - 1 : r == CHUNK + 1 ? 0 : r - 1;
+    for (int dx = 0; dx < 3; ++dx) {
+      rows[r][dx] = nb[dy][dx] ? nb[dy][dx]->cells[rr] : 0;
+    }
+    row_sum(&rows[r][1], &s0[r], &s1[r], 1);
+  }
+  for (int r = 0; r < CHUNK; ++r) {
+    rule_fn(&s0[r], &s1[r], &s0[r + 1], &s1[r + 1], &s0[r + 2], &s1[r + 2],
+             &rows[r + 1][1], &c->next[r], 1);
+  }
+}
+
+/**
+ * @brief  pl_list е id һͳʱ漴ͳƸ顣
+ *
+ * @param id ̱߳
+ */
+void pl_band(int id) {
+  uint32_t i0 = (uint32_t)((uint64_t)pl_list_count * id / threads);
+  uint32_t i1 = (uint32_t)((uint64_t)pl_list_count * (id + 1) / threads);
+  memset(&band_stats[id], 0, sizeof(life_stats));
+  for (uint32_t i = i0; i < i1; ++i) {
+    pl_chunk *c = pl_get(pl_list[i]);
+    pl_compute(c);
+    for (int r = 0; r < CHUNK && stats_on; ++r) {
+      stats_row_fn(&c->cells[r], &c->next[r], 1, (long long)c->cy * CHUNK + r,
+                   (long long)c->cx * 64, ~(uint64_t)0, &band_stats[id]);
+    }
+  }
+}
+
+/**
+ * @brief
+ * ƽǰһΪԵлϸ鲹飬̳߳ؼһͳһ滻ѱΪȫ黹أ
+ * õʱ pl_compact ͷŶڴ棬ڴֻϸֲйءڴ治ʱǰ
+ *
+ * @return int ɹΪ1ڴ治Ϊ0
+ */
+int pl_step() {
+  if (!pl_grow() || !pl_gather()) {
+    return 0;
+  }
+  pool_run(pl_band);
+  for (uint32_t i = 0; i < pl_list_count; ++i) {
+    pl_chunk *c = pl_get(pl_list[i]);
+    uint64_t any = 0;
+    for (int r = 0; r < CHUNK; ++r) {
+      c->cells[r] = c->next[r];
+      any |= c->next[r];
+    }
+    if (!any) {
+      pl_remove(c->cy, c->cx);
+    }
+  }
+  pl_compact();
+  return 1;
+}
+
+/**
+ * @brief
+ * õ鲻˷֮һʱθƵ·ĿУؽϣͷԭеĿ顢ϣ
+ * pl_list ɢڸУ黹ܴճ飬ϣϸٶС
+ * ֮ı䣬ֻ pl_step ĩβãʱûб𴦱šڴ治ʱԭ
+ *
+ */
+void pl_compact() {
+  if (pl_total <= CHUNK_BLOCK || pl_used * 8 >= pl_total) {
+    return;
+  }
+  if (pl_used == 0) {
+    pl_reset();
+    return;
+  }
+  uint32_t count = (pl_used + CHUNK_BLOCK - 1) / CHUNK_BLOCK, made = 0;
+  uint32_t size = 1024;
+  while (size < pl_used * 4) {
+    size *= 2;
+  }
+  pl_chunk **blocks = malloc(sizeof(pl_chunk *) * count);
+  uint32_t *stack = malloc(sizeof(uint32_t) * count * CHUNK_BLOCK);
+  uint64_t *keys = malloc(sizeof(uint64_t) * size);
+  uint32_t *vals = malloc(sizeof(uint32_t) * size);
+  while (blocks != NULL && made < count &&
+         (blocks[made] = aligned_malloc(sizeof(pl_chunk) * CHUNK_BLOCK))) {
+    made++;
+  }
+  if (made < count || stack == NULL || keys == NULL || vals == NULL) {
+    while (made > 0) {
+      aligned_free(blocks[--made]);
+    }
+    free(blocks);
+    free(stack);
+    free(keys);
+    free(vals);
+    return;
+  }
+  memset(vals, 0xff, sizeof(uint32_t) * size);
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < pl_size; ++i) {
+    if (pl_vals[i] != PL_NONE) {
+      blocks[n / CHUNK_BLOCK][n % CHUNK_BLOCK] = *pl_get(pl_vals[i]);
+      uint32_t j = (uint32_t)hl_hash(pl_keys[i]) & (size - 1);
+      while (vals[j] != PL_NONE) j = (j + 1) & (size - 1);
+      keys[j] = pl_keys[i], vals[j] = n++;
+    }
+  }
+  pl_reset();
+  pl_blocks = blocks, pl_free = stack, pl_keys = keys, pl_vals = vals;
+  pl_total = count * CHUNK_BLOCK, pl_size = size, pl_used = n;
+  for (uint32_t i = pl_total; i > n; --i) {
+    pl_free[pl_free_count++] = i - 1;
+  }
+}
+
+/**
+ * @brief
+ * ɵǰͼؽƽ档ͼ i е w ֶӦ (i / 64, w)
+ * ÿһȽȥλλΪ 0 ڴ治ʱƽ档
+ *
+ * @return int ɹΪ1ڴ治Ϊ0
+ */
+int pl_from_map() {
+  pl_reset();
+  uint64_t tail = tail_mask();
+  for (int i = 0; i < row; ++i) {
+    const uint64_t *p = row_ptr(map, i);
+    for (int w = 0; w < words; ++w) {
+      uint64_t x = w == words - 1 ? p[w] & tail : p[w];
+      uint32_t id = x ? pl_insert(i / CHUNK, w) : 0;
+      if (id == PL_NONE) {
+        pl_reset();
+        return 0;
+      }
+      if (x) {
+        pl_get(id)->cells[i % CHUNK] = x;
+      }
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief ƽͼغϵĲдصͼ
+ *
+ */
+void pl_to_map() {
+  uint64_t tail = tail_mask();
+  memset(map, 0, (size_t)(row + 2) * stride * sizeof(uint64_t));
+  for (uint32_t i = 0; i < pl_size; ++i) {
+    if (pl_vals[i] == PL_NONE) {
+      continue;
+    }
+    const pl_chunk *c = pl_get(pl_vals[i]);
+    if (c->cx < 0 || c->cx >= words || c->cy < 0 ||
+        (long long)c->cy * CHUNK >= row) {
+      continue;
+    }
+    for (int r = 0; r < CHUNK && c->cy * CHUNK + r < row; ++r) {
+      row_ptr(map, c->cy * CHUNK + r)[c->cx] =
+          c->cx == words - 1 ? c->cells[r] & tail : c->cells[r];
+    }
+  }
+}
+
+/**
+ * @brief ĩβ׷ n ֽڣʱ󡣻ڸ֮֡临á
+ *
+ * @param s ֽ
+ * @param n ֽ
+ */
+void out_put(const char *s, size_t n) {
+  if (out_len + n > out_cap) {
+    size_t cap = out_cap ? out_cap : 1 << 16;
+    while (cap < out_len + n) {
+      cap *= 2;
+    }
+    char *p = realloc(out_buf, cap);
+    if (p == NULL) {
+      out_flush();
+      if (n > out_cap) {
+        fwrite(s, 1, n, stdout);
+        return;
+      }
+    } else {
+      out_buf = p, out_cap = cap;
+    }
+  }
+  memcpy(out_buf + out_len, s, n);
+  out_len += n;
+}
+
+/**
+ * @brief  printf ĸʽĩβ׷ַ
+ *
+ * @param fmt ʽ
+ */
+void out_printf(const char *fmt, ...) {
+  char s[LEN];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(s, sizeof(s), fmt, ap);
+  va_end(ap);
+  if (n > 0) {
+    out_put(s, n < LEN ? (size_t)n : LEN - 1);
+  }
+}
+
+/**
+ * @brief ȳ stdio δݣ write һд塣
  *
- * @param buf ַλ
  */
-void get_input(char *buf) {
-  fgets(buf, LEN, stdin);
-  buf[strlen(buf) - 1] = '\0';
+void out_flush() {
+  fflush(stdout);
+  size_t done = 0;
+  while (done < out_len) {
+    long n = (long)write(STDOUT_FILENO, out_buf + done, out_len - done);
+    if (n <= 0) {
+      break;
+    }
+    done += (size_t)n;
+  }
+  out_len = 0;
 }
+
 /**
- * @brief ʾ档
+ * @brief ѹƵϽǣʹ ANSI תУⲿ
  *
  */
-void help() {
-  printf("    [\\h]    print command [h]ints\n");
-  printf("    [\\p]    [p]rint current map\n");
-  printf("    [\\l <filename>]  [l]oad map from a local file\n");
-  printf("    [\\s <filename>]  [s]ave map to local\n");
-  printf("    [\\d]    enter [d]esign mode\n");
-  printf("    [\\q]    [q]uit design mode\n");
-  printf("    [\\g]    [g]enerate next generation of life\n");
-  printf("    [\\r]    enter auto_[r]un mode\n");
-  printf("    [\\e]    [e]xit auto_run mode\n");
-  printf("    [end]   [end] the game\n");
+void clear_screen() {
+  out_put("\x1b[H\x1b[2J", 7);
+  out_flush();
+  screen_valid = 0;
 }
 
 /**
- * @brief ʾʼӭ档
+ * @brief ʼնˡ Windows ¿̨ ANSI תе֧֡
  *
  */
-void welcome() {
-  char *s = "************************************************\n";
-  printf("%s%s", s, s);
-  printf("                GAME OF LIFE\n\n");
-  printf("          Welcome to the game of life.\n");
-  printf("You'll experience the joy of Cellular Automaton.\n\n");
-  printf("                ARE YOU READY\n\n");
-  printf("%s%s", s, s);
-  help();
+void term_init() {
+#ifdef _WIN32
+  HANDLE h = GetStdHandle(STD_OUTPUT_HANDLE);
+  DWORD mode;
+  if (GetConsoleMode(h, &mode)) {
+    SetConsoleMode(h, mode | 0x0004);
+  }
+#endif
 }
 
 /**
- * @brief
- * һַֽΪ֡һΪȥհַͷһհַβ֮ǰڶΪһհַβȥհַ֮ǰڷֽȡȡֽʱڴոļ·ȡʱͨһϵжȷһ
+ * @brief ȡն˵޷ȡʱΪ 80x24 
  *
- * @param cmd ͨΪȡһַ
- * @param buf ֽĵһַ
- * @param filename ֽĵڶַ
+ * @param w λ
+ * @param h λ
  */
-void get_command(char *cmd, char *buf, char *filename) {
-  convert_lower_case(cmd);
-  int t = 0, len = (int)strlen(cmd), i = 0, j = 0;
-  while (t < len && (cmd[t] == ' ' || cmd[t] == '\t')) ++t;
-  while (t < len && cmd[t] != ' ' && cmd[t] != '\t') buf[i++] = cmd[t++];
-  buf[i] = '\0';
-  while (t < len && (cmd[t] == ' ' || cmd[t] == '\t')) ++t;
-  while (t < len) filename[j++] = cmd[t++];
-  j--;
-  while (j >= 0 && filename[j] == ' ' || filename[j] == '\t') j--;
-  filename[j + 1] = '\0';
+void term_size(int *w, int *h) {
+  *w = 80, *h = 24;
+#ifdef _WIN32
+  CONSOLE_SCREEN_BUFFER_INFO info;
+  if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info)) {
+    *w = info.srWindow.Right - info.srWindow.Left + 1;
+    *h = info.srWindow.Bottom - info.srWindow.Top + 1;
+  }
+#else
+  struct winsize ws;
+  if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col && ws.ws_row) {
+    *w = ws.ws_col, *h = ws.ws_row;
+  }
+#endif
 }
 
 /**
- * @brief ַsеĸȫתΪСд
+ * @brief ׷һäַ UTF-8 루 U+2800 ӵλ
  *
- * @param s Ҫתַ
+ * @param dots λ k λΪäĵ k + 1 
  */
-void convert_lower_case(char *s) {
-  int len = (int)strlen(s);
-  for (int i = 0; i < len; ++i) {
-    if (s[i] >= 'A' && s[i] <= 'Z') {
-      s[i] += 32;
-    }
-  }
+void out_braille(int dots) {
+  char s[3] = {(char)0xe2, (char)(0xa0 | dots >> 6), (char)(0x80 | (dots & 63))};
+  out_put(s, 3);
 }
 
 /**
  * @brief
- * رصͼϵͳԭԭ޷أļļϷ򳬹ΧڸϸĴȡ0ȡΪȡΪȡѾȡļβȡʱʣϸĬ
+ * äģʽһַĵλһַӦͼ 4  2 еϸͼϸΪ
  *
- * @param filename Ҫصļ
+ * @param grid ͼ丱
+ * @param i ϸ
+ * @param j ϸ
+ * @return int λ
  */
-void load_map(char *filename) {
-  FILE *fp = fopen(filename, "r");
-  if (fp == NULL) {
-    printf("load_map: error: no such file\n");
-    fclose(fp);
-    return;
-  }
-  int x = 0, y = 0;
-  fscanf(fp, "%d%d", &x, &y);
-  if (x <= 0 || y <= 0) {
-    printf("load_map: error: illegal map\n");
-    return;
-  }
-  if (x >= KMAX || y >= KMAX) {
-    printf("load_map: error: map is too large\n");
-    return;
-  }
-  row = x, col = y;
-  double buf;
-  for (int i = 0; i < row; ++i) {
-    for (int j = 0; j < col; ++j) {
-      buf = 0;
-      fscanf(fp, "%lf", &buf);
-      if (buf > 0) {
-        map[i][j] = 1;
-      } else {
-        map[i][j] = 0;
+int braille_dots(const uint64_t *grid, int i, int j) {
+  static const int bit[4][2] = {{0x01, 0x08}, {0x02, 0x10}, {0x04, 0x20},
+                                {0x40, 0x80}};
+  int dots = 0;
+  for (int a = 0; a < 4 && i + a < row; ++a) {
+    for (int b = 0; b < 2 && j + b < col; ++b) {
+      if (grid_cell(grid, i + a, j + b)) {
+        dots |= bit[a][b];
       }
     }
   }
-  fclose(fp);
-  is_map = 1;
-  printf("row = %d, column = %d\n", row, col);
-  printf("loading complete\n");
+  return dots;
 }
 
 /**
- * @brief ͼء޵ͼ򱨴˳ϵͳԭ򱣴ʧܡ
+ * @brief
+ * Զģʽһ֡һΪ״̬ΪͼӿеĲ֡ͼÿ GLYPH_W зŽնʱʾ򣨻
+ * \view braille ʱÿäַʾ 4x2 ϸӿڴСȡն˴СϽ \view
+ * áһֻ֡ػ仯ַ ANSI ƶ꣬֡ƴһдն˴Сʾʽӿڱ仯ʱػ档
  *
- * @param filename Ҫļ
+ * @param status ״̬
+ * @param grid Ҫʾĵͼ丱 map ͬ
  */
-void save_map(char *filename) {
-  if (!is_map) {
-    is_map_error();
-    return;
-  }
-  FILE *fp = fopen(filename, "w");
-  if (fp == NULL) {
-    printf("save_map: error: failed to save file\n");
-    fclose(fp);
-    return;
+void render_frame(const char *status, const uint64_t *grid) {
+  int w, h;
+  term_size(&w, &h);
+  int cells_h = h - 2 > 1 ? h - 2 : 1;
+  int braille = view_mode == VIEW_BRAILLE ||
+                (view_mode == VIEW_AUTO &&
+                 ((long long)col * GLYPH_W > w || row > cells_h));
+  int ch = braille ? 4 : 1, cw = braille ? 2 : 1;
+  int glyph_w = braille ? 1 : GLYPH_W;
+  int r0 = view_row < row ? view_row / ch * ch : 0;
+  int c0 = view_col < col ? view_col / cw * cw : 0;
+  int vr = (row - r0 + ch - 1) / ch, vc = (col - c0 + cw - 1) / cw;
+  vr = vr < cells_h ? vr : cells_h;
+  vc = vc < w / glyph_w ? vc : w / glyph_w;
+  if (vc < 1) {
+    vc = 1;
   }
-  fprintf(fp, "%d %d\n", row, col);
-  for (int i = 0; i < row; ++i) {
-    for (int j = 0; j < col; ++j) {
-      fprintf(fp, "%d ", map[i][j]);
+  size_t n = (size_t)vr * vc;
+  if (!screen_valid || braille != screen_braille || r0 != screen_r0 ||
+      c0 != screen_c0 || vr != screen_rows || vc != screen_cols) {
+    if (n > screen_cap) {
+      int16_t *p = realloc(screen, n * sizeof(int16_t));
+      if (p == NULL) {
+        return;
+      }
+      screen = p, screen_cap = n;
+    }
+    for (size_t k = 0; k < n; ++k) {
+      screen[k] = -1;
     }
-    fprintf(fp, "\n");
+    out_put("\x1b[H\x1b[2J", 7);
+    screen_valid = 1, screen_braille = braille;
+    screen_r0 = r0, screen_c0 = c0, screen_rows = vr, screen_cols = vc;
   }
-  fclose(fp);
-  printf("saving successfully\n");
-}
-
-/**
- * @brief ͼĳΧϸԱ߽ۡ
- *
- * @param x x
- * @param y y
- * @return int õΧϸ
- */
-int count_alive_neighbors(int x, int y) {
-  int alive = 0;
-  for (int i = x - 1; i <= x + 1; ++i) {
-    if (i < 0 || i >= row) continue;
-    for (int j = y - 1; j <= y + 1; ++j) {
-      if (j < 0 || j >= col || (i == x && j == y)) continue;
-      alive += map[i][j];
+  out_printf("\x1b[1;1H%s\x1b[K", status);
+  int cur_y = -1, cur_x = -1;
+  for (int y = 0; y < vr; ++y) {
+    for (int x = 0; x < vc; ++x) {
+      int i = r0 + y * ch, j = c0 + x * cw;
+      int code = braille ? braille_dots(grid, i, j) : grid_cell(grid, i, j);
+      int16_t *old = &screen[(size_t)y * vc + x];
+      if (*old == code) {
+        continue;
+      }
+      *old = (int16_t)code;
+      if (y != cur_y || x != cur_x) {
+        out_printf("\x1b[%d;%dH", y + 2, x * glyph_w + 1);
+      }
+      if (braille) {
+        out_braille(code);
+      } else {
+        out_put(code ? " " : " ", code ? sizeof(" ") - 1 : sizeof(" ") - 1);
+      }
+      cur_y = y, cur_x = x + 1;
     }
   }
-  return alive;
+  out_printf("\x1b[%d;1H", vr + 2);
+  out_flush();
 }
 
 /**
  * @brief
- * һϸͼȼϸΧϸٸϷϸͼ
+ * ԶģʽʾʽӿڡΪ auto  cells  braille
+ * ӿϽϸУΪʱʾǰá
  *
+ * @param arg 
  */
-void generate_next_status() {
-  if (!is_map) {
-    is_map_error();
+void set_view(char *arg) {
+  int r, c;
+  char extra;
+  if (strcmp(arg, "auto") == 0) {
+    view_mode = VIEW_AUTO;
+  } else if (strcmp(arg, "cells") == 0) {
+    view_mode = VIEW_CELLS;
+  } else if (strcmp(arg, "braille") == 0) {
+    view_mode = VIEW_BRAILLE;
+  } else if (sscanf(arg, "%d %d %c", &r, &c, &extra) == 2 && r >= 0 &&
+             c >= 0) {
+    view_row = r, view_col = c;
+  } else if (strcmp(arg, EMPTY) != 0) {
+    printf("set_view: error: unknown view: %s\n", arg);
     return;
   }
-  for (int i = 0; i < row; i++)
-    for (int j = 0; j < col; j++)
-      alive_neighbors[i][j] = count_alive_neighbors(i, j);
-  for (int i = 0; i < row; ++i) {
-    for (int j = 0; j < col; ++j) {
-      if (map[i][j] == 1 &&
-          (alive_neighbors[i][j] < 2 || alive_neighbors[i][j] > 3)) {
-        map[i][j] = 0;
-      } else if (map[i][j] == 0 && alive_neighbors[i][j] == 3) {
-        map[i][j] = 1;
-      }
-    }
-  }
+  screen_valid = 0;
+  printf("view = %s, origin = (%d, %d)\n",
+         view_mode == VIEW_CELLS     ? "cells"
+         : view_mode == VIEW_BRAILLE ? "braille"
+                                     : "auto",
+         view_row, view_col);
 }
 
 /**
- * @brief ӡͼеͼӡ޵ͼ
+ * @brief
+ * ӡͼеͼӡ޵ͼ󡣸ƴУÿ
+ * RD_BLOCK ֽ write дһΣÿϸһ printf 
  *
  */
 void print_map() {
@@ -332,21 +6691,32 @@ void print_map() {
     is_map_error();
     return;
   }
+  PROF_ENTER(PROF_RENDER);
   for (int i = 0; i < row; i++) {
+    const uint64_t *p = row_ptr(map, i);
     for (int j = 0; j < col; j++) {
-      printf(map[i][j] > 0 ? " " : " ");
+      if (p[j >> 6] >> (j & 63) & 1) {
+        out_put(" ", sizeof(" ") - 1);
+      } else {
+        out_put(" ", sizeof(" ") - 1);
+      }
+    }
+    out_put("\n", 1);
+    if (out_len >= RD_BLOCK) {
+      out_flush();
     }
-    printf("\n");
   }
+  out_flush();
+  PROF_LEAVE(PROF_RENDER, (double)row * col);
 }
 
 /**
  * @brief ͼģʽѭû룬 is_design
- * жΪλáûΪС120зǷƽʾû档
+ * жΪλáûΪС KMAX ҵͼڴԷ䡣зǷƽʾû档
  *
  */
 void design_map() {
-  system("cls");
+  clear_screen();
   char buf[LEN], s1[LEN], s2[LEN];
   int len1, len2, x, y, is_digit;
   printf("Enter design mode.\n");
@@ -359,7 +6729,9 @@ void design_map() {
     } else {
       printf("\n[D] (use [\\q] to quit) -> ");
     }
-    get_input(buf);
+    if (!get_input(buf)) {
+      break;
+    }
     get_command(buf, s1, s2);
     if (strcmp(s1, QUIT) == 0 && strcmp(s2, EMPTY) == 0) {
       break;
@@ -385,6 +6757,10 @@ void design_map() {
       printf("design_map: error: format error\n");
       continue;
     }
+    if (len1 > 9 || len2 > 9) {
+      printf("design_map: error: number too large\n");
+      continue;
+    }
     x = 0, y = 0;
     for (int i = len1 - 1; i >= 0; i--) {
       x += (s1[i] - '0') * (int)pow(10, len1 - 1 - i);
@@ -406,69 +6782,498 @@ void design_map() {
       continue;
     }
     if (!is_design) {
-      is_design = 1;
-      row = x, col = y;
-      for (int i = 0; i < row; ++i) {
-        for (int j = 0; j < col; ++j) {
-          map[i][j] = 0;
-        }
+      if (!clear_map(x, y)) {
+        printf("design_map: error: map is too large\n");
+        continue;
       }
+      is_design = 1;
       printf("Set alive cells. (EX: 0 0)\n");
       is_map = 1;
       print_map();
     } else {
-      map[x][y] = 1;
+      set_cell(x, y, 1);
     }
   }
-  system("cls");
+  clear_screen();
   printf("--> You have quited the design mode.\n");
   if (is_design) {
+    engine_attach();
     print_map();
     printf("(Use [\\s <filename>] to save map to local.)\n");
   }
 }
 
 /**
- * @brief Զģʽ޵ͼ˳ is_run
- * ״̬1ΪУ0ΪͣԶм2룬ÿǰ
- * ENTER ͣͣʱ ENTER  [\e] ˳ģʽΪ
+ * @brief
+ * лն˵İģʽʱرлԣصȴسɶرʱָǰá
+ * Windows  getch л壬á
+ *
+ * @param on 1Ϊ0Ϊָ
+ */
+void term_raw(int on) {
+#ifndef _WIN32
+  static struct termios saved;
+  static int active = 0;
+  if (on && !active && tcgetattr(STDIN_FILENO, &saved) == 0) {
+    struct termios t = saved;
+    t.c_lflag &= ~(tcflag_t)(ICANON | ECHO);
+    t.c_cc[VMIN] = 1, t.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSANOW, &t);
+    active = 1;
+  } else if (!on && active) {
+    tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+    active = 0;
+  }
+#else
+  (void)on;
+#endif
+}
+
+/**
+ * @brief
+ *  timeout ڵȴһΰ POSIX ϵͳ poll ȴ׼룬 Windows  kbhit
+ * ѯһأصȵʱ׼Ҷϻסһ״̬Ժٵȴֱӷ
+ * KEY_EOF 
+ *
+ * @param timeout ȴĺ0 Ϊֻ鲻ȴΪһֱȴ
+ * @return int ַʱΪ -1 Ϊ KEY_EOF
+ */
+int read_key(int timeout) {
+  static int closed = 0;
+  if (closed) {
+    return KEY_EOF;
+  }
+#ifdef _WIN32
+  double end = now_seconds() + timeout / 1000.0;
+  while (!kbhit()) {
+    if (timeout >= 0 && now_seconds() >= end) {
+      return -1;
+    }
+    Sleep(1);
+  }
+  return getch();
+#else
+  struct pollfd p = {STDIN_FILENO, POLLIN, 0};
+  unsigned char c;
+  int ready = poll(&p, 1, timeout);
+  if (ready < 0 && errno != EINTR) {
+    closed = 1;
+    return KEY_EOF;
+  } else if (ready <= 0) {
+    return -1;
+  }
+  ssize_t got = read(STDIN_FILENO, &c, 1);
+  if (got == 1) {
+    return c;
+  } else if (got == 0 || (errno != EINTR && errno != EAGAIN) ||
+             (p.revents & (POLLHUP | POLLERR | POLLNVAL))) {
+    closed = 1;
+    return KEY_EOF;
+  }
+  return -1;
+#endif
+}
+
+/**
+ * @brief ʾԶģʽÿɵĴ
+ *
+ * @param arg  max գ max ʾٶ
+ */
+void set_speed(char *arg) {
+  double v;
+  char *end;
+  if (strcmp(arg, "max") == 0) {
+    sim_speed = 0;
+  } else if (strcmp(arg, EMPTY) != 0) {
+    v = strtod(arg, &end);
+    if (*end != '\0' || !(v > 0) || v > 1e9) {
+      printf("set_speed: error: expected a positive number or max\n");
+      return;
+    }
+    sim_speed = v;
+  }
+  if (sim_speed > 0) {
+    printf("speed = %g generations/s\n", sim_speed);
+  } else {
+    printf("speed = max\n");
+  }
+}
+
+/**
+ * @brief ʾԶģʽÿػĴ
+ *
+ * @param arg 0.1  1000 ֮
+ */
+void set_fps(char *arg) {
+  if (strcmp(arg, EMPTY) != 0) {
+    char *end;
+    double v = strtod(arg, &end);
+    if (*end != '\0' || !(v >= 0.1 && v <= 1000)) {
+      printf("set_fps: error: expected a number from 0.1 to 1000\n");
+      return;
+    }
+    frame_rate = v;
+  }
+  printf("fps = %g\n", frame_rate);
+}
+
+/**
+ * @brief
+ * ģ̰߳ѵǰͼƽԼռһ֡뽻λе֡Ϊֻ֡һԭӽȴʾ̡߳
+ *
+ */
+void publish_frame() {
+  frame *f = &frames[frame_back];
+  memcpy(f->cells, map, (size_t)(row + 2) * stride * sizeof(uint64_t));
+  f->generation = generation;
+  if (!describe_history(f->note)) {
+    f->note[0] = '\0';
+  }
+  frame_back = atomic_exchange(&frame_spare, frame_back | FRAME_FRESH) & 3;
+}
+
+/**
+ * @brief
+ * ģ̣߳ sim_speed ɣʾ޹ءʾ߳ frame_wanted
+ * ʱڸһ֮󷢲һ֡ʱÿ֮󶼷ͣʱϵȴֱҪһ֡˳ʱôʱĵȴ
+ * sleep ״̬һ⵽ʱͣһ֡ run_target
+ * ʱٶȣ⵽ںڣĿʱͣ HashLife һĴǰԽĿꡣ
+ * һҲûɣƽڴ治㣩ʱͣ
+ *
+ * @param arg δʹ
+ * @return void* NULL
+ */
+void *sim_main(void *arg) {
+  (void)arg;
+  int settled = period != 0;
+  double next_gen = now_seconds();
+  pthread_mutex_lock(&run_lock);
+  while (!run_stop) {
+    if (frame_wanted) {
+      frame_wanted = 0;
+      pthread_mutex_unlock(&run_lock);
+      publish_frame();
+      pthread_mutex_lock(&run_lock);
+      continue;
+    }
+    if (run_paused && run_steps == 0) {
+      pthread_cond_wait(&run_cond, &run_lock);
+      next_gen = now_seconds();
+      continue;
+    }
+    if (!run_paused && run_target >= 0 && generation >= run_target) {
+      run_target = -1, run_paused = 1, frame_wanted = 1;
+      continue;
+    }
+    double now = now_seconds();
+    if (!run_paused && sim_speed > 0 && run_target < 0 && now < next_gen) {
+      struct timespec ts;
+      clock_gettime(CLOCK_REALTIME, &ts);
+      double t = ts.tv_nsec * 1e-9 + (next_gen - now);
+      ts.tv_sec += (time_t)t;
+      ts.tv_nsec = (long)((t - floor(t)) * 1e9);
+      pthread_cond_timedwait(&run_cond, &run_lock, &ts);
+      continue;
+    }
+    int step = run_paused;
+    if (step) {
+      run_steps--;
+    }
+    double speed = run_target >= 0 ? 0 : sim_speed;
+    long long left = step || run_target < 0 ? 0 : run_target - generation;
+    pthread_mutex_unlock(&run_lock);
+    long long from = generation;
+    if (left > 0 && (period || (engine == ENGINE_HASHLIFE &&
+                                left < (1ll << hl_k)))) {
+      advance(left);
+    } else {
+      generate_next_status();
+    }
+    next_gen = speed > 0 ? next_gen + 1 / speed : now;
+    if (next_gen < now - 1) {
+      next_gen = now;
+    }
+    pthread_mutex_lock(&run_lock);
+    if (generation == from) {
+      run_target = -1, run_paused = 1, run_steps = 0;
+    }
+    frame_wanted |= step || generation == from;
+    if (!settled && period) {
+      settled = 1, frame_wanted = 1;
+      run_paused |= run_target < 0;
+    }
+  }
+  pthread_mutex_unlock(&run_lock);
+  return NULL;
+}
+
+/**
+ * @brief
+ * ޸ģ̵߳Ŀ״̬ʾֻ߳ڰҪ֡ʱãʱ伫̡
+ *
+ * @param paused µͣ״̬ -1 Ϊ
+ * @param steps ӵĵ
+ * @param want ǷҪһ֡
+ * @param stop Ƿ˳
+ */
+void sim_control(int paused, int steps, int want, int stop) {
+  pthread_mutex_lock(&run_lock);
+  if (paused >= 0) {
+    run_paused = paused;
+  }
+  run_steps += steps;
+  frame_wanted |= want;
+  run_stop |= stop;
+  pthread_cond_signal(&run_cond);
+  pthread_mutex_unlock(&run_lock);
+}
+
+/**
+ * @brief
+ * Զģʽ޵ͼ˳ģ߳ sim_main нУֻ߳ʾ밴ÿ 1 / frame_rate
+ * Ҫһ֡ģ߳굱ǰһ彻߳ԭӽȡµһ֡ render_frame
+ * ػ档ʾնʱģⲻӰ죬ֻмĴʾȴʱ read_key
+ * Чسոͣ n ͣʱһ +  - ٶȼӱ룬 e  q
+ * ˳ģʽʱǷͣ˳ͼΪʱ״̬ʾԶͣһΡ
+ * ĿʱȫУ״̬ʾĿꡢÿԤʣʱ䣬ͣ
  *
+ * @param target Ŀ -1 ΪûĿ
  */
-void auto_run() {
+void auto_run(long long target) {
   if (!is_map) {
     is_map_error();
     printf("Exit auto_run mode...\n");
     return;
   }
-  int is_run = 1;
-  char buff[LEN], s1[LEN], s2[LEN];
+  size_t bytes = (size_t)(row + 2) * stride * sizeof(uint64_t);
+  for (int k = 0; k < 3; ++k) {
+    frames[k].cells = aligned_malloc(bytes);
+    if (frames[k].cells == NULL) {
+      while (k-- > 0) {
+        aligned_free(frames[k].cells);
+      }
+      printf("auto_run: error: out of memory\n");
+      return;
+    }
+  }
+  int front = 0, paused = 0, waiting = 1;
+  frame_back = 1;
+  atomic_store(&frame_spare, 2);
+  run_paused = 0, run_steps = 0, run_stop = 0, frame_wanted = 1;
+  run_target = target;
+  long long gen0 = generation;
+  double time0 = now_seconds();
+  pthread_t sim;
+  if (pthread_create(&sim, NULL, sim_main, NULL) != 0) {
+    for (int k = 0; k < 3; ++k) {
+      aligned_free(frames[k].cells);
+    }
+    printf("auto_run: error: failed to start the simulation thread\n");
+    return;
+  }
+  char status[2 * LEN], speed[96];
+  double next_frame = now_seconds() + 1 / frame_rate;
+  term_raw(1);
+  clear_screen();
   while (1) {
-    if (is_run) {
-      system("cls");
-      generate_next_status();
-      printf("Press ENTER to suspend.\n");
-      print_map();
-      sleep(2);
-      if (kbhit()) {
-        if (getch() == '\r') {
-          is_run = 0;
-        }
+    double now = now_seconds();
+    if (atomic_load(&frame_spare) & FRAME_FRESH) {
+      front = atomic_exchange(&frame_spare, front) & 3;
+      pthread_mutex_lock(&run_lock);
+      paused = run_paused;
+      double s = sim_speed;
+      target = run_target;
+      pthread_mutex_unlock(&run_lock);
+      long long g = frames[front].generation;
+      double rate = (g - gen0) / (now - time0 > 1e-9 ? now - time0 : 1e-9);
+      if (target >= 0) {
+        snprintf(speed, sizeof(speed), "max to %lld (%.4g/s, ETA %.1f s)",
+                 target, rate, rate > 0 ? (target - g) / rate : 0.0);
+      } else {
+        snprintf(speed, sizeof(speed), s > 0 ? "%.4g/s" : "max", s);
+      }
+      snprintf(status, sizeof(status), "%s  generation = %lld  speed = %s  %s",
+               paused ? "[ENTER] run  [n] step  [e] exit"
+                      : "[ENTER] pause  [+/-] speed  [e] exit",
+               frames[front].generation, speed, frames[front].note);
+      PROF_ENTER(PROF_RENDER);
+      render_frame(status, frames[front].cells);
+      PROF_LEAVE(PROF_RENDER, (double)row * col);
+      waiting = 0;
+      next_frame = now + 1 / frame_rate;
+    }
+    if (!waiting && !paused && now >= next_frame) {
+      sim_control(-1, 0, 1, 0);
+      waiting = 1;
+    }
+    int timeout = waiting  ? 2
+                  : paused ? -1
+                           : (int)((next_frame - now) * 1000) + 1;
+    int key = read_key(timeout);
+    if (key == '\r' || key == '\n' || key == ' ') {
+      paused = !paused;
+      gen0 = frames[front].generation, time0 = now;
+      sim_control(paused, 0, 1, 0);
+      waiting = 1;
+    } else if (key == 'n' && paused) {
+      sim_control(-1, 1, 0, 0);
+      waiting = 1;
+    } else if (key == '+' || key == '-') {
+      pthread_mutex_lock(&run_lock);
+      if (key == '+' && sim_speed > 0 && sim_speed < 1e9) {
+        sim_speed *= 2;
+      } else if (key == '-' && sim_speed > 0.001) {
+        sim_speed /= 2;
       }
+      pthread_mutex_unlock(&run_lock);
+      sim_control(-1, 0, 1, 0);
+      waiting = 1;
+    } else if (key == 'e' || key == 'q' || key == KEY_EOF) {
+      break;
+    }
+  }
+  sim_control(-1, 0, 0, 1);
+  pthread_join(sim, NULL);
+  for (int k = 0; k < 3; ++k) {
+    aligned_free(frames[k].cells);
+  }
+  term_raw(0);
+  clear_screen();
+  printf("--> You have returned to the normal mode.\n");
+}
+
+/**
+ * @brief
+ *  n м䲻ʾͼѡķʽ滻ɽͬİλ棻
+ * infinite ߽µİλ n  JUMP_MIN ʱƽת HashLife
+ * Ĳǰתأ
+ * HashLife һǰ⵽񵴺µڡÿǰĴ 1
+ * ʹÿԼʱ 0.05 룬ÿ 0.25 ͬһˢ½ȡÿԤʣʱ䡣׼Ϊնʱÿ֮鰴ȡʧܣƽڴ治㣩ʱͬͣ¡
+ *
+ * @param n 
+ */
+void fast_forward(long long n) {
+  if (!is_map) {
+    is_map_error();
+    return;
+  }
+  int saved = engine;
+  int plane = engine == ENGINE_BITWISE && boundary == BOUNDARY_INFINITE &&
+              n >= JUMP_MIN;
+  if (engine == ENGINE_LUT) {
+    engine = ENGINE_BITWISE;
+  }
+  if (plane) {
+    hl_from_plane();
+  }
+  long long done = 0, chunk = 1, start_gen = generation;
+  double start = now_seconds(), shown = start;
+  int cancelled = 0, keys = isatty(STDIN_FILENO);
+  term_raw(keys);
+  while (done < n) {
+    long long step = chunk < n - done ? chunk : n - done;
+    double t = now_seconds();
+    if (plane) {
+      hl_advance((uint64_t)step);
+      generation += step;
     } else {
-      printf("\nPress ENTER to restart or use [\\e] to exit auto_run mode.\n");
-      get_input(buff);
-      get_command(buff, s1, s2);
-      if (strcmp(s1, EXIT) == 0 && strcmp(s2, EMPTY) == 0) {
-        system("cls");
-        printf("--> You have returned to the normal mode.\n");
+      advance(step);
+      if (generation != start_gen + done + step) {
+        cancelled = 1;
         break;
-      } else if (strcmp(s1, EMPTY) == 0) {
-        is_run = 1;
-      } else {
-        printf("auto_run: error: input error");
       }
     }
+    done += step;
+    double now = now_seconds();
+    if (now - t < 0.05) {
+      chunk *= 2;
+    } else if (now - t > 0.2 && chunk > 1) {
+      chunk /= 2;
+    }
+    if (now - shown >= 0.25 || done == n) {
+      double rate = done / (now - start > 1e-9 ? now - start : 1e-9);
+      printf("\rgeneration = %lld  %lld / %lld  %.4g generations/s  ETA %.1f s"
+             "  (press any key to cancel)  ",
+             generation, done, n, rate, (n - done) / rate);
+      fflush(stdout);
+      shown = now;
+    }
+    if (keys && done < n && read_key(0) >= 0) {
+      cancelled = 1;
+      break;
+    }
+  }
+  term_raw(0);
+  if (plane) {
+    if (hl_to_plane()) {
+      pl_to_map();
+    }
+    hl_reset();
+    mark_all_tiles();
+    if (stats_on) {
+      scan_stats();
+    }
+  }
+  engine = saved;
+  double secs = now_seconds() - start;
+  char note[LEN];
+  printf("\n%s: %lld generations in %.3f s (%.4g generations/s), generation = "
+         "%lld\n",
+         cancelled ? "cancelled" : "done", generation - start_gen, secs,
+         (generation - start_gen) / (secs > 1e-9 ? secs : 1e-9), generation);
+  if (describe_history(note)) {
+    printf("%s\n", note);
+  }
+  print_map();
+}
+
+/**
+ * @brief ޲ʱһвʱ fast_forward  N 
+ *
+ * @param arg 
+ */
+void generate_command(char *arg) {
+  if (strcmp(arg, EMPTY) == 0) {
+    generate_next_status();
+    print_map();
+    return;
+  }
+  char *end;
+  long long n = strtoll(arg, &end, 10);
+  if (*end != '\0' || n <= 0) {
+    printf("generate: error: expected a positive number of generations\n");
+    return;
+  } else if (n > GENS_MAX) {
+    printf("generate: error: at most %lld generations at a time\n", GENS_MAX);
+    return;
+  }
+  fast_forward(n);
+}
+
+/**
+ * @brief Զ޲ʱԶģʽ --to GEN ʾȫе GEN ͣ
+ *
+ * @param arg --to GEN 
+ */
+void run_command(char *arg) {
+  if (strcmp(arg, EMPTY) == 0) {
+    auto_run(-1);
+    return;
+  }
+  char *end = arg;
+  long long to = -1;
+  if (strncmp(arg, "--to", 4) == 0 && (arg[4] == ' ' || arg[4] == '\t')) {
+    to = strtoll(arg + 5, &end, 10);
+  }
+  if (to < 0 || end == arg + 5 || *end != '\0') {
+    printf("run: error: expected [\\r] or [\\r --to <generation>]\n");
+    return;
+  }
+  if (is_map && to <= generation) {
+    printf("run: error: already at generation %lld\n", generation);
+    return;
   }
+  auto_run(to);
 }
 
 /**
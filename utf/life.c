@@ -9,13 +9,63 @@
  *
  */
 
-#include <conio.h>
+/**
+ * @brief
+ * 声明用到的 POSIX 函数与常量（ clock_gettime 、 CLOCK_MONOTONIC 、 fileno
+ * 等），使程序在 -std=c11 下也能编译，不依赖 GNU 方言的默认设置。剖析时的
+ * syscall 还需要 _DEFAULT_SOURCE 。
+ *
+ */
+#define _POSIX_C_SOURCE 200809L
+#if defined(LIFE_PROFILE) && defined(__linux__)
+#define _DEFAULT_SOURCE
+#endif
+
+#include <assert.h>
+#include <errno.h>
 #include <math.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
+#ifdef _WIN32
+#include <conio.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <termios.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+/**
+ * @brief 编译器支持 x86 SIMD 指令，可在运行时选择 SSE4.1 或 AVX2 内核。
+ *
+ */
+#define SIMD_X86
+#endif
+
+#if defined(LIFE_PROFILE) && defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+/**
+ * @brief 开启了 LIFE_PROFILE 且系统提供 perf_event_open ，可读取硬件计数器。
+ *
+ */
+#define PROF_HW
+#endif
+
 /**
  * @brief 字符串最大长度。
  *
@@ -23,10 +73,302 @@
 #define LEN 1024
 
 /**
- * @brief 地图最大长宽。
+ * @brief 地图最大长宽。仅用于防止整数溢出，实际能加载的大小由可用内存决定。
+ *
+ */
+#define KMAX (1 << 30)
+
+/**
+ * @brief 地图内存区的对齐字节数，与缓存行大小一致。
+ *
+ */
+#define ALIGN 64
+
+/**
+ * @brief 工作线程数上限。
+ *
+ */
+#define TMAX 256
+
+/**
+ * @brief 按位并行引擎：逐代计算整张地图，地图外细胞恒为死亡。
+ *
+ */
+#define ENGINE_BITWISE 0
+
+/**
+ * @brief HashLife 引擎：四叉树加结果缓存，地图外视为无限平面。
+ *
+ */
+#define ENGINE_HASHLIFE 1
+
+/**
+ * @brief 查表引擎：每次查表得到 2x2 个细胞的下一代，地图外细胞恒为死亡或环面相接。
+ *
+ */
+#define ENGINE_LUT 2
+
+/**
+ * @brief HashLife 空节点编号，表示尚无缓存结果。
+ *
+ */
+#define HL_NONE 0xffffffffu
+
+/**
+ * @brief HashLife 节点数上限，超过后回收不再使用的节点与缓存。
+ *
+ */
+#define HL_LIMIT (1u << 22)
+
+/**
+ * @brief 稀疏模式下每个区块的行数。区块宽为一个字，即 64x64 个细胞。
+ *
+ */
+#define TILE 64
+
+/**
+ * @brief 边界外的细胞恒为死亡。
+ *
+ */
+#define BOUNDARY_DEAD 0
+
+/**
+ * @brief 无限平面，地图只是平面上的一个窗口。
+ *
+ */
+#define BOUNDARY_INFINITE 1
+
+/**
+ * @brief 环面，上下、左右两边相接。
+ *
+ */
+#define BOUNDARY_TORUS 2
+
+/**
+ * @brief 无限平面中每个区块的边长，区块每行恰好一个字。
+ *
+ */
+#define CHUNK 64
+
+/**
+ * @brief 无限平面区块池每次分配的区块数。
+ *
+ */
+#define CHUNK_BLOCK 1024
+
+/**
+ * @brief 无限平面中表示“无区块”的编号。
+ *
+ */
+#define PL_NONE 0xffffffffu
+
+/**
+ * @brief 读取地图文件时每次读入的字节数。
+ *
+ */
+#define RD_BLOCK (1 << 22)
+
+/**
+ * @brief 读取每个数之前保证缓冲中至少剩余的字节数，使常见的数不会跨越缓冲边界。
+ *
+ */
+#define RD_MARGIN 128
+
+/**
+ * @brief 二进制快照文件开头的 8 字节标识。
+ *
+ */
+#define SNAP_MAGIC "LIFESNAP"
+
+/**
+ * @brief 二进制快照格式版本号。
+ *
+ */
+#define SNAP_VERSION 1
+
+/**
+ * @brief 基准测试中每项至少运行的秒数。
+ *
+ */
+#define BENCH_TIME 0.25
+
+/**
+ * @brief 可检测的最长振荡周期，即历史表保留的代数。
+ *
+ */
+#define HISTORY 1024
+
+/**
+ * @brief
+ * fast_forward 在 infinite 边界下改用 HashLife 的最少代数。代数较少时转换与建树的开销抵不上收益，仍逐代计算。
+ *
+ */
+#define JUMP_MIN 1024
+
+/**
+ * @brief
+ * 一条命令最多生成的代数。 HashLife 前进 2 的 j 次方代要求根节点至少 j + 3 层，图案还会随代数长大，而
+ * hl_empty 只到第 63 层；留出余量后取 2 的 58 次方。
+ *
+ */
+#define GENS_MAX (1ll << 58)
+
+/**
+ * @brief 历史表的项数，须为 2 的幂。
+ *
+ */
+#define HISTORY_SLOTS 4096
+
+/**
+ * @brief 历史表每次查找或插入至多探测的项数。
+ *
+ */
+#define HISTORY_PROBE 16
+
+/**
+ * @brief 三缓冲交换位中表示新帧的标志位。
+ *
+ */
+#define FRAME_FRESH 4
+
+/**
+ * @brief read_key 在标准输入结束或出错时的返回值，与超时的 -1 区分。
+ *
+ */
+#define KEY_EOF -2
+
+/**
+ * @brief 差分测试中每张地图运行的代数。
+ *
+ */
+#define CHECK_GENS 64
+
+/**
+ * @brief 差分测试中长时间运行的代数。
+ *
+ */
+#define CHECK_LONG 2000
+
+/**
+ * @brief 自动运行模式的显示方式：地图放得下时逐格显示，否则用盲文字符缩小显示。
+ *
+ */
+#define VIEW_AUTO 0
+
+/**
+ * @brief 逐格显示，每个细胞占 GLYPH_W 列。
+ *
+ */
+#define VIEW_CELLS 1
+
+/**
+ * @brief 盲文字符显示，每个字符 4 行 2 列细胞。
+ *
+ */
+#define VIEW_BRAILLE 2
+
+/**
+ * @brief
+ * 逐格显示时每个细胞（符号加一个空格）在终端上占的列数。 GBK 控制台中 ■ 与 □
+ * 为全角字符，占两列。
+ *
+ */
+#ifdef _WIN32
+#define GLYPH_W 3
+#else
+#define GLYPH_W 2
+#endif
+
+/**
+ * @brief 计时阶段：求各行的水平和，即邻居计数。
+ *
+ */
+#define PROF_SUM 0
+
+/**
+ * @brief 计时阶段：由行和按规则求下一代（查表引擎的查表也计入此阶段）。
+ *
+ */
+#define PROF_RULE 1
+
+/**
+ * @brief 计时阶段：一次 generate_next_status 的全部工作。
+ *
+ */
+#define PROF_STEP 2
+
+/**
+ * @brief 计时阶段：打印地图或绘制自动运行模式的一帧。
+ *
+ */
+#define PROF_RENDER 3
+
+/**
+ * @brief 计时阶段：加载地图文件。
+ *
+ */
+#define PROF_LOAD 4
+
+/**
+ * @brief 计时阶段：保存地图文件。
+ *
+ */
+#define PROF_SAVE 5
+
+/**
+ * @brief 计时阶段数。
+ *
+ */
+#define PROF_PHASES 6
+
+/**
+ * @brief
+ * 采样行中邻居计数与规则之外的部分（哈希、统计）。不单独显示，只用于按比例拆分条带用时。
+ *
+ */
+#define PROF_REST PROF_PHASES
+
+/**
+ * @brief
+ * 每个条带中每隔多少行（查表引擎为多少次 lut_rows ）细分计时一行，须为 2 的幂。其余各行不读时钟。
+ *
+ */
+#define PROF_EVERY 64
+
+/**
+ * @brief 读取的硬件计数器数：指令数、缓存未命中数、分支预测失败数。
+ *
+ */
+#define PROF_EVENTS 3
+
+/**
+ * @brief
+ * 热点路径计时。编译时定义 LIFE_PROFILE 才生效，否则以下各宏展开为空，不留下任何代码。
+ * 逐行读时钟的开销在窄地图上会超过被测的工作，因此条带只整体计时一次（ PROF_START 与
+ * PROF_BAND ）；每 PROF_EVERY 行由 PROF_SAMPLE 选出一行，用 PROF_LAP
+ * 细分为邻居计数、规则与其余部分，条带用时按这些采样行的比例拆分到各阶段。
+ * PROF_ENTER 、 PROF_LEAVE 包住较粗的阶段，同时读取硬件计数器。
  *
  */
-#define KMAX 120
+#ifdef LIFE_PROFILE
+#define PROF_INIT() prof_init()
+#define PROF_START(t) double t = now_seconds()
+#define PROF_SAMPLE(t, k)                                                      \
+  int t##_on = (k) % PROF_EVERY == 0;                                          \
+  double t = t##_on ? now_seconds() : 0
+#define PROF_LAP(id, phase, t) (t##_on ? prof_lap(id, phase, &t) : (void)0)
+#define PROF_BAND(id, t, rows, cells) prof_band(id, t, rows, cells)
+#define PROF_ENTER(phase) prof_enter(phase)
+#define PROF_LEAVE(phase, cells) prof_leave(phase, cells)
+#else
+#define PROF_INIT()
+#define PROF_START(t)
+#define PROF_SAMPLE(t, k)
+#define PROF_LAP(id, phase, t)
+#define PROF_BAND(id, t, rows, cells)
+#define PROF_ENTER(phase)
+#define PROF_LEAVE(phase, cells)
+#endif
 
 #define HELP "\\h"
 #define LOAD "\\l"
@@ -34,9 +376,18 @@
 #define DESIGN "\\d"
 #define GENERATE "\\g"
 #define RUN "\\r"
-#define EXIT "\\e"
 #define QUIT "\\q"
 #define PRINT "\\p"
+#define ENGINE "\\engine"
+#define SPARSE "\\sparse"
+#define DETECT "\\detect"
+#define BOUNDARY "\\boundary"
+#define VIEW "\\view"
+#define RULE "\\rule"
+#define SPEED "\\speed"
+#define FPS "\\fps"
+#define STATS "\\stats"
+#define PROF "\\prof"
 #define END "end"
 #define EMPTY ""
 
@@ -52,6 +403,30 @@ int row = 0;
  */
 int col = 0;
 
+/**
+ * @brief 地图每行实际使用的 64 位字数。每个字存放 64 个细胞，一位一个细胞。
+ *
+ */
+int words = 0;
+
+/**
+ * @brief 地图每行在内存中的字数，为 words 加左右各一个边框字。
+ *
+ */
+int stride = 0;
+
+/**
+ * @brief 地图内存区首地址。地图、下一代缓冲与行和缓冲均从此区域划分。
+ *
+ */
+uint64_t *arena = NULL;
+
+/**
+ * @brief 地图内存区当前容量（字节）。只在加载更大的地图时重新分配。
+ *
+ */
+size_t arena_size = 0;
+
 /**
  * @brief 标记，判断程序中是否已有地图。
  *
@@ -59,272 +434,6256 @@ int col = 0;
 int is_map = 0;
 
 /**
- * @brief 全局地图数组。
+ * @brief
+ * 全局地图。按位存储，第 i 行第 j 列细胞为 row_ptr(map, i)[j / 64] 的第 j % 64
+ * 位，每行超出 col 的多余位恒为 0。四周各有一圈边框（上下各一行，左右各一个字），边框内细胞恒为死亡，使计算时无需判断边界。
  *
  */
-int map[KMAX][KMAX];
+uint64_t *map = NULL;
 
 /**
- * @brief 相邻存活细胞数量。
+ * @brief
+ * 下一代细胞图缓冲，大小与地图相同。生成时直接写入此处，完成后与 map
+ * 交换指针，两者轮流作为当前地图。
  *
  */
-int alive_neighbors[KMAX][KMAX];
+uint64_t *next_map = NULL;
 
-void get_input(char *);
-
-void help(void);
+/**
+ * @brief 输出缓冲，一帧或一段地图拼好后用一次 write 写出。
+ *
+ */
+char *out_buf = NULL;
 
-void welcome(void);
+/**
+ * @brief 输出缓冲中已有的字节数与容量。
+ *
+ */
+size_t out_len = 0, out_cap = 0;
 
-void get_command(char *, char *, char *);
+/**
+ * @brief 自动运行模式的显示方式， VIEW_AUTO 、 VIEW_CELLS 或 VIEW_BRAILLE 。
+ *
+ */
+int view_mode = VIEW_AUTO;
 
-void load_map(char *);
+/**
+ * @brief 视口左上角细胞的行与列。
+ *
+ */
+int view_row = 0, view_col = 0;
 
-void save_map(char *);
+/**
+ * @brief 自动运行模式每秒生成的代数， 0 表示不限速度。
+ *
+ */
+double sim_speed = 10;
 
-void convert_lower_case(char *);
+/**
+ * @brief 自动运行模式每秒最多重绘的次数，与生成的速度无关。
+ *
+ */
+double frame_rate = 30;
 
-void generate_next_status(void);
+/**
+ * @brief
+ * 终端上每个字符位置当前显示的内容：逐格显示时为细胞状态，盲文显示时为点位，-1
+ * 表示未知。下一帧只重绘与此不同的字符。
+ *
+ */
+int16_t *screen = NULL;
 
-void print_map(void);
+/**
+ * @brief screen 的容量。
+ *
+ */
+size_t screen_cap = 0;
 
-void design_map(void);
+/**
+ * @brief screen 是否与终端一致，以及其对应的显示方式、视口与大小。
+ *
+ */
+int screen_valid = 0, screen_braille = 0, screen_r0 = 0, screen_c0 = 0,
+    screen_rows = 0, screen_cols = 0;
 
-void auto_run(void);
+/**
+ * @brief 当前地图的代数。加载文本格式或重新设计时为 0 ，二进制快照保存并恢复此值。
+ *
+ */
+long long generation = 0;
 
-void is_map_error(void);
+/**
+ * @brief
+ * 以写时复制方式映射到内存的二进制快照文件，加载后 map 直接指向其中的地图部分。第一代生成后下一代缓冲换回内存区并解除映射。
+ *
+ */
+void *snapshot = NULL;
 
-int main() {
-  system("cls");
+/**
+ * @brief 快照映射的字节数。
+ *
+ */
+size_t snapshot_size = 0;
+
+/**
+ * @brief
+ * 行和缓冲，每个线程各一份，每份三行，轮流存放相邻三行的横向三格和。每行两个位平面，分别为和的低位与高位。
+ *
+ */
+uint64_t *row_sums = NULL;
+
+/**
+ * @brief 当前地图各行的哈希，地图哈希 board_hash 为它们的异或。
+ *
+ */
+uint64_t *row_hash = NULL;
+
+/**
+ * @brief 每个线程的行和缓冲相隔的字数，按缓存行对齐以免线程间伪共享。
+ *
+ */
+size_t sums_stride = 0;
+
+/**
+ * @brief 生成时使用的线程数（含主线程），启动时由命令行参数指定。
+ *
+ */
+int threads = 1;
+
+/**
+ * @brief 工作线程，共 threads - 1 个，启动时创建，之后每代复用。
+ *
+ */
+pthread_t *workers = NULL;
+
+/**
+ * @brief 线程池当前要执行的任务，参数为线程编号。为 NULL 时工作线程退出。
+ *
+ */
+void (*pool_job)(int) = NULL;
+
+/**
+ * @brief 线程池屏障的互斥锁。
+ *
+ */
+pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief 线程池屏障的条件变量。
+ *
+ */
+pthread_cond_t pool_cond = PTHREAD_COND_INITIALIZER;
+
+/**
+ * @brief 已到达屏障的线程数。
+ *
+ */
+int pool_count = 0;
+
+/**
+ * @brief 屏障轮次，每当全部线程到达时加一。
+ *
+ */
+unsigned pool_phase = 0;
+
+/**
+ * @brief 稀疏模式开关。开启后按位并行引擎只计算上一代有变化的区块及其相邻区块。
+ *
+ */
+int sparse = 0;
+
+/**
+ * @brief 区块的行数与列数。
+ *
+ */
+int tile_rows = 0, tile_cols = 0;
+
+/**
+ * @brief 各区块在上一代是否有变化，由生成时写入 tile_next ，生成后与之交换。
+ *
+ */
+uint8_t *tile_last = NULL;
+
+/**
+ * @brief 各区块在本代是否有变化。
+ *
+ */
+uint8_t *tile_next = NULL;
+
+/**
+ * @brief 每个线程在本代计算的区块数。
+ *
+ */
+long long tile_work[TMAX];
+
+/**
+ * @brief 每个线程本代地图哈希的变化量，由 generate_next_status 合并进 board_hash 。
+ *
+ */
+uint64_t hash_delta[TMAX];
+
+/**
+ * @brief
+ * 一代的统计：代数、存活数、本代出生与死亡的细胞数，以及活细胞的外接矩形（上、左、下、右，含边界；
+ * infinite 边界下可为负）。存活数为 0 时外接矩形无意义。
+ *
+ */
+typedef struct {
+  long long generation;
+  long long population, births, deaths;
+  long long top, left, bottom, right;
+} life_stats;
+
+/**
+ * @brief 每个线程本代的部分统计，由 finish_stats 合并。
+ *
+ */
+life_stats band_stats[TMAX];
+
+/**
+ * @brief 最近一次的统计结果，由 finish_stats 或 scan_stats 更新。
+ *
+ */
+life_stats stats;
+
+/**
+ * @brief
+ * 是否在生成时逐代统计。开启后各引擎（ HashLife 除外）算完一行随即统计该行，不另行扫描地图。
+ *
+ */
+int stats_on = 0;
+
+/**
+ * @brief stats 的状态： 0 为无效， 1 为扫描所得（没有出生、死亡数）， 2 为生成时统计所得。
+ *
+ */
+int stats_valid = 0;
+
+/**
+ * @brief 逐代写入统计结果的 CSV 文件，为 NULL 时不写。
+ *
+ */
+FILE *stats_csv = NULL;
+
+/**
+ * @brief
+ * 稀疏模式下每个区块最近一次计算时的统计（不含死亡数），跳过的区块沿用。位于 arena 中。
+ *
+ */
+life_stats *tile_stats = NULL;
+
+#ifdef LIFE_PROFILE
+/**
+ * @brief
+ * 一个线程在各阶段累计的用时（秒）、次数与处理的细胞数，以及当前条带中采样行在邻居计数、规则与其余部分的用时。
+ *
+ */
+typedef struct {
+  double seconds[PROF_PHASES];
+  double cells[PROF_PHASES];
+  long long calls[PROF_PHASES];
+  double sampled[PROF_REST + 1];
+} prof_counter;
+
+/**
+ * @brief
+ * 各线程的计时结果，按线程号索引。较粗的阶段（ PROF_STEP 及以后）同一时刻只有一个线程进入，记在第 0 项。
+ *
+ */
+prof_counter prof[TMAX];
+
+/**
+ * @brief 较粗的阶段最近一次进入时的时间。
+ *
+ */
+double prof_begin[PROF_PHASES];
+
+/**
+ * @brief 较粗的阶段最近一次进入时的硬件计数器读数。
+ *
+ */
+long long prof_hw_begin[PROF_PHASES][PROF_EVENTS];
+
+/**
+ * @brief 较粗的阶段累计的硬件计数器增量。
+ *
+ */
+long long prof_hw[PROF_PHASES][PROF_EVENTS];
+
+/**
+ * @brief
+ * 硬件计数器的文件描述符，不可用时为 -1
+ * 。在创建任何线程之前打开并设置继承，因此计数包括工作线程与模拟线程。
+ *
+ */
+int prof_fd[PROF_EVENTS] = {-1, -1, -1};
+
+/**
+ * @brief 硬件计数器不可用的原因。
+ *
+ */
+char prof_hw_error[LEN] = "";
+#endif
+
+/**
+ * @brief
+ * 当前地图的 64 位哈希，为各字按内容与位置散列后的异或。生成时各线程算完一行随即更新该行的哈希（数据仍在缓存中），只把变化量合并进来，无需另行扫描地图。只在
+ * history_on 且尚未检测到周期时更新。
+ *
+ */
+uint64_t board_hash = 0;
+
+/**
+ * @brief 同样大小的空地图的哈希，用于发现灭绝。
+ *
+ */
+uint64_t empty_hash = 0;
+
+/**
+ * @brief 历史表中各项的地图哈希。
+ *
+ */
+uint64_t history_hash[HISTORY_SLOTS];
+
+/**
+ * @brief 历史表中各项的代数， -1 为空闲。
+ *
+ */
+long long history_gen[HISTORY_SLOTS];
+
+/**
+ * @brief
+ * 是否开启灭绝、静物与振荡检测，由 \detect 命令或批处理模式的 --detect
+ * 设置，默认关闭。检测每代都要维护地图哈希：单线程生成 3000x3000 、密度 50% 的随机地图 300 代，从约 0.077 s
+ * 增至约 0.110 s （多约 40%）；同样大小、只放 12 个高斯帕滑翔机枪的地图从约 0.073 s 增至约 0.087 s
+ * （多约 20%），因为没有变化的行只比较不散列。
+ *
+ */
+int detect = 0;
+
+/**
+ * @brief 是否检测灭绝、静物与振荡：开启了 detect 且当前引擎与边界模式支持。
+ *
+ */
+int history_on = 0;
+
+/**
+ * @brief 检测到的周期： 0 为尚未发现， 1 为静物或已灭绝，大于 1 为振荡周期。
+ *
+ */
+int period = 0;
+
+/**
+ * @brief 地图是否已全部死亡。
+ *
+ */
+int extinct = 0;
+
+/**
+ * @brief 地图进入静物或振荡（或灭绝）的代数，尚未发现时为 -1 。
+ *
+ */
+long long settled_at = -1;
+
+/**
+ * @brief
+ * 待确认的周期，为 0 时没有。历史表中哈希相同只说明很可能重复，须在 confirm_at
+ * 之后再生成一个周期，逐字比较地图与 confirm_map 相同后才设置 period 。
+ *
+ */
+int confirm_period = 0;
+
+/**
+ * @brief 发现哈希相同时的代数。
+ *
+ */
+long long confirm_at = -1;
+
+/**
+ * @brief 待确认结果中较早一代的代数，确认后成为 settled_at 。
+ *
+ */
+long long confirm_from = -1;
+
+/**
+ * @brief 发现哈希相同时地图的副本，每行 words 个字，多余位已清除。
+ *
+ */
+uint64_t *confirm_map = NULL;
+
+/**
+ * @brief 上一代计算与跳过的区块数。
+ *
+ */
+long long tiles_computed = 0, tiles_skipped = 0;
+
+/**
+ * @brief 开启稀疏模式以来累计计算与跳过的区块数。
+ *
+ */
+long long tiles_computed_sum = 0, tiles_skipped_sum = 0;
+
+/**
+ * @brief 当前地图使用的模拟引擎， ENGINE_BITWISE 、 ENGINE_LUT 或 ENGINE_HASHLIFE 。
+ *
+ */
+int engine = ENGINE_BITWISE;
+
+/**
+ * @brief 边界模式， BOUNDARY_DEAD 、 BOUNDARY_INFINITE 或 BOUNDARY_TORUS 。
+ * HashLife 引擎只支持无限平面。
+ *
+ */
+int boundary = BOUNDARY_DEAD;
+
+/**
+ * @brief 无限平面的一个 64x64 区块。第 r 行为 cells[r] ，生成时下一代写入 next 。
+ *
+ */
+typedef struct {
+  int32_t cy, cx;
+  uint64_t cells[CHUNK];
+  uint64_t next[CHUNK];
+} pl_chunk;
+
+/**
+ * @brief 区块池，每块 CHUNK_BLOCK 个区块，区块编号 i 位于第 i / CHUNK_BLOCK
+ * 块。已分配的块不会移动。
+ *
+ */
+pl_chunk **pl_blocks = NULL;
+
+/**
+ * @brief 区块池已分配的区块总数。
+ *
+ */
+uint32_t pl_total = 0;
+
+/**
+ * @brief 空闲区块编号栈及其大小。
+ *
+ */
+uint32_t *pl_free = NULL, pl_free_count = 0;
+
+/**
+ * @brief 区块哈希表的键，为区块行列坐标拼成的 64 位整数。开放寻址。
+ *
+ */
+uint64_t *pl_keys = NULL;
+
+/**
+ * @brief 区块哈希表的值，为区块编号， PL_NONE 表示空位。
+ *
+ */
+uint32_t *pl_vals = NULL;
+
+/**
+ * @brief 区块哈希表大小（ 2 的幂）与已用数量。
+ *
+ */
+uint32_t pl_size = 0, pl_used = 0;
+
+/**
+ * @brief 本代要计算的区块编号列表及其容量。
+ *
+ */
+uint32_t *pl_list = NULL, pl_list_count = 0, pl_list_capacity = 0;
+
+/**
+ * @brief HashLife 四叉树节点。第 3 层为叶子，存放 8x8
+ * 个细胞；更高层由四个下一层子节点组成。相同内容的节点只存一份。
+ *
+ */
+typedef struct {
+  uint32_t nw, ne, sw, se;
+  uint64_t bits;
+  uint32_t result;
+  int8_t level, result_j;
+} hl_node;
+
+/**
+ * @brief HashLife 节点数组，用编号代替指针。
+ *
+ */
+hl_node *hl_nodes = NULL;
+
+/**
+ * @brief HashLife 已用节点数与节点数组容量。
+ *
+ */
+uint32_t hl_count = 0, hl_capacity = 0;
+
+/**
+ * @brief HashLife 哈希表，开放寻址，存放节点编号，用于查找相同内容的节点。
+ *
+ */
+uint32_t *hl_table = NULL;
+
+/**
+ * @brief HashLife 哈希表大小，为 2 的幂。
+ *
+ */
+uint32_t hl_table_size = 0;
+
+/**
+ * @brief 各层的全死节点编号。
+ *
+ */
+uint32_t hl_empty[64];
+
+/**
+ * @brief HashLife 根节点编号。
+ *
+ */
+uint32_t hl_root = HL_NONE;
+
+/**
+ * @brief HashLife 根节点左上角在地图坐标中的行、列。
+ *
+ */
+long long hl_y = 0, hl_x = 0;
+
+/**
+ * @brief HashLife 每次生成前进 2 的 hl_k 次方代。
+ *
+ */
+int hl_k = 0;
+
+int get_input(char *);
+
+void help(void);
+
+void welcome(void);
+
+void get_command(char *, char *, char *);
+
+/**
+ * @brief 按块读取文件的缓冲读入器。
+ *
+ */
+typedef struct {
+  FILE *fp;
+  char *buf;
+  size_t pos, len;
+  int eof;
+  long long bytes;
+} reader;
+
+/**
+ * @brief
+ * 二进制快照（ .bin ）文件头，共 64 字节，按本机字节序存放。其后紧接整张地图在内存中的样子：
+ * (rows + 2) 行，每行 (cols + 63) / 64 + 2 个字，含上下左右边框，边框与每行多余位均为 0
+ * 。因此加载时可把文件映射到内存直接作为地图。
+ *
+ */
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  int64_t rows, cols;
+  int64_t generation;
+  char rule[24];
+} snap_header;
+
+/**
+ * @brief
+ * 自动运行模式中模拟线程交给显示线程的一帧：地图副本（布局与 map 相同）、代数与检测结果。
+ *
+ */
+typedef struct {
+  uint64_t *cells;
+  long long generation;
+  char note[LEN];
+} frame;
+
+/**
+ * @brief
+ * 三缓冲的三帧。模拟线程独占 frame_back 写入，显示线程独占一帧读取，余下一帧的编号放在
+ * frame_spare 中，双方各用一次原子交换与它互换，谁也不等谁。
+ *
+ */
+frame frames[3];
+
+/**
+ * @brief 模拟线程正在写入的帧。
+ *
+ */
+int frame_back = 1;
+
+/**
+ * @brief 三缓冲的交换位：低两位为待交换的帧， FRAME_FRESH 位表示该帧尚未被显示线程取走。
+ *
+ */
+atomic_int frame_spare = 2;
+
+/**
+ * @brief 自动运行模式的控制锁，保护 run_paused 、 run_steps 、 run_stop 、 run_target 、
+ * frame_wanted 与 sim_speed 。
+ *
+ */
+pthread_mutex_t run_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief 控制状态改变时唤醒模拟线程的条件变量。
+ *
+ */
+pthread_cond_t run_cond = PTHREAD_COND_INITIALIZER;
+
+/**
+ * @brief 模拟线程是否暂停、暂停时待生成的单步代数、是否退出。
+ *
+ */
+int run_paused = 0, run_steps = 0, run_stop = 0;
+
+/**
+ * @brief 自动运行模式的目标代数，到达后暂停并恢复为 -1 ；为 -1 时没有目标。
+ *
+ */
+long long run_target = -1;
+
+/**
+ * @brief 显示线程需要新的一帧时置 1 ，模拟线程发布后清 0 。
+ *
+ */
+int frame_wanted = 0;
+
+double now_seconds(void);
+
+void rd_fill(reader *);
+
+int rd_skip_space(reader *);
+
+int rd_int(reader *);
+
+int rd_cell(reader *);
+
+int rd_getc(reader *);
+
+int rd_line(reader *, char *);
+
+void rd_rewind(reader *);
+
+const char *file_ext(const char *);
+
+int ctz64(uint64_t);
+
+int clz64(uint64_t);
+
+int popcount64(uint64_t);
+
+int run_end(const uint64_t *, int, int);
+
+void set_run(int, int, int);
+
+void load_rule(const char *);
+
+int load_dense(reader *);
+
+int load_rle(reader *);
+
+int load_life106(reader *);
+
+int load_cells(reader *);
+
+int load_binary(reader *);
+
+void load_map(char *);
+
+int save_dense(FILE *);
+
+int save_rle(FILE *);
+
+int save_life106(FILE *);
+
+int save_cells(FILE *, const char *);
+
+int save_binary(FILE *);
+
+int save_map(char *);
+
+void convert_lower_case(char *);
+
+int get_cell(int, int);
+
+void set_cell(int, int, int);
+
+void *aligned_malloc(size_t);
+
+void aligned_free(void *);
+
+int reserve_map(int, int);
+
+int clear_map(int, int);
+
+void unmap_snapshot(void);
+
+uint64_t *row_ptr(uint64_t *, int);
+
+uint64_t tail_mask(void);
+
+int count_alive_neighbors(const uint8_t *, int, int, int, int);
+
+void row_sum(const uint64_t *, uint64_t *, uint64_t *, int);
+
+void row_rule(const uint64_t *, const uint64_t *, const uint64_t *,
+              const uint64_t *, const uint64_t *, const uint64_t *,
+              const uint64_t *, uint64_t *, int);
+
+#ifdef SIMD_X86
+void row_sum_sse(const uint64_t *, uint64_t *, uint64_t *, int);
+
+void row_rule_any(const uint64_t *, const uint64_t *, const uint64_t *,
+                  const uint64_t *, const uint64_t *, const uint64_t *,
+                  const uint64_t *, uint64_t *, int);
+
+void row_rule_any_avx2(const uint64_t *, const uint64_t *, const uint64_t *,
+                       const uint64_t *, const uint64_t *, const uint64_t *,
+                       const uint64_t *, uint64_t *, int);
+
+void row_rule_sse(const uint64_t *, const uint64_t *, const uint64_t *,
+                  const uint64_t *, const uint64_t *, const uint64_t *,
+                  const uint64_t *, uint64_t *, int);
+
+void row_sum_avx2(const uint64_t *, uint64_t *, uint64_t *, int);
+
+void row_rule_avx2(const uint64_t *, const uint64_t *, const uint64_t *,
+                   const uint64_t *, const uint64_t *, const uint64_t *,
+                   const uint64_t *, uint64_t *, int);
+#endif
+
+void select_kernels(void);
+
+void use_kernels(int);
+
+int parse_rule(const char *, int *, int *);
+
+void format_rule(int, int, char *);
+
+void compile_rule(void);
+
+void build_lut(void);
+
+void lut_rows(int, int, int, int);
+
+void generate_lut_band(int);
+
+int set_rule(int, int);
+
+void choose_rule(char *);
+
+int parse_options(int, char *[]);
+
+long long advance(long long);
+
+int run_batch(void);
+
+int bench_fill(int, int);
+
+void configure_engine(int, int, int);
+
+long long peak_rss_kb(void);
+
+int run_bench(void);
+
+void ref_step(const uint8_t *, uint8_t *, uint8_t *, int, int, int);
+
+uint64_t map_hash(void);
+
+int map_clean(void);
+
+uint64_t ref_hash(const uint8_t *, int, int, int, int);
+
+int check_case(int, int, int, int, int, int);
+
+int check_detect(int, int, int);
+
+int check_collision(int, int);
+
+void ref_stats(const uint8_t *, const uint8_t *, int, int, int, life_stats *);
+
+int run_check(void);
+
+void barrier_wait(void);
+
+void *worker_main(void *);
+
+void start_workers(int);
+
+void stop_workers(void);
+
+void pool_run(void (*)(int));
+
+void clear_halo(void);
+
+void fill_halo(void);
+
+void generate_band(int);
+
+int generate_tile(int, int, uint64_t *);
+
+void generate_sparse_band(int);
+
+void mark_all_tiles(void);
+
+uint64_t word_key(uint64_t, int, int);
+
+void hash_row(const uint64_t *, const uint64_t *, int, uint64_t *);
+
+void stats_row(const uint64_t *, const uint64_t *, int, long long, long long,
+               uint64_t, life_stats *);
+#ifdef SIMD_X86
+
+void stats_row_popcnt(const uint64_t *, const uint64_t *, int, long long,
+                      long long, uint64_t, life_stats *);
+
+void stats_row_avx2(const uint64_t *, const uint64_t *, int, long long,
+                    long long, uint64_t, life_stats *);
+#endif
+
+void stats_add(const uint64_t *, int, long long, long long, long long,
+               long long, life_stats *);
+
+void merge_stats(life_stats *, const life_stats *);
+
+void finish_stats(void);
+
+void scan_stats(void);
+
+int open_stats_csv(const char *);
+
+int close_stats_csv(void);
+
+void write_stats(void);
+
+void show_stats(char *);
+
+#ifdef LIFE_PROFILE
+void prof_init(void);
+
+long long prof_read(int);
+
+void prof_lap(int, int, double *);
+
+void prof_band(int, double, int, double);
+
+void prof_enter(int);
+
+void prof_leave(int, double);
+#endif
+
+void show_profile(char *);
+
+int hash_word(const uint64_t *, const uint64_t *, int, int, uint64_t *);
+
+uint64_t full_hash(int);
+
+int board_empty(void);
+
+void reset_history(void);
+
+void record_history(void);
+
+void copy_board(uint64_t *);
+
+int board_matches(const uint64_t *);
+
+int describe_history(char *);
+
+void set_sparse(char *);
+
+void set_detect(char *);
+
+int generate_next_status(void);
+
+void choose_engine(char *);
+
+void engine_attach(void);
+
+uint64_t next_bits(uint64_t, uint64_t, uint64_t);
+
+uint64_t hl_hash(uint64_t);
+
+void hl_reset(void);
+
+uint32_t hl_intern(hl_node *);
+
+uint32_t hl_leaf(uint64_t);
+
+uint32_t hl_join(uint32_t, uint32_t, uint32_t, uint32_t);
+
+uint32_t hl_centre(uint32_t);
+
+uint32_t hl_leaf_centre(uint32_t, uint32_t, uint32_t, uint32_t);
+
+uint32_t hl_inner(uint32_t, uint32_t, uint32_t, uint32_t);
+
+uint32_t hl_base(uint32_t, int);
+
+uint32_t hl_step(uint32_t, int);
+
+int hl_is_centred(uint32_t);
+
+void hl_expand(void);
+
+void hl_advance(uint64_t);
+
+uint32_t hl_build(long long, long long, int);
+
+void hl_from_map(void);
+
+void hl_write(uint32_t, long long, long long, int);
+
+void hl_to_map(void);
+
+uint32_t hl_build_rows(const uint64_t *, int, int, int);
+
+int pl_split(uint32_t *, int, int, long long);
+
+uint32_t hl_build_chunks(uint32_t *, int, long long, long long, int);
+
+void hl_from_plane(void);
+
+int hl_put(uint32_t, long long, long long, int);
+
+int hl_to_plane(void);
+
+uint32_t hl_copy(uint32_t, hl_node *, uint32_t *);
+
+void hl_collect(void);
+
+void set_boundary(char *);
+
+pl_chunk *pl_get(uint32_t);
+
+void pl_reset(void);
+
+uint32_t pl_find(int32_t, int32_t);
+
+uint32_t pl_insert(int32_t, int32_t);
+
+void pl_remove(int32_t, int32_t);
+
+int pl_gather(void);
+
+int pl_grow(void);
+
+void pl_compute(pl_chunk *);
+
+void pl_band(int);
+
+int pl_step(void);
+
+void pl_compact(void);
+
+int pl_from_map(void);
+
+void pl_to_map(void);
+
+void out_put(const char *, size_t);
+
+void out_printf(const char *, ...);
+
+void out_flush(void);
+
+void clear_screen(void);
+
+void term_init(void);
+
+void term_size(int *, int *);
+
+void out_braille(int);
+
+int grid_cell(const uint64_t *, int, int);
+
+int braille_dots(const uint64_t *, int, int);
+
+void render_frame(const char *, const uint64_t *);
+
+void set_view(char *);
+
+void print_map(void);
+
+void design_map(void);
+
+void term_raw(int);
+
+int read_key(int);
+
+void set_speed(char *);
+
+void set_fps(char *);
+
+void publish_frame(void);
+
+void *sim_main(void *);
+
+void sim_control(int, int, int, int);
+
+void auto_run(long long);
+
+void fast_forward(long long);
+
+void generate_command(char *);
+
+void run_command(char *);
+
+void is_map_error(void);
+
+/**
+ * @brief 出生条件，第 n 位为 1 表示死细胞有 n 个存活邻居时出生。默认为 B3 。
+ *
+ */
+int rule_birth = 1 << 3;
+
+/**
+ * @brief 存活条件，第 n 位为 1 表示活细胞有 n 个存活邻居时存活。默认为 S23 。
+ *
+ */
+int rule_survive = 1 << 2 | 1 << 3;
+
+/**
+ * @brief
+ * 由 compile_rule 展开的规则掩码，按九宫格存活数（含自身，0 到 9）索引，全 1
+ * 表示自身死亡时出生（ rule_bm ）或自身存活时存活（ rule_sm ）。
+ *
+ */
+uint64_t rule_bm[10], rule_sm[10];
+
+/**
+ * @brief
+ * 查表引擎的表，由 build_lut 按当前规则生成。下标为一个 4x4 区块，第 r 行占第 4r 到 4r + 3
+ * 位，行内低位在左；值的第 0 、 1 位为中心上行左右两格的下一代，第 2 、 3 位为下行左右两格。共 64
+ * KB ，可以放进 L2 缓存。
+ *
+ */
+uint8_t lut[1 << 16];
+
+/**
+ * @brief 选择内核时允许的最高指令集，0 为标量， 1 为 SSE4.1 ， 2 为 AVX2 。
+ *
+ */
+int kernel_level = 2;
+
+/**
+ * @brief 当前使用的行和函数，由 select_kernels 按 CPU 支持的指令集选择。
+ *
+ */
+void (*row_sum_fn)(const uint64_t *, uint64_t *, uint64_t *, int) = row_sum;
+
+/**
+ * @brief 当前使用的规则函数，由 select_kernels 按 CPU 支持的指令集与当前规则选择。
+ *
+ */
+void (*row_rule_fn)(const uint64_t *, const uint64_t *, const uint64_t *,
+                    const uint64_t *, const uint64_t *, const uint64_t *,
+                    const uint64_t *, uint64_t *, int) = row_rule;
+
+/**
+ * @brief 逐行统计函数，由 use_kernels 选择 AVX2 、 POPCNT 或标量版本。
+ *
+ */
+void (*stats_row_fn)(const uint64_t *, const uint64_t *, int, long long,
+                     long long, uint64_t, life_stats *) = stats_row;
+
+/**
+ * @brief
+ * 当前规则的标量规则函数，供稀疏模式、 HashLife 与无限平面逐字调用。
+ *
+ */
+void (*rule_fn)(const uint64_t *, const uint64_t *, const uint64_t *,
+                const uint64_t *, const uint64_t *, const uint64_t *,
+                const uint64_t *, uint64_t *, int) = row_rule;
+
+/**
+ * @brief 批处理模式的输入文件，为 NULL 时进入交互模式。
+ *
+ */
+char *batch_in = NULL;
+
+/**
+ * @brief 批处理模式的输出文件，为 NULL 时不保存。
+ *
+ */
+char *batch_out = NULL;
+
+/**
+ * @brief 批处理模式使用的引擎与边界模式，为 NULL 时保持默认。
+ *
+ */
+char *batch_engine = NULL, *batch_boundary = NULL;
+
+/**
+ * @brief
+ * 命令行 --rule 指定的规则（出生、存活条件），由 parse_options 解析一次。 batch_birth
+ * 为 -1 时未指定，使用默认规则或地图文件中的规则。
+ *
+ */
+int batch_birth = -1, batch_survive = 0;
+
+/**
+ * @brief 批处理模式逐代写入统计结果的 CSV 文件，为 NULL 时不统计。
+ *
+ */
+char *batch_stats = NULL;
+
+/**
+ * @brief 批处理模式要生成的代数。
+ *
+ */
+long long batch_gens = 0;
+
+/**
+ * @brief 标记，是否以基准测试模式运行。
+ *
+ */
+int bench = 0;
+
+/**
+ * @brief 标记，是否以差分测试模式运行。
+ *
+ */
+int check = 0;
+
+/**
+ * @brief 当前使用的内核名称。
+ *
+ */
+const char *kernel_name = "scalar";
+
+int main(int argc, char *argv[]) {
+  PROF_INIT();
+  select_kernels();
+  compile_rule();
+  if (!parse_options(argc, argv)) {
+    return 1;
+  }
+  if (batch_in != NULL) {
+    return run_batch();
+  }
+  if (bench) {
+    return run_bench();
+  }
+  if (check) {
+    return run_check();
+  }
+  term_init();
+  clear_screen();
   welcome();
   char cmd[LEN], buff[LEN], filename[LEN];
   while (1) {
-    printf("\n[I] -> ");
-    get_input(cmd);
-    get_command(cmd, buff, filename);
-    if (strcmp(buff, HELP) == 0 && strcmp(filename, EMPTY) == 0) {
-      help();
-    } else if (strcmp(buff, LOAD) == 0) {
-      load_map(filename);
-    } else if (strcmp(buff, SAVE) == 0) {
-      save_map(filename);
-    } else if (strcmp(buff, DESIGN) == 0 && strcmp(filename, EMPTY) == 0) {
-      design_map();
-    } else if (strcmp(buff, GENERATE) == 0 && strcmp(filename, EMPTY) == 0) {
+    printf("\n[I] -> ");
+    if (!get_input(cmd)) {
+      strcpy(cmd, END);
+    }
+    get_command(cmd, buff, filename);
+    if (strcmp(buff, HELP) == 0 && strcmp(filename, EMPTY) == 0) {
+      help();
+    } else if (strcmp(buff, LOAD) == 0) {
+      PROF_ENTER(PROF_LOAD);
+      load_map(filename);
+      PROF_LEAVE(PROF_LOAD, is_map ? (double)row * col : 0);
+    } else if (strcmp(buff, SAVE) == 0) {
+      PROF_ENTER(PROF_SAVE);
+      save_map(filename);
+      PROF_LEAVE(PROF_SAVE, is_map ? (double)row * col : 0);
+    } else if (strcmp(buff, DESIGN) == 0 && strcmp(filename, EMPTY) == 0) {
+      design_map();
+    } else if (strcmp(buff, GENERATE) == 0) {
+      generate_command(filename);
+    } else if (strcmp(buff, RUN) == 0) {
+      run_command(filename);
+    } else if (strcmp(buff, QUIT) == 0 && strcmp(filename, EMPTY) == 0) {
+      printf("This command is only available in design mode.\n");
+    } else if (strcmp(buff, PRINT) == 0 && strcmp(filename, EMPTY) == 0) {
+      print_map();
+    } else if (strcmp(buff, ENGINE) == 0) {
+      choose_engine(filename);
+    } else if (strcmp(buff, SPARSE) == 0) {
+      set_sparse(filename);
+    } else if (strcmp(buff, DETECT) == 0) {
+      set_detect(filename);
+    } else if (strcmp(buff, BOUNDARY) == 0) {
+      set_boundary(filename);
+    } else if (strcmp(buff, VIEW) == 0) {
+      set_view(filename);
+    } else if (strcmp(buff, RULE) == 0) {
+      choose_rule(filename);
+    } else if (strcmp(buff, SPEED) == 0) {
+      set_speed(filename);
+    } else if (strcmp(buff, FPS) == 0) {
+      set_fps(filename);
+    } else if (strcmp(buff, STATS) == 0) {
+      show_stats(filename);
+    } else if (strcmp(buff, PROF) == 0) {
+      show_profile(filename);
+    } else if (strcmp(buff, END) == 0 && strcmp(filename, EMPTY) == 0) {
+      printf("See you next time!\n");
+      stop_workers();
+      break;
+    } else if (strcmp(buff, EMPTY) == 0) {
+      continue;
+    } else {
+      printf("error: command not found: %s %s\n", buff, filename);
+    }
+    printf("\n");
+  }
+  return 0;
+}
+
+/**
+ * @brief 获取一整行输入字符串。长度不大于1024。输入结束时得到空串。
+ *
+ * @param buf 输入字符串存放位置
+ * @return int 1为读到一行，0为输入结束
+ */
+int get_input(char *buf) {
+  if (fgets(buf, LEN, stdin) == NULL) {
+    buf[0] = '\0';
+    return 0;
+  }
+  buf[strcspn(buf, "\n")] = '\0';
+  return 1;
+}
+/**
+ * @brief 显示帮助界面。
+ *
+ */
+void help() {
+  printf("    [\\h]    print command [h]ints\n");
+  printf("    [\\p]    [p]rint current map\n");
+  printf("    [\\l <filename>]  [l]oad map from a local file\n");
+  printf("    [\\s <filename>]  [s]ave map to local\n");
+  printf("            (.rle, .lif/.life, .cells and .bin files use the RLE, "
+         "Life 1.06, plaintext and binary snapshot formats)\n");
+  printf("    [\\d]    enter [d]esign mode\n");
+  printf("    [\\q]    [q]uit design mode\n");
+  printf("    [\\g [N]]  [g]enerate next generation of life, or N "
+         "generations at full speed (any key cancels)\n");
+  printf("    [\\r [--to GEN]]  enter auto_[r]un mode (keys: ENTER pause/run, "
+         "n step, +/- speed), --to runs at full speed and pauses at GEN\n");
+  printf("    [e]     [e]xit auto_run mode\n");
+  printf("    [\\engine [bitwise|lut|hashlife [k]]]  show or choose the "
+         "simulation [engine]\n");
+  printf("    [\\sparse [on|off]]  skip unchanged 64x64 tiles, show tile "
+         "counters\n");
+  printf("    [\\detect [on|off]]  [detect] extinction, still lifes and "
+         "oscillators (off by default)\n");
+  printf("    [\\boundary [dead|infinite|torus]]  show or choose the "
+         "[boundary] mode\n");
+  printf("    [\\view [auto|cells|braille|<row> <col>]]  choose how auto_run "
+         "draws the map, or move the [view]port\n");
+  printf("    [\\rule [B3/S23]]  show or set the B/S [rule], e.g. B36/S23\n");
+  printf("    [\\speed [N|max]]  generations per second in auto_run\n");
+  printf("    [\\fps [N]]  redraws per second in auto_run\n");
+  printf("    [\\stats [on|off|csv <filename>|csv off]]  population, births, "
+         "deaths and bounding box, tracked while generating\n");
+  printf("    [\\prof [reset]]  time per phase and hardware counters "
+         "(builds with -DLIFE_PROFILE)\n");
+  printf("    [end]   [end] the game\n");
+}
+
+/**
+ * @brief 显示初始欢迎界面。
+ *
+ */
+void welcome() {
+  char *s = "************************************************\n";
+  printf("%s%s", s, s);
+  printf("                GAME OF LIFE\n\n");
+  printf("          Welcome to the game of life.\n");
+  printf("You'll experience the joy of Cellular Automaton.\n\n");
+  printf("                ARE YOU READY\n\n");
+  printf("%s%s", s, s);
+  help();
+}
+
+/**
+ * @brief
+ * 将一个字符串分解为两个部分。第一个部分为去掉空白字符后的头部到第一个空白字符或尾部之前。第二个部分为第一个空白字符后到尾部去掉空白字符之前。可用于分解命令，获取两个整数等。当分解命令时，可用于处理带空格的文件名及路径。当获取两个整数时，可通过一系列判断来确保输入一定是两个整数。
+ *
+ * @param cmd 输入的命令（通常为获取的一整行字符串）
+ * @param buf 分解的第一个字符串
+ * @param filename 分解的第二个字符串
+ */
+void get_command(char *cmd, char *buf, char *filename) {
+  convert_lower_case(cmd);
+  int t = 0, len = (int)strlen(cmd), i = 0, j = 0;
+  while (t < len && (cmd[t] == ' ' || cmd[t] == '\t')) ++t;
+  while (t < len && cmd[t] != ' ' && cmd[t] != '\t') buf[i++] = cmd[t++];
+  buf[i] = '\0';
+  while (t < len && (cmd[t] == ' ' || cmd[t] == '\t')) ++t;
+  while (t < len) filename[j++] = cmd[t++];
+  j--;
+  while (j >= 0 && filename[j] == ' ' || filename[j] == '\t') j--;
+  filename[j + 1] = '\0';
+}
+
+/**
+ * @brief 将输入的字符串s中的字母全转换为小写。
+ *
+ * @param s 需要转换的字符串
+ */
+void convert_lower_case(char *s) {
+  int len = (int)strlen(s);
+  for (int i = 0; i < len; ++i) {
+    if (s[i] >= 'A' && s[i] <= 'Z') {
+      s[i] += 32;
+    }
+  }
+}
+
+/**
+ * @brief 取得单调递增的时间，用于计时。
+ *
+ * @return double 秒
+ */
+double now_seconds() {
+#ifdef _WIN32
+  LARGE_INTEGER freq, t;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&t);
+  return (double)t.QuadPart / (double)freq.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+/**
+ * @brief
+ * 把缓冲中未读的字节移到开头，并从文件读入更多字节直至缓冲满或文件结束。缓冲末尾总是补一个
+ * '\0' 。
+ *
+ * @param r 读入器
+ */
+void rd_fill(reader *r) {
+  memmove(r->buf, r->buf + r->pos, r->len - r->pos);
+  r->len -= r->pos, r->pos = 0;
+  while (!r->eof && r->len < RD_BLOCK) {
+    size_t n = fread(r->buf + r->len, 1, RD_BLOCK - r->len, r->fp);
+    if (n == 0) {
+      r->eof = 1;
+    }
+    r->len += n, r->bytes += (long long)n;
+  }
+  r->buf[r->len] = '\0';
+}
+
+/**
+ * @brief 跳过空白字符，并保证之后缓冲中至少有 RD_MARGIN 个字节（或已到文件尾）。
+ *
+ * @param r 读入器
+ * @return int 还有字符可读为1，已到文件尾为0
+ */
+int rd_skip_space(reader *r) {
+  while (1) {
+    while (r->pos < r->len &&
+           (r->buf[r->pos] == ' ' || (r->buf[r->pos] >= '\t' &&
+                                      r->buf[r->pos] <= '\r'))) {
+      r->pos++;
+    }
+    if (r->len - r->pos < RD_MARGIN && !r->eof) {
+      rd_fill(r);
+      continue;
+    }
+    return r->pos < r->len;
+  }
+}
+
+/**
+ * @brief 读取一个十进制整数，格式同 scanf 的 %d 。
+ *
+ * @param r 读入器
+ * @return int 读到的整数，失败时为 0
+ */
+int rd_int(reader *r) {
+  if (!rd_skip_space(r)) {
+    return 0;
+  }
+  char *end;
+  long v = strtol(r->buf + r->pos, &end, 10);
+  r->pos = (size_t)(end - r->buf);
+  return v > KMAX || v < -KMAX ? KMAX : (int)v;
+}
+
+/**
+ * @brief
+ * 读取一个细胞的存活情况，语义同 scanf 的 %lf 后判断是否大于 0
+ * 。绝大多数输入是纯数字，直接逐字节判断是否含非 0 数字；带符号、小数点、指数等的数交给
+ * strtod 。遇到无法解析的内容时返回 -1 ，与 scanf 一样之后的细胞都读不出。
+ *
+ * @param r 读入器
+ * @return int 存活为1，死亡为0，无法继续读取为-1
+ */
+int rd_cell(reader *r) {
+  if (!rd_skip_space(r)) {
+    return -1;
+  }
+  const char *p = r->buf + r->pos, *end = r->buf + r->len;
+  int nonzero = 0, digits = 0;
+  while (p < end && *p >= '0' && *p <= '9') {
+    nonzero |= *p++ != '0';
+    digits++;
+    if (p == end && !r->eof) {
+      r->pos = (size_t)(p - r->buf);
+      rd_fill(r);
+      p = r->buf, end = r->buf + r->len;
+    }
+  }
+  if (digits > 0 && (p == end || (*p != '.' && *p != 'e' &&
+                                           *p != 'E' && *p != 'x' &&
+                                           *p != 'X'))) {
+    r->pos = (size_t)(p - r->buf);
+    return nonzero;
+  }
+  char *stop;
+  double v = strtod(r->buf + r->pos, &stop);
+  if (stop == r->buf + r->pos) {
+    return -1;
+  }
+  r->pos = (size_t)(stop - r->buf);
+  return v > 0;
+}
+
+/**
+ * @brief 读取一个字符。
+ *
+ * @param r 读入器
+ * @return int 读到的字符，已到文件尾为 EOF
+ */
+int rd_getc(reader *r) {
+  if (r->pos == r->len) {
+    rd_fill(r);
+  }
+  return r->pos < r->len ? (unsigned char)r->buf[r->pos++] : EOF;
+}
+
+/**
+ * @brief 读取一行，去掉换行符与回车符。超过 LEN - 1 个字符的部分被丢弃。
+ *
+ * @param r 读入器
+ * @param line 行的存放位置
+ * @return int 读到一行为1，已到文件尾为0
+ */
+int rd_line(reader *r, char *line) {
+  int c = rd_getc(r), n = 0;
+  if (c == EOF) {
+    return 0;
+  }
+  while (c != EOF && c != '\n') {
+    if (c != '\r' && n < LEN - 1) {
+      line[n++] = (char)c;
+    }
+    c = rd_getc(r);
+  }
+  line[n] = '\0';
+  return 1;
+}
+
+/**
+ * @brief 回到文件开头重新读取。
+ *
+ * @param r 读入器
+ */
+void rd_rewind(reader *r) {
+  rewind(r->fp);
+  r->pos = r->len = 0, r->eof = 0;
+}
+
+/**
+ * @brief 取文件名的扩展名。
+ *
+ * @param filename 文件名
+ * @return const char* 从最后一个 '.' 开始的部分，没有扩展名时为空字符串
+ */
+const char *file_ext(const char *filename) {
+  const char *dot = strrchr(filename, '.');
+  const char *slash = strrchr(filename, '/');
+  if (dot == NULL || (slash != NULL && slash > dot)) {
+    return EMPTY;
+  }
+  return dot;
+}
+
+/**
+ * @brief 求 64 位整数末尾 0 的个数。
+ *
+ * @param x 非 0 的整数
+ * @return int 末尾 0 的个数
+ */
+int ctz64(uint64_t x) {
+#ifdef __GNUC__
+  return __builtin_ctzll(x);
+#else
+  int n = 0;
+  while (!(x & 1)) {
+    x >>= 1, n++;
+  }
+  return n;
+#endif
+}
+
+/**
+ * @brief 求 64 位整数开头 0 的个数。
+ *
+ * @param x 非 0 的整数
+ * @return int 开头 0 的个数
+ */
+int clz64(uint64_t x) {
+#ifdef __GNUC__
+  return __builtin_clzll(x);
+#else
+  int n = 0;
+  while (!(x >> 63)) {
+    x <<= 1, n++;
+  }
+  return n;
+#endif
+}
+
+/**
+ * @brief 求 64 位整数中 1 的个数。
+ *
+ * @param x 整数
+ * @return int 1 的个数
+ */
+int popcount64(uint64_t x) {
+#ifdef __GNUC__
+  return __builtin_popcountll(x);
+#else
+  int n = 0;
+  for (; x; x &= x - 1) {
+    n++;
+  }
+  return n;
+#endif
+}
+
+/**
+ * @brief 从某行第 j 列开始找第一个状态不为 v 的细胞，整字相同时一次跳过 64 个。
+ *
+ * @param p 该行首字地址
+ * @param j 起始列
+ * @param v 细胞状态
+ * @return int 第一个状态不为 v 的列，直到行尾都相同时为 col
+ */
+int run_end(const uint64_t *p, int j, int v) {
+  while (j < col) {
+    uint64_t x = (v ? ~p[j >> 6] : p[j >> 6]) >> (j & 63);
+    if (x) {
+      j += ctz64(x);
+      return j < col ? j : col;
+    }
+    j = (j | 63) + 1;
+  }
+  return col;
+}
+
+/**
+ * @brief 将第 i 行从第 j 列开始的 n 个细胞置为存活，超出地图的部分忽略。
+ *
+ * @param i 行
+ * @param j 起始列
+ * @param n 个数
+ */
+void set_run(int i, int j, int n) {
+  if (i < 0 || i >= row || j < 0 || j >= col || n <= 0) {
+    return;
+  }
+  int e = n > col - j ? col : j + n;
+  uint64_t *p = row_ptr(map, i);
+  while (j < e) {
+    int k = (j | 63) + 1 < e ? (j | 63) + 1 : e;
+    uint64_t bits = k - j == 64 ? ~(uint64_t)0 : ((uint64_t)1 << (k - j)) - 1;
+    p[j >> 6] |= bits << (j & 63);
+    j = k;
+  }
+}
+
+/**
+ * @brief
+ * 加载地图文件中记录的规则。无法识别或与当前引擎冲突时显示警告并保留当前规则。
+ *
+ * @param rule 规则字符串，为 NULL 时不改变规则
+ */
+void load_rule(const char *rule) {
+  int b, s;
+  if (rule == NULL) {
+    return;
+  }
+  if (!parse_rule(rule, &b, &s)) {
+    printf("load_map: warning: unknown rule %s, keeping the current rule\n",
+           rule);
+  } else if (!set_rule(b, s)) {
+    printf("load_map: warning: keeping the current rule\n");
+  }
+}
+
+/**
+ * @brief
+ * 读取本程序的文本格式。第一行为行数与列数，之后每个细胞一个数，数值大于0则读取为存活，否则读取为死亡。读取至已经读取结束或文件尾部，剩下细胞默认死亡。由
+ * rd_cell 直接扫描字符，每行凑满一个字再写入地图。
+ *
+ * @param r 读入器
+ * @return int 成功为1，失败为0
+ */
+int load_dense(reader *r) {
+  int x = rd_int(r);
+  int y = rd_int(r);
+  if (x <= 0 || y <= 0) {
+    printf("load_map: error: illegal map\n");
+    return 0;
+  }
+  if (x >= KMAX || y >= KMAX || !clear_map(x, y)) {
+    printf("load_map: error: map is too large\n");
+    return 0;
+  }
+  int stop = 0;
+  for (int i = 0; i < row && !stop; ++i) {
+    uint64_t *p = row_ptr(map, i), word = 0;
+    int j = 0;
+    for (; j < col; ++j) {
+      int v = rd_cell(r);
+      if (v < 0) {
+        stop = 1;
+        break;
+      }
+      word |= (uint64_t)v << (j & 63);
+      if ((j & 63) == 63) {
+        p[j >> 6] = word, word = 0;
+      }
+    }
+    if (word) {
+      p[j >> 6] = word;
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief
+ * 读取 RLE 格式。以 # 开头的行为注释，头部 "x = 列数, y = 行数"
+ * 决定地图大小。之后 b 为死细胞， o 及其他字母为活细胞， $
+ * 为换行，前面的数字为重复次数， ! 为结束。超出地图的细胞被忽略。头部的 rule
+ * 项为规则。
+ *
+ * @param r 读入器
+ * @return int 成功为1，失败为0
+ */
+int load_rle(reader *r) {
+  char line[LEN], compact[LEN], *rule = NULL;
+  int x = 0, y = 0;
+  while (rd_line(r, line)) {
+    if (line[0] == '#' || line[0] == '\0') {
+      continue;
+    }
+    int n = 0;
+    for (int i = 0; line[i]; ++i) {
+      if (line[i] != ' ' && line[i] != '\t') {
+        compact[n++] = line[i];
+      }
+    }
+    compact[n] = '\0';
+    sscanf(compact, "x=%d,y=%d", &y, &x);
+    rule = strstr(compact, "rule=");
+    if (rule != NULL) {
+      rule += 5;
+    }
+    break;
+  }
+  if (x <= 0 || y <= 0) {
+    printf("load_map: error: illegal map\n");
+    return 0;
+  }
+  if (x >= KMAX || y >= KMAX || !clear_map(x, y)) {
+    printf("load_map: error: map is too large\n");
+    return 0;
+  }
+  int i = 0, j = 0, c, count = 0;
+  while ((c = rd_getc(r)) != EOF && c != '!') {
+    if (c >= '0' && c <= '9') {
+      count = count >= KMAX / 10 ? KMAX : count * 10 + (c - '0');
+      continue;
+    }
+    int n = count > 0 ? count : 1;
+    if (c == 'b' || c == '.') {
+      j = n > col - j ? col : j + n;
+    } else if (c == '$') {
+      i = n > row - i ? row : i + n, j = 0;
+    } else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+      set_run(i, j, n);
+      j = n > col - j ? col : j + n;
+    } else {
+      continue;
+    }
+    count = 0;
+  }
+  load_rule(rule);
+  return 1;
+}
+
+/**
+ * @brief
+ * 读取 Life 1.06 格式。以 # 开头的行为注释，其余每行为一个活细胞的 "列 行"
+ * 坐标，可以为负。地图大小取所有活细胞的外接矩形，没有活细胞时为 1x1 。 #R
+ * 行为规则。坐标用 strtoll 读入，超出 long long 范围的文件报错；外接矩形的宽高以无符号数相减求得，
+ * 坐标相距再远也不会溢出，在确定地图大小之前就与 KMAX 比较。
+ *
+ * @param r 读入器
+ * @return int 成功为1，失败为0
+ */
+int load_life106(reader *r) {
+  char line[LEN], rule[LEN] = "";
+  long long *cells = NULL, n = 0, cap = 0;
+  long long min_x = 0, max_x = 0, min_y = 0, max_y = 0, cx, cy;
+  while (rd_line(r, line)) {
+    if (line[0] == '#' && line[1] == 'R') {
+      sscanf(line + 2, "%1023s", rule);
+    }
+    char *end1, *end2;
+    errno = 0;
+    cx = strtoll(line, &end1, 10);
+    cy = strtoll(end1, &end2, 10);
+    if (line[0] == '#' || end1 == line || end2 == end1) {
+      continue;
+    }
+    if (errno == ERANGE) {
+      free(cells);
+      printf("load_map: error: map is too large\n");
+      return 0;
+    }
+    if (n == cap) {
+      cap = cap ? cap * 2 : 1024;
+      long long *q = realloc(cells, sizeof(long long) * 2 * cap);
+      if (q == NULL) {
+        free(cells);
+        printf("load_map: error: out of memory\n");
+        return 0;
+      }
+      cells = q;
+    }
+    cells[2 * n] = cx, cells[2 * n + 1] = cy;
+    min_x = n == 0 || cx < min_x ? cx : min_x;
+    max_x = n == 0 || cx > max_x ? cx : max_x;
+    min_y = n == 0 || cy < min_y ? cy : min_y;
+    max_y = n == 0 || cy > max_y ? cy : max_y;
+    n++;
+  }
+  unsigned long long span_x = (unsigned long long)max_x - min_x;
+  unsigned long long span_y = (unsigned long long)max_y - min_y;
+  if (span_x >= KMAX - 1 || span_y >= KMAX - 1 ||
+      !clear_map((int)span_y + 1, (int)span_x + 1)) {
+    free(cells);
+    printf("load_map: error: map is too large\n");
+    return 0;
+  }
+  for (long long k = 0; k < n; ++k) {
+    set_cell((int)(cells[2 * k + 1] - min_y), (int)(cells[2 * k] - min_x), 1);
+  }
+  free(cells);
+  load_rule(rule[0] ? rule : NULL);
+  return 1;
+}
+
+/**
+ * @brief
+ * 读取 plaintext （ .cells ）格式。以 ! 开头的行为注释，其余每行为地图的一行，
+ * . 为死细胞，其他字符为活细胞。先读一遍求出行数（非注释行数）与列数（最长行的长度），再回到开头读入细胞。
+ *
+ * @param r 读入器
+ * @return int 成功为1，失败为0
+ */
+int load_cells(reader *r) {
+  long long x = 0, y = 0, len = 0;
+  int c, comment = 0, start = 1;
+  while ((c = rd_getc(r)) != EOF) {
+    if (start) {
+      comment = c == '!', start = 0;
+      x += !comment;
+    }
+    if (c == '\n') {
+      start = 1, len = 0;
+    } else if (!comment && c != '\r' && ++len > y) {
+      y = len;
+    }
+  }
+  if (x <= 0 || y <= 0) {
+    printf("load_map: error: illegal map\n");
+    return 0;
+  }
+  if (x >= KMAX || y >= KMAX || !clear_map((int)x, (int)y)) {
+    printf("load_map: error: map is too large\n");
+    return 0;
+  }
+  rd_rewind(r);
+  int i = 0, j = 0;
+  start = 1;
+  while ((c = rd_getc(r)) != EOF) {
+    if (start) {
+      comment = c == '!', start = 0;
+    }
+    if (c == '\n') {
+      i += !comment, j = 0, start = 1;
+    } else if (!comment && c != '\r') {
+      if (c != '.') {
+        set_cell(i, j, 1);
+      }
+      j++;
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief
+ * 读取二进制快照（ .bin ）。检查文件头与文件大小后，把整个文件以写时复制方式映射到内存，
+ * map 直接指向文件中的地图部分，不解析、不复制；只有生成时被改写的页才会复制。
+ * 本程序保存的快照边框与多余位均为 0 ，其他来源或损坏的文件则不一定，因此映射后先只读检查一遍，不干净时才用
+ * clear_halo 清除（只有被改写的页会复制），使生成前读取地图的转换、统计、保存与哈希不受影响。 Windows
+ * 下没有 mmap ，改为一次读入。
+ *
+ * @param r 读入器，只使用其中的文件与字节数
+ * @return int 成功为1，失败为0
+ */
+int load_binary(reader *r) {
+  snap_header h;
+  if (fread(&h, sizeof(h), 1, r->fp) != 1 ||
+      memcmp(h.magic, SNAP_MAGIC, 8) != 0 || h.version != SNAP_VERSION ||
+      h.header_size != sizeof(h) || h.rows <= 0 || h.cols <= 0) {
+    printf("load_map: error: illegal map\n");
+    return 0;
+  }
+  int birth, survive;
+  h.rule[sizeof(h.rule) - 1] = '\0';
+  if (!parse_rule(h.rule, &birth, &survive)) {
+    printf("load_map: error: unknown rule\n");
+    return 0;
+  }
+  if (h.rows >= KMAX || h.cols >= KMAX) {
+    printf("load_map: error: map is too large\n");
+    return 0;
+  }
+  size_t plane = ((size_t)h.rows + 2) * (((size_t)h.cols + 63) / 64 + 2) *
+                 sizeof(uint64_t);
+  size_t size = sizeof(h) + plane;
+#ifdef _WIN32
+  _fseeki64(r->fp, 0, SEEK_END);
+  long long bytes = _ftelli64(r->fp);
+#else
+  struct stat st;
+  long long bytes = fstat(fileno(r->fp), &st) == 0 ? (long long)st.st_size : -1;
+#endif
+  if (bytes < 0 || (size_t)bytes != size) {
+    printf("load_map: error: illegal map\n");
+    return 0;
+  }
+#ifdef _WIN32
+  void *p = malloc(size);
+  fseek(r->fp, 0, SEEK_SET);
+  if (p != NULL && fread(p, 1, size, r->fp) != size) {
+    free(p);
+    printf("load_map: error: illegal map\n");
+    return 0;
+  }
+#else
+  void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                 fileno(r->fp), 0);
+  if (p == MAP_FAILED) {
+    p = NULL;
+  }
+#endif
+  if (p == NULL || !reserve_map((int)h.rows, (int)h.cols)) {
+#ifdef _WIN32
+    free(p);
+#else
+    if (p != NULL) {
+      munmap(p, size);
+    }
+#endif
+    printf("load_map: error: map is too large\n");
+    return 0;
+  }
+  memset(next_map, 0, (size_t)(tile_next + (size_t)tile_rows * tile_cols -
+                                (uint8_t *)next_map));
+  snapshot = p, snapshot_size = size;
+  map = (uint64_t *)((char *)p + sizeof(h));
+  if (!map_clean()) {
+    clear_halo();
+  }
+  generation = (long long)h.generation;
+  r->bytes = (long long)size;
+  load_rule(h.rule);
+  return 1;
+}
+
+/**
+ * @brief
+ * 加载本地地图。格式按扩展名选择： .rle 为 RLE ， .lif 与 .life 为 Life 1.06
+ * ， .cells 为 plaintext ， .bin 为二进制快照，其他为本程序的文本格式。如果因系统原因或输入原因无法加载，报无文件错误；如果地图大小不合法或超过范围，报错。文件按
+ * RD_BLOCK 字节分块读入，最后显示读取速度。
+ *
+ * @param filename 需要加载的文件名
+ */
+void load_map(char *filename) {
+  double start = now_seconds();
+  FILE *fp = fopen(filename, "rb");
+  if (fp == NULL) {
+    printf("load_map: error: no such file\n");
+    return;
+  }
+  reader r = {fp, malloc(RD_BLOCK + 1), 0, 0, 0, 0};
+  if (r.buf == NULL) {
+    printf("load_map: error: out of memory\n");
+    fclose(fp);
+    return;
+  }
+  const char *ext = file_ext(filename);
+  int ok;
+  if (strcmp(ext, ".rle") == 0) {
+    ok = load_rle(&r);
+  } else if (strcmp(ext, ".lif") == 0 || strcmp(ext, ".life") == 0) {
+    ok = load_life106(&r);
+  } else if (strcmp(ext, ".cells") == 0) {
+    ok = load_cells(&r);
+  } else if (strcmp(ext, ".bin") == 0) {
+    ok = load_binary(&r);
+  } else {
+    ok = load_dense(&r);
+  }
+  free(r.buf);
+  fclose(fp);
+  if (!ok) {
+    return;
+  }
+  is_map = 1;
+  engine_attach();
+  double secs = now_seconds() - start;
+  printf("row = %d, column = %d\n", row, col);
+  if (generation) {
+    printf("generation = %lld\n", generation);
+  }
+  printf("loading complete (%.1f MB in %.3f s, %.1f MB/s)\n", r.bytes / 1e6,
+         secs, secs > 0 ? r.bytes / 1e6 / secs : 0.0);
+}
+
+/**
+ * @brief
+ * 以本程序的文本格式写出地图：第一行为行数与列数，之后每个细胞一个数。每行先在缓冲中拼好再一次写出。
+ *
+ * @param fp 文件
+ * @return int 成功为1，内存不足或写入出错为0
+ */
+int save_dense(FILE *fp) {
+  fprintf(fp, "%d %d\n", row, col);
+  char *line = malloc((size_t)col * 2 + 2);
+  if (line == NULL) {
+    printf("save_map: error: out of memory\n");
+    return 0;
+  }
+  for (int i = 0; i < row; ++i) {
+    const uint64_t *p = row_ptr(map, i);
+    for (int j = 0; j < col; ++j) {
+      line[2 * j] = (char)('0' + (p[j >> 6] >> (j & 63) & 1));
+      line[2 * j + 1] = ' ';
+    }
+    line[2 * col] = '\n', line[2 * col + 1] = '\0';
+    fputs(line, fp);
+  }
+  free(line);
+  return !ferror(fp);
+}
+
+/**
+ * @brief
+ * 以 RLE 格式写出地图。按字查找连续相同的细胞；行末的死细胞与末尾的空行省略，连续的换行合并为一个带次数的
+ * $ ；每行不超过 70 个字符。
+ *
+ * @param fp 文件
+ * @return int 成功为1，写入出错为0
+ */
+int save_rle(FILE *fp) {
+  char rule[24];
+  format_rule(rule_birth, rule_survive, rule);
+  fprintf(fp, "x = %d, y = %d, rule = %s\n", col, row, rule);
+  char item[32];
+  int width = 0, pending = 0;
+  for (int i = 0; i < row; ++i) {
+    const uint64_t *p = row_ptr(map, i);
+    int j = 0;
+    while (j < col) {
+      int v = (int)(p[j >> 6] >> (j & 63) & 1), e = run_end(p, j, v);
+      if (!v && e == col) {
+        break;
+      }
+      for (int k = 0; k < 2; ++k) {
+        int n = k == 0 ? pending : e - j;
+        char tag = k == 0 ? '$' : v ? 'o' : 'b';
+        if (n == 0) {
+          continue;
+        }
+        int len = n == 1 ? sprintf(item, "%c", tag)
+                         : sprintf(item, "%d%c", n, tag);
+        if (width + len > 70) {
+          fputc('\n', fp);
+          width = 0;
+        }
+        fputs(item, fp);
+        width += len;
+      }
+      pending = 0;
+      j = e;
+    }
+    pending++;
+  }
+  fprintf(fp, "!\n");
+  return !ferror(fp);
+}
+
+/**
+ * @brief 以 Life 1.06 格式写出地图，每个活细胞一行 "列 行" 。每行最后一个字先截去多余位。
+ *
+ * @param fp 文件
+ * @return int 成功为1，写入出错为0
+ */
+int save_life106(FILE *fp) {
+  char rule[24];
+  format_rule(rule_birth, rule_survive, rule);
+  fprintf(fp, "#Life 1.06\n#R %s\n", rule);
+  uint64_t tail = tail_mask();
+  for (int i = 0; i < row; ++i) {
+    const uint64_t *p = row_ptr(map, i);
+    for (int w = 0; w < words; ++w) {
+      for (uint64_t x = w == words - 1 ? p[w] & tail : p[w]; x; x &= x - 1) {
+        fprintf(fp, "%d %d\n", w * 64 + ctz64(x), i);
+      }
+    }
+  }
+  return !ferror(fp);
+}
+
+/**
+ * @brief 以 plaintext （ .cells ）格式写出地图，每行写满 col 个字符。
+ *
+ * @param fp 文件
+ * @param filename 文件名，写入 !Name: 注释
+ * @return int 成功为1，内存不足或写入出错为0
+ */
+int save_cells(FILE *fp, const char *filename) {
+  fprintf(fp, "!Name: %s\n", filename);
+  char *line = malloc((size_t)col + 2);
+  if (line == NULL) {
+    printf("save_map: error: out of memory\n");
+    return 0;
+  }
+  for (int i = 0; i < row; ++i) {
+    for (int j = 0; j < col; ++j) {
+      line[j] = get_cell(i, j) ? 'O' : '.';
+    }
+    line[col] = '\n', line[col + 1] = '\0';
+    fputs(line, fp);
+  }
+  free(line);
+  return !ferror(fp);
+}
+
+/**
+ * @brief
+ * 以二进制快照格式写出地图：文件头之后是含边框的整张地图，一次写出。写出前先清空边框，使文件可直接映射为地图。
+ *
+ * @param fp 文件
+ * @return int 成功为1，写入出错为0
+ */
+int save_binary(FILE *fp) {
+  snap_header h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, SNAP_MAGIC, 8);
+  h.version = SNAP_VERSION, h.header_size = sizeof(h);
+  h.rows = row, h.cols = col, h.generation = generation;
+  format_rule(rule_birth, rule_survive, h.rule);
+  clear_halo();
+  size_t n = (size_t)(row + 2) * stride;
+  return fwrite(&h, sizeof(h), 1, fp) == 1 &&
+         fwrite(map, sizeof(uint64_t), n, fp) == n;
+}
+
+/**
+ * @brief
+ * 保存地图至本地。如无地图则报错退出。可能因系统原因保存失败。格式按扩展名选择，与
+ * load_map 相同。各格式的写出函数内存不足或写入出错、关闭文件失败时报错，不显示保存成功。
+ *
+ * @param filename 需要保存的文件名
+ * @return int 成功为1，失败为0
+ */
+int save_map(char *filename) {
+  if (!is_map) {
+    is_map_error();
+    return 0;
+  }
+  const char *ext = file_ext(filename);
+  FILE *fp = fopen(filename, strcmp(ext, ".bin") == 0 ? "wb" : "w");
+  if (fp == NULL) {
+    printf("save_map: error: failed to save file\n");
+    return 0;
+  }
+  int ok;
+  if (strcmp(ext, ".rle") == 0) {
+    ok = save_rle(fp);
+  } else if (strcmp(ext, ".lif") == 0 || strcmp(ext, ".life") == 0) {
+    ok = save_life106(fp);
+  } else if (strcmp(ext, ".cells") == 0) {
+    ok = save_cells(fp, filename);
+  } else if (strcmp(ext, ".bin") == 0) {
+    ok = save_binary(fp);
+  } else {
+    ok = save_dense(fp);
+  }
+  if (fclose(fp) != 0) {
+    ok = 0;
+  }
+  if (!ok) {
+    printf("save_map: error: failed to save file\n");
+    return 0;
+  }
+  printf("saving successfully\n");
+  return 1;
+}
+
+/**
+ * @brief 读取地图上某点细胞的存活情况。
+ *
+ * @param x x坐标
+ * @param y y坐标
+ * @return int 存活为1，死亡为0
+ */
+int get_cell(int x, int y) { return grid_cell(map, x, y); }
+
+/**
+ * @brief 读取与 map 布局相同的任意地图副本中某个细胞。
+ *
+ * @param grid 地图副本
+ * @param x 行号
+ * @param y 列号
+ * @return int 存活为1，否则为0
+ */
+int grid_cell(const uint64_t *grid, int x, int y) {
+  return (int)(grid[(size_t)(x + 1) * stride + 1 + (y >> 6)] >> (y & 63) & 1);
+}
+
+/**
+ * @brief 设置地图上某点细胞的存活情况。
+ *
+ * @param x x坐标
+ * @param y y坐标
+ * @param v 非0为存活，0为死亡
+ */
+void set_cell(int x, int y, int v) {
+  uint64_t *p = row_ptr(map, x) + (y >> 6);
+  if (v) {
+    *p |= (uint64_t)1 << (y & 63);
+  } else {
+    *p &= ~((uint64_t)1 << (y & 63));
+  }
+}
+
+/**
+ * @brief 分配按 ALIGN 字节对齐的内存。
+ *
+ * @param size 字节数
+ * @return void* 内存首地址，失败时为 NULL
+ */
+void *aligned_malloc(size_t size) {
+#ifdef _WIN32
+  return _aligned_malloc(size, ALIGN);
+#else
+  void *p = NULL;
+  return posix_memalign(&p, ALIGN, size) == 0 ? p : NULL;
+#endif
+}
+
+/**
+ * @brief 释放由 aligned_malloc 分配的内存。
+ *
+ * @param p 内存首地址
+ */
+void aligned_free(void *p) {
+#ifdef _WIN32
+  _aligned_free(p);
+#else
+  free(p);
+#endif
+}
+
+/**
+ * @brief
+ * 设置地图行列数并划分内存区，但不清空内容。地图、下一代缓冲与行和缓冲在同一块对齐内存区中划分，内存区仅在容量不足时重新分配，之后各代生成均复用该区域。分配失败时保留原地图。
+ *
+ * @param x 行数
+ * @param y 列数
+ * @return int 成功为1，内存不足为0
+ */
+int reserve_map(int x, int y) {
+  size_t w = ((size_t)y + 63) / 64;
+  size_t plane = (((size_t)x + 2) * (w + 2) * sizeof(uint64_t) + ALIGN - 1) /
+                 ALIGN * ALIGN;
+  size_t sums = (6 * w * sizeof(uint64_t) + ALIGN - 1) / ALIGN * ALIGN;
+  size_t tiles = ((size_t)x + TILE - 1) / TILE * w;
+  size_t need = plane * 2 + sums * threads + (size_t)x * sizeof(uint64_t) +
+                tiles * sizeof(life_stats) + 2 * tiles;
+  if (need > arena_size) {
+    uint64_t *p = aligned_malloc(need);
+    if (p == NULL) {
+      return 0;
+    }
+    aligned_free(arena);
+    arena = p, arena_size = need;
+  }
+  unmap_snapshot();
+  row = x, col = y, words = (int)w, stride = (int)w + 2;
+  map = arena;
+  next_map = arena + plane / sizeof(uint64_t);
+  row_sums = next_map + plane / sizeof(uint64_t);
+  sums_stride = sums / sizeof(uint64_t);
+  tile_rows = (x + TILE - 1) / TILE, tile_cols = (int)w;
+  row_hash = row_sums + sums_stride * threads;
+  tile_stats = (life_stats *)(row_hash + x);
+  tile_last = (uint8_t *)(tile_stats + tiles);
+  tile_next = tile_last + tiles;
+  return 1;
+}
+
+/**
+ * @brief 设置地图行列数，并将所有细胞置为死亡，代数归零。分配失败时保留原地图。
+ *
+ * @param x 行数
+ * @param y 列数
+ * @return int 成功为1，内存不足为0
+ */
+int clear_map(int x, int y) {
+  if (!reserve_map(x, y)) {
+    return 0;
+  }
+  memset(arena, 0, (size_t)(tile_next + (size_t)tile_rows * tile_cols -
+                             (uint8_t *)arena));
+  mark_all_tiles();
+  generation = 0;
+  return 1;
+}
+
+/**
+ * @brief 解除二进制快照的映射。调用前 map 与 next_map 都已不再指向快照。
+ *
+ */
+void unmap_snapshot() {
+  if (snapshot == NULL) {
+    return;
+  }
+#ifdef _WIN32
+  free(snapshot);
+#else
+  munmap(snapshot, snapshot_size);
+#endif
+  snapshot = NULL, snapshot_size = 0;
+}
+
+/**
+ * @brief
+ * 逐格计算地图上某点周围存活细胞的数量。对边界情况分类讨论。地图为每格一字节的 r x c
+ * 数组，即本程序最初的地图表示。生成下一代时不再使用，作为差分测试（ ref_step ）的参考实现。
+ *
+ * @param g 地图
+ * @param r 行数
+ * @param c 列数
+ * @param x x坐标
+ * @param y y坐标
+ * @return int 该点周围存活细胞的数量
+ */
+int count_alive_neighbors(const uint8_t *g, int r, int c, int x, int y) {
+  int alive = 0;
+  for (int i = x - 1; i <= x + 1; ++i) {
+    if (i < 0 || i >= r) continue;
+    for (int j = y - 1; j <= y + 1; ++j) {
+      if (j < 0 || j >= c || (i == x && j == y)) continue;
+      alive += g[(size_t)i * c + j];
+    }
+  }
+  return alive;
+}
+
+/**
+ * @brief 取地图某一行第一个有效字的地址。 i 为 -1 或 row 时为上下边框行。
+ *
+ * @param grid 地图或下一代缓冲
+ * @param i 行号
+ * @return uint64_t* 该行首字地址
+ */
+uint64_t *row_ptr(uint64_t *grid, int i) {
+  return grid + (size_t)(i + 1) * stride + 1;
+}
+
+/**
+ * @brief 取每行最后一个字的有效位掩码：低 col % 64 位为 1 ，列数为 64 的倍数时全为 1 。
+ *
+ * @return uint64_t 掩码
+ */
+uint64_t tail_mask() {
+  return (col & 63) ? ((uint64_t)1 << (col & 63)) - 1 : ~(uint64_t)0;
+}
+
+/**
+ * @brief
+ * 计算一行中每个细胞与其左右两格的存活数之和（0 到 3），一次处理 64
+ * 个细胞。左右邻居用移位对齐，跨字的位取自相邻字，行首行尾取自边框字，因此无需判断边界。
+ *
+ * @param src 该行首字地址
+ * @param s0 和的低位
+ * @param s1 和的高位
+ * @param n 字数
+ */
+void row_sum(const uint64_t *src, uint64_t *s0, uint64_t *s1, int n) {
+  for (int w = 0; w < n; ++w) {
+    uint64_t x = src[w];
+    uint64_t l = (x << 1) | (src[w - 1] >> 63);
+    uint64_t r = (x >> 1) | (src[w + 1] << 63);
+    s0[w] = l ^ x ^ r;
+    s1[w] = (l & x) | (r & (l ^ x));
+  }
+}
+
+/**
+ * @brief
+ * 由上、本、下三行的横向三格和得到九宫格存活数（含自身），并按游戏规则得到下一代。九宫格存活数为
+ * 3 的细胞必定存活，为 4 的细胞保持原状态，其余死亡。三个两位数相加时，低位直接异或，进位与三个高位一起计数，只需判断该计数为
+ * 1 或 2 。
+ *
+ * @param a0 上一行和的低位
+ * @param a1 上一行和的高位
+ * @param b0 本行和的低位
+ * @param b1 本行和的高位
+ * @param c0 下一行和的低位
+ * @param c1 下一行和的高位
+ * @param self 本行当前状态
+ * @param dst 本行下一代状态
+ * @param n 字数
+ */
+void row_rule(const uint64_t *a0, const uint64_t *a1, const uint64_t *b0,
+              const uint64_t *b1, const uint64_t *c0, const uint64_t *c1,
+              const uint64_t *self, uint64_t *dst, int n) {
+  for (int w = 0; w < n; ++w) {
+    uint64_t u0 = a0[w] ^ b0[w] ^ c0[w];
+    uint64_t k = (a0[w] & b0[w]) | (c0[w] & (a0[w] ^ b0[w]));
+    uint64_t p = a1[w] ^ b1[w], q = a1[w] & b1[w];
+    uint64_t r = c1[w] ^ k, s = c1[w] & k;
+    uint64_t one = (p ^ r) & ~(q | s);
+    uint64_t two = (p & r) | (~(p | r) & (q ^ s));
+    dst[w] = (u0 & one) | (~u0 & two & self[w]);
+  }
+}
+
+/**
+ * @brief
+ * 任意 B/S 规则的 row_rule 。先按 row_rule 的方法把九宫格存活数（含自身，0 到 9
+ * ）求成四个位平面，再译码为各个取值的平面，与 compile_rule 预先展开的掩码 rule_bm （自身死亡时出生）、
+ * rule_sm （自身存活时存活）相与后合并。规则在编译时已变成掩码，计算时不再逐格查表或判断。
+ *
+ * @param a0 上一行和的低位
+ * @param a1 上一行和的高位
+ * @param b0 本行和的低位
+ * @param b1 本行和的高位
+ * @param c0 下一行和的低位
+ * @param c1 下一行和的高位
+ * @param self 本行当前状态
+ * @param dst 本行下一代状态
+ * @param n 字数
+ */
+void row_rule_any(const uint64_t *a0, const uint64_t *a1, const uint64_t *b0,
+                  const uint64_t *b1, const uint64_t *c0, const uint64_t *c1,
+                  const uint64_t *self, uint64_t *dst, int n) {
+  for (int w = 0; w < n; ++w) {
+    uint64_t u0 = a0[w] ^ b0[w] ^ c0[w];
+    uint64_t k = (a0[w] & b0[w]) | (c0[w] & (a0[w] ^ b0[w]));
+    uint64_t p = a1[w] ^ b1[w], q = a1[w] & b1[w];
+    uint64_t r = c1[w] ^ k, s = c1[w] & k;
+    uint64_t h0 = p ^ r, h1 = q ^ s ^ (p & r), h2 = q & s;
+    uint64_t lo[4] = {~u0 & ~h0, u0 & ~h0, ~u0 & h0, u0 & h0};
+    uint64_t hi[3] = {~h1 & ~h2, h1, h2};
+    uint64_t born = 0, keep = 0;
+    for (int t = 0; t < 10; ++t) {
+      uint64_t eq = lo[t & 3] & hi[t >> 2];
+      born |= eq & rule_bm[t], keep |= eq & rule_sm[t];
+    }
+    dst[w] = (~self[w] & born) | (self[w] & keep);
+  }
+}
+
+#ifdef SIMD_X86
+/**
+ * @brief
+ * row_rule_any 的 AVX2 版本，用 GCC 向量扩展每次处理四个字，余下的字交给
+ * row_rule_any 。
+ *
+ * @param a0 上一行和的低位
+ * @param a1 上一行和的高位
+ * @param b0 本行和的低位
+ * @param b1 本行和的高位
+ * @param c0 下一行和的低位
+ * @param c1 下一行和的高位
+ * @param self 本行当前状态
+ * @param dst 本行下一代状态
+ * @param n 字数
+ */
+__attribute__((target("avx2"))) void row_rule_any_avx2(
+    const uint64_t *a0, const uint64_t *a1, const uint64_t *b0,
+    const uint64_t *b1, const uint64_t *c0, const uint64_t *c1,
+    const uint64_t *self, uint64_t *dst, int n) {
+  typedef uint64_t v4 __attribute__((vector_size(32), aligned(8)));
+  v4 bm[10], sm[10];
+  for (int t = 0; t < 10; ++t) {
+    bm[t] = (v4){rule_bm[t], rule_bm[t], rule_bm[t], rule_bm[t]};
+    sm[t] = (v4){rule_sm[t], rule_sm[t], rule_sm[t], rule_sm[t]};
+  }
+  int w = 0;
+  for (; w + 4 <= n; w += 4) {
+    v4 va0 = *(const v4 *)(a0 + w), vb0 = *(const v4 *)(b0 + w);
+    v4 vc0 = *(const v4 *)(c0 + w), va1 = *(const v4 *)(a1 + w);
+    v4 vb1 = *(const v4 *)(b1 + w), vc1 = *(const v4 *)(c1 + w);
+    v4 x = *(const v4 *)(self + w);
+    v4 u0 = va0 ^ vb0 ^ vc0;
+    v4 k = (va0 & vb0) | (vc0 & (va0 ^ vb0));
+    v4 p = va1 ^ vb1, q = va1 & vb1, r = vc1 ^ k, s = vc1 & k;
+    v4 h0 = p ^ r, h1 = q ^ s ^ (p & r), h2 = q & s;
+    v4 lo[4] = {~u0 & ~h0, u0 & ~h0, ~u0 & h0, u0 & h0};
+    v4 hi[3] = {~h1 & ~h2, h1, h2};
+    v4 born = lo[0] & hi[0] & bm[0], keep = lo[0] & hi[0] & sm[0];
+    for (int t = 1; t < 10; ++t) {
+      v4 eq = lo[t & 3] & hi[t >> 2];
+      born |= eq & bm[t], keep |= eq & sm[t];
+    }
+    *(v4 *)(dst + w) = (~x & born) | (x & keep);
+  }
+  _mm256_zeroupper();
+  row_rule_any(a0 + w, a1 + w, b0 + w, b1 + w, c0 + w, c1 + w, self + w,
+               dst + w, n - w);
+}
+#endif
+
+
+#ifdef SIMD_X86
+/**
+ * @brief row_sum 的 SSE4.1 版本，每次处理两个字，余下的字交给 row_sum 。
+ *
+ * @param src 该行首字地址
+ * @param s0 和的低位
+ * @param s1 和的高位
+ * @param n 字数
+ */
+__attribute__((target("sse4.1"))) void row_sum_sse(const uint64_t *src,
+                                                   uint64_t *s0, uint64_t *s1,
+                                                   int n) {
+  int w = 0;
+  for (; w + 2 <= n; w += 2) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(src + w));
+    __m128i xl = _mm_loadu_si128((const __m128i *)(src + w - 1));
+    __m128i xr = _mm_loadu_si128((const __m128i *)(src + w + 1));
+    __m128i l = _mm_or_si128(_mm_slli_epi64(x, 1), _mm_srli_epi64(xl, 63));
+    __m128i r = _mm_or_si128(_mm_srli_epi64(x, 1), _mm_slli_epi64(xr, 63));
+    __m128i lx = _mm_xor_si128(l, x);
+    _mm_storeu_si128((__m128i *)(s0 + w), _mm_xor_si128(lx, r));
+    _mm_storeu_si128((__m128i *)(s1 + w),
+                     _mm_or_si128(_mm_and_si128(l, x), _mm_and_si128(r, lx)));
+  }
+  row_sum(src + w, s0 + w, s1 + w, n - w);
+}
+
+/**
+ * @brief row_rule 的 SSE4.1 版本，每次处理两个字，余下的字交给 row_rule 。
+ *
+ * @param a0 上一行和的低位
+ * @param a1 上一行和的高位
+ * @param b0 本行和的低位
+ * @param b1 本行和的高位
+ * @param c0 下一行和的低位
+ * @param c1 下一行和的高位
+ * @param self 本行当前状态
+ * @param dst 本行下一代状态
+ * @param n 字数
+ */
+__attribute__((target("sse4.1"))) void row_rule_sse(
+    const uint64_t *a0, const uint64_t *a1, const uint64_t *b0,
+    const uint64_t *b1, const uint64_t *c0, const uint64_t *c1,
+    const uint64_t *self, uint64_t *dst, int n) {
+  int w = 0;
+  for (; w + 2 <= n; w += 2) {
+    __m128i va0 = _mm_loadu_si128((const __m128i *)(a0 + w));
+    __m128i vb0 = _mm_loadu_si128((const __m128i *)(b0 + w));
+    __m128i vc0 = _mm_loadu_si128((const __m128i *)(c0 + w));
+    __m128i va1 = _mm_loadu_si128((const __m128i *)(a1 + w));
+    __m128i vb1 = _mm_loadu_si128((const __m128i *)(b1 + w));
+    __m128i vc1 = _mm_loadu_si128((const __m128i *)(c1 + w));
+    __m128i x = _mm_loadu_si128((const __m128i *)(self + w));
+    __m128i ab = _mm_xor_si128(va0, vb0);
+    __m128i u0 = _mm_xor_si128(ab, vc0);
+    __m128i k = _mm_or_si128(_mm_and_si128(va0, vb0), _mm_and_si128(vc0, ab));
+    __m128i p = _mm_xor_si128(va1, vb1), q = _mm_and_si128(va1, vb1);
+    __m128i r = _mm_xor_si128(vc1, k), t = _mm_and_si128(vc1, k);
+    __m128i qt = _mm_or_si128(q, t);
+    __m128i one = _mm_andnot_si128(qt, _mm_xor_si128(p, r));
+    __m128i two = _mm_or_si128(_mm_and_si128(p, r),
+                               _mm_andnot_si128(_mm_or_si128(p, r),
+                                                _mm_xor_si128(q, t)));
+    __m128i res = _mm_or_si128(_mm_and_si128(u0, one),
+                               _mm_andnot_si128(u0, _mm_and_si128(two, x)));
+    _mm_storeu_si128((__m128i *)(dst + w), res);
+  }
+  row_rule(a0 + w, a1 + w, b0 + w, b1 + w, c0 + w, c1 + w, self + w, dst + w,
+           n - w);
+}
+
+/**
+ * @brief row_sum 的 AVX2 版本，每次处理四个字，余下的字交给 row_sum 。
+ *
+ * @param src 该行首字地址
+ * @param s0 和的低位
+ * @param s1 和的高位
+ * @param n 字数
+ */
+__attribute__((target("avx2"))) void row_sum_avx2(const uint64_t *src,
+                                                  uint64_t *s0, uint64_t *s1,
+                                                  int n) {
+  int w = 0;
+  for (; w + 4 <= n; w += 4) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(src + w));
+    __m256i xl = _mm256_loadu_si256((const __m256i *)(src + w - 1));
+    __m256i xr = _mm256_loadu_si256((const __m256i *)(src + w + 1));
+    __m256i l =
+        _mm256_or_si256(_mm256_slli_epi64(x, 1), _mm256_srli_epi64(xl, 63));
+    __m256i r =
+        _mm256_or_si256(_mm256_srli_epi64(x, 1), _mm256_slli_epi64(xr, 63));
+    __m256i lx = _mm256_xor_si256(l, x);
+    _mm256_storeu_si256((__m256i *)(s0 + w), _mm256_xor_si256(lx, r));
+    _mm256_storeu_si256(
+        (__m256i *)(s1 + w),
+        _mm256_or_si256(_mm256_and_si256(l, x), _mm256_and_si256(r, lx)));
+  }
+  _mm256_zeroupper();
+  row_sum(src + w, s0 + w, s1 + w, n - w);
+}
+
+/**
+ * @brief row_rule 的 AVX2 版本，每次处理四个字，余下的字交给 row_rule 。
+ *
+ * @param a0 上一行和的低位
+ * @param a1 上一行和的高位
+ * @param b0 本行和的低位
+ * @param b1 本行和的高位
+ * @param c0 下一行和的低位
+ * @param c1 下一行和的高位
+ * @param self 本行当前状态
+ * @param dst 本行下一代状态
+ * @param n 字数
+ */
+__attribute__((target("avx2"))) void row_rule_avx2(
+    const uint64_t *a0, const uint64_t *a1, const uint64_t *b0,
+    const uint64_t *b1, const uint64_t *c0, const uint64_t *c1,
+    const uint64_t *self, uint64_t *dst, int n) {
+  int w = 0;
+  for (; w + 4 <= n; w += 4) {
+    __m256i va0 = _mm256_loadu_si256((const __m256i *)(a0 + w));
+    __m256i vb0 = _mm256_loadu_si256((const __m256i *)(b0 + w));
+    __m256i vc0 = _mm256_loadu_si256((const __m256i *)(c0 + w));
+    __m256i va1 = _mm256_loadu_si256((const __m256i *)(a1 + w));
+    __m256i vb1 = _mm256_loadu_si256((const __m256i *)(b1 + w));
+    __m256i vc1 = _mm256_loadu_si256((const __m256i *)(c1 + w));
+    __m256i x = _mm256_loadu_si256((const __m256i *)(self + w));
+    __m256i ab = _mm256_xor_si256(va0, vb0);
+    __m256i u0 = _mm256_xor_si256(ab, vc0);
+    __m256i k =
+        _mm256_or_si256(_mm256_and_si256(va0, vb0), _mm256_and_si256(vc0, ab));
+    __m256i p = _mm256_xor_si256(va1, vb1), q = _mm256_and_si256(va1, vb1);
+    __m256i r = _mm256_xor_si256(vc1, k), t = _mm256_and_si256(vc1, k);
+    __m256i qt = _mm256_or_si256(q, t);
+    __m256i one = _mm256_andnot_si256(qt, _mm256_xor_si256(p, r));
+    __m256i two = _mm256_or_si256(
+        _mm256_and_si256(p, r),
+        _mm256_andnot_si256(_mm256_or_si256(p, r), _mm256_xor_si256(q, t)));
+    __m256i res =
+        _mm256_or_si256(_mm256_and_si256(u0, one),
+                        _mm256_andnot_si256(u0, _mm256_and_si256(two, x)));
+    _mm256_storeu_si256((__m256i *)(dst + w), res);
+  }
+  _mm256_zeroupper();
+  row_rule(a0 + w, a1 + w, b0 + w, b1 + w, c0 + w, c1 + w, self + w, dst + w,
+           n - w);
+}
+#endif
+
+/**
+ * @brief
+ * 按 CPU 支持的指令集选择行和与规则函数，依次尝试 AVX2 、 SSE4.1
+ * 与标量版本，三者结果逐位相同。环境变量 LIFE_SIMD 可设为 avx2 、 sse4.1 或
+ * scalar ，限制可使用的最高指令集。
+ *
+ */
+void select_kernels() {
+  const char *env = getenv("LIFE_SIMD");
+  int level = 2;
+  if (env != NULL && strcmp(env, "sse4.1") == 0) {
+    level = 1;
+  } else if (env != NULL && strcmp(env, "scalar") == 0) {
+    level = 0;
+  }
+  use_kernels(level);
+}
+
+/**
+ * @brief
+ * 选择不超过 level 的、 CPU 支持的最快内核。 B3/S23 使用专门的内核，其他规则使用
+ * row_rule_any 系列（ SSE4.1 级别没有单独的版本，使用标量版本）。
+ *
+ * @param level 0 为标量， 1 为 SSE4.1 ， 2 为 AVX2
+ */
+void use_kernels(int level) {
+  int life = rule_birth == 1 << 3 && rule_survive == (1 << 2 | 1 << 3);
+  kernel_level = level;
+  rule_fn = life ? row_rule : row_rule_any;
+  row_sum_fn = row_sum, row_rule_fn = rule_fn, kernel_name = "scalar";
+  stats_row_fn = stats_row;
+#ifdef SIMD_X86
+  __builtin_cpu_init();
+  if (level >= 2 && __builtin_cpu_supports("avx2") &&
+      __builtin_cpu_supports("popcnt")) {
+    stats_row_fn = stats_row_avx2;
+  } else if (level >= 1 && __builtin_cpu_supports("popcnt")) {
+    stats_row_fn = stats_row_popcnt;
+  }
+  if (level >= 2 && __builtin_cpu_supports("avx2")) {
+    row_sum_fn = row_sum_avx2;
+    row_rule_fn = life ? row_rule_avx2 : row_rule_any_avx2;
+    kernel_name = "avx2";
+  } else if (level >= 1 && __builtin_cpu_supports("sse4.1")) {
+    row_sum_fn = row_sum_sse;
+    row_rule_fn = life ? row_rule_sse : row_rule_any;
+    kernel_name = "sse4.1";
+  }
+#endif
+}
+
+/**
+ * @brief
+ * 解析 B/S 规则字符串，支持 B3/S23 、 S23/B3 （不区分大小写）与传统的 23/3
+ * （存活/出生）三种写法。数字只能为 0 到 8 。
+ *
+ * @param str 规则字符串
+ * @param birth 出生条件存放位置，第 n 位表示 n 个邻居时出生
+ * @param survive 存活条件存放位置，第 n 位表示 n 个邻居时存活
+ * @return int 成功为1，格式错误为0
+ */
+int parse_rule(const char *str, int *birth, int *survive) {
+  const char *slash = strchr(str, '/');
+  if (slash == NULL || strchr(slash + 1, '/') != NULL) {
+    return 0;
+  }
+  int mask[2] = {0, 0}, kind[2] = {-1, -1};
+  for (int part = 0; part < 2; ++part) {
+    const char *c = part == 0 ? str : slash + 1;
+    const char *end = part == 0 ? slash : slash + 1 + strlen(slash + 1);
+    if (c < end && (*c == 'b' || *c == 'B')) {
+      kind[part] = 0, c++;
+    } else if (c < end && (*c == 's' || *c == 'S')) {
+      kind[part] = 1, c++;
+    }
+    for (; c < end; ++c) {
+      if (*c < '0' || *c > '8') {
+        return 0;
+      }
+      mask[part] |= 1 << (*c - '0');
+    }
+  }
+  if (kind[0] == -1 && kind[1] == -1) {
+    *survive = mask[0], *birth = mask[1];
+    return 1;
+  }
+  if (kind[0] == -1 || kind[1] == -1 || kind[0] == kind[1]) {
+    return 0;
+  }
+  *birth = mask[kind[0] == 0 ? 0 : 1], *survive = mask[kind[0] == 1 ? 0 : 1];
+  return 1;
+}
+
+/**
+ * @brief 把规则写成 B3/S23 形式的字符串。
+ *
+ * @param birth 出生条件
+ * @param survive 存活条件
+ * @param out 字符串存放位置，至少 24 字节
+ */
+void format_rule(int birth, int survive, char *out) {
+  int n = 0;
+  out[n++] = 'B';
+  for (int i = 0; i <= 8; ++i) {
+    if (birth >> i & 1) out[n++] = (char)('0' + i);
+  }
+  out[n++] = '/', out[n++] = 'S';
+  for (int i = 0; i <= 8; ++i) {
+    if (survive >> i & 1) out[n++] = (char)('0' + i);
+  }
+  out[n] = '\0';
+}
+
+/**
+ * @brief
+ * 编译规则：把出生与存活条件展开为按九宫格存活数（含自身）索引的全 0 或全 1
+ * 掩码，生成查表引擎的表，并选择内核。 B3/S23 使用专门的 row_rule 系列，其他规则使用 row_rule_any 系列。
+ *
+ */
+void compile_rule() {
+  for (int t = 0; t < 10; ++t) {
+    rule_bm[t] = t <= 8 && (rule_birth >> t & 1) ? ~(uint64_t)0 : 0;
+    rule_sm[t] = t >= 1 && (rule_survive >> (t - 1) & 1) ? ~(uint64_t)0 : 0;
+  }
+  build_lut();
+  use_kernels(kernel_level);
+}
+
+/**
+ * @brief
+ * 按当前规则生成查表引擎的表。对每个 4x4 区块，逐格数出中心四个细胞的九宫格存活数，按出生或存活条件得到下一代。共
+ * 65536 项，每次切换规则时重新生成。
+ *
+ */
+void build_lut() {
+  for (int idx = 0; idx < 1 << 16; ++idx) {
+    int out = 0;
+    for (int y = 1; y <= 2; ++y) {
+      for (int x = 1; x <= 2; ++x) {
+        int alive = 0;
+        for (int i = y - 1; i <= y + 1; ++i) {
+          for (int j = x - 1; j <= x + 1; ++j) {
+            alive += idx >> (4 * i + j) & 1;
+          }
+        }
+        int next = (idx >> (4 * y + x) & 1) ? rule_survive >> (alive - 1) & 1
+                                            : rule_birth >> alive & 1;
+        out |= next << (2 * (y - 1) + x - 1);
+      }
+    }
+    lut[idx] = (uint8_t)out;
+  }
+}
+
+/**
+ * @brief
+ * 用查表计算第 r0 到 r1 - 1 行、第 w0 到 w1 - 1 字的下一代，写入下一代缓冲。每次取相邻两行及其上下各一行，每行取
+ * 4 位拼成下标，一次查表得到 2x2 个细胞。每行先左移一位接上左侧字的最高位，使第 2k 、 2k + 1
+ * 列的区块恰好位于第 2k 到 2k + 3 位；字末的区块跨入右侧字，单独拼接。行数为奇数时最后一行单独查表，只取上半结果。
+ *
+ * @param r0 起始行
+ * @param r1 结束行（不含）
+ * @param w0 起始字
+ * @param w1 结束字（不含）
+ */
+void lut_rows(int r0, int r1, int w0, int w1) {
+  uint64_t tail = tail_mask();
+  for (int i = r0; i < r1; i += 2) {
+    const uint64_t *p[4] = {row_ptr(map, i - 1), row_ptr(map, i),
+                            row_ptr(map, i + 1),
+                            row_ptr(map, i + 2 <= row ? i + 2 : i + 1)};
+    uint64_t *d0 = row_ptr(next_map, i), *d1 = row_ptr(next_map, i + 1);
+    int pair = i + 1 < r1;
+    for (int w = w0; w < w1; ++w) {
+      uint64_t lo[4];
+      unsigned last = 0;
+      for (int r = 0; r < 4; ++r) {
+        lo[r] = (p[r][w] << 1) | (p[r][w - 1] >> 63);
+        last |= (unsigned)((p[r][w] >> 61) | (p[r][w + 1] & 1) << 3) << 4 * r;
+      }
+      uint64_t a = 0, b = 0;
+      for (int s = 0; s < 62; s += 2) {
+        unsigned t = lut[(lo[0] >> s & 15) | (lo[1] >> s & 15) << 4 |
+                         (lo[2] >> s & 15) << 8 | (lo[3] >> s & 15) << 12];
+        a |= (uint64_t)(t & 3) << s;
+        b |= (uint64_t)(t >> 2) << s;
+      }
+      a |= (uint64_t)(lut[last] & 3) << 62;
+      b |= (uint64_t)(lut[last] >> 2) << 62;
+      if (w == words - 1) {
+        a &= tail, b &= tail;
+      }
+      d0[w] = a;
+      if (pair) {
+        d1[w] = b;
+      }
+    }
+  }
+}
+
+/**
+ * @brief
+ * 查表引擎计算第 id 个横向条带的下一代，条带划分与 generate_band
+ * 相同。每算完两行，趁数据还在缓存中更新这两行的哈希（尚未检测到周期时）与统计（开启统计时）。
+ *
+ * @param id 线程编号
+ */
+void generate_lut_band(int id) {
+  int r0 = (int)((long long)row * id / threads);
+  int r1 = (int)((long long)row * (id + 1) / threads);
+  uint64_t tail = tail_mask();
+  hash_delta[id] = 0;
+  memset(&band_stats[id], 0, sizeof(life_stats));
+  PROF_START(band);
+  for (int i = r0; i < r1; i += 2) {
+    int i1 = i + 2 < r1 ? i + 2 : r1;
+    PROF_SAMPLE(lap, (i - r0) / 2);
+    lut_rows(i, i1, 0, words);
+    PROF_LAP(id, PROF_RULE, lap);
+    for (int k = i; k < i1; ++k) {
+      if (history_on && !period) {
+        hash_row(row_ptr(map, k), row_ptr(next_map, k), k, &hash_delta[id]);
+      }
+      if (stats_on) {
+        stats_row_fn(row_ptr(map, k), row_ptr(next_map, k), words, k, 0, tail,
+                     &band_stats[id]);
+      }
+    }
+    PROF_LAP(id, PROF_REST, lap);
+  }
+  PROF_BAND(id, band, r1 - r0, 64.0 * words * (r1 - r0));
+}
+
+/**
+ * @brief
+ * 设置规则。出生条件含 0 的规则会让地图外的空白处出生，只能用于死亡或环面边界的按位并行引擎。
+ * HashLife 的结果缓存依赖规则，因此清空，调用者之后须调用 engine_attach 重建。
+ *
+ * @param birth 出生条件
+ * @param survive 存活条件
+ * @return int 成功为1，与当前引擎或边界模式冲突为0
+ */
+int set_rule(int birth, int survive) {
+  if ((birth & 1) &&
+      (engine == ENGINE_HASHLIFE || boundary == BOUNDARY_INFINITE)) {
+    printf("set_rule: error: B0 rules need a dead or torus boundary\n");
+    return 0;
+  }
+  rule_birth = birth, rule_survive = survive;
+  compile_rule();
+  if (engine == ENGINE_HASHLIFE) {
+    hl_reset();
+  }
+  return 1;
+}
+
+/**
+ * @brief 显示或设置规则。
+ *
+ * @param arg 规则字符串或空
+ */
+void choose_rule(char *arg) {
+  int b, s;
+  if (strcmp(arg, EMPTY) != 0) {
+    if (!parse_rule(arg, &b, &s)) {
+      printf("choose_rule: error: unknown rule: %s\n", arg);
+      return;
+    }
+    if (!set_rule(b, s)) {
+      return;
+    }
+    engine_attach();
+  }
+  char name[24];
+  format_rule(rule_birth, rule_survive, name);
+  printf("rule = %s\n", name);
+}
+
+/**
+ * @brief
+ * 解析命令行参数。 [-t|--threads N] 指定生成时使用的线程数。给出 --in
+ * 时进入批处理模式： --in 为输入地图， --gens 为生成代数， --out 为输出地图，
+ * --engine 与 --boundary 选择引擎与边界模式， --detect 开启周期检测，不显示地图、不等待输入。 --bench
+ * 运行基准测试， --check 运行差分测试。 --rule 指定规则，只在这里解析一次；基准测试中随即用
+ * set_rule 设置，批处理模式中由 run_batch 在选定引擎与边界后设置，覆盖地图文件中的规则。
+ *
+ * @param argc 参数个数
+ * @param argv 参数列表
+ * @return int 成功为1，参数错误为0
+ */
+int parse_options(int argc, char *argv[]) {
+  int n = 1, ok = 1;
+  for (int i = 1; i < argc && ok; ++i) {
+    if ((strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--threads") == 0) &&
+        i + 1 < argc) {
+      n = atoi(argv[++i]);
+      if (n <= 0 || n > TMAX) {
+        printf("error: thread count must be between 1 and %d\n", TMAX);
+        return 0;
+      }
+    } else if (strcmp(argv[i], "--bench") == 0) {
+      bench = 1;
+    } else if (strcmp(argv[i], "--check") == 0) {
+      check = 1;
+    } else if (strcmp(argv[i], "--rule") == 0 && i + 1 < argc) {
+      ok = parse_rule(argv[++i], &batch_birth, &batch_survive);
+    } else if (strcmp(argv[i], "--in") == 0 && i + 1 < argc) {
+      batch_in = argv[++i];
+    } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+      batch_out = argv[++i];
+    } else if (strcmp(argv[i], "--detect") == 0) {
+      detect = 1;
+    } else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+      batch_stats = argv[++i];
+    } else if (strcmp(argv[i], "--gens") == 0 && i + 1 < argc) {
+      char *end;
+      batch_gens = strtoll(argv[++i], &end, 10);
+      ok = *end == '\0' && batch_gens >= 0 && batch_gens <= GENS_MAX;
+    } else if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+      batch_engine = argv[++i];
+      ok = strcmp(batch_engine, "bitwise") == 0 ||
+           strcmp(batch_engine, "lut") == 0 ||
+           strcmp(batch_engine, "hashlife") == 0;
+    } else if (strcmp(argv[i], "--boundary") == 0 && i + 1 < argc) {
+      batch_boundary = argv[++i];
+      ok = strcmp(batch_boundary, "dead") == 0 ||
+           strcmp(batch_boundary, "infinite") == 0 ||
+           strcmp(batch_boundary, "torus") == 0;
+    } else {
+      ok = 0;
+    }
+  }
+  if (!ok || bench + check + (batch_in != NULL) > 1 ||
+      (batch_in == NULL && (batch_out != NULL || batch_stats != NULL ||
+                            batch_gens != 0 || detect ||
+                            batch_engine != NULL || batch_boundary != NULL))) {
+    printf("usage: %s [-t|--threads N]\n", argv[0]);
+    printf("       %s --in FILE [--gens N] [--out FILE] [--stats FILE.csv] "
+           "[--engine bitwise|lut|hashlife] [--boundary dead|infinite|torus] "
+           "[--rule B3/S23] [--detect] [-t|--threads N]\n",
+           argv[0]);
+    printf("       %s --bench [--rule B3/S23] [-t|--threads N]\n", argv[0]);
+    printf("       %s --check [-t|--threads N]\n", argv[0]);
+    return 0;
+  }
+  if (batch_birth >= 0 && batch_in == NULL) {
+    set_rule(batch_birth, batch_survive);
+  }
+  start_workers(n);
+  return 1;
+}
+
+/**
+ * @brief
+ * 连续生成 gens 代。 HashLife 引擎一次前进 gens 代，再把地图范围内的细胞写回地图；其他引擎逐代调用
+ * generate_next_status
+ * ，一旦检测到地图已灭绝、成为静物或进入振荡，就直接跳过余下的整周期，只再生成不足一个周期的代数，结果与逐代生成相同。
+ * 某一代生成失败（无限平面内存不足）时停下，此时 generation 少于预期。
+ *
+ * @param gens 代数
+ * @return long long 实际计算的代数
+ */
+long long advance(long long gens) {
+  if (gens <= 0) {
+    return 0;
+  }
+  if (engine == ENGINE_HASHLIFE) {
+    hl_advance((uint64_t)gens);
+    hl_to_map();
+    generation += gens;
+    return gens;
+  }
+  long long done = 0;
+  for (long long g = 0; g < gens; ++g) {
+    if (period) {
+      long long skip = (gens - g) / period * period;
+      generation += skip, g += skip;
+      if (g == gens) {
+        break;
+      }
+    }
+    if (!generate_next_status()) {
+      break;
+    }
+    done++;
+  }
+  return done;
+}
+
+/**
+ * @brief
+ * 批处理模式：加载 batch_in ，选择引擎与边界模式，生成 batch_gens 代，保存到
+ * batch_out ，最后显示用时与每秒生成的代数、细胞数。先用最终的规则（ --rule 或文件中的规则）、引擎与边界一次检查三者是否相容（
+ * hashlife 只支持 infinite ， lut 不支持 infinite ，含 B0 的规则不支持 infinite ），不相容时报错退出；
+ * 相容时此时仍是默认的 bitwise 引擎与死亡边界，依次用 set_rule 、 choose_engine 与 set_boundary
+ * 设置都不会失败，只有无限平面内存不足时 engine_attach 会换回死亡边界，此时同样退出。给出 batch_stats 时逐代统计并写入 CSV
+ * 文件，写入出错也算失败。生成中途失败（无限平面内存不足）时不保存。
+ * 开启 LIFE_PROFILE 编译时最后显示各阶段的用时与硬件计数器。
+ *
+ * @return int 成功为0，失败为1
+ */
+int run_batch() {
+  PROF_ENTER(PROF_LOAD);
+  load_map(batch_in);
+  PROF_LEAVE(PROF_LOAD, is_map ? (double)row * col : 0);
+  if (!is_map) {
+    stop_workers();
+    return 1;
+  }
+  int birth = batch_birth >= 0 ? batch_birth : rule_birth;
+  int hashlife = batch_engine != NULL && strcmp(batch_engine, "hashlife") == 0;
+  int lut_engine = batch_engine != NULL && strcmp(batch_engine, "lut") == 0;
+  int plane =
+      batch_boundary != NULL && strcmp(batch_boundary, "infinite") == 0;
+  int infinite = hashlife || plane;
+  const char *error = NULL;
+  if (hashlife && batch_boundary != NULL && !plane) {
+    error = "hashlife only supports infinite";
+  } else if (lut_engine && infinite) {
+    error = "lut only supports dead and torus";
+  } else if ((birth & 1) && infinite) {
+    error = "B0 rules need a dead or torus boundary";
+  }
+  if (error != NULL) {
+    printf("batch: error: %s\n", error);
+    stop_workers();
+    return 1;
+  }
+  if (batch_birth >= 0) {
+    set_rule(batch_birth, batch_survive);
+  }
+  if (batch_engine != NULL) {
+    choose_engine(batch_engine);
+  }
+  if (batch_boundary != NULL) {
+    set_boundary(batch_boundary);
+  }
+  if (infinite && boundary != BOUNDARY_INFINITE) {
+    stop_workers();
+    return 1;
+  }
+  if (batch_stats != NULL) {
+    if (!open_stats_csv(batch_stats)) {
+      stop_workers();
+      return 1;
+    }
+    stats_on = 1;
+    scan_stats();
+    write_stats();
+  }
+  double start = now_seconds();
+  long long gen0 = generation;
+  long long done = advance(batch_gens);
+  double secs = now_seconds() - start;
+  int saved = generation == gen0 + batch_gens;
+  double cells = (double)row * col * (double)done;
+  char buf[LEN];
+  printf("generations = %lld, computed = %lld, time = %.3f s\n", batch_gens,
+         done, secs);
+  if (describe_history(buf)) {
+    printf("%s, stopped early\n", buf);
+  }
+  if (secs > 0) {
+    printf("%.1f generations/s, %.3e cells/s, %.3f ns/cell\n", done / secs,
+           cells / secs, cells > 0 ? secs * 1e9 / cells : 0);
+  }
+  if (!saved) {
+    printf("generation %lld reached, stopped early\n", generation);
+  } else if (batch_out != NULL) {
+    PROF_ENTER(PROF_SAVE);
+    saved = save_map(batch_out);
+    PROF_LEAVE(PROF_SAVE, (double)row * col);
+  }
+  saved &= close_stats_csv();
+#ifdef LIFE_PROFILE
+  show_profile(EMPTY);
+#endif
+  stop_workers();
+  return !saved;
+}
+
+/**
+ * @brief
+ * 按编号生成一个 n x n 的基准测试地图：0 到 2 为密度 10% 、 35% 、 50%
+ * 的随机地图（固定种子）， 3 为中央的 R-pentomino ， 4 为中央的高斯帕滑翔机枪， 5
+ * 为空地图， 6 为铺满方块的静物。
+ *
+ * @param workload 编号
+ * @param n 边长
+ * @return int 成功为1，内存不足为0
+ */
+int bench_fill(int workload, int n) {
+  static const int rpent[5][2] = {{0, 1}, {0, 2}, {1, 0}, {1, 1}, {2, 1}};
+  static const int gun[36][2] = {
+      {0, 24}, {1, 22}, {1, 24}, {2, 12}, {2, 13}, {2, 20}, {2, 21}, {2, 34},
+      {2, 35}, {3, 11}, {3, 15}, {3, 20}, {3, 21}, {3, 34}, {3, 35}, {4, 0},
+      {4, 1},  {4, 10}, {4, 16}, {4, 20}, {4, 21}, {5, 0},  {5, 1},  {5, 10},
+      {5, 14}, {5, 16}, {5, 17}, {5, 22}, {5, 24}, {6, 10}, {6, 16}, {6, 24},
+      {7, 11}, {7, 15}, {8, 12}, {8, 13}};
+  if (!clear_map(n, n)) {
+    return 0;
+  }
+  is_map = 1;
+  if (workload <= 2) {
+    static const int density[3] = {10, 35, 50};
+    for (int i = 0; i < n; ++i) {
+      for (int j = 0; j < n; ++j) {
+        if (hl_hash((uint64_t)i * n + j + 1) % 100 < (uint64_t)density[workload]) {
+          set_cell(i, j, 1);
+        }
+      }
+    }
+  } else if (workload == 3) {
+    for (int k = 0; k < 5; ++k) {
+      set_cell(n / 2 + rpent[k][0], n / 2 + rpent[k][1], 1);
+    }
+  } else if (workload == 4) {
+    for (int k = 0; k < 36; ++k) {
+      set_cell(n / 2 - 4 + gun[k][0], n / 2 - 18 + gun[k][1], 1);
+    }
+  } else if (workload == 6) {
+    for (int i = 0; i + 1 < n; i += 3) {
+      for (int j = 0; j + 1 < n; j += 3) {
+        set_run(i, j, 2);
+        set_run(i + 1, j, 2);
+      }
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief
+ * 直接设置引擎、边界模式与稀疏模式，清空 HashLife 与无限平面的状态后让引擎从地图重建。 HashLife
+ * 每次生成前进一代。供基准测试与差分测试使用，不显示任何信息。
+ *
+ * @param eng 引擎
+ * @param bnd 边界模式
+ * @param sp 是否开启稀疏模式
+ */
+void configure_engine(int eng, int bnd, int sp) {
+  hl_reset();
+  pl_reset();
+  engine = eng, boundary = bnd, sparse = sp;
+  hl_k = 0;
+  engine_attach();
+}
+
+/**
+ * @brief 取进程迄今为止的最大常驻内存。
+ *
+ * @return long long 千字节数，无法取得时为 -1
+ */
+long long peak_rss_kb() {
+#ifdef _WIN32
+  return -1;
+#else
+  struct rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru) != 0) {
+    return -1;
+  }
+#ifdef __APPLE__
+  return (long long)ru.ru_maxrss / 1024;
+#else
+  return (long long)ru.ru_maxrss;
+#endif
+#endif
+}
+
+/**
+ * @brief
+ * 基准测试模式：对每种地图、每个边长、每种引擎，连续生成直至用时达到 BENCH_TIME
+ * 秒，以 JSON 输出代数、用时、每秒代数、每秒细胞数、每细胞纳秒数与最大常驻内存。最大常驻内存为进程迄今的峰值，只增不减。
+ *
+ * @return int 成功为0，内存不足为1
+ */
+int run_bench() {
+  static const char *workloads[] = {"soup10",     "soup35", "soup50",
+                                    "rpentomino", "gun",    "empty",
+                                    "still_life"};
+  static const char *engines[] = {"bitwise",  "sparse",   "infinite",
+                                  "hashlife", "lut"};
+  static const int sizes[] = {256, 1024, 4096};
+  printf("{\n  \"kernel\": \"%s\",\n  \"threads\": %d,\n  \"results\": [",
+         kernel_name, threads);
+  int first = 1;
+  for (int w = 0; w < 7; ++w) {
+    for (int s = 0; s < 3; ++s) {
+      for (int e = 0; e < 5; ++e) {
+        if (!bench_fill(w, sizes[s])) {
+          printf("\n  ]\n}\n");
+          stop_workers();
+          return 1;
+        }
+        configure_engine(e == 3   ? ENGINE_HASHLIFE
+                         : e == 4 ? ENGINE_LUT
+                                  : ENGINE_BITWISE,
+                         e == 2 || e == 3 ? BOUNDARY_INFINITE : BOUNDARY_DEAD,
+                         e == 1);
+        long long gens = 0;
+        double start = now_seconds(), secs;
+        do {
+          generate_next_status();
+          gens++;
+          secs = now_seconds() - start;
+        } while (secs < BENCH_TIME);
+        double cells = (double)sizes[s] * sizes[s] * (double)gens;
+        printf("%s\n    {\"workload\": \"%s\", \"size\": %d, \"engine\": "
+               "\"%s\", \"generations\": %lld, \"seconds\": %.6f, "
+               "\"gens_per_s\": %.3f, \"cells_per_s\": %.6e, \"ns_per_cell\": "
+               "%.6f, \"peak_rss_kb\": %lld}",
+               first ? "" : ",", workloads[w], sizes[s], engines[e], gens, secs,
+               gens / secs, cells / secs, secs * 1e9 / cells, peak_rss_kb());
+        fflush(stdout);
+        first = 0;
+      }
+    }
+  }
+  printf("\n  ]\n}\n");
+  configure_engine(ENGINE_BITWISE, BOUNDARY_DEAD, 0);
+  stop_workers();
+  return 0;
+}
+
+/**
+ * @brief
+ * 参考实现：用 count_alive_neighbors 逐格计算一代的邻居数，再按 rule_birth 与
+ * rule_survive 决定生死，地图为每格一字节的 r x c 数组。 torus
+ * 为1时上下、左右相接：先把地图连同环绕过来的一圈边框复制到 (r + 2) x (c + 2) 的 pad
+ * 中，再在其中计数；否则边界外为死亡，直接在 g 上计数。
+ *
+ * @param g 当前一代
+ * @param out 下一代
+ * @param pad 环面时使用的缓冲，至少 (r + 2) * (c + 2) 字节
+ * @param r 行数
+ * @param c 列数
+ * @param torus 是否为环面
+ */
+void ref_step(const uint8_t *g, uint8_t *out, uint8_t *pad, int r, int c,
+              int torus) {
+  const uint8_t *s = g;
+  int sr = r, sc = c, o = 0;
+  if (torus) {
+    sr = r + 2, sc = c + 2, o = 1, s = pad;
+    for (int i = 0; i < sr; ++i) {
+      for (int j = 0; j < sc; ++j) {
+        pad[(size_t)i * sc + j] =
+            g[(size_t)((i - 1 + r) % r) * c + (j - 1 + c) % c];
+      }
+    }
+  }
+  for (int x = 0; x < r; ++x) {
+    for (int y = 0; y < c; ++y) {
+      int alive = count_alive_neighbors(s, sr, sc, x + o, y + o);
+      uint8_t self = g[(size_t)x * c + y];
+      out[(size_t)x * c + y] =
+          (uint8_t)((self ? rule_survive : rule_birth) >> alive & 1);
+    }
+  }
+}
+
+/**
+ * @brief
+ * 计算当前地图的 64 位哈希。按行逐字混合，每行最后一个字先截去多余位，因此只取决于地图内的细胞。
+ *
+ * @return uint64_t 哈希值
+ */
+uint64_t map_hash() {
+  uint64_t h = (uint64_t)row << 32 | (uint32_t)col;
+  uint64_t tail = tail_mask();
+  for (int i = 0; i < row; ++i) {
+    const uint64_t *p = row_ptr(map, i);
+    for (int w = 0; w < words; ++w) {
+      h = hl_hash(h ^ (w == words - 1 ? p[w] & tail : p[w]));
+    }
+  }
+  return h;
+}
+
+/**
+ * @brief
+ * 检查当前地图的边框与每行多余位是否全为 0 ，即 clear_halo
+ * 之后的状态。只读不写，用于加载快照与差分测试。
+ *
+ * @return int 全为 0 时为1，否则为0
+ */
+int map_clean() {
+  for (int i = -1; i <= row; ++i) {
+    const uint64_t *p = row_ptr(map, i);
+    if (i == -1 || i == row) {
+      for (int w = -1; w < stride - 1; ++w) {
+        if (p[w]) {
+          return 0;
+        }
+      }
+    } else if (p[-1] || p[words] || (p[words - 1] & ~tail_mask())) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief
+ * 以与 map_hash 相同的方法计算参考地图中一个窗口的哈希。窗口为 r x c ，左上角位于参考地图（每行
+ * gc 个字节）的 (m, m) 。
+ *
+ * @param g 参考地图
+ * @param gc 参考地图列数
+ * @param m 窗口左上角的行与列
+ * @param r 窗口行数
+ * @param c 窗口列数
+ * @return uint64_t 哈希值
+ */
+uint64_t ref_hash(const uint8_t *g, int gc, int m, int r, int c) {
+  uint64_t h = (uint64_t)r << 32 | (uint32_t)c;
+  for (int i = 0; i < r; ++i) {
+    const uint8_t *p = g + (size_t)(i + m) * gc + m;
+    for (int j = 0; j < c; j += 64) {
+      uint64_t x = 0;
+      for (int k = 0; k < 64 && j + k < c; ++k) {
+        x |= (uint64_t)p[j + k] << k;
+      }
+      h = hl_hash(h ^ x);
+    }
+  }
+  return h;
+}
+
+/**
+ * @brief
+ * 由参考地图的新旧两代求统计结果，用于检查增量统计。坐标减去四周留出的 m
+ * 格，与被测地图一致。
+ *
+ * @param g 新一代参考地图
+ * @param h 旧一代参考地图
+ * @param gr 参考地图行数
+ * @param gc 参考地图列数
+ * @param m 四周留出的格数
+ * @param st 统计结果
+ */
+void ref_stats(const uint8_t *g, const uint8_t *h, int gr, int gc, int m,
+               life_stats *st) {
+  life_stats s = {0, 0, 0, 0, 0, 0, 0, 0};
+  for (int i = 0; i < gr; ++i) {
+    for (int j = 0; j < gc; ++j) {
+      int a = h[(size_t)i * gc + j], b = g[(size_t)i * gc + j];
+      s.births += b && !a, s.deaths += a && !b;
+      if (b) {
+        life_stats one = {0, 1, 0, 0, i - m, j - m, i - m, j - m};
+        merge_stats(&s, &one);
+      }
+    }
+  }
+  *st = s;
+}
+
+/**
+ * @brief
+ * 用参考实现检查一种配置在一张地图上的结果。地图为 r x c ，内容由 fill 决定（0
+ * 为空， 1 为全满，其他为以 fill 为种子、密度 35% 的随机地图）。每代比较当前地图与参考地图的哈希；
+ * jump 为1时改为一次前进 gens 代后比较一次，其中 infinite 配置把整个无限平面转入 HashLife
+ * 四叉树前进再转回，即 fast_forward 的做法。无限平面的参考地图四周各留 gens + 2
+ * 格，保证活细胞到不了参考地图的边界。逐代检查时同时比较增量统计与由参考地图求得的统计，有限地图还检查边框与多余位为
+ * 0 ；最后把有限地图转为无限平面，比较存活数与外接矩形，模拟保存或切换边界时读到多余位的情形。不一致时报告第一个不同的细胞。
+ *
+ * @param cfg 配置编号，见 run_check
+ * @param r 行数
+ * @param c 列数
+ * @param fill 地图内容
+ * @param gens 代数
+ * @param jump 是否一次前进
+ * @return int 一致为1，不一致或内存不足为0
+ */
+int check_case(int cfg, int r, int c, int fill, int gens, int jump) {
+  static const char *names[] = {"bitwise/dead", "sparse/dead", "bitwise/torus",
+                                "sparse/torus", "infinite",    "hashlife",
+                                "lut/dead",     "lut/torus",   "lut/sparse"};
+  int infinite = cfg == 4 || cfg == 5;
+  int torus = cfg == 2 || cfg == 3 || cfg == 7 || cfg == 8;
+  int m = infinite ? gens + 2 : 0, gr = r + 2 * m, gc = c + 2 * m;
+  uint8_t *g = calloc((size_t)gr * gc, 1), *h = calloc((size_t)gr * gc, 1);
+  uint8_t *pad = malloc((size_t)(gr + 2) * (gc + 2));
+  if (g == NULL || h == NULL || pad == NULL || !clear_map(r, c)) {
+    free(g);
+    free(h);
+    free(pad);
+    printf("check: error: out of memory\n");
+    return 0;
+  }
+  is_map = 1;
+  for (int i = 0; i < r; ++i) {
+    for (int j = 0; j < c; ++j) {
+      int v = fill == 1;
+      if (fill > 1) {
+        v = hl_hash((uint64_t)fill << 40 ^ ((uint64_t)i * c + j)) % 100 < 35;
+      }
+      g[(size_t)(i + m) * gc + j + m] = (uint8_t)v;
+      if (v) {
+        set_cell(i, j, 1);
+      }
+    }
+  }
+  stats_on = cfg != 5;
+  configure_engine(cfg == 5   ? ENGINE_HASHLIFE
+                   : cfg >= 6 ? ENGINE_LUT
+                              : ENGINE_BITWISE,
+                   infinite ? BOUNDARY_INFINITE
+                   : torus  ? BOUNDARY_TORUS
+                            : BOUNDARY_DEAD,
+                   cfg == 1 || cfg == 3 || cfg == 8);
+  int ok = 1;
+  for (int t = 1; t <= gens && ok; ++t) {
+    ref_step(g, h, pad, gr, gc, torus);
+    uint8_t *s = g;
+    g = h, h = s;
+    if (jump && t < gens) {
+      continue;
+    }
+    if (jump && cfg == 4) {
+      hl_from_plane();
+      hl_advance((uint64_t)gens);
+      if (hl_to_plane()) {
+        pl_to_map();
+      }
+      hl_reset();
+    } else if (jump) {
+      advance(gens);
+    } else {
       generate_next_status();
-      print_map();
-    } else if (strcmp(buff, RUN) == 0 && strcmp(filename, EMPTY) == 0) {
-      auto_run();
-    } else if (strcmp(buff, EXIT) == 0 && strcmp(filename, EMPTY) == 0) {
-      printf("This command is only available in auto_run mode.\n");
-    } else if (strcmp(buff, QUIT) == 0 && strcmp(filename, EMPTY) == 0) {
-      printf("This command is only available in design mode.\n");
-    } else if (strcmp(buff, PRINT) == 0 && strcmp(filename, EMPTY) == 0) {
-      print_map();
-    } else if (strcmp(buff, END) == 0 && strcmp(filename, EMPTY) == 0) {
-      printf("See you next time!\n");
+    }
+    if (history_on && !period && board_hash != full_hash(0)) {
+      printf("check: MISMATCH %s kernel=%s threads=%d board=%dx%d fill=%d "
+             "generation=%d incremental hash differs from a full rehash\n",
+             names[cfg], kernel_name, threads, r, c, fill, t);
+      ok = 0;
+      break;
+    }
+    life_stats want;
+    ref_stats(g, h, gr, gc, m, &want);
+    want.generation = stats.generation;
+    if (!jump && stats_on && memcmp(&want, &stats, sizeof(life_stats)) != 0) {
+      printf("check: MISMATCH %s kernel=%s threads=%d board=%dx%d fill=%d "
+             "generation=%d stats: population=%lld births=%lld deaths=%lld "
+             "box=%lld,%lld,%lld,%lld, expected %lld %lld %lld "
+             "%lld,%lld,%lld,%lld\n",
+             names[cfg], kernel_name, threads, r, c, fill, t, stats.population,
+             stats.births, stats.deaths, stats.top, stats.left, stats.bottom,
+             stats.right, want.population, want.births, want.deaths, want.top,
+             want.left, want.bottom, want.right);
+      ok = 0;
+      break;
+    }
+    if (!infinite && !map_clean()) {
+      printf("check: MISMATCH %s kernel=%s threads=%d board=%dx%d fill=%d "
+             "generation=%d halo or padding bits past col are set\n",
+             names[cfg], kernel_name, threads, r, c, fill, t);
+      ok = 0;
+      break;
+    }
+    if (map_hash() == ref_hash(g, gc, m, r, c)) {
+      continue;
+    }
+    ok = 0;
+    for (int i = 0; i < r; ++i) {
+      for (int j = 0; j < c; ++j) {
+        int want = g[(size_t)(i + m) * gc + j + m];
+        if (get_cell(i, j) != want) {
+          printf("check: MISMATCH %s kernel=%s threads=%d board=%dx%d fill=%d "
+                 "generation=%d cell=(%d, %d) expected=%d got=%d\n",
+                 names[cfg], kernel_name, threads, r, c, fill, t, i, j, want,
+                 !want);
+          i = r;
+          break;
+        }
+      }
+    }
+  }
+  if (ok && !infinite && !(rule_birth & 1)) {
+    life_stats want;
+    ref_stats(g, g, gr, gc, m, &want);
+    stats_on = 1;
+    configure_engine(ENGINE_BITWISE, BOUNDARY_INFINITE, 0);
+    scan_stats();
+    if (stats.population != want.population ||
+        (want.population &&
+         (stats.left != want.left || stats.right != want.right))) {
+      printf("check: MISMATCH %s kernel=%s threads=%d board=%dx%d fill=%d "
+             "converted to infinite: population=%lld columns %lld to %lld, "
+             "expected %lld columns %lld to %lld\n",
+             names[cfg], kernel_name, threads, r, c, fill, stats.population,
+             stats.left, stats.right, want.population, want.left, want.right);
+      ok = 0;
+    }
+  }
+  free(g);
+  free(h);
+  free(pad);
+  return ok;
+}
+
+/**
+ * @brief
+ * 检查灭绝、静物与振荡检测：在一张小地图上放置图案，先逐代生成 gens
+ * 代（关闭检测），记下结果，再打开检测用 advance 前进同样的代数，要求检测到预期的周期与起始代数，且跳过整周期后的地图与逐代生成的相同。图案依次为空地图、
+ * 单个细胞、方块、闪光灯、一代后变为方块的三个细胞、环面上的滑翔机（ 8x8 的环面上周期为 32 ）。
+ *
+ * @param pat 图案编号
+ * @param cfg 配置编号，见 run_check
+ * @param gens 代数
+ * @return int 一致为1，否则为0
+ */
+int check_detect(int pat, int cfg, int gens) {
+  static const int cells[][6][2] = {
+      {{-1, 0}},
+      {{3, 3}, {-1, 0}},
+      {{1, 1}, {1, 2}, {2, 1}, {2, 2}, {-1, 0}},
+      {{2, 1}, {2, 2}, {2, 3}, {-1, 0}},
+      {{1, 1}, {1, 2}, {2, 1}, {-1, 0}},
+      {{0, 1}, {1, 2}, {2, 0}, {2, 1}, {2, 2}, {-1, 0}}};
+  static const int want[][3] = {{1, 0, 1}, {1, 1, 1},  {1, 0, 0},
+                                {2, 0, 0}, {1, 1, 0}, {32, 0, 0}};
+  int torus = cfg == 2 || cfg == 3 || cfg == 7 || cfg == 8;
+  if (pat == 5 && !torus) {
+    return 1;
+  }
+  uint64_t hash[2];
+  for (int pass = 0; pass < 2; ++pass) {
+    if (!clear_map(8, 8)) {
+      printf("check: error: out of memory\n");
+      return 0;
+    }
+    is_map = 1;
+    for (int k = 0; cells[pat][k][0] >= 0; ++k) {
+      set_cell(cells[pat][k][0], cells[pat][k][1], 1);
+    }
+    configure_engine(cfg >= 6 ? ENGINE_LUT : ENGINE_BITWISE,
+                     torus ? BOUNDARY_TORUS : BOUNDARY_DEAD,
+                     cfg == 1 || cfg == 3 || cfg == 8);
+    if (pass == 0) {
+      history_on = 0;
+      for (int t = 0; t < gens; ++t) {
+        generate_next_status();
+      }
+    } else {
+      advance(gens);
+    }
+    hash[pass] = map_hash();
+  }
+  if (period != want[pat][0] || settled_at != want[pat][1] ||
+      extinct != want[pat][2] || generation != gens || hash[0] != hash[1]) {
+    printf("check: MISMATCH detect pattern=%d cfg=%d period=%d settled_at=%lld "
+           "extinct=%d generation=%lld same_board=%d\n",
+           pat, cfg, period, settled_at, extinct, generation,
+           hash[0] == hash[1]);
+    return 0;
+  }
+  return 1;
+}
+
+/**
+ * @brief
+ * 检查周期检测在哈希碰撞时不会误跳：在 16x16 的地图中央放置 R-pentomino ，第 5
+ * 代时把历史表中本代的项改写为第 2 代，模拟与第 2 代的哈希碰撞，再用 advance
+ * 前进到 gens 代，要求逐字确认后不认定周期，结果与关闭检测逐代生成的相同。
+ *
+ * @param cfg 配置编号，见 run_check
+ * @param gens 代数
+ * @return int 一致为1，否则为0
+ */
+int check_collision(int cfg, int gens) {
+  int torus = cfg == 2 || cfg == 3 || cfg == 7 || cfg == 8;
+  uint64_t hash[2];
+  for (int pass = 0; pass < 2; ++pass) {
+    if (!clear_map(16, 16)) {
+      printf("check: error: out of memory\n");
+      return 0;
+    }
+    is_map = 1;
+    set_cell(7, 8, 1), set_cell(7, 9, 1), set_cell(8, 7, 1);
+    set_cell(8, 8, 1), set_cell(9, 8, 1);
+    configure_engine(cfg >= 6 ? ENGINE_LUT : ENGINE_BITWISE,
+                     torus ? BOUNDARY_TORUS : BOUNDARY_DEAD,
+                     cfg == 1 || cfg == 3 || cfg == 8);
+    if (pass == 0) {
+      history_on = 0;
+      advance(gens);
+    } else {
+      advance(5);
+      for (int i = 0; i < HISTORY_SLOTS; ++i) {
+        if (history_gen[i] == generation && history_hash[i] == board_hash) {
+          history_gen[i] = generation - 3;
+        }
+      }
+      record_history();
+      advance(gens - 5);
+    }
+    hash[pass] = map_hash();
+  }
+  if (period == 3 || generation != gens || hash[0] != hash[1]) {
+    printf("check: MISMATCH collision cfg=%d period=%d generation=%lld "
+           "same_board=%d\n",
+           cfg, period, generation, hash[0] == hash[1]);
+    return 0;
+  }
+  return 1;
+}
+
+/**
+ * @brief
+ * 差分测试模式：以 count_alive_neighbors 逐格计算的参考实现（ ref_step ）为准，对 B3/S23 与几种其他规则，检查每种内核下的按位并行引擎与稀疏模式（死亡与环面边界）、查表引擎、无限平面与
+ * HashLife 引擎（出生条件含 0 的规则只检查前者）。地图包括 1x1 、 1xN 、 Nx1 、字边界两侧的宽度与普通大小，内容为空、全满与随机，每种各运行
+ * CHECK_GENS 代（其他规则减半）；另有 CHECK_LONG 代的长时间运行，以及 HashLife 一次前进多代。检查期间开启周期检测，以便同时检查增量哈希与 check_detect 。
+ *
+ * @return int 全部一致为0，否则为1
+ */
+int run_check() {
+  static const int sizes[][2] = {
+      {1, 1},   {1, 2},   {1, 63},  {1, 64},  {1, 65},   {1, 200},  {2, 1},
+      {63, 1},  {64, 1},  {65, 1},  {200, 1}, {2, 2},    {3, 3},    {5, 7},
+      {63, 63}, {64, 64}, {65, 65}, {64, 128}, {129, 65}, {100, 130}};
+  static const char *rules[] = {"B3/S23",      "B36/S23", "B3678/S34678",
+                                "B2/S",        "B1357/S1357", "B0/S8"};
+  int n = (int)(sizeof(sizes) / sizeof(sizes[0]));
+  long long cases = 0, failed = 0;
+  int level = kernel_level;
+  detect = 1;
+  for (int ru = 0; ru < 6; ++ru) {
+    int birth, survive;
+    parse_rule(rules[ru], &birth, &survive);
+    configure_engine(ENGINE_BITWISE, BOUNDARY_DEAD, 0);
+    set_rule(birth, survive);
+    int gens = ru == 0 ? CHECK_GENS : CHECK_GENS / 2;
+    const char *seen[3] = {NULL, NULL, NULL};
+    for (int lv = 0; lv < 3; ++lv) {
+      use_kernels(lv);
+      if ((seen[0] != NULL && strcmp(seen[0], kernel_name) == 0) ||
+          (seen[1] != NULL && strcmp(seen[1], kernel_name) == 0)) {
+        continue;
+      }
+      seen[lv] = kernel_name;
+      for (int cfg = 0; cfg < 4; ++cfg) {
+        for (int s = 0; s < n; ++s) {
+          for (int fill = 0; fill < 3; ++fill) {
+            cases++;
+            failed += !check_case(cfg, sizes[s][0], sizes[s][1],
+                                  fill < 2 ? fill : s + 2, gens, 0);
+          }
+        }
+        if (ru == 0) {
+          cases++;
+          failed += !check_case(cfg, 100, 130, 99, CHECK_LONG, 0);
+        }
+      }
+    }
+    use_kernels(level);
+    for (int cfg = 6; cfg < 9; ++cfg) {
+      for (int s = 0; s < n; ++s) {
+        for (int fill = 0; fill < 3; ++fill) {
+          cases++;
+          failed += !check_case(cfg, sizes[s][0], sizes[s][1],
+                                fill < 2 ? fill : s + 2, gens, 0);
+        }
+      }
+      if (ru == 0) {
+        cases++;
+        failed += !check_case(cfg, 100, 130, 99, CHECK_LONG, 0);
+      }
+    }
+    for (int cfg = 4; cfg < 6 && !(birth & 1); ++cfg) {
+      for (int s = 0; s < n; ++s) {
+        for (int fill = 0; fill < 3; ++fill) {
+          cases++;
+          failed += !check_case(cfg, sizes[s][0], sizes[s][1],
+                                fill < 2 ? fill : s + 2, gens / 2, 0);
+        }
+      }
+      cases++;
+      failed += !check_case(cfg, 40, 60, 98, CHECK_LONG / 10, 0);
+    }
+    for (int cfg = 4; cfg < 6 && !(birth & 1); ++cfg) {
+      cases++;
+      failed += !check_case(cfg, 40, 60, 97, CHECK_LONG / 10, 1);
+    }
+    if (ru == 0) {
+      for (int pat = 0; pat < 6; ++pat) {
+        for (int cfg = 0; cfg < 9; ++cfg) {
+          if (cfg != 4 && cfg != 5) {
+            cases++;
+            failed += !check_detect(pat, cfg, 1000);
+          }
+        }
+      }
+      for (int cfg = 0; cfg < 9; ++cfg) {
+        if (cfg != 4 && cfg != 5) {
+          cases++;
+          failed += !check_collision(cfg, 200);
+        }
+      }
+    }
+    printf("check: rule %s done\n", rules[ru]);
+  }
+  configure_engine(ENGINE_BITWISE, BOUNDARY_DEAD, 0);
+  set_rule(1 << 3, 1 << 2 | 1 << 3);
+  stats_on = 0, detect = 0;
+  printf("check: %lld cases, %lld failed\n", cases, failed);
+  stop_workers();
+  return failed != 0;
+}
+
+/**
+ * @brief 线程池屏障。所有 threads 个线程都调用后才一起返回，可重复使用。
+ *
+ */
+void barrier_wait() {
+  pthread_mutex_lock(&pool_lock);
+  unsigned phase = pool_phase;
+  if (++pool_count == threads) {
+    pool_count = 0;
+    pool_phase++;
+    pthread_cond_broadcast(&pool_cond);
+  } else {
+    while (phase == pool_phase) {
+      pthread_cond_wait(&pool_cond, &pool_lock);
+    }
+  }
+  pthread_mutex_unlock(&pool_lock);
+}
+
+/**
+ * @brief 工作线程主循环。在屏障处等待任务，执行后再次在屏障处汇合。
+ *
+ * @param arg 线程编号
+ * @return void* 无
+ */
+void *worker_main(void *arg) {
+  int id = (int)(intptr_t)arg;
+  while (1) {
+    barrier_wait();
+    if (pool_job == NULL) {
       break;
-    } else if (strcmp(buff, EMPTY) == 0) {
+    }
+    pool_job(id);
+    barrier_wait();
+  }
+  return NULL;
+}
+
+/**
+ * @brief 创建线程池。主线程作为 0 号线程参与计算，另建 n - 1
+ * 个工作线程。创建失败时退出程序。
+ *
+ * @param n 线程总数
+ */
+void start_workers(int n) {
+  threads = n;
+  if (n == 1) {
+    return;
+  }
+  workers = malloc(sizeof(pthread_t) * (n - 1));
+  for (int i = 1; i < n; ++i) {
+    if (workers == NULL ||
+        pthread_create(&workers[i - 1], NULL, worker_main,
+                       (void *)(intptr_t)i) != 0) {
+      printf("error: failed to create worker threads\n");
+      exit(1);
+    }
+  }
+}
+
+/**
+ * @brief 通知工作线程退出并等待其结束。
+ *
+ */
+void stop_workers() {
+  if (threads == 1) {
+    return;
+  }
+  pool_job = NULL;
+  barrier_wait();
+  for (int i = 1; i < threads; ++i) {
+    pthread_join(workers[i - 1], NULL);
+  }
+  free(workers);
+  workers = NULL, threads = 1;
+}
+
+/**
+ * @brief 让所有线程执行同一任务，全部完成后返回。单线程时直接调用。
+ *
+ * @param job 任务函数，参数为线程编号
+ */
+void pool_run(void (*job)(int)) {
+  if (threads == 1) {
+    job(0);
+    return;
+  }
+  pool_job = job;
+  barrier_wait();
+  job(0);
+  barrier_wait();
+}
+
+/**
+ * @brief
+ * 把当前地图的边框与每行多余位清为 0
+ * ，即死亡边界下的边框。环面边界生成时会在此基础上重新填写，保存快照前也调用此函数。
+ *
+ */
+void clear_halo() {
+  for (int i = 0; i < row; ++i) {
+    uint64_t *p = row_ptr(map, i);
+    p[words - 1] &= tail_mask();
+    p[-1] = p[words] = 0;
+  }
+  size_t bytes = (size_t)stride * sizeof(uint64_t);
+  memset(row_ptr(map, -1) - 1, 0, bytes);
+  memset(row_ptr(map, row) - 1, 0, bytes);
+}
+
+/**
+ * @brief
+ * 生成前填写当前地图的边框。死亡边界时边框全为 0 。环面边界时左边框字的最高位为该行最后一个细胞，第
+ * col 列（最后一个字的多余位或右边框字的最低位）为该行第一个细胞，上下边框行分别复制最后一行与第一行，四角随之相接。这样计算内核无需取模或判断边界，只有边框的
+ * O(row + col) 个字需要每代重写。
+ *
+ */
+void fill_halo() {
+  clear_halo();
+  if (boundary != BOUNDARY_TORUS) {
+    return;
+  }
+  int last = (col - 1) & 63;
+  for (int i = 0; i < row; ++i) {
+    uint64_t *p = row_ptr(map, i);
+    p[-1] = (p[words - 1] >> last & 1) << 63;
+    p[col >> 6] |= (p[0] & 1) << (col & 63);
+  }
+  size_t bytes = (size_t)stride * sizeof(uint64_t);
+  memcpy(row_ptr(map, -1) - 1, row_ptr(map, row - 1) - 1, bytes);
+  memcpy(row_ptr(map, row) - 1, row_ptr(map, 0) - 1, bytes);
+}
+
+/**
+ * @brief
+ * 计算第 id 个横向条带的下一代，写入下一代缓冲。地图按行平均分为 threads
+ * 个条带。逐行滑动计算：每行的横向三格和只计算一次，保存在该线程三行轮换的行和缓冲中，供上下相邻行共用，每个细胞只需三次按位加法。行内计算使用
+ * select_kernels 选出的 SIMD 或标量函数。每行最后一个字截去超出 col
+ * 的位，保证边框与多余位始终为死亡。尚未检测到周期时，算完一行随即更新该行的哈希；开启统计时随即统计该行。
+ *
+ * @param id 线程编号
+ */
+void generate_band(int id) {
+  int r0 = (int)((long long)row * id / threads);
+  int r1 = (int)((long long)row * (id + 1) / threads);
+  hash_delta[id] = 0;
+  memset(&band_stats[id], 0, sizeof(life_stats));
+  if (r0 >= r1) {
+    return;
+  }
+  int n = words;
+  uint64_t tail = tail_mask();
+  uint64_t *prev = row_sums + sums_stride * id;
+  uint64_t *cur = prev + 2 * n, *next = prev + 4 * n;
+  row_sum_fn(row_ptr(map, r0 - 1), prev, prev + n, n);
+  row_sum_fn(row_ptr(map, r0), cur, cur + n, n);
+  PROF_START(band);
+  for (int i = r0; i < r1; ++i) {
+    PROF_SAMPLE(lap, i - r0);
+    row_sum_fn(row_ptr(map, i + 1), next, next + n, n);
+    PROF_LAP(id, PROF_SUM, lap);
+    uint64_t *dst = row_ptr(next_map, i);
+    row_rule_fn(prev, prev + n, cur, cur + n, next, next + n, row_ptr(map, i),
+                dst, n);
+    dst[n - 1] &= tail;
+    PROF_LAP(id, PROF_RULE, lap);
+    if (history_on && !period) {
+      hash_row(row_ptr(map, i), dst, i, &hash_delta[id]);
+    }
+    if (stats_on) {
+      stats_row_fn(row_ptr(map, i), dst, n, i, 0, tail, &band_stats[id]);
+    }
+    PROF_LAP(id, PROF_REST, lap);
+    uint64_t *t = prev;
+    prev = cur, cur = next, next = t;
+  }
+  PROF_BAND(id, band, r1 - r0, 64.0 * n * (r1 - r0));
+}
+
+/**
+ * @brief
+ * 生成下一代细胞图。按位并行引擎中各线程只读当前地图、只写下一代缓冲，因此一次屏障汇合后即可交换两者指针，无需复制。
+ * HashLife 引擎一次前进 2 的 hl_k 次方代，再把地图范围内的细胞写回地图。
+ * 环面边界下交换后的地图是两代前填写过边框的缓冲，稀疏模式跳过的区块更保留着当时写入多余位的环绕细胞，因此交换后清除边框与多余位，使其他部分（保存、转换边界或引擎、统计）读到的地图总是干净的。
+ * 刚加载二进制快照时当前地图就是映射的文件，第一次交换后把下一代缓冲换回内存区并解除映射。
+ * 最后合并各线程的哈希变化量，检测灭绝、静物与振荡；开启统计时合并各线程的统计。
+ * 无限平面内存不足时不前进。
+ *
+ * @return int 前进了为1，没有地图或内存不足为0
+ */
+int generate_next_status() {
+  if (!is_map) {
+    is_map_error();
+    return 0;
+  }
+  PROF_ENTER(PROF_STEP);
+  if (engine == ENGINE_HASHLIFE) {
+    hl_advance((uint64_t)1 << hl_k);
+    hl_to_map();
+    generation += (long long)1 << hl_k;
+    stats_valid = 0;
+    PROF_LEAVE(PROF_STEP, (double)row * col * (double)((long long)1 << hl_k));
+    return 1;
+  }
+  if (boundary == BOUNDARY_INFINITE) {
+    if (!pl_step()) {
+      PROF_LEAVE(PROF_STEP, 0);
+      return 0;
+    }
+    pl_to_map();
+    generation++;
+    if (stats_on) {
+      finish_stats();
+    }
+    PROF_LEAVE(PROF_STEP, (double)row * col);
+    return 1;
+  }
+  fill_halo();
+  if (sparse) {
+    pool_run(generate_sparse_band);
+    long long total = (long long)tile_rows * tile_cols, work = 0;
+    for (int i = 0; i < threads; ++i) {
+      work += tile_work[i];
+    }
+    tiles_computed = work, tiles_skipped = total - work;
+    tiles_computed_sum += work, tiles_skipped_sum += total - work;
+    uint8_t *f = tile_last;
+    tile_last = tile_next, tile_next = f;
+  } else {
+    pool_run(engine == ENGINE_LUT ? generate_lut_band : generate_band);
+  }
+  uint64_t *t = map;
+  map = next_map, next_map = t;
+  if (boundary == BOUNDARY_TORUS) {
+    clear_halo();
+  }
+  generation++;
+  if (history_on && !period) {
+    for (int i = 0; i < threads; ++i) {
+      board_hash ^= hash_delta[i];
+    }
+    record_history();
+  }
+  if (stats_on) {
+    finish_stats();
+  }
+  if (snapshot != NULL && next_map != arena) {
+    next_map = arena;
+    unmap_snapshot();
+    mark_all_tiles();
+  }
+  PROF_LEAVE(PROF_STEP, (double)row * col);
+  return 1;
+}
+
+/**
+ * @brief
+ * 计算一个区块的下一代，写入下一代缓冲。与 generate_band 相同的滑动行和算法，只是每行只有一个字；查表引擎改用
+ * lut_rows 。逐行比较新旧两代，统计变化并更新地图哈希；开启统计时把该区块的统计记入 tile_stats 。
+ *
+ * @param ty 区块行号
+ * @param tx 区块列号，即字号
+ * @param delta 地图哈希变化量
+ * @return int 区块内有变化的字数
+ */
+int generate_tile(int ty, int tx, uint64_t *delta) {
+  int r0 = ty * TILE, r1 = r0 + TILE < row ? r0 + TILE : row;
+  uint64_t tail = tx == words - 1 ? tail_mask() : ~(uint64_t)0;
+  int changes = 0;
+  life_stats *st = &tile_stats[(size_t)ty * tile_cols + tx];
+  if (stats_on) {
+    memset(st, 0, sizeof(life_stats));
+  }
+  if (engine == ENGINE_LUT) {
+    lut_rows(r0, r1, tx, tx + 1);
+    for (int i = r0; i < r1; ++i) {
+      changes += hash_word(row_ptr(map, i), row_ptr(next_map, i), i, tx, delta);
+      if (stats_on) {
+        stats_row_fn(row_ptr(map, i) + tx, row_ptr(next_map, i) + tx, 1, i,
+                     64ll * tx, tail, st);
+      }
+    }
+    return changes;
+  }
+  uint64_t s0[3], s1[3];
+  int prev = 0, cur = 1, next = 2;
+  row_sum(row_ptr(map, r0 - 1) + tx, &s0[prev], &s1[prev], 1);
+  row_sum(row_ptr(map, r0) + tx, &s0[cur], &s1[cur], 1);
+  for (int i = r0; i < r1; ++i) {
+    row_sum(row_ptr(map, i + 1) + tx, &s0[next], &s1[next], 1);
+    const uint64_t *src = row_ptr(map, i) + tx;
+    uint64_t *dst = row_ptr(next_map, i) + tx;
+    rule_fn(&s0[prev], &s1[prev], &s0[cur], &s1[cur], &s0[next], &s1[next],
+             src, dst, 1);
+    *dst &= tail;
+    changes += hash_word(row_ptr(map, i), row_ptr(next_map, i), i, tx, delta);
+    if (stats_on) {
+      stats_row_fn(src, dst, 1, i, 64ll * tx, tail, st);
+    }
+    int t = prev;
+    prev = cur, cur = next, next = t;
+  }
+  return changes;
+}
+
+/**
+ * @brief
+ * 稀疏模式下计算第 id 个条带（按区块行划分）的下一代。区块自身及相邻八个区块在上一代都没有变化时，该区块本代也不会变化，直接跳过；此时下一代缓冲中保存的上上代内容与当前相同，无需复制。环面模式下相邻区块跨边相接。
+ *
+ * @param id 线程编号
+ */
+void generate_sparse_band(int id) {
+  int t0 = (int)((long long)tile_rows * id / threads);
+  int t1 = (int)((long long)tile_rows * (id + 1) / threads);
+  long long work = 0;
+  int torus = boundary == BOUNDARY_TORUS;
+  hash_delta[id] = 0;
+  for (int ty = t0; ty < t1; ++ty) {
+    for (int tx = 0; tx < tile_cols; ++tx) {
+      int active = 0;
+      for (int i = ty - 1; i <= ty + 1 && !active; ++i) {
+        for (int j = tx - 1; j <= tx + 1; ++j) {
+          int ii = i, jj = j;
+          if (torus) {
+            ii = ii < 0 ? tile_rows - 1 : ii == tile_rows ? 0 : ii;
+            jj = jj < 0 ? tile_cols - 1 : jj == tile_cols ? 0 : jj;
+          }
+          if (ii >= 0 && ii < tile_rows && jj >= 0 && jj < tile_cols &&
+              tile_last[(size_t)ii * tile_cols + jj]) {
+            active = 1;
+            break;
+          }
+        }
+      }
+      size_t t = (size_t)ty * tile_cols + tx;
+      tile_next[t] = active && generate_tile(ty, tx, &hash_delta[id]) > 0;
+      if (!active && stats_on) {
+        tile_stats[t].births = 0;
+      }
+      work += active;
+    }
+  }
+  tile_work[id] = work;
+}
+
+/**
+ * @brief
+ * 把所有区块标记为有变化，使稀疏模式下一代计算全部区块。地图被整体改写（加载、设计、切换引擎或开启稀疏模式）后调用，此时下一代缓冲与当前地图不再相差一代。
+ *
+ */
+void mark_all_tiles() {
+  if (tile_last != NULL) {
+    memset(tile_last, 1, (size_t)tile_rows * tile_cols);
+  }
+}
+
+/**
+ * @brief 开启或关闭稀疏模式，并显示区块计数。
+ *
+ * @param arg on 、 off 或空
+ */
+void set_sparse(char *arg) {
+  if (strcmp(arg, "on") == 0) {
+    if (!sparse) {
+      sparse = 1;
+      tiles_computed = tiles_skipped = 0;
+      tiles_computed_sum = tiles_skipped_sum = 0;
+      mark_all_tiles();
+    }
+  } else if (strcmp(arg, "off") == 0) {
+    sparse = 0;
+  } else if (strcmp(arg, EMPTY) != 0) {
+    printf("set_sparse: error: expected on or off\n");
+    return;
+  }
+  printf("sparse = %s, tiles = %lld\n", sparse ? "on" : "off",
+         (long long)tile_rows * tile_cols);
+  printf("last generation: computed = %lld, skipped = %lld\n", tiles_computed,
+         tiles_skipped);
+  printf("total: computed = %lld, skipped = %lld\n", tiles_computed_sum,
+         tiles_skipped_sum);
+}
+
+/**
+ * @brief 开启或关闭灭绝、静物与振荡检测，并显示检测结果。开启时从当前一代重新开始记录。
+ *
+ * @param arg on 、 off 或空
+ */
+void set_detect(char *arg) {
+  if (strcmp(arg, "on") == 0 || strcmp(arg, "off") == 0) {
+    int on = strcmp(arg, "on") == 0;
+    if (on != detect) {
+      detect = on;
+      reset_history();
+    }
+  } else if (strcmp(arg, EMPTY) != 0) {
+    printf("set_detect: error: expected on or off\n");
+    return;
+  }
+  char buf[LEN];
+  printf("detect = %s%s\n", detect ? "on" : "off",
+         detect && !history_on && is_map
+             ? " (not available on the infinite plane or with hashlife)"
+             : "");
+  if (describe_history(buf)) {
+    printf("%s\n", buf);
+  }
+}
+
+/**
+ * @brief
+ * 显示或选择模拟引擎。无参数时显示当前引擎；参数为 bitwise 、 lut 或 hashlife
+ * ，后者可再跟一个整数 k ，表示每次生成前进 2 的 k 次方代， 2 的 k 次方不超过 GENS_MAX 。 lut
+ * 只支持死亡与环面边界。
+ *
+ * @param arg 命令参数
+ */
+void choose_engine(char *arg) {
+  char name[LEN], rest[LEN];
+  get_command(arg, name, rest);
+  if (strcmp(name, EMPTY) == 0) {
+    if (engine == ENGINE_HASHLIFE) {
+      printf("engine = hashlife, 2^%d generations per step, %u nodes\n", hl_k,
+             hl_count);
+    } else if (engine == ENGINE_LUT) {
+      printf("engine = lut, 2x2 cells per lookup, threads = %d\n", threads);
+    } else {
+      printf("engine = bitwise, kernel = %s, threads = %d\n", kernel_name,
+             threads);
+    }
+    return;
+  }
+  int k = 0;
+  if (strcmp(name, "bitwise") == 0 && strcmp(rest, EMPTY) == 0) {
+    engine = ENGINE_BITWISE;
+    hl_reset();
+    engine_attach();
+  } else if (strcmp(name, "lut") == 0 && strcmp(rest, EMPTY) == 0) {
+    if (boundary == BOUNDARY_INFINITE) {
+      printf("choose_engine: error: lut only supports dead and torus\n");
+      return;
+    }
+    engine = ENGINE_LUT;
+    engine_attach();
+  } else if (strcmp(name, "hashlife") == 0 &&
+             (strcmp(rest, EMPTY) == 0 ||
+              (sscanf(rest, "%d", &k) == 1 && k >= 0 && k < 60 &&
+               (1ll << k) <= GENS_MAX))) {
+    if (rule_birth & 1) {
+      printf("choose_engine: error: hashlife does not support B0 rules\n");
+      return;
+    }
+    hl_k = k;
+    if (engine != ENGINE_HASHLIFE) {
+      engine = ENGINE_HASHLIFE;
+      boundary = BOUNDARY_INFINITE;
+      pl_reset();
+      engine_attach();
+    }
+  } else {
+    printf("choose_engine: error: unknown engine: %s\n", arg);
+    return;
+  }
+  choose_engine(EMPTY);
+}
+
+/**
+ * @brief
+ * 地图被加载、重新设计、切换引擎或边界模式后调用，让当前引擎从地图重建其内部状态。地图外原有的细胞不会保留。
+ * 无限平面内存不足时换成死亡边界，地图本身不受影响。
+ *
+ */
+void engine_attach() {
+  if (engine == ENGINE_HASHLIFE && is_map) {
+    hl_from_map();
+  } else if (boundary == BOUNDARY_INFINITE && is_map && !pl_from_map()) {
+    boundary = BOUNDARY_DEAD;
+    printf("infinite: error: boundary = dead\n");
+  }
+  mark_all_tiles();
+  reset_history();
+  if (stats_on) {
+    scan_stats();
+  } else {
+    stats_valid = 0;
+  }
+}
+
+/**
+ * @brief
+ * 地图中一个字按内容与位置得到的散列值，地图哈希为所有字的散列值的异或。先把高半字折入低半字，再加上由位置得到的数、乘以奇数常数，使不同位置、不同内容的变化不会相消；每字只需一次乘法。
+ *
+ * @param x 字的内容
+ * @param i 行号
+ * @param w 字号
+ * @return uint64_t 散列值
+ */
+uint64_t word_key(uint64_t x, int i, int w) {
+  uint64_t y = (x ^ x >> 32) + ((uint64_t)i * words + w + 1) * 0x9e3779b97f4a7c15ull;
+  y *= 0xbf58476d1ce4e5b9ull;
+  return y ^ y >> 32;
+}
+
+/**
+ * @brief
+ * 更新一行的哈希并记入 row_hash ，把新旧行哈希的异或累加进 *delta 。先逐字比较新旧两代，直到遇到第一个不同的字：
+ * 整行相同时 row_hash 不变，直接返回，空白与静止的行只花一遍比较；有变化的行通常在头几个字就分出来。有变化时整行重新计算，代价是每字一次散列，比逐字比较新旧两代更省：后者在随机地图上每字需要两次散列，或者会频繁地分支预测失败。
+ *
+ * @param src 旧一代该行首字地址
+ * @param dst 新一代该行首字地址，最后一个字已截去超出 col 的位
+ * @param i 行号
+ * @param delta 地图哈希变化量
+ */
+void hash_row(const uint64_t *src, const uint64_t *dst, int i,
+              uint64_t *delta) {
+  int same = 0;
+  while (same < words - 1 && src[same] == dst[same]) {
+    ++same;
+  }
+  if (same == words - 1 && (src[same] & tail_mask()) == dst[same]) {
+    return;
+  }
+  uint64_t h = 0;
+  for (int w = 0; w < words; ++w) {
+    h ^= word_key(dst[w], i, w);
+  }
+  *delta ^= h ^ row_hash[i];
+  row_hash[i] = h;
+}
+
+/**
+ * @brief
+ * 比较某一行第 w 字的新旧两代，有变化时把新旧散列值的异或同时累加进该行的哈希与
+ * *delta 。供稀疏模式逐区块使用，多数区块没有变化。旧一代截去超出 col
+ * 的位（环面模式下那里存放着边框）。
+ *
+ * @param src 旧一代该行首字地址
+ * @param dst 新一代该行首字地址
+ * @param i 行号
+ * @param w 字号
+ * @param delta 地图哈希变化量
+ * @return int 有变化为1，否则为0
+ */
+int hash_word(const uint64_t *src, const uint64_t *dst, int i, int w,
+              uint64_t *delta) {
+  uint64_t old = src[w];
+  if (w == words - 1) {
+    old &= tail_mask();
+  }
+  if (dst[w] == old) {
+    return 0;
+  }
+  uint64_t d = word_key(old, i, w) ^ word_key(dst[w], i, w);
+  row_hash[i] ^= d;
+  *delta ^= d;
+  return 1;
+}
+
+/**
+ * @brief
+ * 统计一行中连续 n 个字的新一代，累加进 *st
+ * ：出生数（新一代存活而旧一代死亡）、存活数与活细胞的外接矩形。生成时算完一行随即调用，两代数据都还在缓存中，不必另行扫描地图。死亡数不逐行计算，由
+ * finish_stats 按上一代与本代的存活数之差求出。旧一代最后一个字截去 tail
+ * 以外的位（环面模式下那里存放着边框）。
+ *
+ * @param src 旧一代首字地址
+ * @param dst 新一代首字地址
+ * @param n 字数
+ * @param y 该行的行号
+ * @param x 首字第 0 位的列号
+ * @param tail 最后一个字的有效位
+ * @param st 统计结果
+ */
+void stats_row(const uint64_t *src, const uint64_t *dst, int n, long long y,
+               long long x, uint64_t tail, life_stats *st) {
+  long long born = 0, live = 0;
+  for (int w = 0; w < n; ++w) {
+    uint64_t a = w == n - 1 ? src[w] & tail : src[w];
+    born += popcount64(dst[w] & ~a);
+    live += popcount64(dst[w]);
+  }
+  stats_add(dst, n, y, x, born, live, st);
+}
+
+#ifdef SIMD_X86
+/**
+ * @brief stats_row 的 POPCNT 版本，结果相同。
+ *
+ * @param src 旧一代首字地址
+ * @param dst 新一代首字地址
+ * @param n 字数
+ * @param y 该行的行号
+ * @param x 首字第 0 位的列号
+ * @param tail 最后一个字的有效位
+ * @param st 统计结果
+ */
+__attribute__((target("popcnt"))) void stats_row_popcnt(
+    const uint64_t *src, const uint64_t *dst, int n, long long y, long long x,
+    uint64_t tail, life_stats *st) {
+  long long born = 0, live = 0;
+  for (int w = 0; w < n; ++w) {
+    uint64_t a = w == n - 1 ? src[w] & tail : src[w];
+    born += __builtin_popcountll(dst[w] & ~a);
+    live += __builtin_popcountll(dst[w]);
+  }
+  stats_add(dst, n, y, x, born, live, st);
+}
+
+/**
+ * @brief
+ * stats_row 的 AVX2 版本，结果相同。每次处理四个字，用 4 位查表（ vpshufb
+ * ）求各字节中 1 的个数，再用 vpsadbw 累加为 64 位的和；最后一个字与余下的字交给
+ * POPCNT 。
+ *
+ * @param src 旧一代首字地址
+ * @param dst 新一代首字地址
+ * @param n 字数
+ * @param y 该行的行号
+ * @param x 首字第 0 位的列号
+ * @param tail 最后一个字的有效位
+ * @param st 统计结果
+ */
+__attribute__((target("avx2,popcnt"))) void stats_row_avx2(
+    const uint64_t *src, const uint64_t *dst, int n, long long y, long long x,
+    uint64_t tail, life_stats *st) {
+  const __m256i nib = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2,
+                                       3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2,
+                                       2, 3, 2, 3, 3, 4);
+  const __m256i low = _mm256_set1_epi8(0x0f), zero = _mm256_setzero_si256();
+  __m256i vb = zero, vl = zero;
+  int w = 0;
+  for (; w + 4 < n; w += 4) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(src + w));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(dst + w));
+    __m256i c = _mm256_andnot_si256(a, b);
+    __m256i cb = _mm256_add_epi8(
+        _mm256_shuffle_epi8(nib, _mm256_and_si256(c, low)),
+        _mm256_shuffle_epi8(nib, _mm256_and_si256(_mm256_srli_epi16(c, 4), low)));
+    __m256i cl = _mm256_add_epi8(
+        _mm256_shuffle_epi8(nib, _mm256_and_si256(b, low)),
+        _mm256_shuffle_epi8(nib, _mm256_and_si256(_mm256_srli_epi16(b, 4), low)));
+    vb = _mm256_add_epi64(vb, _mm256_sad_epu8(cb, zero));
+    vl = _mm256_add_epi64(vl, _mm256_sad_epu8(cl, zero));
+  }
+  uint64_t sb[4], sl[4];
+  _mm256_storeu_si256((__m256i *)sb, vb);
+  _mm256_storeu_si256((__m256i *)sl, vl);
+  long long born = (long long)(sb[0] + sb[1] + sb[2] + sb[3]);
+  long long live = (long long)(sl[0] + sl[1] + sl[2] + sl[3]);
+  _mm256_zeroupper();
+  for (; w < n; ++w) {
+    uint64_t a = w == n - 1 ? src[w] & tail : src[w];
+    born += __builtin_popcountll(dst[w] & ~a);
+    live += __builtin_popcountll(dst[w]);
+  }
+  stats_add(dst, n, y, x, born, live, st);
+}
+#endif
+
+/**
+ * @brief
+ * 把一行的出生数与存活数累加进 *st ，有活细胞时从两端找到第一个与最后一个非 0
+ * 的字，求出该行活细胞的最左、最右列并入外接矩形。
+ *
+ * @param dst 新一代首字地址
+ * @param n 字数
+ * @param y 该行的行号
+ * @param x 首字第 0 位的列号
+ * @param born 出生数
+ * @param live 存活数
+ * @param st 统计结果
+ */
+void stats_add(const uint64_t *dst, int n, long long y, long long x,
+               long long born, long long live, life_stats *st) {
+  life_stats s = {0, live, born, 0, y, 0, y, 0};
+  if (live) {
+    int first = 0, last = n - 1;
+    while (!dst[first]) {
+      first++;
+    }
+    while (!dst[last]) {
+      last--;
+    }
+    s.left = x + 64ll * first + ctz64(dst[first]);
+    s.right = x + 64ll * last + 63 - clz64(dst[last]);
+  }
+  merge_stats(st, &s);
+}
+
+/**
+ * @brief 把 *src 的计数累加进 *dst ，外接矩形取两者的并。
+ *
+ * @param dst 累加结果
+ * @param src 部分统计
+ */
+void merge_stats(life_stats *dst, const life_stats *src) {
+  dst->births += src->births, dst->deaths += src->deaths;
+  if (src->population == 0) {
+    return;
+  }
+  if (dst->population == 0) {
+    dst->top = src->top, dst->left = src->left;
+    dst->bottom = src->bottom, dst->right = src->right;
+  } else {
+    dst->top = src->top < dst->top ? src->top : dst->top;
+    dst->left = src->left < dst->left ? src->left : dst->left;
+    dst->bottom = src->bottom > dst->bottom ? src->bottom : dst->bottom;
+    dst->right = src->right > dst->right ? src->right : dst->right;
+  }
+  dst->population += src->population;
+}
+
+/**
+ * @brief
+ * 每代结束时调用：合并各线程（稀疏模式下为各区块）的统计得到 stats ，死亡数由上一代的存活数加本代出生数减本代存活数求出，并向
+ * stats_csv 写一行。稀疏模式跳过的区块没有变化，沿用其上次的存活数与外接矩形。只在
+ * stats_on 时调用。
+ *
+ */
+void finish_stats() {
+  life_stats s = {generation, 0, 0, 0, 0, 0, 0, 0};
+  if (sparse && boundary != BOUNDARY_INFINITE) {
+    size_t tiles = (size_t)tile_rows * tile_cols;
+    for (size_t t = 0; t < tiles; ++t) {
+      merge_stats(&s, &tile_stats[t]);
+    }
+  } else {
+    for (int i = 0; i < threads; ++i) {
+      merge_stats(&s, &band_stats[i]);
+    }
+  }
+  if (stats_valid) {
+    s.deaths = stats.population + s.births - s.population;
+  }
+  stats = s, stats_valid = stats_valid ? 2 : 1;
+  write_stats();
+}
+
+/**
+ * @brief
+ * 扫描当前地图（ infinite 边界下为整个无限平面）得到存活数与外接矩形，出生、死亡数记为 0
+ * 。地图被整体改写后调用，此后由生成过程增量维护。 HashLife 引擎不统计。
+ *
+ */
+void scan_stats() {
+  life_stats s = {generation, 0, 0, 0, 0, 0, 0, 0};
+  stats_valid = 0;
+  if (!is_map || engine == ENGINE_HASHLIFE) {
+    return;
+  }
+  if (boundary == BOUNDARY_INFINITE) {
+    for (uint32_t i = 0; i < pl_size; ++i) {
+      if (pl_vals[i] != PL_NONE) {
+        const pl_chunk *c = pl_get(pl_vals[i]);
+        for (int r = 0; r < CHUNK; ++r) {
+          stats_row_fn(&c->cells[r], &c->cells[r], 1,
+                       (long long)c->cy * CHUNK + r, (long long)c->cx * 64,
+                       ~(uint64_t)0, &s);
+        }
+      }
+    }
+  } else {
+    uint64_t tail = tail_mask();
+    for (int i = 0; i < row; ++i) {
+      const uint64_t *p = row_ptr(map, i);
+      stats_row_fn(p, p, words, i, 0, tail, &s);
+    }
+  }
+  stats = s, stats_valid = 1;
+}
+
+/**
+ * @brief 打开 CSV 文件并写入表头，此后每代写一行。已有打开的文件时先关闭。
+ *
+ * @param path 文件路径
+ * @return int 成功为1，失败为0
+ */
+int open_stats_csv(const char *path) {
+  close_stats_csv();
+  stats_csv = fopen(path, "w");
+  if (stats_csv == NULL) {
+    printf("stats: error: cannot open %s\n", path);
+    return 0;
+  }
+  fprintf(stats_csv, "generation,population,births,deaths,top,left,bottom,"
+                     "right\n");
+  return 1;
+}
+
+/**
+ * @brief 关闭 stats_csv 。写入或关闭出错（如磁盘已满）时文件不完整，显示错误。没有打开的文件时什么也不做。
+ *
+ * @return int 成功或没有打开的文件为1，出错为0
+ */
+int close_stats_csv() {
+  if (stats_csv == NULL) {
+    return 1;
+  }
+  int ok = !ferror(stats_csv);
+  ok = fclose(stats_csv) == 0 && ok;
+  stats_csv = NULL;
+  if (!ok) {
+    printf("stats: error: failed to write the csv file\n");
+  }
+  return ok;
+}
+
+/**
+ * @brief 向 stats_csv 写一行 stats 。没有活细胞时外接矩形的四列留空。
+ *
+ */
+void write_stats() {
+  if (stats_csv == NULL) {
+    return;
+  }
+  if (stats.population) {
+    fprintf(stats_csv, "%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld\n",
+            stats.generation, stats.population, stats.births, stats.deaths,
+            stats.top, stats.left, stats.bottom, stats.right);
+  } else {
+    fprintf(stats_csv, "%lld,0,%lld,%lld,,,,\n", stats.generation,
+            stats.births, stats.deaths);
+  }
+}
+
+/**
+ * @brief
+ * 统计命令。无参数时显示 stats ； on 、 off 开启或关闭逐代统计； csv FILE
+ * 开启统计并把每代的结果写入 CSV 文件， csv off 关闭文件。
+ *
+ * @param arg 命令参数
+ */
+void show_stats(char *arg) {
+  if (strcmp(arg, "on") == 0) {
+    stats_on = 1;
+    scan_stats();
+    mark_all_tiles();
+  } else if (strcmp(arg, "off") == 0) {
+    stats_on = 0;
+  } else if (strcmp(arg, "csv off") == 0) {
+    if (!close_stats_csv()) {
+      return;
+    }
+  } else if (strncmp(arg, "csv ", 4) == 0) {
+    if (!open_stats_csv(arg + 4)) {
+      return;
+    }
+    stats_on = 1;
+    scan_stats();
+    mark_all_tiles();
+    write_stats();
+  } else if (strcmp(arg, EMPTY) != 0) {
+    printf("stats: error: expected on, off, csv <filename> or csv off\n");
+    return;
+  }
+  printf("stats = %s%s\n", stats_on ? "on" : "off",
+         stats_csv != NULL ? ", writing csv" : "");
+  if (engine == ENGINE_HASHLIFE) {
+    printf("stats: not tracked by the hashlife engine\n");
+    return;
+  }
+  if (!is_map) {
+    return;
+  }
+  if (!stats_valid || stats.generation != generation) {
+    scan_stats();
+  }
+  printf("generation = %lld, population = %lld", stats.generation,
+         stats.population);
+  if (stats_valid == 2) {
+    printf(", births = %lld, deaths = %lld\n", stats.births, stats.deaths);
+  } else {
+    printf(" (births and deaths are counted while stats are on)\n");
+  }
+  if (stats.population) {
+    printf("bounding box: rows %lld to %lld, columns %lld to %lld (%lld x "
+           "%lld)\n",
+           stats.top, stats.bottom, stats.left, stats.right,
+           stats.bottom - stats.top + 1, stats.right - stats.left + 1);
+  } else {
+    printf("bounding box: empty\n");
+  }
+}
+
+#ifdef LIFE_PROFILE
+/**
+ * @brief
+ * 打开硬件计数器：指令数、缓存未命中数与分支预测失败数，各用一个 perf_event_open
+ * 计数器，只计用户态。须在创建任何线程之前调用，之后创建的线程继承计数器。任一个打不开时全部关闭，只计时。
+ *
+ */
+void prof_init() {
+#ifdef PROF_HW
+  static const uint64_t config[PROF_EVENTS] = {PERF_COUNT_HW_INSTRUCTIONS,
+                                               PERF_COUNT_HW_CACHE_MISSES,
+                                               PERF_COUNT_HW_BRANCH_MISSES};
+  for (int e = 0; e < PROF_EVENTS; ++e) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config[e];
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    prof_fd[e] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (prof_fd[e] < 0) {
+      snprintf(prof_hw_error, LEN, "perf_event_open: %s", strerror(errno));
+      for (int k = 0; k < e; ++k) {
+        close(prof_fd[k]);
+        prof_fd[k] = -1;
+      }
+      return;
+    }
+  }
+#else
+  snprintf(prof_hw_error, LEN, "perf_event_open needs Linux");
+#endif
+}
+
+/**
+ * @brief 读取一个硬件计数器，包括继承它的各线程。
+ *
+ * @param e 计数器编号
+ * @return long long 计数，不可用时为0
+ */
+long long prof_read(int e) {
+  uint64_t v = 0;
+  if (prof_fd[e] < 0 || read(prof_fd[e], &v, sizeof(v)) != sizeof(v)) {
+    return 0;
+  }
+  return (long long)v;
+}
+
+/**
+ * @brief 把采样行中距 *t 的时间记入线程 id 当前条带的某一部分，并把 *t 设为当前时间。
+ *
+ * @param id 线程号
+ * @param phase PROF_SUM 、 PROF_RULE 或 PROF_REST
+ * @param t 起始时间
+ */
+void prof_lap(int id, int phase, double *t) {
+  double now = now_seconds();
+  prof[id].sampled[phase] += now - *t;
+  *t = now;
+}
+
+/**
+ * @brief
+ * 结束一个条带：把自 t 起的用时按采样行的比例拆分给邻居计数与规则（其余部分不计），两者中有采样的阶段各记
+ * rows 行与 cells 个细胞，再清空采样。
+ *
+ * @param id 线程号
+ * @param t 条带开始的时间
+ * @param rows 条带行数
+ * @param cells 条带细胞数
+ */
+void prof_band(int id, double t, int rows, double cells) {
+  double secs = now_seconds() - t, *f = prof[id].sampled;
+  double total = f[PROF_SUM] + f[PROF_RULE] + f[PROF_REST];
+  for (int p = PROF_SUM; p <= PROF_RULE && rows > 0 && total > 0; ++p) {
+    if (f[p] > 0) {
+      prof[id].seconds[p] += secs * f[p] / total;
+      prof[id].cells[p] += cells;
+      prof[id].calls[p] += rows;
+    }
+  }
+  memset(f, 0, sizeof(prof[id].sampled));
+}
+
+/**
+ * @brief 进入一个较粗的阶段，记下时间与硬件计数器读数。
+ *
+ * @param phase 阶段
+ */
+void prof_enter(int phase) {
+  for (int e = 0; e < PROF_EVENTS; ++e) {
+    prof_hw_begin[phase][e] = prof_read(e);
+  }
+  prof_begin[phase] = now_seconds();
+}
+
+/**
+ * @brief 离开一个较粗的阶段，累计用时与硬件计数器增量。
+ *
+ * @param phase 阶段
+ * @param cells 本次处理的细胞数
+ */
+void prof_leave(int phase, double cells) {
+  prof[0].seconds[phase] += now_seconds() - prof_begin[phase];
+  prof[0].cells[phase] += cells;
+  prof[0].calls[phase]++;
+  for (int e = 0; e < PROF_EVENTS; ++e) {
+    prof_hw[phase][e] += prof_read(e) - prof_hw_begin[phase][e];
+  }
+}
+#endif
+
+/**
+ * @brief
+ * 性能剖析命令。无参数时按阶段显示次数、总用时、每次与每细胞的纳秒数，以及较粗阶段的硬件计数器；
+ * reset 清零。邻居计数与规则两个阶段为各线程用时之和，其余为实际经过的时间。
+ * 自动运行模式中模拟与绘制同时进行，而计数器按进程计数，绘制阶段的计数包含同时进行的模拟。
+ * 未定义 LIFE_PROFILE 编译时只提示如何开启。
+ *
+ * @param arg 命令参数
+ */
+void show_profile(char *arg) {
+#ifdef LIFE_PROFILE
+  static const char *names[PROF_PHASES] = {
+      "neighbor count", "rule apply", "step", "render", "load", "save"};
+  if (strcmp(arg, "reset") == 0) {
+    memset(prof, 0, sizeof(prof));
+    memset(prof_hw, 0, sizeof(prof_hw));
+    printf("prof: counters reset\n");
+    return;
+  } else if (strcmp(arg, EMPTY) != 0) {
+    printf("prof: error: expected reset or nothing\n");
+    return;
+  }
+  printf("%-15s %10s %11s %12s %9s %14s %14s %14s\n", "phase", "calls",
+         "total ms", "ns/call", "ns/cell", "instructions", "cache-misses",
+         "branch-misses");
+  for (int p = 0; p < PROF_PHASES; ++p) {
+    double secs = 0, cells = 0;
+    long long calls = 0;
+    for (int i = 0; i < TMAX; ++i) {
+      secs += prof[i].seconds[p];
+      cells += prof[i].cells[p];
+      calls += prof[i].calls[p];
+    }
+    if (calls == 0) {
+      continue;
+    }
+    printf("%-15s %10lld %11.3f %12.1f %9.3f", names[p], calls, secs * 1e3,
+           secs * 1e9 / calls, cells > 0 ? secs * 1e9 / cells : 0);
+    if (p >= PROF_STEP && prof_fd[0] >= 0) {
+      printf(" %14lld %14lld %14lld\n", prof_hw[p][0], prof_hw[p][1],
+             prof_hw[p][2]);
+    } else {
+      printf(" %14s %14s %14s\n", "-", "-", "-");
+    }
+  }
+  printf("prof: neighbor count and rule apply are each band's time split by "
+         "1 row in %d timed in detail; their calls are rows\n",
+         PROF_EVERY);
+  if (prof_fd[0] < 0) {
+    printf("prof: hardware counters unavailable (%s)\n", prof_hw_error);
+  }
+#else
+  (void)arg;
+  printf("prof: not compiled in, rebuild with -DLIFE_PROFILE\n");
+#endif
+}
+
+/**
+ * @brief 逐字计算当前地图或同样大小的空地图的哈希。
+ *
+ * @param empty 为1时计算空地图
+ * @return uint64_t 哈希
+ */
+uint64_t full_hash(int empty) {
+  uint64_t tail = tail_mask();
+  uint64_t h = 0;
+  for (int i = 0; i < row; ++i) {
+    const uint64_t *p = row_ptr(map, i);
+    for (int w = 0; w < words; ++w) {
+      uint64_t x = empty ? 0 : w == words - 1 ? p[w] & tail : p[w];
+      h ^= word_key(x, i, w);
+    }
+  }
+  return h;
+}
+
+/**
+ * @brief 逐字确认当前地图是否全部死亡。
+ *
+ * @return int 全部死亡为1，否则为0
+ */
+int board_empty() {
+  uint64_t tail = tail_mask();
+  for (int i = 0; i < row; ++i) {
+    const uint64_t *p = row_ptr(map, i);
+    for (int w = 0; w < words; ++w) {
+      if ((w == words - 1 ? p[w] & tail : p[w]) != 0) {
+        return 0;
+      }
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief
+ * 地图被整体改写或引擎、边界、规则改变后调用：重新计算各行与整张地图的哈希，清空历史表与检测结果。只在开启
+ * detect 时，且只在死亡或环面边界的 bitwise 与 lut 引擎中检测，无限平面上地图只是一个窗口，窗口内重复不代表整个平面重复。
+ *
+ */
+void reset_history() {
+  history_on = detect && is_map && engine != ENGINE_HASHLIFE &&
+               boundary != BOUNDARY_INFINITE;
+  period = 0, extinct = 0, settled_at = -1;
+  free(confirm_map);
+  confirm_map = NULL, confirm_period = 0;
+  for (int i = 0; i < HISTORY_SLOTS; ++i) {
+    history_gen[i] = -1;
+  }
+  if (history_on) {
+    uint64_t tail = tail_mask();
+    board_hash = 0;
+    for (int i = 0; i < row; ++i) {
+      const uint64_t *p = row_ptr(map, i);
+      row_hash[i] = 0;
+      for (int w = 0; w < words; ++w) {
+        row_hash[i] ^= word_key(w == words - 1 ? p[w] & tail : p[w], i, w);
+      }
+      board_hash ^= row_hash[i];
+    }
+    empty_hash = full_hash(1);
+    record_history();
+  }
+}
+
+/**
+ * @brief
+ * 每代结束时调用，检测灭绝、静物与振荡。哈希等于空地图的哈希时逐字确认是否全部死亡；否则在历史表中查找相同的哈希，找到则两者代数之差即为候选周期（静物为
+ * 1 ），找不到则记下本代。历史表按哈希开放寻址，每次至多探测 HISTORY_PROBE
+ * 项，插入时覆盖其中空闲、过期或最旧的项，因此查找与插入都是常数时间，表的大小固定。
+ * 哈希可能碰撞，而批处理模式会据此跳过整周期，因此候选周期先复制当前地图，再生成一个周期后逐字比较，相同才确认；不同则视为碰撞，继续记录。
+ * 同一时刻只确认一个候选，副本无法分配时放弃该候选。已检测到结果后不再记录。
+ *
+ */
+void record_history() {
+  if (!history_on || period) {
+    return;
+  }
+  if (board_hash == empty_hash && board_empty()) {
+    period = 1, extinct = 1, settled_at = generation;
+    return;
+  }
+  if (confirm_period && generation - confirm_at == confirm_period) {
+    int same = board_matches(confirm_map);
+    free(confirm_map);
+    confirm_map = NULL;
+    if (same) {
+      period = confirm_period, settled_at = confirm_from;
+      confirm_period = 0;
+      return;
+    }
+    confirm_period = 0;
+  }
+  int victim = -1;
+  for (int k = 0; k < HISTORY_PROBE; ++k) {
+    int s = (int)((board_hash + (uint64_t)k) & (HISTORY_SLOTS - 1));
+    long long g = history_gen[s];
+    if (g >= 0 && g < generation && generation - g <= HISTORY &&
+        history_hash[s] == board_hash) {
+      if (!confirm_period) {
+        confirm_map = malloc((size_t)row * words * sizeof(uint64_t));
+        if (confirm_map != NULL) {
+          copy_board(confirm_map);
+          confirm_period = (int)(generation - g);
+          confirm_at = generation, confirm_from = g;
+        }
+      }
+      return;
+    }
+    if (victim < 0 || g < history_gen[victim]) {
+      victim = s;
+    }
+  }
+  history_hash[victim] = board_hash;
+  history_gen[victim] = generation;
+}
+
+/**
+ * @brief 把当前地图复制为每行 words 个字的紧凑副本，每行最后一个字截去多余位。
+ *
+ * @param copy 副本，至少 row * words 个字
+ */
+void copy_board(uint64_t *copy) {
+  uint64_t tail = tail_mask();
+  for (int i = 0; i < row; ++i) {
+    uint64_t *q = copy + (size_t)i * words;
+    memcpy(q, row_ptr(map, i), (size_t)words * sizeof(uint64_t));
+    q[words - 1] &= tail;
+  }
+}
+
+/**
+ * @brief 逐字比较当前地图与 copy_board 得到的副本。
+ *
+ * @param copy 副本
+ * @return int 相同为1，否则为0
+ */
+int board_matches(const uint64_t *copy) {
+  uint64_t tail = tail_mask();
+  for (int i = 0; i < row; ++i) {
+    const uint64_t *p = row_ptr(map, i), *q = copy + (size_t)i * words;
+    if (memcmp(p, q, (size_t)(words - 1) * sizeof(uint64_t)) != 0 ||
+        (p[words - 1] & tail) != q[words - 1]) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief 显示检测结果。
+ *
+ * @param buf 输出缓冲，长度至少为 LEN
+ * @return int 已检测到结果为1，否则为0
+ */
+int describe_history(char *buf) {
+  if (!period) {
+    return 0;
+  }
+  if (extinct) {
+    snprintf(buf, LEN, "extinct at generation %lld", settled_at);
+  } else if (period == 1) {
+    snprintf(buf, LEN, "still life since generation %lld", settled_at);
+  } else {
+    snprintf(buf, LEN, "period %d oscillator since generation %lld", period,
+             settled_at);
+  }
+  return 1;
+}
+
+/**
+ * @brief 计算一个字内 64 个细胞的下一代，字外的邻居视为死亡。
+ *
+ * @param a 上一行
+ * @param b 本行
+ * @param c 下一行
+ * @return uint64_t 本行下一代
+ */
+uint64_t next_bits(uint64_t a, uint64_t b, uint64_t c) {
+  uint64_t src[3][3] = {{0, a, 0}, {0, b, 0}, {0, c, 0}}, s0[3], s1[3], d;
+  for (int k = 0; k < 3; ++k) {
+    row_sum(&src[k][1], &s0[k], &s1[k], 1);
+  }
+  rule_fn(&s0[0], &s1[0], &s0[1], &s1[1], &s0[2], &s1[2], &b, &d, 1);
+  return d;
+}
+
+/**
+ * @brief 64 位整数哈希（ splitmix64 的混合函数）。
+ *
+ * @param x 输入
+ * @return uint64_t 哈希值
+ */
+uint64_t hl_hash(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ull;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+/**
+ * @brief 释放 HashLife 的全部节点，并清空根节点。
+ *
+ */
+void hl_reset() {
+  free(hl_nodes);
+  free(hl_table);
+  hl_nodes = NULL, hl_table = NULL;
+  hl_count = hl_capacity = hl_table_size = 0;
+  hl_root = HL_NONE;
+}
+
+/**
+ * @brief
+ * 查找与 n 内容相同的节点，没有则新建。节点数组与哈希表按需倍增，新建时结果缓存为空。
+ *
+ * @param n 节点内容
+ * @return uint32_t 节点编号
+ */
+uint32_t hl_intern(hl_node *n) {
+  if (hl_count * 2 >= hl_table_size) {
+    uint32_t size = hl_table_size ? hl_table_size * 2 : 1u << 16;
+    uint32_t *table = malloc(sizeof(uint32_t) * size);
+    if (table == NULL) {
+      printf("hashlife: error: out of memory\n");
+      exit(1);
+    }
+    memset(table, 0xff, sizeof(uint32_t) * size);
+    for (uint32_t i = 0; i < hl_count; ++i) {
+      hl_node *m = &hl_nodes[i];
+      uint64_t h = m->level == 3 ? hl_hash(m->bits)
+                                 : hl_hash(m->nw ^ (uint64_t)m->ne << 32) ^
+                                       hl_hash(m->sw ^ (uint64_t)m->se << 32 ^ 1);
+      uint32_t j = (uint32_t)h & (size - 1);
+      while (table[j] != HL_NONE) j = (j + 1) & (size - 1);
+      table[j] = i;
+    }
+    free(hl_table);
+    hl_table = table, hl_table_size = size;
+  }
+  uint64_t h = n->level == 3 ? hl_hash(n->bits)
+                             : hl_hash(n->nw ^ (uint64_t)n->ne << 32) ^
+                                   hl_hash(n->sw ^ (uint64_t)n->se << 32 ^ 1);
+  uint32_t j = (uint32_t)h & (hl_table_size - 1);
+  while (hl_table[j] != HL_NONE) {
+    hl_node *m = &hl_nodes[hl_table[j]];
+    if (m->level == n->level &&
+        (n->level == 3 ? m->bits == n->bits
+                       : m->nw == n->nw && m->ne == n->ne && m->sw == n->sw &&
+                             m->se == n->se)) {
+      return hl_table[j];
+    }
+    j = (j + 1) & (hl_table_size - 1);
+  }
+  if (hl_count == hl_capacity) {
+    uint32_t cap = hl_capacity ? hl_capacity * 2 : 1u << 15;
+    hl_node *nodes = realloc(hl_nodes, sizeof(hl_node) * cap);
+    if (nodes == NULL) {
+      printf("hashlife: error: out of memory\n");
+      exit(1);
+    }
+    hl_nodes = nodes, hl_capacity = cap;
+  }
+  n->result = HL_NONE, n->result_j = -1;
+  hl_nodes[hl_count] = *n;
+  hl_table[j] = hl_count;
+  return hl_count++;
+}
+
+/**
+ * @brief 取得一个 8x8 叶子节点。第 r 行第 c 列细胞为 bits 的第 r * 8 + c 位。
+ *
+ * @param bits 64 个细胞
+ * @return uint32_t 节点编号
+ */
+uint32_t hl_leaf(uint64_t bits) {
+  hl_node n = {0, 0, 0, 0, bits, HL_NONE, 3, -1};
+  return hl_intern(&n);
+}
+
+/**
+ * @brief 由四个同层子节点组成上一层节点。
+ *
+ * @param nw 左上
+ * @param ne 右上
+ * @param sw 左下
+ * @param se 右下
+ * @return uint32_t 节点编号
+ */
+uint32_t hl_join(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se) {
+  hl_node n = {nw, ne, sw, se, 0, HL_NONE, (int8_t)(hl_nodes[nw].level + 1),
+               -1};
+  return hl_intern(&n);
+}
+
+/**
+ * @brief 取节点中央边长一半的部分，节点层数不低于 5 。
+ *
+ * @param m 节点编号
+ * @return uint32_t 中央部分，层数减一
+ */
+uint32_t hl_centre(uint32_t m) {
+  hl_node n = hl_nodes[m];
+  return hl_join(hl_nodes[n.nw].se, hl_nodes[n.ne].sw, hl_nodes[n.sw].ne,
+                 hl_nodes[n.se].nw);
+}
+
+/**
+ * @brief
+ * 由四个 8x8 叶子拼成的 16x16 区域中取中央 8x8 ，即 a 的右下、 b 的左下、 c
+ * 的右上与 d 的左上各 4x4 。
+ *
+ * @param a 左上叶子
+ * @param b 右上叶子
+ * @param c 左下叶子
+ * @param d 右下叶子
+ * @return uint32_t 叶子编号
+ */
+uint32_t hl_leaf_centre(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+  uint64_t ba = hl_nodes[a].bits, bb = hl_nodes[b].bits;
+  uint64_t bc = hl_nodes[c].bits, bd = hl_nodes[d].bits, bits = 0;
+  for (int r = 0; r < 4; ++r) {
+    uint64_t top = (ba >> ((r + 4) * 8 + 4) & 0xf) |
+                   (bb >> ((r + 4) * 8) & 0xf) << 4;
+    uint64_t bottom = (bc >> (r * 8 + 4) & 0xf) | (bd >> (r * 8) & 0xf) << 4;
+    bits |= top << (r * 8) | bottom << ((r + 4) * 8);
+  }
+  return hl_leaf(bits);
+}
+
+/**
+ * @brief
+ * 四个同层节点排成 2x2 时，取中央与它们同样大小的部分。叶子层用 hl_leaf_centre
+ * 。
+ *
+ * @param a 左上
+ * @param b 右上
+ * @param c 左下
+ * @param d 右下
+ * @return uint32_t 中央部分，与参数同层
+ */
+uint32_t hl_inner(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+  if (hl_nodes[a].level == 3) {
+    return hl_leaf_centre(a, b, c, d);
+  }
+  return hl_join(hl_nodes[a].se, hl_nodes[b].sw, hl_nodes[c].ne,
+                 hl_nodes[d].nw);
+}
+
+/**
+ * @brief
+ * 第 4 层节点（ 16x16 ）直接逐代计算 2 的 j 次方代（ j 不超过 2
+ * ），返回中央 8x8 。每代有效区域向内缩一格，四代后中央 8x8 仍然准确。
+ *
+ * @param m 节点编号
+ * @param j 代数的指数
+ * @return uint32_t 叶子编号
+ */
+uint32_t hl_base(uint32_t m, int j) {
+  hl_node n = hl_nodes[m];
+  uint64_t rows[18] = {0}, next[16];
+  for (int r = 0; r < 8; ++r) {
+    rows[r + 1] = (hl_nodes[n.nw].bits >> (r * 8) & 0xff) |
+                  (hl_nodes[n.ne].bits >> (r * 8) & 0xff) << 8;
+    rows[r + 9] = (hl_nodes[n.sw].bits >> (r * 8) & 0xff) |
+                  (hl_nodes[n.se].bits >> (r * 8) & 0xff) << 8;
+  }
+  for (int g = 0; g < (1 << j); ++g) {
+    for (int r = 0; r < 16; ++r) {
+      next[r] = next_bits(rows[r], rows[r + 1], rows[r + 2]) & 0xffff;
+    }
+    memcpy(rows + 1, next, sizeof(next));
+  }
+  uint64_t bits = 0;
+  for (int r = 0; r < 8; ++r) {
+    bits |= (rows[r + 5] >> 4 & 0xff) << (r * 8);
+  }
+  return hl_leaf(bits);
+}
+
+/**
+ * @brief
+ * HashLife 核心递归。返回第 k 层节点中央边长一半的部分在 2 的 j
+ * 次方代之后的状态（ j 不超过 k - 2 ）。把节点分为九个重叠的下一层节点分别递归，
+ * j = k - 2 时再把结果拼成四个节点递归一次，使代数翻倍；否则直接取九个结果的中央拼接。结果缓存在节点中，相同节点只算一次。
+ *
+ * @param m 节点编号
+ * @param j 代数的指数
+ * @return uint32_t 结果节点编号，层数减一
+ */
+uint32_t hl_step(uint32_t m, int j) {
+  int k = hl_nodes[m].level;
+  if (j > k - 2) {
+    j = k - 2;
+  }
+  if (m == hl_empty[k]) {
+    return hl_empty[k - 1];
+  }
+  if (hl_nodes[m].result != HL_NONE && hl_nodes[m].result_j == j) {
+    return hl_nodes[m].result;
+  }
+  uint32_t res;
+  if (k == 4) {
+    res = hl_base(m, j);
+  } else {
+    hl_node n = hl_nodes[m];
+    hl_node nw = hl_nodes[n.nw], ne = hl_nodes[n.ne];
+    hl_node sw = hl_nodes[n.sw], se = hl_nodes[n.se];
+    uint32_t sub[9] = {
+        n.nw,
+        hl_join(nw.ne, ne.nw, nw.se, ne.sw),
+        n.ne,
+        hl_join(nw.sw, nw.se, sw.nw, sw.ne),
+        hl_centre(m),
+        hl_join(ne.sw, ne.se, se.nw, se.ne),
+        n.sw,
+        hl_join(sw.ne, se.nw, sw.se, se.sw),
+        n.se,
+    };
+    uint32_t r[9];
+    for (int i = 0; i < 9; ++i) {
+      r[i] = hl_step(sub[i], j);
+    }
+    if (j == k - 2) {
+      res = hl_join(hl_step(hl_join(r[0], r[1], r[3], r[4]), j),
+                    hl_step(hl_join(r[1], r[2], r[4], r[5]), j),
+                    hl_step(hl_join(r[3], r[4], r[6], r[7]), j),
+                    hl_step(hl_join(r[4], r[5], r[7], r[8]), j));
+    } else {
+      res = hl_join(hl_inner(r[0], r[1], r[3], r[4]),
+                    hl_inner(r[1], r[2], r[4], r[5]),
+                    hl_inner(r[3], r[4], r[6], r[7]),
+                    hl_inner(r[4], r[5], r[7], r[8]));
+    }
+  }
+  hl_nodes[m].result = res, hl_nodes[m].result_j = (int8_t)j;
+  return res;
+}
+
+/**
+ * @brief 判断节点的活细胞是否都在中央边长一半的范围内。
+ *
+ * @param m 节点编号，层数不低于 5
+ * @return int 是为1，否为0
+ */
+int hl_is_centred(uint32_t m) {
+  hl_node n = hl_nodes[m];
+  uint32_t e = hl_empty[n.level - 2];
+  hl_node nw = hl_nodes[n.nw], ne = hl_nodes[n.ne];
+  hl_node sw = hl_nodes[n.sw], se = hl_nodes[n.se];
+  return nw.nw == e && nw.ne == e && nw.sw == e && ne.nw == e && ne.ne == e &&
+         ne.se == e && sw.nw == e && sw.sw == e && sw.se == e && se.ne == e &&
+         se.sw == e && se.se == e;
+}
+
+/**
+ * @brief 在根节点四周补上死细胞，使其边长翻倍而原内容位于中央。根节点不超过第 63 层，由 GENS_MAX
+ * 保证。
+ *
+ */
+void hl_expand() {
+  hl_node n = hl_nodes[hl_root];
+  assert(n.level < 63);
+  uint32_t e = hl_empty[n.level - 1];
+  hl_root = hl_join(hl_join(e, e, e, n.nw), hl_join(e, e, n.ne, e),
+                    hl_join(e, n.sw, e, e), hl_join(n.se, e, e, e));
+  hl_y -= 1ll << (n.level - 1), hl_x -= 1ll << (n.level - 1);
+}
+
+/**
+ * @brief
+ * 将整个平面前进 gens 代。按 gens 的二进制位分次前进 2 的 j
+ * 次方代：先扩展根节点，使活细胞位于中央且层数足够，再多扩展一层留出生长空间，取
+ * hl_step 的结果作为新的根节点；最后去掉四周多余的空白。
+ *
+ * @param gens 代数
+ */
+void hl_advance(uint64_t gens) {
+  for (int j = 0; j < 64 && (gens >> j) != 0; ++j) {
+    if (!(gens >> j & 1)) {
+      continue;
+    }
+    while (hl_nodes[hl_root].level < j + 2 || !hl_is_centred(hl_root)) {
+      hl_expand();
+    }
+    hl_expand();
+    int level = hl_nodes[hl_root].level;
+    hl_root = hl_step(hl_root, j);
+    hl_y += 1ll << (level - 2), hl_x += 1ll << (level - 2);
+    while (hl_nodes[hl_root].level > 5 && hl_is_centred(hl_root)) {
+      hl_y += 1ll << (hl_nodes[hl_root].level - 2);
+      hl_x += 1ll << (hl_nodes[hl_root].level - 2);
+      hl_root = hl_centre(hl_root);
+    }
+    if (hl_count > HL_LIMIT) {
+      hl_collect();
+    }
+  }
+}
+
+/**
+ * @brief
+ * 由地图中左上角为 (y, x) 、第 level 层大小的区域建立节点。跨过第 col
+ * 列的叶子截去地图外的位，不依赖多余位为 0 。
+ *
+ * @param y 行
+ * @param x 列，为 8 的倍数
+ * @param level 层数
+ * @return uint32_t 节点编号
+ */
+uint32_t hl_build(long long y, long long x, int level) {
+  if (y >= row || x >= col) {
+    return hl_empty[level];
+  }
+  if (level == 3) {
+    uint64_t mask = col - x < 8 ? ((uint64_t)1 << (col - x)) - 1 : 0xff;
+    uint64_t bits = 0;
+    for (int r = 0; r < 8 && y + r < row; ++r) {
+      bits |= (row_ptr(map, (int)(y + r))[x >> 6] >> (x & 63) & mask)
+              << (r * 8);
+    }
+    return hl_leaf(bits);
+  }
+  long long half = 1ll << (level - 1);
+  return hl_join(hl_build(y, x, level - 1), hl_build(y, x + half, level - 1),
+                 hl_build(y + half, x, level - 1),
+                 hl_build(y + half, x + half, level - 1));
+}
+
+/**
+ * @brief 由当前地图重建 HashLife 四叉树，地图左上角对齐根节点左上角。
+ *
+ */
+void hl_from_map() {
+  hl_reset();
+  hl_empty[3] = hl_leaf(0);
+  for (int i = 4; i < 64; ++i) {
+    hl_empty[i] = hl_join(hl_empty[i - 1], hl_empty[i - 1], hl_empty[i - 1],
+                          hl_empty[i - 1]);
+  }
+  int level = 5;
+  while ((1ll << level) < row || (1ll << level) < col) {
+    level++;
+  }
+  hl_root = hl_build(0, 0, level);
+  hl_y = hl_x = 0;
+}
+
+/**
+ * @brief 把节点中落在地图范围内的活细胞写入地图。
+ *
+ * @param m 节点编号
+ * @param y 节点左上角的行
+ * @param x 节点左上角的列
+ * @param level 层数
+ */
+void hl_write(uint32_t m, long long y, long long x, int level) {
+  long long size = 1ll << level;
+  if (m == hl_empty[level] || y >= row || x >= col || y + size <= 0 ||
+      x + size <= 0) {
+    return;
+  }
+  if (level == 3) {
+    uint64_t bits = hl_nodes[m].bits;
+    for (int r = 0; r < 8; ++r) {
+      for (int c = 0; c < 8; ++c) {
+        if ((bits >> (r * 8 + c) & 1) && y + r >= 0 && y + r < row &&
+            x + c >= 0 && x + c < col) {
+          set_cell((int)(y + r), (int)(x + c), 1);
+        }
+      }
+    }
+    return;
+  }
+  hl_node n = hl_nodes[m];
+  long long half = size / 2;
+  hl_write(n.nw, y, x, level - 1);
+  hl_write(n.ne, y, x + half, level - 1);
+  hl_write(n.sw, y + half, x, level - 1);
+  hl_write(n.se, y + half, x + half, level - 1);
+}
+
+/**
+ * @brief 把 HashLife 平面中与地图重合的部分写回地图，地图外的细胞不受影响。
+ *
+ */
+void hl_to_map() {
+  memset(map, 0, (size_t)(row + 2) * stride * sizeof(uint64_t));
+  hl_write(hl_root, hl_y, hl_x, hl_nodes[hl_root].level);
+}
+
+/**
+ * @brief 由区块中左上角为 (y, x) 、第 level 层大小的区域建立节点。
+ *
+ * @param rows 区块的 64 行
+ * @param y 行
+ * @param x 列，为 8 的倍数
+ * @param level 层数，不超过 6
+ * @return uint32_t 节点编号
+ */
+uint32_t hl_build_rows(const uint64_t *rows, int y, int x, int level) {
+  if (level == 3) {
+    uint64_t bits = 0;
+    for (int r = 0; r < 8; ++r) {
+      bits |= (rows[y + r] >> x & 0xff) << (r * 8);
+    }
+    return hl_leaf(bits);
+  }
+  int half = 1 << (level - 1);
+  return hl_join(hl_build_rows(rows, y, x, level - 1),
+                 hl_build_rows(rows, y, x + half, level - 1),
+                 hl_build_rows(rows, y + half, x, level - 1),
+                 hl_build_rows(rows, y + half, x + half, level - 1));
+}
+
+/**
+ * @brief 把区块编号按行坐标（或列坐标）是否小于 mid 分为前后两段。
+ *
+ * @param ids 区块编号
+ * @param n 个数
+ * @param by_x 1为按列坐标，0为按行坐标
+ * @param mid 分界
+ * @return int 前一段的个数
+ */
+int pl_split(uint32_t *ids, int n, int by_x, long long mid) {
+  int k = 0;
+  for (int i = 0; i < n; ++i) {
+    const pl_chunk *c = pl_get(ids[i]);
+    if ((by_x ? c->cx : c->cy) < mid) {
+      uint32_t t = ids[i];
+      ids[i] = ids[k], ids[k++] = t;
+    }
+  }
+  return k;
+}
+
+/**
+ * @brief
+ * 由左上角区块为 (cy, cx) 、第 level 层大小的区域内的 n 个区块建立节点，四个象限各自递归。
+ *
+ * @param ids 区域内的区块编号，会被重新排列
+ * @param n 个数
+ * @param cy 区域左上角的区块行坐标
+ * @param cx 区域左上角的区块列坐标
+ * @param level 层数，不小于 6
+ * @return uint32_t 节点编号
+ */
+uint32_t hl_build_chunks(uint32_t *ids, int n, long long cy, long long cx,
+                         int level) {
+  if (n == 0) {
+    return hl_empty[level];
+  }
+  if (level == 6) {
+    return hl_build_rows(pl_get(ids[0])->cells, 0, 0, 6);
+  }
+  long long half = 1ll << (level - 7);
+  int top = pl_split(ids, n, 0, cy + half);
+  int nw = pl_split(ids, top, 1, cx + half);
+  int sw = pl_split(ids + top, n - top, 1, cx + half);
+  return hl_join(hl_build_chunks(ids, nw, cy, cx, level - 1),
+                 hl_build_chunks(ids + nw, top - nw, cy, cx + half, level - 1),
+                 hl_build_chunks(ids + top, sw, cy + half, cx, level - 1),
+                 hl_build_chunks(ids + top + sw, n - top - sw, cy + half,
+                                 cx + half, level - 1));
+}
+
+/**
+ * @brief
+ * 由无限平面的全部区块（而不只是地图范围内的部分）重建 HashLife
+ * 四叉树，根节点左上角对齐活区块外接矩形的左上角。内存不足时退出程序。
+ *
+ */
+void hl_from_plane() {
+  hl_reset();
+  hl_empty[3] = hl_leaf(0);
+  for (int i = 4; i < 64; ++i) {
+    hl_empty[i] = hl_join(hl_empty[i - 1], hl_empty[i - 1], hl_empty[i - 1],
+                          hl_empty[i - 1]);
+  }
+  uint32_t *ids = malloc(sizeof(uint32_t) * (pl_used + 1));
+  if (ids == NULL) {
+    printf("hashlife: error: out of memory\n");
+    exit(1);
+  }
+  int n = 0;
+  long long y0 = 0, x0 = 0, y1 = 0, x1 = 0;
+  for (uint32_t i = 0; i < pl_size; ++i) {
+    if (pl_vals[i] == PL_NONE) {
       continue;
-    } else {
-      printf("error: command not found: %s %s\n", buff, filename);
     }
-    printf("\n");
+    const pl_chunk *c = pl_get(pl_vals[i]);
+    int live = 0;
+    for (int r = 0; r < CHUNK && !live; ++r) {
+      live = c->cells[r] != 0;
+    }
+    if (!live) {
+      continue;
+    }
+    if (n == 0 || c->cy < y0) y0 = c->cy;
+    if (n == 0 || c->cx < x0) x0 = c->cx;
+    if (n == 0 || c->cy > y1) y1 = c->cy;
+    if (n == 0 || c->cx > x1) x1 = c->cx;
+    ids[n++] = pl_vals[i];
+  }
+  int level = 6;
+  while ((1ll << (level - 6)) <= y1 - y0 || (1ll << (level - 6)) <= x1 - x0) {
+    level++;
+  }
+  hl_root = hl_build_chunks(ids, n, y0, x0, level);
+  hl_y = y0 * CHUNK, hl_x = x0 * CHUNK;
+  free(ids);
+}
+
+/**
+ * @brief 把节点中的全部活细胞写入无限平面，需要时分配区块。
+ *
+ * @param m 节点编号
+ * @param y 节点左上角的行
+ * @param x 节点左上角的列，为 8 的倍数
+ * @param level 层数
+ * @return int 成功为1，内存不足为0
+ */
+int hl_put(uint32_t m, long long y, long long x, int level) {
+  if (m == hl_empty[level]) {
+    return 1;
+  }
+  if (level == 3) {
+    uint64_t bits = hl_nodes[m].bits;
+    for (int r = 0; r < 8; ++r) {
+      uint64_t b = bits >> (r * 8) & 0xff;
+      if (b) {
+        long long yy = y + r;
+        uint32_t id = pl_insert((int32_t)(yy >> 6), (int32_t)(x >> 6));
+        if (id == PL_NONE) {
+          return 0;
+        }
+        pl_get(id)->cells[yy & 63] |= b << (x & 63);
+      }
+    }
+    return 1;
+  }
+  hl_node n = hl_nodes[m];
+  long long half = 1ll << (level - 1);
+  return hl_put(n.nw, y, x, level - 1) &&
+         hl_put(n.ne, y, x + half, level - 1) &&
+         hl_put(n.sw, y + half, x, level - 1) &&
+         hl_put(n.se, y + half, x + half, level - 1);
+}
+
+/**
+ * @brief
+ * 用 HashLife 平面的全部活细胞重建无限平面。内存不足时改为只把地图范围内的细胞写回地图，清空平面并换成死亡边界，地图外的细胞丢失。
+ *
+ * @return int 成功为1，内存不足为0
+ */
+int hl_to_plane() {
+  pl_reset();
+  if (hl_put(hl_root, hl_y, hl_x, hl_nodes[hl_root].level)) {
+    return 1;
   }
+  pl_reset();
+  hl_to_map();
+  boundary = BOUNDARY_DEAD;
+  printf("infinite: error: cells outside the map were dropped, boundary = "
+         "dead\n");
   return 0;
 }
 
 /**
- * @brief 获取一整行输入字符串。长度不大于1024。
+ * @brief 把以 m 为根的子树复制到新的节点数组中，用于回收。
+ *
+ * @param m 旧编号
+ * @param old 旧节点数组
+ * @param remap 旧编号到新编号的对应表
+ * @return uint32_t 新编号
+ */
+uint32_t hl_copy(uint32_t m, hl_node *old, uint32_t *remap) {
+  if (remap[m] != HL_NONE) {
+    return remap[m];
+  }
+  hl_node n = old[m];
+  if (n.level == 3) {
+    remap[m] = hl_leaf(n.bits);
+  } else {
+    uint32_t nw = hl_copy(n.nw, old, remap), ne = hl_copy(n.ne, old, remap);
+    uint32_t sw = hl_copy(n.sw, old, remap), se = hl_copy(n.se, old, remap);
+    remap[m] = hl_join(nw, ne, sw, se);
+  }
+  return remap[m];
+}
+
+/**
+ * @brief 回收节点：只保留根节点与各层全死节点可达的节点，并丢弃所有结果缓存。
+ *
+ */
+void hl_collect() {
+  hl_node *old = hl_nodes;
+  uint32_t count = hl_count;
+  uint32_t *remap = malloc(sizeof(uint32_t) * count);
+  if (remap == NULL) {
+    return;
+  }
+  memset(remap, 0xff, sizeof(uint32_t) * count);
+  free(hl_table);
+  hl_nodes = NULL, hl_table = NULL;
+  hl_count = hl_capacity = hl_table_size = 0;
+  for (int i = 3; i < 64; ++i) {
+    hl_empty[i] = hl_copy(hl_empty[i], old, remap);
+  }
+  hl_root = hl_copy(hl_root, old, remap);
+  free(old);
+  free(remap);
+}
+
+/**
+ * @brief
+ * 显示或选择边界模式。 dead 为地图外恒为死亡； infinite
+ * 为无限平面，活细胞可以离开地图继续演化，地图只显示平面上行列坐标从 0
+ * 开始的窗口； torus 为环面，地图上下、左右两边相接。
+ *
+ * @param arg dead 、 infinite 、 torus 或空
+ */
+void set_boundary(char *arg) {
+  if (strcmp(arg, "dead") == 0) {
+    if (engine == ENGINE_HASHLIFE) {
+      printf("set_boundary: error: hashlife only supports infinite\n");
+      return;
+    }
+    boundary = BOUNDARY_DEAD;
+    pl_reset();
+    engine_attach();
+  } else if (strcmp(arg, "infinite") == 0) {
+    if (engine == ENGINE_LUT) {
+      printf("set_boundary: error: lut only supports dead and torus\n");
+      return;
+    }
+    if (rule_birth & 1) {
+      printf("set_boundary: error: infinite does not support B0 rules\n");
+      return;
+    }
+    if (boundary != BOUNDARY_INFINITE) {
+      boundary = BOUNDARY_INFINITE;
+      engine_attach();
+    }
+  } else if (strcmp(arg, "torus") == 0) {
+    if (engine == ENGINE_HASHLIFE) {
+      printf("set_boundary: error: hashlife only supports infinite\n");
+      return;
+    }
+    boundary = BOUNDARY_TORUS;
+    pl_reset();
+    engine_attach();
+  } else if (strcmp(arg, EMPTY) != 0) {
+    printf("set_boundary: error: unknown boundary: %s\n", arg);
+    return;
+  }
+  if (boundary == BOUNDARY_INFINITE && engine != ENGINE_HASHLIFE) {
+    printf("boundary = infinite, chunks = %u (%u allocated)\n", pl_used,
+           pl_total);
+  } else {
+    printf("boundary = %s\n", boundary == BOUNDARY_INFINITE ? "infinite"
+                               : boundary == BOUNDARY_TORUS  ? "torus"
+                                                             : "dead");
+  }
+}
+
+/**
+ * @brief 由编号取得区块地址。
+ *
+ * @param i 区块编号
+ * @return pl_chunk* 区块地址
+ */
+pl_chunk *pl_get(uint32_t i) {
+  return &pl_blocks[i / CHUNK_BLOCK][i % CHUNK_BLOCK];
+}
+
+/**
+ * @brief 释放无限平面的全部区块与哈希表。
+ *
+ */
+void pl_reset() {
+  for (uint32_t i = 0; i < pl_total / CHUNK_BLOCK; ++i) {
+    aligned_free(pl_blocks[i]);
+  }
+  free(pl_blocks);
+  free(pl_free);
+  free(pl_keys);
+  free(pl_vals);
+  free(pl_list);
+  pl_blocks = NULL, pl_free = NULL, pl_keys = NULL, pl_vals = NULL;
+  pl_list = NULL;
+  pl_total = pl_free_count = pl_size = pl_used = 0;
+  pl_list_count = pl_list_capacity = 0;
+}
+
+/**
+ * @brief 在哈希表中查找区块。
+ *
+ * @param cy 区块行坐标
+ * @param cx 区块列坐标
+ * @return uint32_t 区块编号，不存在时为 PL_NONE
+ */
+uint32_t pl_find(int32_t cy, int32_t cx) {
+  if (pl_size == 0) {
+    return PL_NONE;
+  }
+  uint64_t key = (uint64_t)(uint32_t)cy << 32 | (uint32_t)cx;
+  uint32_t j = (uint32_t)hl_hash(key) & (pl_size - 1);
+  while (pl_vals[j] != PL_NONE) {
+    if (pl_keys[j] == key) {
+      return pl_vals[j];
+    }
+    j = (j + 1) & (pl_size - 1);
+  }
+  return PL_NONE;
+}
+
+/**
+ * @brief
+ * 取得区块，不存在时从区块池中取一个全死区块插入。池中无空闲区块时整块分配
+ * CHUNK_BLOCK 个；哈希表装载率超过一半时倍增。内存不足时显示错误，平面保持原样。
+ *
+ * @param cy 区块行坐标
+ * @param cx 区块列坐标
+ * @return uint32_t 区块编号，内存不足时为 PL_NONE
+ */
+uint32_t pl_insert(int32_t cy, int32_t cx) {
+  uint32_t found = pl_find(cy, cx);
+  if (found != PL_NONE) {
+    return found;
+  }
+  if ((pl_used + 1) * 2 > pl_size) {
+    uint32_t size = pl_size ? pl_size * 2 : 1024;
+    uint64_t *keys = malloc(sizeof(uint64_t) * size);
+    uint32_t *vals = malloc(sizeof(uint32_t) * size);
+    if (keys == NULL || vals == NULL) {
+      free(keys);
+      free(vals);
+      printf("infinite: error: out of memory\n");
+      return PL_NONE;
+    }
+    memset(vals, 0xff, sizeof(uint32_t) * size);
+    for (uint32_t i = 0; i < pl_size; ++i) {
+      if (pl_vals[i] != PL_NONE) {
+        uint32_t j = (uint32_t)hl_hash(pl_keys[i]) & (size - 1);
+        while (vals[j] != PL_NONE) j = (j + 1) & (size - 1);
+        keys[j] = pl_keys[i], vals[j] = pl_vals[i];
+      }
+    }
+    free(pl_keys);
+    free(pl_vals);
+    pl_keys = keys, pl_vals = vals, pl_size = size;
+  }
+  if (pl_free_count == 0) {
+    pl_chunk **blocks =
+        realloc(pl_blocks, sizeof(pl_chunk *) * (pl_total / CHUNK_BLOCK + 1));
+    uint32_t *stack =
+        realloc(pl_free, sizeof(uint32_t) * (pl_total + CHUNK_BLOCK));
+    if (blocks != NULL) {
+      pl_blocks = blocks;
+    }
+    if (stack != NULL) {
+      pl_free = stack;
+    }
+    pl_chunk *block =
+        blocks && stack ? aligned_malloc(sizeof(pl_chunk) * CHUNK_BLOCK) : NULL;
+    if (block == NULL) {
+      printf("infinite: error: out of memory\n");
+      return PL_NONE;
+    }
+    pl_blocks[pl_total / CHUNK_BLOCK] = block;
+    for (uint32_t i = CHUNK_BLOCK; i > 0; --i) {
+      pl_free[pl_free_count++] = pl_total + i - 1;
+    }
+    pl_total += CHUNK_BLOCK;
+  }
+  uint32_t id = pl_free[--pl_free_count];
+  pl_chunk *c = pl_get(id);
+  c->cy = cy, c->cx = cx;
+  memset(c->cells, 0, sizeof(c->cells));
+  uint64_t key = (uint64_t)(uint32_t)cy << 32 | (uint32_t)cx;
+  uint32_t j = (uint32_t)hl_hash(key) & (pl_size - 1);
+  while (pl_vals[j] != PL_NONE) j = (j + 1) & (pl_size - 1);
+  pl_keys[j] = key, pl_vals[j] = id;
+  pl_used++;
+  return id;
+}
+
+/**
+ * @brief
+ * 从哈希表中删除区块并归还区块池。删除后把同一探测链上其后的表项前移，不留墓碑。
+ *
+ * @param cy 区块行坐标
+ * @param cx 区块列坐标
+ */
+void pl_remove(int32_t cy, int32_t cx) {
+  uint64_t key = (uint64_t)(uint32_t)cy << 32 | (uint32_t)cx;
+  uint32_t mask = pl_size - 1, j = (uint32_t)hl_hash(key) & mask;
+  while (pl_vals[j] != PL_NONE && pl_keys[j] != key) j = (j + 1) & mask;
+  if (pl_vals[j] == PL_NONE) {
+    return;
+  }
+  pl_free[pl_free_count++] = pl_vals[j];
+  pl_vals[j] = PL_NONE;
+  pl_used--;
+  for (uint32_t k = (j + 1) & mask; pl_vals[k] != PL_NONE; k = (k + 1) & mask) {
+    uint32_t home = (uint32_t)hl_hash(pl_keys[k]) & mask;
+    if (((k - home) & mask) >= ((k - j) & mask)) {
+      pl_keys[j] = pl_keys[k], pl_vals[j] = pl_vals[k];
+      pl_vals[k] = PL_NONE;
+      j = k;
+    }
+  }
+}
+
+/**
+ * @brief 把哈希表中全部区块的编号收集到 pl_list 中。
+ *
+ * @return int 成功为1，内存不足为0
+ */
+int pl_gather() {
+  if (pl_list_capacity < pl_used) {
+    uint32_t *list = realloc(pl_list, sizeof(uint32_t) * pl_size);
+    if (list == NULL) {
+      printf("infinite: error: out of memory\n");
+      return 0;
+    }
+    pl_list = list, pl_list_capacity = pl_size;
+  }
+  pl_list_count = 0;
+  for (uint32_t i = 0; i < pl_size; ++i) {
+    if (pl_vals[i] != PL_NONE) {
+      pl_list[pl_list_count++] = pl_vals[i];
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief
+ * 活细胞到达区块边缘时，为下一代可能出生细胞的相邻区块（含对角）预先插入全死区块。
+ *
+ * @return int 成功为1，内存不足为0，此时已插入的全死区块不影响结果
+ */
+int pl_grow() {
+  if (!pl_gather()) {
+    return 0;
+  }
+  uint32_t n = pl_list_count;
+  int ok = 1;
+  for (uint32_t i = 0; i < n; ++i) {
+    const pl_chunk *c = pl_get(pl_list[i]);
+    uint64_t any = 0;
+    for (int r = 0; r < CHUNK; ++r) {
+      any |= c->cells[r];
+    }
+    uint64_t top = c->cells[0], bottom = c->cells[CHUNK - 1];
+    int32_t cy = c->cy, cx = c->cx;
+    if (top) ok &= pl_insert(cy - 1, cx) != PL_NONE;
+    if (bottom) ok &= pl_insert(cy + 1, cx) != PL_NONE;
+    if (any & 1) ok &= pl_insert(cy, cx - 1) != PL_NONE;
+    if (any >> 63) ok &= pl_insert(cy, cx + 1) != PL_NONE;
+    if (top & 1) ok &= pl_insert(cy - 1, cx - 1) != PL_NONE;
+    if (top >> 63) ok &= pl_insert(cy - 1, cx + 1) != PL_NONE;
+    if (bottom & 1) ok &= pl_insert(cy + 1, cx - 1) != PL_NONE;
+    if (bottom >> 63) ok &= pl_insert(cy + 1, cx + 1) != PL_NONE;
+    if (!ok) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief
+ * 计算一个区块的下一代，写入其 next 。先从相邻八个区块取出周围一圈细胞，拼成
+ * 66 行、每行三个字的局部地图，再用与按位并行引擎相同的行和与规则函数计算。
+ *
+ * @param c 区块地址
+ */
+void pl_compute(pl_chunk *c) {
+  const pl_chunk *nb[3][3];
+  for (int dy = -1; dy <= 1; ++dy) {
+    for (int dx = -1; dx <= 1; ++dx) {
+      uint32_t id = dy || dx ? pl_find(c->cy + dy, c->cx + dx) : PL_NONE;
+      nb[dy + 1][dx + 1] = dy || dx ? (id == PL_NONE ? NULL : pl_get(id)) : c;
+    }
+  }
+  uint64_t rows[CHUNK + 2][3], s0[CHUNK + 2], s1[CHUNK + 2];
+  for (int r = 0; r < CHUNK + 2; ++r) {
+    int dy = r == 0 ? 0 : r == CHUNK + 1 ? 2 : 1;
+    int rr = r == 0 ? CHUNK - 1 : r == CHUNK + 1 ? 0 : r - 1;
+    for (int dx = 0; dx < 3; ++dx) {
+      rows[r][dx] = nb[dy][dx] ? nb[dy][dx]->cells[rr] : 0;
+    }
+    row_sum(&rows[r][1], &s0[r], &s1[r], 1);
+  }
+  for (int r = 0; r < CHUNK; ++r) {
+    rule_fn(&s0[r], &s1[r], &s0[r + 1], &s1[r + 1], &s0[r + 2], &s1[r + 2],
+             &rows[r + 1][1], &c->next[r], 1);
+  }
+}
+
+/**
+ * @brief 计算 pl_list 中第 id 段区块的下一代，开启统计时随即统计各区块。
+ *
+ * @param id 线程编号
+ */
+void pl_band(int id) {
+  uint32_t i0 = (uint32_t)((uint64_t)pl_list_count * id / threads);
+  uint32_t i1 = (uint32_t)((uint64_t)pl_list_count * (id + 1) / threads);
+  memset(&band_stats[id], 0, sizeof(life_stats));
+  for (uint32_t i = i0; i < i1; ++i) {
+    pl_chunk *c = pl_get(pl_list[i]);
+    pl_compute(c);
+    for (int r = 0; r < CHUNK && stats_on; ++r) {
+      stats_row_fn(&c->cells[r], &c->next[r], 1, (long long)c->cy * CHUNK + r,
+                   (long long)c->cx * 64, ~(uint64_t)0, &band_stats[id]);
+    }
+  }
+}
+
+/**
+ * @brief
+ * 无限平面前进一代。先为边缘有活细胞的区块补齐相邻区块，再由线程池计算所有区块的下一代，最后统一替换，并把变为全死的区块归还区块池；
+ * 池中在用的区块过少时由 pl_compact 释放多余的内存，因此内存只与活细胞分布有关。内存不足时不前进。
+ *
+ * @return int 成功为1，内存不足为0
+ */
+int pl_step() {
+  if (!pl_grow() || !pl_gather()) {
+    return 0;
+  }
+  pool_run(pl_band);
+  for (uint32_t i = 0; i < pl_list_count; ++i) {
+    pl_chunk *c = pl_get(pl_list[i]);
+    uint64_t any = 0;
+    for (int r = 0; r < CHUNK; ++r) {
+      c->cells[r] = c->next[r];
+      any |= c->next[r];
+    }
+    if (!any) {
+      pl_remove(c->cy, c->cx);
+    }
+  }
+  pl_compact();
+  return 1;
+}
+
+/**
+ * @brief
+ * 区块池在用的区块不足八分之一时整理：把在用区块依次复制到新分配的块中，按在用数重建哈希表，再释放原有的块、哈希表与
+ * pl_list 。空闲区块散布在各块中，逐块归还很少能凑成整块，整理后池与哈希表都随活细胞减少而缩小。
+ * 区块编号随之改变，因此只在 pl_step 末尾调用，此时没有别处保存编号。内存不足时保持原样。
+ *
+ */
+void pl_compact() {
+  if (pl_total <= CHUNK_BLOCK || pl_used * 8 >= pl_total) {
+    return;
+  }
+  if (pl_used == 0) {
+    pl_reset();
+    return;
+  }
+  uint32_t count = (pl_used + CHUNK_BLOCK - 1) / CHUNK_BLOCK, made = 0;
+  uint32_t size = 1024;
+  while (size < pl_used * 4) {
+    size *= 2;
+  }
+  pl_chunk **blocks = malloc(sizeof(pl_chunk *) * count);
+  uint32_t *stack = malloc(sizeof(uint32_t) * count * CHUNK_BLOCK);
+  uint64_t *keys = malloc(sizeof(uint64_t) * size);
+  uint32_t *vals = malloc(sizeof(uint32_t) * size);
+  while (blocks != NULL && made < count &&
+         (blocks[made] = aligned_malloc(sizeof(pl_chunk) * CHUNK_BLOCK))) {
+    made++;
+  }
+  if (made < count || stack == NULL || keys == NULL || vals == NULL) {
+    while (made > 0) {
+      aligned_free(blocks[--made]);
+    }
+    free(blocks);
+    free(stack);
+    free(keys);
+    free(vals);
+    return;
+  }
+  memset(vals, 0xff, sizeof(uint32_t) * size);
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < pl_size; ++i) {
+    if (pl_vals[i] != PL_NONE) {
+      blocks[n / CHUNK_BLOCK][n % CHUNK_BLOCK] = *pl_get(pl_vals[i]);
+      uint32_t j = (uint32_t)hl_hash(pl_keys[i]) & (size - 1);
+      while (vals[j] != PL_NONE) j = (j + 1) & (size - 1);
+      keys[j] = pl_keys[i], vals[j] = n++;
+    }
+  }
+  pl_reset();
+  pl_blocks = blocks, pl_free = stack, pl_keys = keys, pl_vals = vals;
+  pl_total = count * CHUNK_BLOCK, pl_size = size, pl_used = n;
+  for (uint32_t i = pl_total; i > n; --i) {
+    pl_free[pl_free_count++] = i - 1;
+  }
+}
+
+/**
+ * @brief
+ * 由当前地图重建无限平面。地图第 i 行第 w 个字对应区块 (i / 64, w)
+ * 。每行最后一个字先截去多余位，不依赖多余位为 0 。内存不足时清空平面。
+ *
+ * @return int 成功为1，内存不足为0
+ */
+int pl_from_map() {
+  pl_reset();
+  uint64_t tail = tail_mask();
+  for (int i = 0; i < row; ++i) {
+    const uint64_t *p = row_ptr(map, i);
+    for (int w = 0; w < words; ++w) {
+      uint64_t x = w == words - 1 ? p[w] & tail : p[w];
+      uint32_t id = x ? pl_insert(i / CHUNK, w) : 0;
+      if (id == PL_NONE) {
+        pl_reset();
+        return 0;
+      }
+      if (x) {
+        pl_get(id)->cells[i % CHUNK] = x;
+      }
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief 把无限平面中与地图重合的部分写回地图。
+ *
+ */
+void pl_to_map() {
+  uint64_t tail = tail_mask();
+  memset(map, 0, (size_t)(row + 2) * stride * sizeof(uint64_t));
+  for (uint32_t i = 0; i < pl_size; ++i) {
+    if (pl_vals[i] == PL_NONE) {
+      continue;
+    }
+    const pl_chunk *c = pl_get(pl_vals[i]);
+    if (c->cx < 0 || c->cx >= words || c->cy < 0 ||
+        (long long)c->cy * CHUNK >= row) {
+      continue;
+    }
+    for (int r = 0; r < CHUNK && c->cy * CHUNK + r < row; ++r) {
+      row_ptr(map, c->cy * CHUNK + r)[c->cx] =
+          c->cx == words - 1 ? c->cells[r] & tail : c->cells[r];
+    }
+  }
+}
+
+/**
+ * @brief 在输出缓冲末尾追加 n 个字节，容量不足时扩大。缓冲在各帧之间复用。
+ *
+ * @param s 字节
+ * @param n 字节数
+ */
+void out_put(const char *s, size_t n) {
+  if (out_len + n > out_cap) {
+    size_t cap = out_cap ? out_cap : 1 << 16;
+    while (cap < out_len + n) {
+      cap *= 2;
+    }
+    char *p = realloc(out_buf, cap);
+    if (p == NULL) {
+      out_flush();
+      if (n > out_cap) {
+        fwrite(s, 1, n, stdout);
+        return;
+      }
+    } else {
+      out_buf = p, out_cap = cap;
+    }
+  }
+  memcpy(out_buf + out_len, s, n);
+  out_len += n;
+}
+
+/**
+ * @brief 按 printf 的格式在输出缓冲末尾追加字符串。
+ *
+ * @param fmt 格式
+ */
+void out_printf(const char *fmt, ...) {
+  char s[LEN];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(s, sizeof(s), fmt, ap);
+  va_end(ap);
+  if (n > 0) {
+    out_put(s, n < LEN ? (size_t)n : LEN - 1);
+  }
+}
+
+/**
+ * @brief 先冲掉 stdio 中尚未输出的内容，再用 write 一次写出输出缓冲。
  *
- * @param buf 输入字符串存放位置
  */
-void get_input(char *buf) {
-  fgets(buf, LEN, stdin);
-  buf[strlen(buf) - 1] = '\0';
+void out_flush() {
+  fflush(stdout);
+  size_t done = 0;
+  while (done < out_len) {
+    long n = (long)write(STDOUT_FILENO, out_buf + done, out_len - done);
+    if (n <= 0) {
+      break;
+    }
+    done += (size_t)n;
+  }
+  out_len = 0;
 }
+
 /**
- * @brief 显示帮助界面。
+ * @brief 清屏并把光标移到左上角，使用 ANSI 转义序列，不调用外部命令。
  *
  */
-void help() {
-  printf("    [\\h]    print command [h]ints\n");
-  printf("    [\\p]    [p]rint current map\n");
-  printf("    [\\l <filename>]  [l]oad map from a local file\n");
-  printf("    [\\s <filename>]  [s]ave map to local\n");
-  printf("    [\\d]    enter [d]esign mode\n");
-  printf("    [\\q]    [q]uit design mode\n");
-  printf("    [\\g]    [g]enerate next generation of life\n");
-  printf("    [\\r]    enter auto_[r]un mode\n");
-  printf("    [\\e]    [e]xit auto_run mode\n");
-  printf("    [end]   [end] the game\n");
+void clear_screen() {
+  out_put("\x1b[H\x1b[2J", 7);
+  out_flush();
+  screen_valid = 0;
 }
 
 /**
- * @brief 显示初始欢迎界面。
+ * @brief 初始化终端。 Windows 下开启控制台对 ANSI 转义序列的支持。
  *
  */
-void welcome() {
-  char *s = "************************************************\n";
-  printf("%s%s", s, s);
-  printf("                GAME OF LIFE\n\n");
-  printf("          Welcome to the game of life.\n");
-  printf("You'll experience the joy of Cellular Automaton.\n\n");
-  printf("                ARE YOU READY\n\n");
-  printf("%s%s", s, s);
-  help();
+void term_init() {
+#ifdef _WIN32
+  HANDLE h = GetStdHandle(STD_OUTPUT_HANDLE);
+  DWORD mode;
+  if (GetConsoleMode(h, &mode)) {
+    SetConsoleMode(h, mode | 0x0004);
+  }
+#endif
 }
 
 /**
- * @brief
- * 将一个字符串分解为两个部分。第一个部分为去掉空白字符后的头部到第一个空白字符或尾部之前。第二个部分为第一个空白字符后到尾部去掉空白字符之前。可用于分解命令，获取两个整数等。当分解命令时，可用于处理带空格的文件名及路径。当获取两个整数时，可通过一系列判断来确保输入一定是两个整数。
+ * @brief 取终端的列数与行数，无法取得时为 80x24 。
  *
- * @param cmd 输入的命令（通常为获取的一整行字符串）
- * @param buf 分解的第一个字符串
- * @param filename 分解的第二个字符串
+ * @param w 列数存放位置
+ * @param h 行数存放位置
  */
-void get_command(char *cmd, char *buf, char *filename) {
-  convert_lower_case(cmd);
-  int t = 0, len = (int)strlen(cmd), i = 0, j = 0;
-  while (t < len && (cmd[t] == ' ' || cmd[t] == '\t')) ++t;
-  while (t < len && cmd[t] != ' ' && cmd[t] != '\t') buf[i++] = cmd[t++];
-  buf[i] = '\0';
-  while (t < len && (cmd[t] == ' ' || cmd[t] == '\t')) ++t;
-  while (t < len) filename[j++] = cmd[t++];
-  j--;
-  while (j >= 0 && filename[j] == ' ' || filename[j] == '\t') j--;
-  filename[j + 1] = '\0';
+void term_size(int *w, int *h) {
+  *w = 80, *h = 24;
+#ifdef _WIN32
+  CONSOLE_SCREEN_BUFFER_INFO info;
+  if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info)) {
+    *w = info.srWindow.Right - info.srWindow.Left + 1;
+    *h = info.srWindow.Bottom - info.srWindow.Top + 1;
+  }
+#else
+  struct winsize ws;
+  if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col && ws.ws_row) {
+    *w = ws.ws_col, *h = ws.ws_row;
+  }
+#endif
 }
 
 /**
- * @brief 将输入的字符串s中的字母全转换为小写。
+ * @brief 追加一个盲文字符的 UTF-8 编码（ U+2800 加点位）。
  *
- * @param s 需要转换的字符串
+ * @param dots 点位，第 k 位为盲文第 k + 1 点
  */
-void convert_lower_case(char *s) {
-  int len = (int)strlen(s);
-  for (int i = 0; i < len; ++i) {
-    if (s[i] >= 'A' && s[i] <= 'Z') {
-      s[i] += 32;
-    }
-  }
+void out_braille(int dots) {
+  char s[3] = {(char)0xe2, (char)(0xa0 | dots >> 6), (char)(0x80 | (dots & 63))};
+  out_put(s, 3);
 }
 
 /**
  * @brief
- * 加载本地地图。如果因系统原因或输入原因无法加载，报无文件错误。如果文件内行数与列数不合法或超过范围，报错。对于各细胞的存活情况。读取浮点数，大于0则读取为存活，否则读取为死亡。读取至已经读取结束或文件尾部。读取完成时，剩下细胞默认死亡。
+ * 计算盲文模式下一个字符的点位。一个字符对应地图上 4 行 2 列的细胞，地图外的细胞视为死亡。
  *
- * @param filename 需要加载的文件名
+ * @param grid 地图或其副本
+ * @param i 左上细胞的行
+ * @param j 左上细胞的列
+ * @return int 点位
  */
-void load_map(char *filename) {
-  FILE *fp = fopen(filename, "r");
-  if (fp == NULL) {
-    printf("load_map: error: no such file\n");
-    fclose(fp);
-    return;
-  }
-  int x = 0, y = 0;
-  fscanf(fp, "%d%d", &x, &y);
-  if (x <= 0 || y <= 0) {
-    printf("load_map: error: illegal map\n");
-    return;
-  }
-  if (x >= KMAX || y >= KMAX) {
-    printf("load_map: error: map is too large\n");
-    return;
-  }
-  row = x, col = y;
-  double buf;
-  for (int i = 0; i < row; ++i) {
-    for (int j = 0; j < col; ++j) {
-      buf = 0;
-      fscanf(fp, "%lf", &buf);
-      if (buf > 0) {
-        map[i][j] = 1;
-      } else {
-        map[i][j] = 0;
+int braille_dots(const uint64_t *grid, int i, int j) {
+  static const int bit[4][2] = {{0x01, 0x08}, {0x02, 0x10}, {0x04, 0x20},
+                                {0x40, 0x80}};
+  int dots = 0;
+  for (int a = 0; a < 4 && i + a < row; ++a) {
+    for (int b = 0; b < 2 && j + b < col; ++b) {
+      if (grid_cell(grid, i + a, j + b)) {
+        dots |= bit[a][b];
       }
     }
   }
-  fclose(fp);
-  is_map = 1;
-  printf("row = %d, column = %d\n", row, col);
-  printf("loading complete\n");
+  return dots;
 }
 
 /**
- * @brief 保存地图至本地。如无地图则报错退出。可能因系统原因保存失败。
+ * @brief
+ * 绘制自动运行模式的一帧。第一行为状态，其下为地图在视口中的部分。地图能以每格 GLYPH_W 列放进终端时逐格显示，否则（或
+ * \view braille 时）每个盲文字符显示 4x2 个细胞。视口大小取终端大小，左上角由 \view
+ * 设置。与上一帧相比只重绘变化的字符，用 ANSI 序列移动光标，整帧拼在输出缓冲中一次写出。终端大小、显示方式或视口变化时整屏重绘。
  *
- * @param filename 需要保存的文件名
+ * @param status 状态行文字
+ * @param grid 要显示的地图或其副本，布局与 map 相同
  */
-void save_map(char *filename) {
-  if (!is_map) {
-    is_map_error();
-    return;
-  }
-  FILE *fp = fopen(filename, "w");
-  if (fp == NULL) {
-    printf("save_map: error: failed to save file\n");
-    fclose(fp);
-    return;
+void render_frame(const char *status, const uint64_t *grid) {
+  int w, h;
+  term_size(&w, &h);
+  int cells_h = h - 2 > 1 ? h - 2 : 1;
+  int braille = view_mode == VIEW_BRAILLE ||
+                (view_mode == VIEW_AUTO &&
+                 ((long long)col * GLYPH_W > w || row > cells_h));
+  int ch = braille ? 4 : 1, cw = braille ? 2 : 1;
+  int glyph_w = braille ? 1 : GLYPH_W;
+  int r0 = view_row < row ? view_row / ch * ch : 0;
+  int c0 = view_col < col ? view_col / cw * cw : 0;
+  int vr = (row - r0 + ch - 1) / ch, vc = (col - c0 + cw - 1) / cw;
+  vr = vr < cells_h ? vr : cells_h;
+  vc = vc < w / glyph_w ? vc : w / glyph_w;
+  if (vc < 1) {
+    vc = 1;
   }
-  fprintf(fp, "%d %d\n", row, col);
-  for (int i = 0; i < row; ++i) {
-    for (int j = 0; j < col; ++j) {
-      fprintf(fp, "%d ", map[i][j]);
+  size_t n = (size_t)vr * vc;
+  if (!screen_valid || braille != screen_braille || r0 != screen_r0 ||
+      c0 != screen_c0 || vr != screen_rows || vc != screen_cols) {
+    if (n > screen_cap) {
+      int16_t *p = realloc(screen, n * sizeof(int16_t));
+      if (p == NULL) {
+        return;
+      }
+      screen = p, screen_cap = n;
+    }
+    for (size_t k = 0; k < n; ++k) {
+      screen[k] = -1;
     }
-    fprintf(fp, "\n");
+    out_put("\x1b[H\x1b[2J", 7);
+    screen_valid = 1, screen_braille = braille;
+    screen_r0 = r0, screen_c0 = c0, screen_rows = vr, screen_cols = vc;
   }
-  fclose(fp);
-  printf("saving successfully\n");
-}
-
-/**
- * @brief 计算地图上某点周围存活细胞的数量。对边界情况分类讨论。
- *
- * @param x x坐标
- * @param y y坐标
- * @return int 该点周围存活细胞的数量
- */
-int count_alive_neighbors(int x, int y) {
-  int alive = 0;
-  for (int i = x - 1; i <= x + 1; ++i) {
-    if (i < 0 || i >= row) continue;
-    for (int j = y - 1; j <= y + 1; ++j) {
-      if (j < 0 || j >= col || (i == x && j == y)) continue;
-      alive += map[i][j];
+  out_printf("\x1b[1;1H%s\x1b[K", status);
+  int cur_y = -1, cur_x = -1;
+  for (int y = 0; y < vr; ++y) {
+    for (int x = 0; x < vc; ++x) {
+      int i = r0 + y * ch, j = c0 + x * cw;
+      int code = braille ? braille_dots(grid, i, j) : grid_cell(grid, i, j);
+      int16_t *old = &screen[(size_t)y * vc + x];
+      if (*old == code) {
+        continue;
+      }
+      *old = (int16_t)code;
+      if (y != cur_y || x != cur_x) {
+        out_printf("\x1b[%d;%dH", y + 2, x * glyph_w + 1);
+      }
+      if (braille) {
+        out_braille(code);
+      } else {
+        out_put(code ? "■ " : "□ ", code ? sizeof("■ ") - 1 : sizeof("□ ") - 1);
+      }
+      cur_y = y, cur_x = x + 1;
     }
   }
-  return alive;
+  out_printf("\x1b[%d;1H", vr + 2);
+  out_flush();
 }
 
 /**
  * @brief
- * 生成下一代细胞图。先计算各细胞周围存货细胞数，再根据游戏规则更新细胞图。
+ * 设置自动运行模式的显示方式或视口。参数为 auto 、 cells 、 braille
+ * ，或视口左上角细胞的行与列；为空时显示当前设置。
  *
+ * @param arg 参数
  */
-void generate_next_status() {
-  if (!is_map) {
-    is_map_error();
+void set_view(char *arg) {
+  int r, c;
+  char extra;
+  if (strcmp(arg, "auto") == 0) {
+    view_mode = VIEW_AUTO;
+  } else if (strcmp(arg, "cells") == 0) {
+    view_mode = VIEW_CELLS;
+  } else if (strcmp(arg, "braille") == 0) {
+    view_mode = VIEW_BRAILLE;
+  } else if (sscanf(arg, "%d %d %c", &r, &c, &extra) == 2 && r >= 0 &&
+             c >= 0) {
+    view_row = r, view_col = c;
+  } else if (strcmp(arg, EMPTY) != 0) {
+    printf("set_view: error: unknown view: %s\n", arg);
     return;
   }
-  for (int i = 0; i < row; i++)
-    for (int j = 0; j < col; j++)
-      alive_neighbors[i][j] = count_alive_neighbors(i, j);
-  for (int i = 0; i < row; ++i) {
-    for (int j = 0; j < col; ++j) {
-      if (map[i][j] == 1 &&
-          (alive_neighbors[i][j] < 2 || alive_neighbors[i][j] > 3)) {
-        map[i][j] = 0;
-      } else if (map[i][j] == 0 && alive_neighbors[i][j] == 3) {
-        map[i][j] = 1;
-      }
-    }
-  }
+  screen_valid = 0;
+  printf("view = %s, origin = (%d, %d)\n",
+         view_mode == VIEW_CELLS     ? "cells"
+         : view_mode == VIEW_BRAILLE ? "braille"
+                                     : "auto",
+         view_row, view_col);
 }
 
 /**
- * @brief 打印地图。如已有地图，则打印。否则输出无地图错误。
+ * @brief
+ * 打印地图。如已有地图，则打印。否则输出无地图错误。各行拼在输出缓冲中，每满
+ * RD_BLOCK 字节用 write 写出一次，而不是每个细胞调用一次 printf 。
  *
  */
 void print_map() {
@@ -332,21 +6691,32 @@ void print_map() {
     is_map_error();
     return;
   }
+  PROF_ENTER(PROF_RENDER);
   for (int i = 0; i < row; i++) {
+    const uint64_t *p = row_ptr(map, i);
     for (int j = 0; j < col; j++) {
-      printf(map[i][j] > 0 ? "■ " : "□ ");
+      if (p[j >> 6] >> (j & 63) & 1) {
+        out_put("■ ", sizeof("■ ") - 1);
+      } else {
+        out_put("□ ", sizeof("□ ") - 1);
+      }
+    }
+    out_put("\n", 1);
+    if (out_len >= RD_BLOCK) {
+      out_flush();
     }
-    printf("\n");
   }
+  out_flush();
+  PROF_LEAVE(PROF_RENDER, (double)row * col);
 }
 
 /**
  * @brief 进入地图设计模式。运用循环进行用户输入，用 is_design
- * 判断输入为行列数还是坐标位置。用户输入需为小于120的整数。有非法输入与输入数过大两种输入错误。设计结束后提示用户保存。
+ * 判断输入为行列数还是坐标位置。用户输入需为小于 KMAX 的整数，且地图所需内存可以分配。有非法输入与输入数过大两种输入错误。设计结束后提示用户保存。
  *
  */
 void design_map() {
-  system("cls");
+  clear_screen();
   char buf[LEN], s1[LEN], s2[LEN];
   int len1, len2, x, y, is_digit;
   printf("Enter design mode.\n");
@@ -359,7 +6729,9 @@ void design_map() {
     } else {
       printf("\n[D] (use [\\q] to quit) -> ");
     }
-    get_input(buf);
+    if (!get_input(buf)) {
+      break;
+    }
     get_command(buf, s1, s2);
     if (strcmp(s1, QUIT) == 0 && strcmp(s2, EMPTY) == 0) {
       break;
@@ -385,6 +6757,10 @@ void design_map() {
       printf("design_map: error: format error\n");
       continue;
     }
+    if (len1 > 9 || len2 > 9) {
+      printf("design_map: error: number too large\n");
+      continue;
+    }
     x = 0, y = 0;
     for (int i = len1 - 1; i >= 0; i--) {
       x += (s1[i] - '0') * (int)pow(10, len1 - 1 - i);
@@ -406,69 +6782,498 @@ void design_map() {
       continue;
     }
     if (!is_design) {
-      is_design = 1;
-      row = x, col = y;
-      for (int i = 0; i < row; ++i) {
-        for (int j = 0; j < col; ++j) {
-          map[i][j] = 0;
-        }
+      if (!clear_map(x, y)) {
+        printf("design_map: error: map is too large\n");
+        continue;
       }
+      is_design = 1;
       printf("Set alive cells. (EX: 0 0)\n");
       is_map = 1;
       print_map();
     } else {
-      map[x][y] = 1;
+      set_cell(x, y, 1);
     }
   }
-  system("cls");
+  clear_screen();
   printf("--> You have quited the design mode.\n");
   if (is_design) {
+    engine_attach();
     print_map();
     printf("(Use [\\s <filename>] to save map to local.)\n");
   }
 }
 
 /**
- * @brief 进入自动运行模式。无地图则退出。用 is_run
- * 标记运行状态，1为正在运行，0为正在暂停。自动运行间隔2秒，每次生成前清屏，键入
- * ENTER 后暂停。暂停时键入 ENTER 继续，键入 [\e] 退出该模式，其它为输入错误。
+ * @brief
+ * 切换终端的按键模式。开启时关闭行缓冲与回显，按键不必等待回车即可读到；关闭时恢复进入前的设置。
+ * Windows 的 getch 本身不经行缓冲，无需设置。
+ *
+ * @param on 1为开启，0为恢复
+ */
+void term_raw(int on) {
+#ifndef _WIN32
+  static struct termios saved;
+  static int active = 0;
+  if (on && !active && tcgetattr(STDIN_FILENO, &saved) == 0) {
+    struct termios t = saved;
+    t.c_lflag &= ~(tcflag_t)(ICANON | ECHO);
+    t.c_cc[VMIN] = 1, t.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSANOW, &t);
+    active = 1;
+  } else if (!on && active) {
+    tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+    active = 0;
+  }
+#else
+  (void)on;
+#endif
+}
+
+/**
+ * @brief
+ * 在 timeout 毫秒内等待一次按键。 POSIX 系统用 poll 等待标准输入， Windows 用 kbhit
+ * 轮询。按键一到立即返回，不必等到超时。标准输入读到结束、挂断或出错后记住这一状态，以后不再等待，直接返回
+ * KEY_EOF 。
+ *
+ * @param timeout 最长等待的毫秒数，0 为只检查不等待，负数为一直等待
+ * @return int 按键的字符，超时为 -1 ，输入结束为 KEY_EOF
+ */
+int read_key(int timeout) {
+  static int closed = 0;
+  if (closed) {
+    return KEY_EOF;
+  }
+#ifdef _WIN32
+  double end = now_seconds() + timeout / 1000.0;
+  while (!kbhit()) {
+    if (timeout >= 0 && now_seconds() >= end) {
+      return -1;
+    }
+    Sleep(1);
+  }
+  return getch();
+#else
+  struct pollfd p = {STDIN_FILENO, POLLIN, 0};
+  unsigned char c;
+  int ready = poll(&p, 1, timeout);
+  if (ready < 0 && errno != EINTR) {
+    closed = 1;
+    return KEY_EOF;
+  } else if (ready <= 0) {
+    return -1;
+  }
+  ssize_t got = read(STDIN_FILENO, &c, 1);
+  if (got == 1) {
+    return c;
+  } else if (got == 0 || (errno != EINTR && errno != EAGAIN) ||
+             (p.revents & (POLLHUP | POLLERR | POLLNVAL))) {
+    closed = 1;
+    return KEY_EOF;
+  }
+  return -1;
+#endif
+}
+
+/**
+ * @brief 显示或设置自动运行模式每秒生成的代数。
+ *
+ * @param arg 正数、 max 或空， max 表示不限速度
+ */
+void set_speed(char *arg) {
+  double v;
+  char *end;
+  if (strcmp(arg, "max") == 0) {
+    sim_speed = 0;
+  } else if (strcmp(arg, EMPTY) != 0) {
+    v = strtod(arg, &end);
+    if (*end != '\0' || !(v > 0) || v > 1e9) {
+      printf("set_speed: error: expected a positive number or max\n");
+      return;
+    }
+    sim_speed = v;
+  }
+  if (sim_speed > 0) {
+    printf("speed = %g generations/s\n", sim_speed);
+  } else {
+    printf("speed = max\n");
+  }
+}
+
+/**
+ * @brief 显示或设置自动运行模式每秒最多重绘的次数。
+ *
+ * @param arg 0.1 到 1000 之间的数或空
+ */
+void set_fps(char *arg) {
+  if (strcmp(arg, EMPTY) != 0) {
+    char *end;
+    double v = strtod(arg, &end);
+    if (*end != '\0' || !(v >= 0.1 && v <= 1000)) {
+      printf("set_fps: error: expected a number from 0.1 to 1000\n");
+      return;
+    }
+    frame_rate = v;
+  }
+  printf("fps = %g\n", frame_rate);
+}
+
+/**
+ * @brief
+ * 模拟线程把当前地图复制进自己独占的一帧，再与交换位中的帧互换，并标记为新帧。只有一次原子交换，不会等待显示线程。
+ *
+ */
+void publish_frame() {
+  frame *f = &frames[frame_back];
+  memcpy(f->cells, map, (size_t)(row + 2) * stride * sizeof(uint64_t));
+  f->generation = generation;
+  if (!describe_history(f->note)) {
+    f->note[0] = '\0';
+  }
+  frame_back = atomic_exchange(&frame_spare, frame_back | FRAME_FRESH) & 3;
+}
+
+/**
+ * @brief
+ * 模拟线程：按 sim_speed 连续生成，与显示无关。显示线程置 frame_wanted
+ * 时，在刚算完的一代之后发布一帧；单步时每步之后都发布。暂停时在条件变量上等待，直到继续、单步、要求一帧或退出；限速时用带超时的等待代替
+ * sleep ，控制状态一变立即醒来。检测到灭绝、静物或振荡时自行暂停并发布一帧。有 run_target
+ * 时不限速度，检测到周期后跳过整周期，到达目标代数时暂停； HashLife 引擎最后不足一步的代数单独前进，不会越过目标。
+ * 一代也没能生成（无限平面内存不足）时暂停。
+ *
+ * @param arg 未使用
+ * @return void* NULL
+ */
+void *sim_main(void *arg) {
+  (void)arg;
+  int settled = period != 0;
+  double next_gen = now_seconds();
+  pthread_mutex_lock(&run_lock);
+  while (!run_stop) {
+    if (frame_wanted) {
+      frame_wanted = 0;
+      pthread_mutex_unlock(&run_lock);
+      publish_frame();
+      pthread_mutex_lock(&run_lock);
+      continue;
+    }
+    if (run_paused && run_steps == 0) {
+      pthread_cond_wait(&run_cond, &run_lock);
+      next_gen = now_seconds();
+      continue;
+    }
+    if (!run_paused && run_target >= 0 && generation >= run_target) {
+      run_target = -1, run_paused = 1, frame_wanted = 1;
+      continue;
+    }
+    double now = now_seconds();
+    if (!run_paused && sim_speed > 0 && run_target < 0 && now < next_gen) {
+      struct timespec ts;
+      clock_gettime(CLOCK_REALTIME, &ts);
+      double t = ts.tv_nsec * 1e-9 + (next_gen - now);
+      ts.tv_sec += (time_t)t;
+      ts.tv_nsec = (long)((t - floor(t)) * 1e9);
+      pthread_cond_timedwait(&run_cond, &run_lock, &ts);
+      continue;
+    }
+    int step = run_paused;
+    if (step) {
+      run_steps--;
+    }
+    double speed = run_target >= 0 ? 0 : sim_speed;
+    long long left = step || run_target < 0 ? 0 : run_target - generation;
+    pthread_mutex_unlock(&run_lock);
+    long long from = generation;
+    if (left > 0 && (period || (engine == ENGINE_HASHLIFE &&
+                                left < (1ll << hl_k)))) {
+      advance(left);
+    } else {
+      generate_next_status();
+    }
+    next_gen = speed > 0 ? next_gen + 1 / speed : now;
+    if (next_gen < now - 1) {
+      next_gen = now;
+    }
+    pthread_mutex_lock(&run_lock);
+    if (generation == from) {
+      run_target = -1, run_paused = 1, run_steps = 0;
+    }
+    frame_wanted |= step || generation == from;
+    if (!settled && period) {
+      settled = 1, frame_wanted = 1;
+      run_paused |= run_target < 0;
+    }
+  }
+  pthread_mutex_unlock(&run_lock);
+  return NULL;
+}
+
+/**
+ * @brief
+ * 修改模拟线程的控制状态并唤醒它。显示线程只在按键或需要新帧时调用，持锁时间极短。
+ *
+ * @param paused 新的暂停状态， -1 为不变
+ * @param steps 增加的单步代数
+ * @param want 是否要求一帧
+ * @param stop 是否退出
+ */
+void sim_control(int paused, int steps, int want, int stop) {
+  pthread_mutex_lock(&run_lock);
+  if (paused >= 0) {
+    run_paused = paused;
+  }
+  run_steps += steps;
+  frame_wanted |= want;
+  run_stop |= stop;
+  pthread_cond_signal(&run_cond);
+  pthread_mutex_unlock(&run_lock);
+}
+
+/**
+ * @brief
+ * 进入自动运行模式。无地图则退出。生成在模拟线程 sim_main 中进行，本线程只负责显示与按键：每隔 1 / frame_rate
+ * 秒要求一帧，模拟线程算完当前一代后经三缓冲交来，本线程用原子交换取走最新的一帧并由 render_frame
+ * 重绘。显示慢或终端阻塞时模拟不受影响，只是中间的代不被显示。等待时用 read_key
+ * ，按键立即生效：回车或空格暂停或继续， n 在暂停时生成一代， + 、 - 把速度加倍或减半， e 或 q
+ * 退出该模式；输入结束时无论是否暂停都退出。地图灭绝、成为静物或进入振荡时在状态行显示检测结果并自动暂停一次。
+ * 给出目标代数时全速运行，状态行显示目标、每秒代数与预计剩余时间，到达后暂停。
  *
+ * @param target 目标代数， -1 为没有目标
  */
-void auto_run() {
+void auto_run(long long target) {
   if (!is_map) {
     is_map_error();
     printf("Exit auto_run mode...\n");
     return;
   }
-  int is_run = 1;
-  char buff[LEN], s1[LEN], s2[LEN];
+  size_t bytes = (size_t)(row + 2) * stride * sizeof(uint64_t);
+  for (int k = 0; k < 3; ++k) {
+    frames[k].cells = aligned_malloc(bytes);
+    if (frames[k].cells == NULL) {
+      while (k-- > 0) {
+        aligned_free(frames[k].cells);
+      }
+      printf("auto_run: error: out of memory\n");
+      return;
+    }
+  }
+  int front = 0, paused = 0, waiting = 1;
+  frame_back = 1;
+  atomic_store(&frame_spare, 2);
+  run_paused = 0, run_steps = 0, run_stop = 0, frame_wanted = 1;
+  run_target = target;
+  long long gen0 = generation;
+  double time0 = now_seconds();
+  pthread_t sim;
+  if (pthread_create(&sim, NULL, sim_main, NULL) != 0) {
+    for (int k = 0; k < 3; ++k) {
+      aligned_free(frames[k].cells);
+    }
+    printf("auto_run: error: failed to start the simulation thread\n");
+    return;
+  }
+  char status[2 * LEN], speed[96];
+  double next_frame = now_seconds() + 1 / frame_rate;
+  term_raw(1);
+  clear_screen();
   while (1) {
-    if (is_run) {
-      system("cls");
-      generate_next_status();
-      printf("Press ENTER to suspend.\n");
-      print_map();
-      sleep(2);
-      if (kbhit()) {
-        if (getch() == '\r') {
-          is_run = 0;
-        }
+    double now = now_seconds();
+    if (atomic_load(&frame_spare) & FRAME_FRESH) {
+      front = atomic_exchange(&frame_spare, front) & 3;
+      pthread_mutex_lock(&run_lock);
+      paused = run_paused;
+      double s = sim_speed;
+      target = run_target;
+      pthread_mutex_unlock(&run_lock);
+      long long g = frames[front].generation;
+      double rate = (g - gen0) / (now - time0 > 1e-9 ? now - time0 : 1e-9);
+      if (target >= 0) {
+        snprintf(speed, sizeof(speed), "max to %lld (%.4g/s, ETA %.1f s)",
+                 target, rate, rate > 0 ? (target - g) / rate : 0.0);
+      } else {
+        snprintf(speed, sizeof(speed), s > 0 ? "%.4g/s" : "max", s);
+      }
+      snprintf(status, sizeof(status), "%s  generation = %lld  speed = %s  %s",
+               paused ? "[ENTER] run  [n] step  [e] exit"
+                      : "[ENTER] pause  [+/-] speed  [e] exit",
+               frames[front].generation, speed, frames[front].note);
+      PROF_ENTER(PROF_RENDER);
+      render_frame(status, frames[front].cells);
+      PROF_LEAVE(PROF_RENDER, (double)row * col);
+      waiting = 0;
+      next_frame = now + 1 / frame_rate;
+    }
+    if (!waiting && !paused && now >= next_frame) {
+      sim_control(-1, 0, 1, 0);
+      waiting = 1;
+    }
+    int timeout = waiting  ? 2
+                  : paused ? -1
+                           : (int)((next_frame - now) * 1000) + 1;
+    int key = read_key(timeout);
+    if (key == '\r' || key == '\n' || key == ' ') {
+      paused = !paused;
+      gen0 = frames[front].generation, time0 = now;
+      sim_control(paused, 0, 1, 0);
+      waiting = 1;
+    } else if (key == 'n' && paused) {
+      sim_control(-1, 1, 0, 0);
+      waiting = 1;
+    } else if (key == '+' || key == '-') {
+      pthread_mutex_lock(&run_lock);
+      if (key == '+' && sim_speed > 0 && sim_speed < 1e9) {
+        sim_speed *= 2;
+      } else if (key == '-' && sim_speed > 0.001) {
+        sim_speed /= 2;
       }
+      pthread_mutex_unlock(&run_lock);
+      sim_control(-1, 0, 1, 0);
+      waiting = 1;
+    } else if (key == 'e' || key == 'q' || key == KEY_EOF) {
+      break;
+    }
+  }
+  sim_control(-1, 0, 0, 1);
+  pthread_join(sim, NULL);
+  for (int k = 0; k < 3; ++k) {
+    aligned_free(frames[k].cells);
+  }
+  term_raw(0);
+  clear_screen();
+  printf("--> You have returned to the normal mode.\n");
+}
+
+/**
+ * @brief
+ * 连续生成 n 代，中间不显示地图。选用最快的方式：查表引擎换成结果相同的按位并行引擎；
+ * infinite 边界下的按位并行引擎在 n 不少于 JUMP_MIN 时把整个无限平面转入 HashLife
+ * 四叉树，前进后再转回；
+ * HashLife 引擎一次前进多代；检测到灭绝、静物或振荡后跳过余下的整周期。每次前进的代数从 1
+ * 起倍增，使每次约耗时 0.05 秒，其间每 0.25 秒在同一行刷新进度、每秒代数与预计剩余时间。标准输入为终端时每次之后检查按键，任意键取消；生成失败（无限平面内存不足）时同样停下。
+ *
+ * @param n 代数
+ */
+void fast_forward(long long n) {
+  if (!is_map) {
+    is_map_error();
+    return;
+  }
+  int saved = engine;
+  int plane = engine == ENGINE_BITWISE && boundary == BOUNDARY_INFINITE &&
+              n >= JUMP_MIN;
+  if (engine == ENGINE_LUT) {
+    engine = ENGINE_BITWISE;
+  }
+  if (plane) {
+    hl_from_plane();
+  }
+  long long done = 0, chunk = 1, start_gen = generation;
+  double start = now_seconds(), shown = start;
+  int cancelled = 0, keys = isatty(STDIN_FILENO);
+  term_raw(keys);
+  while (done < n) {
+    long long step = chunk < n - done ? chunk : n - done;
+    double t = now_seconds();
+    if (plane) {
+      hl_advance((uint64_t)step);
+      generation += step;
     } else {
-      printf("\nPress ENTER to restart or use [\\e] to exit auto_run mode.\n");
-      get_input(buff);
-      get_command(buff, s1, s2);
-      if (strcmp(s1, EXIT) == 0 && strcmp(s2, EMPTY) == 0) {
-        system("cls");
-        printf("--> You have returned to the normal mode.\n");
+      advance(step);
+      if (generation != start_gen + done + step) {
+        cancelled = 1;
         break;
-      } else if (strcmp(s1, EMPTY) == 0) {
-        is_run = 1;
-      } else {
-        printf("auto_run: error: input error");
       }
     }
+    done += step;
+    double now = now_seconds();
+    if (now - t < 0.05) {
+      chunk *= 2;
+    } else if (now - t > 0.2 && chunk > 1) {
+      chunk /= 2;
+    }
+    if (now - shown >= 0.25 || done == n) {
+      double rate = done / (now - start > 1e-9 ? now - start : 1e-9);
+      printf("\rgeneration = %lld  %lld / %lld  %.4g generations/s  ETA %.1f s"
+             "  (press any key to cancel)  ",
+             generation, done, n, rate, (n - done) / rate);
+      fflush(stdout);
+      shown = now;
+    }
+    if (keys && done < n && read_key(0) >= 0) {
+      cancelled = 1;
+      break;
+    }
+  }
+  term_raw(0);
+  if (plane) {
+    if (hl_to_plane()) {
+      pl_to_map();
+    }
+    hl_reset();
+    mark_all_tiles();
+    if (stats_on) {
+      scan_stats();
+    }
+  }
+  engine = saved;
+  double secs = now_seconds() - start;
+  char note[LEN];
+  printf("\n%s: %lld generations in %.3f s (%.4g generations/s), generation = "
+         "%lld\n",
+         cancelled ? "cancelled" : "done", generation - start_gen, secs,
+         (generation - start_gen) / (secs > 1e-9 ? secs : 1e-9), generation);
+  if (describe_history(note)) {
+    printf("%s\n", note);
+  }
+  print_map();
+}
+
+/**
+ * @brief 生成命令：无参数时生成下一代，有参数时由 fast_forward 连续生成 N 代。
+ *
+ * @param arg 正整数或空
+ */
+void generate_command(char *arg) {
+  if (strcmp(arg, EMPTY) == 0) {
+    generate_next_status();
+    print_map();
+    return;
+  }
+  char *end;
+  long long n = strtoll(arg, &end, 10);
+  if (*end != '\0' || n <= 0) {
+    printf("generate: error: expected a positive number of generations\n");
+    return;
+  } else if (n > GENS_MAX) {
+    printf("generate: error: at most %lld generations at a time\n", GENS_MAX);
+    return;
+  }
+  fast_forward(n);
+}
+
+/**
+ * @brief 自动运行命令：无参数时进入自动运行模式， --to GEN 表示全速运行到第 GEN 代后暂停。
+ *
+ * @param arg --to GEN 或空
+ */
+void run_command(char *arg) {
+  if (strcmp(arg, EMPTY) == 0) {
+    auto_run(-1);
+    return;
+  }
+  char *end = arg;
+  long long to = -1;
+  if (strncmp(arg, "--to", 4) == 0 && (arg[4] == ' ' || arg[4] == '\t')) {
+    to = strtoll(arg + 5, &end, 10);
+  }
+  if (to < 0 || end == arg + 5 || *end != '\0') {
+    printf("run: error: expected [\\r] or [\\r --to <generation>]\n");
+    return;
+  }
+  if (is_map && to <= generation) {
+    printf("run: error: already at generation %lld\n", generation);
+    return;
   }
+  auto_run(to);
 }
 
 /**